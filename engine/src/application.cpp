@@ -32,11 +32,21 @@ namespace triton
         : iObject(context), _title(title), _fullscreen(fullscreen)
     {
         cInput* input = context->GetSubsystem<cInput>();
+        const sCapabilities* caps = context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+
+        glm::vec2 windowSize = glm::vec2(width, height);
+
+        // Headless graphics records commands only, no window and no GL context
+        if (caps->headlessGraphics == K_TRUE)
+        {
+            _width = windowSize.x;
+            _height = windowSize.y;
 
-        if (input->_initialized == K_FALSE)
             return;
+        }
 
-        glm::vec2 windowSize = glm::vec2(width, height);
+        if (input->_initialized == K_FALSE)
+            return;
 
         if (fullscreen == K_FALSE)
         {
@@ -75,7 +85,8 @@ namespace triton
 
     cWindow::~cWindow()
     {
-        glfwDestroyWindow(_window);
+        if (_window != nullptr)
+            glfwDestroyWindow(_window);
     }
 
     void cWindow::Resize(const glm::vec2& size)
@@ -86,21 +97,29 @@ namespace triton
 
     void cWindow::SwapBuffers()
     {
-        glfwSwapBuffers(_window);
+        if (_window != nullptr)
+            glfwSwapBuffers(_window);
     }
 
     void cWindow::PollEvents()
     {
-        glfwPollEvents();
+        if (_window != nullptr)
+            glfwPollEvents();
     }
 
     types::boolean cWindow::GetRunState() const
     {
+        if (_window == nullptr)
+            return K_FALSE;
+
         return glfwWindowShouldClose(_window);
     }
 
     HWND cWindow::GetWin32Window() const
     {
+        if (_window == nullptr)
+            return nullptr;
+
         return glfwGetWin32Window(_window);
     }
 
@@ -108,7 +127,8 @@ namespace triton
     {
         f64 x = 0;
         f64 y = 0;
-        glfwGetCursorPos(_window, &x, &y);
+        if (_window != nullptr)
+            glfwGetCursorPos(_window, &x, &y);
 
         return cVector2((f32)x, (f32)y);
     }
@@ -18,7 +18,24 @@ namespace triton
 {
     cCameraSystem::cCameraSystem(cContext* context) : cSystem(context) {}
 
-    void cCameraSystem::OnFrameUpdate(cStack<ecs::cScene>* scenes) {}
+    void cCameraSystem::OnFrameUpdate(cStack<ecs::cScene>* scenes)
+    {
+        const iApplication* app = _context->GetSubsystem<cEngine>()->GetApplication();
+        const sCapabilities* caps = app->GetCapabilities();
+        const cWindow* window = app->GetWindow();
+        const f32 width = window != nullptr ? (f32)window->GetWidth() : (f32)caps->windowWidth;
+        const f32 height = window != nullptr ? (f32)window->GetHeight() : (f32)caps->windowHeight;
+
+        // Minimized windows have no size, keep last frame's projection
+        if (width > 0.0f && height > 0.0f)
+        {
+            _camera._projection = cMatrix4(_camera._fov, width / height, _camera._zNear, _camera._zFar);
+            _camera._viewProjection = _camera._projection * _camera._view;
+        }
+
+        cGraphics* gfx = _context->GetSubsystem<cGraphics>();
+        gfx->UpdateLights(_camera._view, _camera._projection, _camera._zNear, _camera._zFar);
+    }
 
     /*void cCamera::Update()
     {
@@ -5,6 +5,7 @@
 #include "../../thirdparty/glm/glm/glm.hpp"
 #include "category.hpp"
 #include "component.hpp"
+#include "components.hpp"
 #include "system.hpp"
 #include "math.hpp"
 #include "types.hpp"
@@ -19,6 +20,7 @@ namespace triton
         explicit cCameraSystem(cContext* context);
         virtual ~cCameraSystem() override final = default;
 
+        // Builds the projection of the camera and culls the lights of cGraphics into its froxel grid
         virtual void OnFrameUpdate(cStack<ecs::cScene>* scenes) override;
 
         void Update();
@@ -26,5 +28,10 @@ namespace triton
         void Move(types::f32 value);
         void Strafe(types::f32 value);
         void Lift(types::f32 value);
+
+        inline ecs::components::sCameraComponent* GetCamera() { return &_camera; }
+
+    private:
+        ecs::components::sCameraComponent _camera = {};
     };
 }
\ No newline at end of file
@@ -11,6 +11,7 @@ namespace triton
         types::usize windowWidth = 640;
         types::usize windowHeight = 480;
         types::boolean fullscreen = types::K_FALSE;
+        types::boolean headlessGraphics = types::K_FALSE;
         types::usize memoryAlignment = 64;
         types::usize maxPhysicsSceneCount = 16;
         types::usize maxPhysicsMaterialCount = 256;
@@ -22,10 +23,29 @@ namespace triton
         types::usize maxRenderTransparentInstanceCount = 65536;
         types::usize maxRenderTextInstanceCount = 8192;
         types::usize maxRenderMaterialCount = 256;
-        types::usize maxRenderLightCount = 256;
+        types::usize maxRenderLightCount = 4096;
         types::usize maxRenderTextureAtlasTextureCount = 8192;
+        types::usize maxRenderDrawCommandCount = 4096;
+        // Froxel grid of the clustered light culling, depth slices are exponential between the camera planes
+        types::usize lightClusterCountX = 16;
+        types::usize lightClusterCountY = 9;
+        types::usize lightClusterCountZ = 24;
+        types::usize maxLightClusterIndexCount = 262144;
+        std::string shaderCachePath = "cache/shaders";
+        // Shader files are checked for changes every frame and the shaders using them are rebuilt
+        types::boolean shaderHotReload = types::K_FALSE;
+        // cGraphics prints how long it took to start and how many shader programs it compiled, loaded or shared
+        types::boolean printStartupStats = types::K_FALSE;
+        types::usize maxTransformCount = 131072;
+        types::usize maxCullingObjectCount = 131072;
+        types::usize maxOccluderTriangleCount = 16384;
+        types::usize occlusionBufferWidth = 256;
+        types::usize occlusionBufferHeight = 128;
         types::usize vertexBufferSize = 64 * 1024 * 1024;
         types::usize indexBufferSize = 64 * 1024 * 1024;
+        types::usize maxGeometryCount = 16384;
+        types::usize geometryDefragmentByteSizePerFrame = 1024 * 1024;
+        types::boolean keepGeometryCPUCopy = types::K_TRUE;
         types::usize hashTableChunkByteSize = 16 * 1024;
         types::usize hashTableMaxChunkCount = 256;
         types::usize hashTableSize = 4096;
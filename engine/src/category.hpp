@@ -24,6 +24,8 @@ namespace triton
         RENDER_PATH_TRANSPARENT = 15,
         RENDER_PATH_TEXT = 16,
         RENDER_PATH_TRANSPARENT_COMPOSITE = 17,
-        RENDER_PATH_QUAD = 18
+        RENDER_PATH_QUAD = 18,
+        VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2 = 19,
+        VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2 = 20
     };
 }
\ No newline at end of file
@@ -0,0 +1,337 @@
+// culling_system.cpp
+
+#include <cstring>
+#include "culling_system.hpp"
+#include "render_context.hpp"
+#include "mesh_optimizer.hpp"
+#include "simd.hpp"
+#include "graphics.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+	static constexpr usize kBoundsChunkByteSize = 64 * 1024;
+
+	// Gribb-Hartmann extraction for GL clip space, planes are normalized so the sphere test can use the radius directly
+	static void ExtractFrustumPlanes(const cMatrix4& viewProjection, glm::vec4* planes)
+	{
+		const f32* m = viewProjection.GetData();
+		const glm::vec4 row0 = glm::vec4(m[0], m[4], m[8], m[12]);
+		const glm::vec4 row1 = glm::vec4(m[1], m[5], m[9], m[13]);
+		const glm::vec4 row2 = glm::vec4(m[2], m[6], m[10], m[14]);
+		const glm::vec4 row3 = glm::vec4(m[3], m[7], m[11], m[15]);
+
+		planes[0] = row3 + row0;
+		planes[1] = row3 - row0;
+		planes[2] = row3 + row1;
+		planes[3] = row3 - row1;
+		planes[4] = row3 + row2;
+		planes[5] = row3 - row2;
+
+		for (usize i = 0; i < 6; i++)
+		{
+			const f32 length = glm::length(glm::vec3(planes[i]));
+			if (length > 0.0f)
+				planes[i] /= length;
+		}
+	}
+
+	cFrustumCulling::cFrustumCulling(cContext* context) : iObject(context)
+	{
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		_maxObjectCount = caps->maxCullingObjectCount;
+
+		// cSoA pads every field array to 64 bytes, leave room for that when sizing the chunk limit
+		const usize elementByteSize = 8 * sizeof(f32) + sizeof(u32);
+		const usize elementCountPerChunk = (kBoundsChunkByteSize - cCullingBounds::kFieldCount * cCullingBounds::kFieldAlignment) / elementByteSize;
+
+		sChunkAllocatorDescriptor boundsAllocatorDesc = {};
+		boundsAllocatorDesc.chunkByteSize = kBoundsChunkByteSize;
+		boundsAllocatorDesc.maxChunkCount = _maxObjectCount / (elementCountPerChunk & ~(cCullingBounds::kElementGranularity - 1)) + 1;
+		_bounds = _context->Create<cCullingBounds>(_context, boundsAllocatorDesc);
+
+		_objectToSlot = (u32*)memoryAllocator->Allocate(_maxObjectCount * sizeof(u32), caps->memoryAlignment);
+		memset(_objectToSlot, 0xFF, _maxObjectCount * sizeof(u32));
+	}
+
+	cFrustumCulling::~cFrustumCulling()
+	{
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		memoryAllocator->Deallocate(_objectToSlot);
+
+		_context->Destroy<cCullingBounds>(_bounds);
+	}
+
+	void cFrustumCulling::Add(u32 objectIndex, const sVertexBufferGeometry* geometry)
+	{
+		Add(objectIndex, geometry->_boundingSphere);
+	}
+
+	void cFrustumCulling::Add(u32 objectIndex, const glm::vec4& localSphere)
+	{
+		if (objectIndex >= _maxObjectCount)
+		{
+			Print("Error: culling object index is out of range!");
+			return;
+		}
+
+		const u32 slot = _objectToSlot[objectIndex];
+		if (slot != kInvalidSlot)
+		{
+			_bounds->Get<0>(slot) = localSphere.x;
+			_bounds->Get<1>(slot) = localSphere.y;
+			_bounds->Get<2>(slot) = localSphere.z;
+			_bounds->Get<3>(slot) = localSphere.w;
+
+			return;
+		}
+
+		_objectToSlot[objectIndex] = _bounds->Push(
+			localSphere.x, localSphere.y, localSphere.z, localSphere.w,
+			localSphere.x, localSphere.y, localSphere.z, localSphere.w,
+			objectIndex
+		);
+	}
+
+	void cFrustumCulling::Remove(u32 objectIndex)
+	{
+		if (objectIndex >= _maxObjectCount || _objectToSlot[objectIndex] == kInvalidSlot)
+			return;
+
+		const u32 slot = _objectToSlot[objectIndex];
+		const u32 lastSlot = (u32)_bounds->GetSize() - 1;
+		const u32 lastObjectIndex = _bounds->Get<8>(lastSlot);
+
+		_bounds->Erase(slot);
+		_objectToSlot[objectIndex] = kInvalidSlot;
+		if (slot != lastSlot)
+			_objectToSlot[lastObjectIndex] = slot;
+	}
+
+	void cFrustumCulling::UpdateBounds(const glm::mat4* worlds)
+	{
+		_bounds->ForEachChunk([worlds](usize count, f32* localX, f32* localY, f32* localZ, f32* localRadius, f32* x, f32* y, f32* z, f32* radius, u32* objects) {
+			for (usize i = 0; i < count; i++)
+			{
+				const glm::mat4& world = worlds[objects[i]];
+				const glm::vec4 center = world * glm::vec4(localX[i], localY[i], localZ[i], 1.0f);
+				const f32 scaleSquared = glm::max(
+					glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+					glm::max(glm::dot(glm::vec3(world[1]), glm::vec3(world[1])), glm::dot(glm::vec3(world[2]), glm::vec3(world[2])))
+				);
+
+				x[i] = center.x;
+				y[i] = center.y;
+				z[i] = center.z;
+				radius[i] = localRadius[i] * glm::sqrt(scaleSquared);
+			}
+		});
+	}
+
+	usize cFrustumCulling::Cull(const cMatrix4& viewProjection, u32* visibleObjects) const
+	{
+		glm::vec4 planes[6];
+		ExtractFrustumPlanes(viewProjection, planes);
+
+		usize visibleCount = 0;
+
+		_bounds->ForEachChunk([&planes, &visibleCount, visibleObjects](usize count, f32*, f32*, f32*, f32*, f32* x, f32* y, f32* z, f32* radius, u32* objects) {
+			usize i = 0;
+
+#if defined(TRITON_SIMD_AVX2)
+			// Chunk arrays are sized in multiples of 8, the tail lanes are masked out below. Loads are unaligned like the
+			// light culling ones, so the test doesn't depend on how the chunks were allocated
+			__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+			for (usize p = 0; p < 6; p++)
+			{
+				planeX[p] = _mm256_set1_ps(planes[p].x);
+				planeY[p] = _mm256_set1_ps(planes[p].y);
+				planeZ[p] = _mm256_set1_ps(planes[p].z);
+				planeW[p] = _mm256_set1_ps(planes[p].w);
+			}
+
+			for (; i < count; i += 8)
+			{
+				const __m256 centerX = _mm256_loadu_ps(x + i);
+				const __m256 centerY = _mm256_loadu_ps(y + i);
+				const __m256 centerZ = _mm256_loadu_ps(z + i);
+				const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (usize p = 0; p < 6; p++)
+				{
+					__m256 distance = _mm256_fmadd_ps(planeX[p], centerX, planeW[p]);
+					distance = _mm256_fmadd_ps(planeY[p], centerY, distance);
+					distance = _mm256_fmadd_ps(planeZ[p], centerZ, distance);
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+				}
+
+				qword mask = (qword)_mm256_movemask_ps(inside);
+				if (count - i < 8)
+					mask &= (1ull << (count - i)) - 1;
+
+				while (mask != 0)
+				{
+					visibleObjects[visibleCount++] = objects[i + cMath::CountTrailingZeros(mask)];
+					mask &= mask - 1;
+				}
+			}
+#elif defined(TRITON_SIMD_SSE)
+			// Same test 4 spheres at a time, chunk arrays are sized in multiples of 8 so the last load stays inside
+			__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+			for (usize p = 0; p < 6; p++)
+			{
+				planeX[p] = _mm_set1_ps(planes[p].x);
+				planeY[p] = _mm_set1_ps(planes[p].y);
+				planeZ[p] = _mm_set1_ps(planes[p].z);
+				planeW[p] = _mm_set1_ps(planes[p].w);
+			}
+
+			for (; i < count; i += 4)
+			{
+				const __m128 centerX = _mm_loadu_ps(x + i);
+				const __m128 centerY = _mm_loadu_ps(y + i);
+				const __m128 centerZ = _mm_loadu_ps(z + i);
+				const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+				__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (usize p = 0; p < 6; p++)
+				{
+					__m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], centerX), planeW[p]);
+					distance = _mm_add_ps(_mm_mul_ps(planeY[p], centerY), distance);
+					distance = _mm_add_ps(_mm_mul_ps(planeZ[p], centerZ), distance);
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+				}
+
+				qword mask = (qword)_mm_movemask_ps(inside);
+				if (count - i < 4)
+					mask &= (1ull << (count - i)) - 1;
+
+				while (mask != 0)
+				{
+					visibleObjects[visibleCount++] = objects[i + cMath::CountTrailingZeros(mask)];
+					mask &= mask - 1;
+				}
+			}
+#else
+			for (; i < count; i++)
+			{
+				boolean inside = K_TRUE;
+				for (usize p = 0; p < 6 && inside == K_TRUE; p++)
+				{
+					if (planes[p].x * x[i] + planes[p].y * y[i] + planes[p].z * z[i] + planes[p].w < -radius[i])
+						inside = K_FALSE;
+				}
+
+				visibleObjects[visibleCount] = objects[i];
+				visibleCount += inside == K_TRUE ? 1 : 0;
+			}
+#endif
+		});
+
+		return visibleCount;
+	}
+
+	cClusterCulling::cClusterCulling(cContext* context) : iObject(context) {}
+
+	usize cClusterCulling::Cull(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const u32* objects, usize count, const cMatrix4& viewProjection, const glm::vec3& cameraPosition, boolean useBackfaceCulling, sDrawIndirectCommand* commands, usize maxCommandCount)
+	{
+		glm::vec4 planes[6];
+		ExtractFrustumPlanes(viewProjection, planes);
+
+		_testedMeshletCount = 0;
+		_visibleMeshletCount = 0;
+		_visibleTriangleCount = 0;
+
+		usize commandCount = 0;
+		for (usize i = 0; i < count; i++)
+		{
+			const usize object = objects != nullptr ? objects[i] : i;
+			const sVertexBufferGeometry* geometry = geometries[object];
+			if (geometry == nullptr)
+				continue;
+
+			const u32 firstIndex = (u32)(geometry->_offsetIndex / sizeof(u32));
+			if (geometry->_meshletCount == 0)
+			{
+				if (commandCount >= maxCommandCount)
+				{
+					Print("Error: cluster culling command limit reached, extra meshlets are skipped!");
+					return commandCount;
+				}
+
+				commands[commandCount++] = { (u32)geometry->_indexCount, 1, firstIndex, (s32)geometry->_offsetVertex, (u32)i };
+				_visibleTriangleCount += geometry->_indexCount / 3;
+				continue;
+			}
+
+			const glm::mat4& world = worlds[object];
+			const glm::mat3 rotation = glm::mat3(world);
+			const f32 scale = glm::sqrt(glm::max(
+				glm::dot(rotation[0], rotation[0]),
+				glm::max(glm::dot(rotation[1], rotation[1]), glm::dot(rotation[2], rotation[2]))
+			));
+
+			// Visible meshlets of this object extend the last command while they stay adjacent in the index buffer
+			const usize objectFirstCommand = commandCount;
+			for (usize m = 0; m < geometry->_meshletCount; m++)
+			{
+				const sMeshlet& meshlet = geometry->_meshlets[m];
+				const glm::vec3 center = glm::vec3(world * glm::vec4(meshlet.center[0], meshlet.center[1], meshlet.center[2], 1.0f));
+				const f32 radius = meshlet.radius * scale;
+
+				_testedMeshletCount += 1;
+
+				boolean visible = K_TRUE;
+				for (usize p = 0; p < 6 && visible == K_TRUE; p++)
+				{
+					if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius)
+						visible = K_FALSE;
+				}
+
+				// Every triangle faces away when the view direction to the whole sphere is inside the cone turned around
+				if (visible == K_TRUE && useBackfaceCulling == K_TRUE && meshlet.coneCutoff < 1.0f)
+				{
+					const glm::vec3 axis = glm::normalize(rotation * glm::vec3(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]));
+					const glm::vec3 view = center - cameraPosition;
+					if (glm::dot(view, axis) >= meshlet.coneCutoff * glm::length(view) + radius)
+						visible = K_FALSE;
+				}
+
+				if (visible == K_FALSE)
+					continue;
+
+				_visibleMeshletCount += 1;
+				_visibleTriangleCount += meshlet.indexCount / 3;
+
+				if (commandCount > objectFirstCommand)
+				{
+					sDrawIndirectCommand& last = commands[commandCount - 1];
+					if (last.firstIndex + last.indexCount == firstIndex + meshlet.firstIndex)
+					{
+						last.indexCount += meshlet.indexCount;
+						continue;
+					}
+				}
+
+				if (commandCount >= maxCommandCount)
+				{
+					Print("Error: cluster culling command limit reached, extra meshlets are skipped!");
+					return commandCount;
+				}
+
+				commands[commandCount++] = { meshlet.indexCount, 1, firstIndex + meshlet.firstIndex, (s32)geometry->_offsetVertex, (u32)i };
+			}
+		}
+
+		return commandCount;
+	}
+}
\ No newline at end of file
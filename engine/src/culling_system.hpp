@@ -0,0 +1,79 @@
+// culling_system.hpp
+
+#pragma once
+
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "object.hpp"
+#include "soa.hpp"
+#include "math.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+	struct sVertexBufferGeometry;
+
+	// local sphere x, y, z, radius, world sphere x, y, z, radius, object index
+	using cCullingBounds = cSoA<types::f32, types::f32, types::f32, types::f32, types::f32, types::f32, types::f32, types::f32, types::u32>;
+
+	// Bounding spheres are kept SoA so Cull tests 8 objects per iteration, 4 without AVX2, against the 6 frustum planes
+	// and writes the indices of the visible ones into a compacted list. Object indices are whatever the
+	// caller uses for its world matrices and materials, the visible list feeds WriteObjectsTo*Buffers as is.
+	class cFrustumCulling : public iObject
+	{
+		TRITON_OBJECT(cFrustumCulling)
+
+	public:
+		explicit cFrustumCulling(cContext* context);
+		virtual ~cFrustumCulling() override final;
+
+		void Add(types::u32 objectIndex, const sVertexBufferGeometry* geometry);
+		void Add(types::u32 objectIndex, const glm::vec4& localSphere);
+		void Remove(types::u32 objectIndex);
+		// worlds are indexed by object index
+		void UpdateBounds(const glm::mat4* worlds);
+		// Returns visible object count, visibleObjects must hold GetSize() entries
+		types::usize Cull(const cMatrix4& viewProjection, types::u32* visibleObjects) const;
+
+		inline types::usize GetSize() const { return _bounds->GetSize(); }
+
+	private:
+		static constexpr types::u32 kInvalidSlot = 0xFFFFFFFF;
+
+	private:
+		types::usize _maxObjectCount = 0;
+		cCullingBounds* _bounds = nullptr;
+		types::u32* _objectToSlot = nullptr;
+	};
+
+	struct sDrawIndirectCommand;
+
+	// Per meshlet frustum and backface cone test for the objects that survived cFrustumCulling. Visible
+	// meshlets become indirect draws of their index range, neighbouring visible meshlets of an object are
+	// merged into one range. Object i of the list is instance i of the instance buffer, the same order
+	// WriteObjectsToOpaqueBuffers uses, so it goes out as the base instance. Geometries without meshlets
+	// are drawn whole, meshlets always cover LOD 0. The cone test drops meshlets whose counter-clockwise
+	// triangles all face away, it only runs for passes that cull back faces, the rasterizer would draw
+	// those triangles otherwise.
+	class cClusterCulling : public iObject
+	{
+		TRITON_OBJECT(cClusterCulling)
+
+	public:
+		explicit cClusterCulling(cContext* context);
+		virtual ~cClusterCulling() override final = default;
+
+		// geometries and worlds are indexed by object, objects may be nullptr for 0..count-1. useBackfaceCulling is
+		// the flag of the pass the commands are drawn with. Returns the command count.
+		types::usize Cull(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const types::u32* objects, types::usize count, const cMatrix4& viewProjection, const glm::vec3& cameraPosition, types::boolean useBackfaceCulling, sDrawIndirectCommand* commands, types::usize maxCommandCount);
+
+		// Meshlets of the last Cull
+		inline types::usize GetTestedMeshletCount() const { return _testedMeshletCount; }
+		inline types::usize GetVisibleMeshletCount() const { return _visibleMeshletCount; }
+		inline types::usize GetVisibleTriangleCount() const { return _visibleTriangleCount; }
+
+	private:
+		types::usize _testedMeshletCount = 0;
+		types::usize _visibleMeshletCount = 0;
+		types::usize _visibleTriangleCount = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+// draw_list.cpp
+
+#include <cstring>
+#include "draw_list.hpp"
+#include "thread_manager.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    static inline u64 MakeFieldMask(usize bitCount)
+    {
+        return (1ull << bitCount) - 1;
+    }
+
+    cDrawList::cDrawList(cContext* context, const sDrawListDescriptor& desc) : iObject(context), _desc(desc)
+    {
+        const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+        _passShift = 64 - kPassBitCount;
+        if (_desc.keyLayout == sDrawListDescriptor::eKeyLayout::STATE_FIRST)
+        {
+            _shaderShift = _passShift - kShaderBitCount;
+            _geometryShift = _shaderShift - kGeometryBitCount;
+            _lodShift = _geometryShift - kLodBitCount;
+            _materialShift = _lodShift - kMaterialBitCount;
+            _depthShift = 0;
+        }
+        else
+        {
+            _depthShift = _passShift - kDepthBitCount;
+            _shaderShift = _depthShift - kShaderBitCount;
+            _geometryShift = _shaderShift - kGeometryBitCount;
+            _lodShift = _geometryShift - kLodBitCount;
+            _materialShift = 0;
+        }
+
+        _batchMask = (MakeFieldMask(kPassBitCount) << _passShift) |
+            (MakeFieldMask(kShaderBitCount) << _shaderShift) |
+            (MakeFieldMask(kGeometryBitCount) << _geometryShift) |
+            (MakeFieldMask(kLodBitCount) << _lodShift);
+
+        _items = (sDrawItem*)memoryAllocator->Allocate(_desc.maxItemCount * sizeof(sDrawItem), caps->memoryAlignment);
+        _scratch = (sDrawItem*)memoryAllocator->Allocate(_desc.maxItemCount * sizeof(sDrawItem), caps->memoryAlignment);
+        _sortedObjects = (u32*)memoryAllocator->Allocate(_desc.maxItemCount * sizeof(u32), caps->memoryAlignment);
+        _batches = (sDrawBatch*)memoryAllocator->Allocate(_desc.maxItemCount * sizeof(sDrawBatch), caps->memoryAlignment);
+    }
+
+    cDrawList::~cDrawList()
+    {
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+        memoryAllocator->Deallocate(_batches);
+        memoryAllocator->Deallocate(_sortedObjects);
+        memoryAllocator->Deallocate(_scratch);
+        memoryAllocator->Deallocate(_items);
+    }
+
+    u64 cDrawList::MakeKey(u32 pass, u32 shader, u32 geometry, u32 lod, u32 material, f32 depth) const
+    {
+        // A masked field would alias another shader or geometry and merge their draws into one batch
+        if (pass >= MakeFieldMask(kPassBitCount) || shader > MakeFieldMask(kShaderBitCount) || geometry > MakeFieldMask(kGeometryBitCount) ||
+            lod > MakeFieldMask(kLodBitCount) || material > MakeFieldMask(kMaterialBitCount))
+        {
+            Print("Error: draw key field is out of range, the draw is skipped!");
+            return kInvalidKey;
+        }
+
+        const u64 depthMask = MakeFieldMask(kDepthBitCount);
+        u64 depthBits = 0;
+        if (_desc.depthOrder != sDrawListDescriptor::eDepthOrder::NONE)
+        {
+            const f32 clampedDepth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+            depthBits = (u64)(clampedDepth * (f32)depthMask);
+            if (_desc.depthOrder == sDrawListDescriptor::eDepthOrder::BACK_TO_FRONT)
+                depthBits = depthMask - depthBits;
+        }
+
+        return ((u64)pass << _passShift) |
+            ((u64)shader << _shaderShift) |
+            ((u64)geometry << _geometryShift) |
+            ((u64)lod << _lodShift) |
+            ((u64)material << _materialShift) |
+            (depthBits << _depthShift);
+    }
+
+    void cDrawList::Clear()
+    {
+        _size = 0;
+        _batchCount = 0;
+    }
+
+    void cDrawList::Push(u64 key, u32 object)
+    {
+        if (_size >= _desc.maxItemCount)
+        {
+            Print("Error: draw list is full!");
+            return;
+        }
+
+        sDrawItem& item = _items[_size++];
+        item.key = key;
+        item.object = object;
+    }
+
+    void cDrawList::Build(usize count, const DrawListBuildFunction& build)
+    {
+        if (_size + count > _desc.maxItemCount)
+        {
+            Print("Error: draw list is full, extra items are skipped!");
+            count = _desc.maxItemCount - _size;
+        }
+
+        sDrawItem* items = _items + _size;
+        _size += count;
+
+        cThread* threads = _context->GetSubsystem<cThread>();
+        const usize workerCount = threads != nullptr ? threads->GetThreadCount() + 1 : 1;
+        usize jobCount = (count + kMinItemCountPerJob - 1) / kMinItemCountPerJob;
+        if (jobCount > workerCount)
+            jobCount = workerCount;
+
+        if (jobCount <= 1 || threads == nullptr)
+        {
+            if (count > 0)
+                build(0, count, items);
+
+            return;
+        }
+
+        const usize countPerJob = (count + jobCount - 1) / jobCount;
+        threads->Dispatch(jobCount, [&](usize jobIndex) {
+            const usize begin = jobIndex * countPerJob;
+            const usize end = begin + countPerJob < count ? begin + countPerJob : count;
+            if (begin < end)
+                build(begin, end, items);
+        });
+    }
+
+    void cDrawList::Sort()
+    {
+        constexpr usize kBucketCount = 1ull << kRadixBitCount;
+        constexpr u64 kDigitMask = kBucketCount - 1;
+
+        // All digit histograms in one read, digits every key shares are skipped below
+        usize histograms[kRadixPassCount][kBucketCount] = {};
+        for (usize i = 0; i < _size; i++)
+        {
+            const u64 key = _items[i].key;
+            for (usize pass = 0; pass < kRadixPassCount; pass++)
+                histograms[pass][(key >> (pass * kRadixBitCount)) & kDigitMask] += 1;
+        }
+
+        sDrawItem* source = _items;
+        sDrawItem* destination = _scratch;
+        for (usize pass = 0; pass < kRadixPassCount; pass++)
+        {
+            usize* histogram = histograms[pass];
+            const usize shift = pass * kRadixBitCount;
+
+            if (_size == 0 || histogram[(source[0].key >> shift) & kDigitMask] == _size)
+                continue;
+
+            usize offset = 0;
+            for (usize bucket = 0; bucket < kBucketCount; bucket++)
+            {
+                const usize bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+
+            for (usize i = 0; i < _size; i++)
+                destination[histogram[(source[i].key >> shift) & kDigitMask]++] = source[i];
+
+            sDrawItem* swap = source;
+            source = destination;
+            destination = swap;
+        }
+
+        if (source != _items)
+            std::memcpy(_items, source, _size * sizeof(sDrawItem));
+
+        _batchCount = 0;
+        for (usize i = 0; i < _size; i++)
+        {
+            _sortedObjects[i] = _items[i].object;
+
+            if (_items[i].key == kInvalidKey)
+                continue;
+
+            if (_batchCount > 0 && ((_items[i].key ^ _batches[_batchCount - 1].key) & _batchMask) == 0)
+            {
+                _batches[_batchCount - 1].count += 1;
+                continue;
+            }
+
+            sDrawBatch& batch = _batches[_batchCount++];
+            batch.key = _items[i].key;
+            batch.first = (u32)i;
+            batch.count = 1;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+// draw_list.hpp
+
+#pragma once
+
+#include <functional>
+#include "object.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    struct sDrawItem
+    {
+        types::u64 key = 0;
+        types::u32 object = 0;
+        types::u32 padding = 0;
+    };
+
+    // Consecutive sorted items sharing pass, shader, geometry and LOD, drawn as one instanced draw
+    struct sDrawBatch
+    {
+        types::u64 key = 0;
+        types::u32 first = 0;
+        types::u32 count = 0;
+    };
+
+    struct sDrawListDescriptor
+    {
+        enum class eKeyLayout
+        {
+            // pass | shader | geometry | lod | material | depth, opaque passes
+            STATE_FIRST = 0,
+            // pass | depth | shader | geometry | lod | material, transparent passes
+            DEPTH_FIRST = 1
+        };
+
+        enum class eDepthOrder
+        {
+            NONE = 0,
+            FRONT_TO_BACK = 1,
+            BACK_TO_FRONT = 2
+        };
+
+        types::usize maxItemCount = 65536;
+        eKeyLayout keyLayout = eKeyLayout::STATE_FIRST;
+        eDepthOrder depthOrder = eDepthOrder::FRONT_TO_BACK;
+    };
+
+    using DrawListBuildFunction = std::function<void(types::usize begin, types::usize end, sDrawItem* items)>;
+
+    // Every draw is a 64 bit sort key plus the index of the object it draws. Keys are LSD radix sorted, then
+    // runs of the same pass, shader, geometry and LOD become batches. Materials come from the instance buffer in
+    // this renderer, so they only order draws inside a batch and never split one. Feed GetSortedObjects to
+    // WriteObjectsTo*Buffers so instance i of the buffers is sorted item i and batches map to base instances.
+    class cDrawList : public iObject
+    {
+        TRITON_OBJECT(cDrawList)
+
+    public:
+        static constexpr types::usize kPassBitCount = 4;
+        static constexpr types::usize kShaderBitCount = 10;
+        static constexpr types::usize kGeometryBitCount = 16;
+        static constexpr types::usize kLodBitCount = 2;
+        static constexpr types::usize kMaterialBitCount = 14;
+        static constexpr types::usize kDepthBitCount = 18;
+        // MakeKey returns it for fields out of range, Sort moves these items past the last batch so they are never drawn
+        static constexpr types::u64 kInvalidKey = 0xFFFFFFFFFFFFFFFFull;
+
+        explicit cDrawList(cContext* context, const sDrawListDescriptor& desc);
+        virtual ~cDrawList() override final;
+
+        // pass must be below 2^kPassBitCount - 1, the last value is kept for kInvalidKey, shader, geometry, lod and
+        // material must fit their bit count. lod is the one cGraphics::SelectLods picked. Depth is clamped to 0..1.
+        types::u64 MakeKey(types::u32 pass, types::u32 shader, types::u32 geometry, types::u32 lod, types::u32 material, types::f32 depth) const;
+        void Clear();
+        void Push(types::u64 key, types::u32 object);
+        // Appends count items, build fills its slice of them as a job on cThread, items[0] is the first appended item
+        void Build(types::usize count, const DrawListBuildFunction& build);
+        // Sorts by key, then fills the sorted object list and the batches
+        void Sort();
+
+        inline types::usize GetSize() const { return _size; }
+        inline const sDrawItem* GetItems() const { return _items; }
+        inline const types::u32* GetSortedObjects() const { return _sortedObjects; }
+        inline const sDrawBatch* GetBatches() const { return _batches; }
+        inline types::usize GetBatchCount() const { return _batchCount; }
+
+    private:
+        static constexpr types::usize kMinItemCountPerJob = 4096;
+        static constexpr types::usize kRadixBitCount = 8;
+        static constexpr types::usize kRadixPassCount = 64 / kRadixBitCount;
+
+    private:
+        sDrawListDescriptor _desc = {};
+        types::usize _passShift = 0;
+        types::usize _shaderShift = 0;
+        types::usize _geometryShift = 0;
+        types::usize _lodShift = 0;
+        types::usize _materialShift = 0;
+        types::usize _depthShift = 0;
+        types::u64 _batchMask = 0;
+        types::usize _size = 0;
+        sDrawItem* _items = nullptr;
+        sDrawItem* _scratch = nullptr;
+        types::u32* _sortedObjects = nullptr;
+        sDrawBatch* _batches = nullptr;
+        types::usize _batchCount = 0;
+    };
+}
\ No newline at end of file
@@ -17,6 +17,19 @@
 #include "render_context.hpp"
 #include "audio.hpp"
 #include "math.hpp"
+#include "pool.hpp"
+#include "transform_system.hpp"
+#include "instance_builder.hpp"
+#include "culling_system.hpp"
+#include "occlusion_system.hpp"
+#include "upload_ring.hpp"
+#include "draw_list.hpp"
+#include "render_graph.hpp"
+#include "offset_allocator.hpp"
+#include "mesh_optimizer.hpp"
+#include "lod_selector.hpp"
+#include "shader_preprocessor.hpp"
+#include "light_culling.hpp"
 
 using namespace types;
 
@@ -39,17 +52,36 @@ namespace triton
 		_context->RegisterFactory<cShader>();
 		_context->RegisterFactory<cTexture>();
 		_context->RegisterFactory<cRenderTarget>();
+		_context->RegisterFactory<cVertexArray>();
+		_context->RegisterFactory<cRenderPassGPU>();
 		_context->RegisterFactory<cRenderPass>();
+		_context->RegisterFactory<cPool<sVertexBufferGeometry>>();
+		_context->RegisterFactory<cTransformHierarchy>();
+		_context->RegisterFactory<cInstanceBuilder>();
+		_context->RegisterFactory<cCullingBounds>();
+		_context->RegisterFactory<cFrustumCulling>();
+		_context->RegisterFactory<cClusterCulling>();
+		_context->RegisterFactory<cOcclusionCulling>();
+		_context->RegisterFactory<cUploadRing>();
+		_context->RegisterFactory<cDrawList>();
+		_context->RegisterFactory<cRenderGraph>();
+		_context->RegisterFactory<cOffsetAllocator>();
+		_context->RegisterFactory<cMappedFile>();
+		_context->RegisterFactory<cMeshOptimizer>();
+		_context->RegisterFactory<cLodSelector>();
+		_context->RegisterFactory<cLightCulling>();
 
 		// Register subsystems
 		_context->RegisterSubsystem(this);
-		_context->RegisterSubsystem(new cGraphics(_context, cGraphics::eAPI::OGL));
+		// cGraphics expands its shaders with the preprocessor and prepares them on the workers
+		_context->RegisterSubsystem(new cThread(_context));
+		_context->RegisterSubsystem(new cFileSystem(_context));
+		_context->RegisterSubsystem(new cShaderPreprocessor(_context));
+		_context->RegisterSubsystem(new cGraphics(_context, _caps->headlessGraphics == K_TRUE ? cGraphics::eAPI::NONE_RECORDING : cGraphics::eAPI::OGL));
 		_context->RegisterSubsystem(new cInput(_context));
 		_context->RegisterSubsystem(new cTextureAtlas(_context));
-		_context->RegisterSubsystem(new cFileSystem(_context));
 		_context->RegisterSubsystem(new cFont(_context));
 		_context->RegisterSubsystem(new cPhysics(_context));
-		_context->RegisterSubsystem(new cThread(_context));
 		_context->RegisterSubsystem(new cTime(_context));
 		_context->RegisterSubsystem(new cEventDispatcher(_context));
 		_context->RegisterSubsystem(new cMath(_context));
@@ -57,6 +89,7 @@ namespace triton
 		// Create systems
 		cAudio* audioSystem = _context->Create<cAudio>(_context, cAudio::API::OAL);
 		cCameraSystem* camera = _context->Create<cCameraSystem>(_context);
+		_context->RegisterSubsystem(camera);
 
 		// Subscribe systems to core events
 		audioSystem->Subscribe(
@@ -65,6 +98,12 @@ namespace triton
 				audioSystem->OnFrameUpdate(context->GetScenes());
 			}
 		);
+		camera->Subscribe(
+			eEventType::FRAME_UPDATE,
+			[camera] (iObject* self, cContext* context, cDataBuffer* data) {
+				camera->OnFrameUpdate(context->GetScenes());
+			}
+		);
 
 		// Create texture manager
 		cTextureAtlas* texture = _context->GetSubsystem<cTextureAtlas>();
@@ -86,6 +125,7 @@ namespace triton
 		auto camera = _context->GetSubsystem<cCameraSystem>();
 		auto time = _context->GetSubsystem<cTime>();
 		auto physics = _context->GetSubsystem<cPhysics>();
+		auto events = _context->GetSubsystem<cEventDispatcher>();
 
 		cWindow* window = _app->GetWindow();
 
@@ -95,7 +135,9 @@ namespace triton
 		{
 			time->Update();
 			// physics->Simulate(); TODO: physics simulation
-			// camera->OnFrameUpdate(); TODO: camera system per frame update
+			gfx->BeginFrame();
+			// Systems update once per frame, the camera system culls the lights for this frame
+			events->Send(eEventType::FRAME_UPDATE);
 			gfx->CompositeFinal();
 			window->SwapBuffers();
 			window->PollEvents();
@@ -53,8 +53,12 @@ namespace triton
             cad.maxChunkCount = caps->hashTableMaxChunkCount;
             cad.hashTableSize = caps->hashTableSize;
 
-            cStack<cEventHandler> listener(_context, cad);
-            _listeners->Insert(type, std::move(listener));
+            listener = _listeners->Insert(type, cStack<cEventHandler>(_context, cad));
+            if (listener == nullptr)
+            {
+                Print("Error: event listener table is full!");
+                return;
+            }
         }
 
         listener->Push(_context, receiver, type, std::move(function));
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
 #include "capabilities.hpp"
 #include "memory_pool.hpp"
 #include "log.hpp"
@@ -67,10 +68,13 @@ namespace triton
 
 		object->~T();
 
-		if (object->_allocatedUsingMemAllocator == types::K_TRUE)
+		if constexpr (std::is_base_of_v<iObject, T>)
 		{
-			cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
-			memoryAllocator->Deallocate(object);
+			if (object->_allocatedUsingMemAllocator == types::K_TRUE)
+			{
+				cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+				memoryAllocator->Deallocate(object);
+			}
 		}
 	}
 
@@ -93,22 +97,39 @@ namespace triton
 	{
 		T* object = nullptr;
 
-		if (data == nullptr)
+		if constexpr (std::is_base_of_v<iObject, T>)
 		{
-			const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
-			cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
-			object = (T*)memoryAllocator->Allocate(sizeof(T), caps->memoryAlignment);
-			object->_allocatedUsingMemAllocator = types::K_TRUE;
+			if (data == nullptr)
+			{
+				const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+				cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+				object = (T*)memoryAllocator->Allocate(sizeof(T), caps->memoryAlignment);
+			}
+			else
+			{
+				object = &(((T*)data)[index]);
+			}
+
+			new (object) T(std::forward<Args>(args)...);
+
+			// Set after construction, the member initializer of iObject would reset it otherwise
+			object->_allocatedUsingMemAllocator = data == nullptr ? types::K_TRUE : types::K_FALSE;
+			object->_id = cIdentifier::Generate(T::GetTypeStatic());
 		}
 		else
 		{
-			object = &(((T*)data)[index]);
-			object->_allocatedUsingMemAllocator = types::K_FALSE;
-		}
+			// POD types carry no header, their storage is always owned by the container
+			if (data == nullptr)
+			{
+				Print("Error: can't create object of type '" + T::GetTypeStatic() + "' without storage!");
 
-		new (object) T(std::forward<Args>(args)...);
+				return nullptr;
+			}
 
-		object->_id = cIdentifier::Generate(T::GetTypeStatic());
+			object = &(((T*)data)[index]);
+
+			new (object) T(std::forward<Args>(args)...);
+		}
 
 		return object;
 	}
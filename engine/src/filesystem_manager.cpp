@@ -4,12 +4,21 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "application.hpp"
 #include "context.hpp"
 #include "filesystem_manager.hpp"
 #include "memory_pool.hpp"
 #include "buffer.hpp"
 #include "engine.hpp"
+#include "log.hpp"
 
 using namespace types;
 
@@ -46,6 +55,87 @@ namespace triton
         inputFile.read((char*)&_data[0], byteSize);
     }
 
+    cMappedFile::cMappedFile(cContext* context) : iObject(context) {}
+
+    cMappedFile::~cMappedFile()
+    {
+        Close();
+    }
+
+    boolean cMappedFile::Open(const std::string& path)
+    {
+        Close();
+
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return K_FALSE;
+
+        LARGE_INTEGER byteSize = {};
+        GetFileSizeEx(file, &byteSize);
+        if (byteSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return K_FALSE;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (data == nullptr)
+        {
+            if (mapping != nullptr)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            return K_FALSE;
+        }
+
+        _fileHandle = (void*)file;
+        _mappingHandle = (void*)mapping;
+        _byteSize = (usize)byteSize.QuadPart;
+#else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return K_FALSE;
+
+        struct stat fileStat = {};
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close(file);
+            return K_FALSE;
+        }
+
+        void* data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED)
+            return K_FALSE;
+
+        _byteSize = (usize)fileStat.st_size;
+#endif
+
+        _data = data;
+
+        return K_TRUE;
+    }
+
+    void cMappedFile::Close()
+    {
+        if (_data == nullptr)
+            return;
+
+#if defined(_WIN32)
+        UnmapViewOfFile(_data);
+        CloseHandle((HANDLE)_mappingHandle);
+        CloseHandle((HANDLE)_fileHandle);
+#else
+        munmap((void*)_data, _byteSize);
+#endif
+
+        _data = nullptr;
+        _byteSize = 0;
+        _fileHandle = nullptr;
+        _mappingHandle = nullptr;
+    }
+
     cFileSystem::cFileSystem(cContext* context) : iObject(context) {}
 
     cDataFile* cFileSystem::CreateDataFile(const std::string& path, types::boolean isText)
@@ -63,4 +153,26 @@ namespace triton
 
         _context->Destroy<cDataFile>(file);
     }
+
+    cMappedFile* cFileSystem::CreateMappedFile(const std::string& path)
+    {
+        cMappedFile* file = _context->Create<cMappedFile>(_context);
+        if (file->Open(path) == K_FALSE)
+        {
+            Print("Error: can't map file '" + path + "'!");
+            _context->Destroy<cMappedFile>(file);
+
+            return nullptr;
+        }
+
+        return file;
+    }
+
+    void cFileSystem::DestroyMappedFile(cMappedFile* file)
+    {
+        if (file == nullptr)
+            return;
+
+        _context->Destroy<cMappedFile>(file);
+    }
 }
\ No newline at end of file
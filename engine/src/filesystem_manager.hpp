@@ -25,6 +25,28 @@ namespace triton
         cDataBuffer* _data = nullptr;
     };
 
+    // Read only view of a whole file through the virtual memory system, pages are loaded on first access
+    class cMappedFile : public iObject
+    {
+        TRITON_OBJECT(cMappedFile)
+
+    public:
+        explicit cMappedFile(cContext* context);
+        virtual ~cMappedFile() override final;
+
+        types::boolean Open(const std::string& path);
+        void Close();
+
+        inline const void* GetData() const { return _data; }
+        inline types::usize GetByteSize() const { return _byteSize; }
+
+    private:
+        const void* _data = nullptr;
+        types::usize _byteSize = 0;
+        void* _fileHandle = nullptr;
+        void* _mappingHandle = nullptr;
+    };
+
     class cFileSystem : public iObject
     {
         TRITON_OBJECT(cFileSystem)
@@ -35,6 +57,9 @@ namespace triton
 
         cDataFile* CreateDataFile(const std::string& path, types::boolean isText);
         void DestroyDataFile(cDataFile* buffer);
+        // Returns nullptr when the file can't be opened
+        cMappedFile* CreateMappedFile(const std::string& path);
+        void DestroyMappedFile(cMappedFile* file);
     };
 
     void* cDataFile::GetData() const
@@ -2,6 +2,11 @@
 
 #include <GL/glew.h>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/mesh.h>
@@ -19,6 +24,18 @@
 #include "filesystem_manager.hpp"
 #include "application.hpp"
 #include "memory_pool.hpp"
+#include "pool.hpp"
+#include "instance_builder.hpp"
+#include "upload_ring.hpp"
+#include "draw_list.hpp"
+#include "render_graph.hpp"
+#include "mesh_file.hpp"
+#include "vertex_format.hpp"
+#include "mesh_optimizer.hpp"
+#include "shader_preprocessor.hpp"
+#include "light_culling.hpp"
+#include "lod_selector.hpp"
+#include "camera_system.hpp"
 #include "log.hpp"
 #include "graphics.hpp"
 #include "render_context.hpp"
@@ -28,6 +45,9 @@ using namespace types;
 
 namespace triton
 {
+    static constexpr cUniformID kViewProjectionID = cUniformID("ViewProjection");
+    static constexpr cUniformID kFontAtlasID = cUniformID("FontAtlas");
+
     sRenderInstance::sRenderInstance(s32 materialIndex, const cTransform& transform)
     {
         // TODO: Implement 2D/3D render instances
@@ -54,6 +74,19 @@ namespace triton
         }
     }
 
+    // Distance where the attenuation drops the light under 1/256, lights without falloff reach every cluster
+    static f32 GetLightRange(f32 constant, f32 linear, f32 quadratic)
+    {
+        constexpr f32 kCutoff = 256.0f;
+
+        if (quadratic > 0.0f)
+            return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * (constant - kCutoff))) / (2.0f * quadratic);
+        if (linear > 0.0f)
+            return (kCutoff - constant) / linear;
+
+        return std::numeric_limits<f32>::infinity();
+    }
+
     sLightInstance::sLightInstance(const cGameObject* object)
     {
         const sLight* light = object->GetLight();
@@ -65,17 +98,52 @@ namespace triton
             light->_attenuationConstant,
             light->_attenuationLinear,
             light->_attenuationQuadratic,
-            0.0f
+            GetLightRange(light->_attenuationConstant, light->_attenuationLinear, light->_attenuationQuadratic)
+        );
+    }
+
+    sLightInstance::sLightInstance(const glm::vec3& position, const sLight& light)
+    {
+        _position = cVector4(glm::vec4(position, 1.0f));
+        _color = cVector4(glm::vec4(light._color, 0.0f));
+        _directionAndScale = cVector4(glm::vec4(light._direction, light._scale));
+        _attenuation = cVector4(
+            light._attenuationConstant,
+            light._attenuationLinear,
+            light._attenuationQuadratic,
+            GetLightRange(light._attenuationConstant, light._attenuationLinear, light._attenuationQuadratic)
         );
     }
 
+    // Copies the range into the lowest free range below it, returns the copied byte size or 0 when it stays
+    static usize RelocateGeometryRange(iGraphicsAPI* gfx, cOffsetAllocator* heap, cBuffer* buffer, void* mirror, sOffsetAllocation& allocation)
+    {
+        const sOffsetAllocation newAllocation = heap->AllocateBelow(allocation);
+        if (newAllocation.node == sOffsetAllocation::kInvalidNode)
+            return 0;
+
+        const usize byteSize = heap->GetAllocationByteSize(allocation);
+        gfx->CopyBuffer(buffer, allocation.offset, buffer, newAllocation.offset, byteSize);
+        if (mirror != nullptr)
+            memcpy((void*)((usize)mirror + newAllocation.offset), (const void*)((usize)mirror + allocation.offset), byteSize);
+
+        heap->Free(allocation);
+        allocation = newAllocation;
+
+        return byteSize;
+    }
+
     cRenderPass::cRenderPass(cContext* context, sRenderPassDescriptor* desc, cRenderPassGPU* renderPass)
-        : iObject(context), _desc(desc), _renderPass(renderPass) {}
+        : iObject(context), _desc(desc), _renderPass(renderPass)
+    {
+        for (const auto& name : _desc->inputTextureNames)
+            _inputTextureIDs.emplace_back(name);
+    }
 
     void cRenderPass::ResizeViewport(const glm::vec2& size)
     {
         _desc->viewport.rect.SetZ(size.x);
-        _desc->viewport.rect.SetZ(size.y);
+        _desc->viewport.rect.SetW(size.y);
     }
 
     void cRenderPass::ResizeColorAttachments(const glm::vec2& size)
@@ -93,6 +161,8 @@ namespace triton
     
     cGraphics::cGraphics(cContext* context, eAPI api) : iObject(context)
     {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
         if (api == eAPI::NONE)
         {
             Print("Error: graphics API not selected!");
@@ -106,207 +176,269 @@ namespace triton
         else if (api == eAPI::D3D11)
         {
         }
+        else if (api == eAPI::NONE_RECORDING)
+        {
+            _gfx = new cNullGraphicsAPI(_context);
+        }
 
+        // cGraphics isn't registered as subsystem yet, use the API directly
         cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
-        iGraphicsAPI* gfx = _context->GetSubsystem<cGraphics>()->GetAPI();
+        iGraphicsAPI* gfx = _gfx;
         iApplication* app = _context->GetSubsystem<cEngine>()->GetApplication();
         const sCapabilities* caps = app->GetCapabilities();
         const cVector2 windowSize = app->GetWindow()->GetSize();
 
+        sChunkAllocatorDescriptor geometryAllocatorDesc = {};
+        _geometries = _context->Create<cPool<sVertexBufferGeometry>>(_context, geometryAllocatorDesc);
+        _instanceBuilder = _context->Create<cInstanceBuilder>(_context, caps->maxRenderMaterialCount);
+        _lightCulling = _context->Create<cLightCulling>(_context);
+        _lodSelector = _context->Create<cLodSelector>(_context, sLodSelectorDescriptor());
+
         _maxOpaqueInstanceBufferByteSize = caps->maxRenderOpaqueInstanceCount * sizeof(sRenderInstance);
         _maxTransparentInstanceBufferByteSize = caps->maxRenderTransparentInstanceCount * sizeof(sRenderInstance);
         _maxTextInstanceBufferByteSize = caps->maxRenderTextInstanceCount * sizeof(sRenderInstance);
         _maxMaterialBufferByteSize = caps->maxRenderMaterialCount * sizeof(cMaterialInstance);
-        _maxLightBufferByteSize = caps->maxRenderLightCount * sizeof(sLightInstance);
+        // The light count goes first as a uvec4
+        _maxLightBufferByteSize = sizeof(glm::uvec4) + caps->maxRenderLightCount * sizeof(sLightInstance);
         _maxTextureAtlasTexturesBufferByteSize = caps->maxRenderTextureAtlasTextureCount * sizeof(sTextureAtlasTextureGPU);
+        _maxDrawCommandCount = caps->maxRenderDrawCommandCount;
 
         _vertexBuffer = gfx->CreateBuffer(caps->vertexBufferSize, cBuffer::eType::VERTEX, 0, nullptr);
         _indexBuffer = gfx->CreateBuffer(caps->indexBufferSize, cBuffer::eType::INDEX, 0, nullptr);
-        _opaqueInstanceBuffer = gfx->CreateBuffer(_maxOpaqueInstanceBufferByteSize, cBuffer::eType::LARGE, 0, nullptr);
-        _transparentInstanceBuffer = gfx->CreateBuffer(_maxTransparentInstanceBufferByteSize, cBuffer::eType::LARGE, 0, nullptr);
         _textInstanceBuffer = gfx->CreateBuffer(_maxTextInstanceBufferByteSize, cBuffer::eType::LARGE, 0, nullptr);
-        _opaqueMaterialBuffer = gfx->CreateBuffer(_maxMaterialBufferByteSize, cBuffer::eType::LARGE, 1, nullptr);
         _textMaterialBuffer = gfx->CreateBuffer(_maxMaterialBufferByteSize, cBuffer::eType::LARGE, 1, nullptr);
-        _transparentMaterialBuffer = gfx->CreateBuffer(_maxMaterialBufferByteSize, cBuffer::eType::LARGE, 1, nullptr);
         _lightBuffer = gfx->CreateBuffer(_maxLightBufferByteSize, cBuffer::eType::LARGE, 2, nullptr);
+        _lightGridBuffer = gfx->CreateBuffer(sizeof(sLightGridHeader) + _lightCulling->GetClusterCount() * sizeof(sLightCluster), cBuffer::eType::LARGE, 4, nullptr);
+        _lightIndexBuffer = gfx->CreateBuffer(_lightCulling->GetMaxLightIndexCount() * sizeof(u32), cBuffer::eType::LARGE, 5, nullptr);
         _opaqueTextureAtlasTexturesBuffer = gfx->CreateBuffer(_maxTextureAtlasTexturesBufferByteSize, cBuffer::eType::LARGE, 3, nullptr);
         _transparentTextureAtlasTexturesBuffer = gfx->CreateBuffer(_maxTextureAtlasTexturesBufferByteSize, cBuffer::eType::LARGE, 3, nullptr);
-
-        _vertices = memoryAllocator->Allocate(caps->vertexBufferSize, caps->memoryAlignment);
-        _verticesByteSize = 0;
-        _indices = memoryAllocator->Allocate(caps->indexBufferSize, caps->memoryAlignment);
-        _indicesByteSize = 0;
-        _opaqueInstances = memoryAllocator->Allocate(_maxOpaqueInstanceBufferByteSize, caps->memoryAlignment);
-        _opaqueInstancesByteSize = 0;
-        _transparentInstances = memoryAllocator->Allocate(_maxTransparentInstanceBufferByteSize, caps->memoryAlignment);
-        _transparentInstancesByteSize = 0;
+        _opaqueDrawCommandBuffer = gfx->CreateBuffer(_maxDrawCommandCount * sizeof(sDrawIndirectCommand), cBuffer::eType::INDIRECT, 0, nullptr);
+
+        // Instances and materials change every frame, they are written straight into persistently mapped memory
+        _opaqueInstanceRing = _context->Create<cUploadRing>(_context, gfx, _maxOpaqueInstanceBufferByteSize, cBuffer::eType::LARGE, 0);
+        _transparentInstanceRing = _context->Create<cUploadRing>(_context, gfx, _maxTransparentInstanceBufferByteSize, cBuffer::eType::LARGE, 0);
+        _opaqueMaterialRing = _context->Create<cUploadRing>(_context, gfx, _maxMaterialBufferByteSize, cBuffer::eType::LARGE, 1);
+        _transparentMaterialRing = _context->Create<cUploadRing>(_context, gfx, _maxMaterialBufferByteSize, cBuffer::eType::LARGE, 1);
+        _opaqueInstanceBuffer = _opaqueInstanceRing->GetBuffer();
+        _transparentInstanceBuffer = _transparentInstanceRing->GetBuffer();
+        _opaqueMaterialBuffer = _opaqueMaterialRing->GetBuffer();
+        _transparentMaterialBuffer = _transparentMaterialRing->GetBuffer();
+
+        // Vertex ranges are aligned to a multiple of every vertex stride so offsets stay whole vertices
+        _vertexHeap = _context->Create<cOffsetAllocator>(_context, caps->vertexBufferSize, kVertexFormatAlignment, caps->maxGeometryCount);
+        _indexHeap = _context->Create<cOffsetAllocator>(_context, caps->indexBufferSize, sizeof(index), caps->maxGeometryCount);
+        _geometryDefragmentByteSizePerFrame = caps->geometryDefragmentByteSizePerFrame;
+        if (caps->keepGeometryCPUCopy == K_TRUE)
+        {
+            _vertices = memoryAllocator->Allocate(caps->vertexBufferSize, caps->memoryAlignment);
+            _indices = memoryAllocator->Allocate(caps->indexBufferSize, caps->memoryAlignment);
+        }
         _textInstances = memoryAllocator->Allocate(_maxTextInstanceBufferByteSize, caps->memoryAlignment);
         _textInstancesByteSize = 0;
-        _opaqueMaterials = memoryAllocator->Allocate(_maxMaterialBufferByteSize, caps->memoryAlignment);
-        _opaqueMaterialsByteSize = 0;
-        _transparentMaterials = memoryAllocator->Allocate(_maxMaterialBufferByteSize, caps->memoryAlignment);
-        _transparentMaterialsByteSize = 0;
         _textMaterials = memoryAllocator->Allocate(_maxMaterialBufferByteSize, caps->memoryAlignment);
         _textMaterialsByteSize = 0;
         _lights = memoryAllocator->Allocate(_maxLightBufferByteSize, caps->memoryAlignment);
-        _lightsByteSize = 0;
+        _lightsByteSize = sizeof(glm::uvec4);
+        _lightCount = 0;
+        // Nothing is lit until the first SetLights and UpdateLights, the passes read no lights and an empty grid
+        memset(_lights, 0, _lightsByteSize);
+        gfx->WriteBuffer(_lightBuffer, 0, _lightsByteSize, _lights);
+        gfx->WriteBuffer(_lightGridBuffer, 0, sizeof(sLightGridHeader), &_lightCulling->GetHeader());
+        gfx->WriteBuffer(_lightGridBuffer, sizeof(sLightGridHeader), _lightCulling->GetClusterCount() * sizeof(sLightCluster), _lightCulling->GetClusters());
         _opaqueTextureAtlasTextures = memoryAllocator->Allocate(_maxTextureAtlasTexturesBufferByteSize, caps->memoryAlignment);
         _opaqueTextureAtlasTexturesByteSize = 0;
         _transparentTextureAtlasTextures = memoryAllocator->Allocate(_maxTextureAtlasTexturesBufferByteSize, caps->memoryAlignment);
         _transparentTextureAtlasTexturesByteSize = 0;
+        _opaqueDrawCommands = (sDrawIndirectCommand*)memoryAllocator->Allocate(_maxDrawCommandCount * sizeof(sDrawIndirectCommand), caps->memoryAlignment);
+        _opaqueDrawCommandCount = 0;
         _materialsMap = new std::unordered_map<cMaterial*, s32>(); // TODO: replace std::unordered_map with cHashTable
 
-        cTexture* color = gfx->CreateTexture(windowSize.GetX(), windowSize.GetY(), 0, cTexture::eDimension::TEXTURE_2D, cTexture::eFormat::RGBA8, nullptr);
-        cTexture* accumulation = gfx->CreateTexture(windowSize.GetX(), windowSize.GetY(), 0, cTexture::eDimension::TEXTURE_2D, cTexture::eFormat::RGBA16F, nullptr);
-        cTexture* revealage = gfx->CreateTexture(windowSize.GetX(), windowSize.GetY(), 0, cTexture::eDimension::TEXTURE_2D, cTexture::eFormat::R8F, nullptr);
-        cTexture* depth = gfx->CreateTexture(windowSize.GetX(), windowSize.GetY(), 0, cTexture::eDimension::TEXTURE_2D, cTexture::eFormat::DEPTH_STENCIL, nullptr);
-
-        _opaqueRenderTarget = gfx->CreateRenderTarget({ color }, depth);
-        _transparentRenderTarget = gfx->CreateRenderTarget({ accumulation, revealage }, depth);
+        // Full screen targets are transient graph textures, the graph creates them and the render targets on Compile
+        _renderGraph = _context->Create<cRenderGraph>(_context, gfx, glm::vec2(windowSize.GetX(), windowSize.GetY()));
+
+        sRenderGraphTextureDescriptor colorDesc;
+        colorDesc.format = cTexture::eFormat::RGBA8;
+        const u32 color = _renderGraph->CreateTexture(colorDesc);
+        sRenderGraphTextureDescriptor accumulationDesc;
+        accumulationDesc.format = cTexture::eFormat::RGBA16F;
+        const u32 accumulation = _renderGraph->CreateTexture(accumulationDesc);
+        sRenderGraphTextureDescriptor revealageDesc;
+        revealageDesc.format = cTexture::eFormat::R8F;
+        const u32 revealage = _renderGraph->CreateTexture(revealageDesc);
+        sRenderGraphTextureDescriptor depthDesc;
+        depthDesc.format = cTexture::eFormat::DEPTH_STENCIL;
+        const u32 depth = _renderGraph->CreateTexture(depthDesc);
 
         cTextureAtlas* textureAtlas = _context->GetSubsystem<cTextureAtlas>();
 
-        sRenderPassDescriptor opaqueRenderPassDesc;
-        opaqueRenderPassDesc.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3;
-        opaqueRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetVertexBuffer());
-        opaqueRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetIndexBuffer());
-        opaqueRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetOpaqueInstanceBuffer());
-        opaqueRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetOpaqueMaterialBuffer());
-        opaqueRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetLightBuffer());
-        opaqueRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetOpaqueTextureAtlasTexturesBuffer());
-        opaqueRenderPassDesc.inputTextures.emplace_back(textureAtlas->GetAtlas());
-        opaqueRenderPassDesc.inputTextureNames.emplace_back("TextureAtlas");
-        opaqueRenderPassDesc.shaderBase = nullptr;
-        opaqueRenderPassDesc.shaderRenderPath = eCategory::RENDER_PATH_OPAQUE;
-        opaqueRenderPassDesc.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
-        opaqueRenderPassDesc.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
+        sRenderGraphPassDescriptor opaqueRenderPassDesc;
+        opaqueRenderPassDesc.renderPass.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3;
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetVertexBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetIndexBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetOpaqueInstanceBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetOpaqueMaterialBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetLightBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetLightGridBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetLightIndexBuffer());
+        opaqueRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetOpaqueTextureAtlasTexturesBuffer());
+        opaqueRenderPassDesc.renderPass.inputTextures.emplace_back(textureAtlas->GetAtlas());
+        opaqueRenderPassDesc.renderPass.inputTextureNames.emplace_back("TextureAtlas");
+        opaqueRenderPassDesc.renderPass.shaderBase = nullptr;
+        opaqueRenderPassDesc.renderPass.shaderRenderPath = eCategory::RENDER_PATH_OPAQUE;
+        opaqueRenderPassDesc.renderPass.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
+        opaqueRenderPassDesc.renderPass.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
         // TODO: Overload constructors for cVector4
-        //opaqueRenderPassDesc.viewport = cVector4(0.0f, 0.0f, windowSize);
-        opaqueRenderPassDesc.depthMode.useDepthTest = K_TRUE;
-        opaqueRenderPassDesc.depthMode.useDepthWrite = K_TRUE;
-        opaqueRenderPassDesc.blendMode.factorCount = 1;
-        opaqueRenderPassDesc.blendMode.srcFactors[0] = sBlendMode::eFactor::ONE;
-        opaqueRenderPassDesc.blendMode.dstFactors[0] = sBlendMode::eFactor::ZERO;
-        _opaque = CreateRenderPass(&opaqueRenderPassDesc);
-
-        sRenderPassDescriptor transparentRenderPassDesc;
-        transparentRenderPassDesc.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3;
-        transparentRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetVertexBuffer());
-        transparentRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetIndexBuffer());
-        transparentRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetTransparentInstanceBuffer());
-        transparentRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetTransparentMaterialBuffer());
-        transparentRenderPassDesc.inputTextures.emplace_back(textureAtlas->GetAtlas());
-        transparentRenderPassDesc.inputTextureNames.emplace_back("TextureAtlas");
-        transparentRenderPassDesc.shaderBase = nullptr;
-        transparentRenderPassDesc.shaderRenderPath = eCategory::RENDER_PATH_TRANSPARENT;
-        transparentRenderPassDesc.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
-        transparentRenderPassDesc.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
+        //opaqueRenderPassDesc.renderPass.viewport = cVector4(0.0f, 0.0f, windowSize);
+        opaqueRenderPassDesc.renderPass.depthMode.useDepthTest = K_TRUE;
+        opaqueRenderPassDesc.renderPass.depthMode.useDepthWrite = K_TRUE;
+        opaqueRenderPassDesc.renderPass.blendMode.factorCount = 1;
+        opaqueRenderPassDesc.renderPass.blendMode.srcFactors[0] = sBlendMode::eFactor::ONE;
+        opaqueRenderPassDesc.renderPass.blendMode.dstFactors[0] = sBlendMode::eFactor::ZERO;
+        opaqueRenderPassDesc.colorOutputs.emplace_back(color);
+        opaqueRenderPassDesc.depthOutput = depth;
+        _opaque = _renderGraph->GetRenderPass(_renderGraph->AddPass(opaqueRenderPassDesc));
+
+        sRenderGraphPassDescriptor transparentRenderPassDesc;
+        transparentRenderPassDesc.renderPass.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3;
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetVertexBuffer());
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetIndexBuffer());
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetTransparentInstanceBuffer());
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetTransparentMaterialBuffer());
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetLightBuffer());
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetLightGridBuffer());
+        transparentRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetLightIndexBuffer());
+        transparentRenderPassDesc.renderPass.inputTextures.emplace_back(textureAtlas->GetAtlas());
+        transparentRenderPassDesc.renderPass.inputTextureNames.emplace_back("TextureAtlas");
+        transparentRenderPassDesc.renderPass.shaderBase = nullptr;
+        transparentRenderPassDesc.renderPass.shaderRenderPath = eCategory::RENDER_PATH_TRANSPARENT;
+        transparentRenderPassDesc.renderPass.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
+        transparentRenderPassDesc.renderPass.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
         // TODO: Overload constructors for cVector4
-        //transparentRenderPassDesc.viewport = cVector4(0.0f, 0.0f, windowSize);
-        transparentRenderPassDesc.depthMode.useDepthTest = K_TRUE;
-        transparentRenderPassDesc.depthMode.useDepthWrite = K_FALSE;
-        transparentRenderPassDesc.blendMode.factorCount = 2;
-        transparentRenderPassDesc.blendMode.srcFactors[0] = sBlendMode::eFactor::ONE;
-        transparentRenderPassDesc.blendMode.dstFactors[0] = sBlendMode::eFactor::ONE;
-        transparentRenderPassDesc.blendMode.srcFactors[1] = sBlendMode::eFactor::ZERO;
-        transparentRenderPassDesc.blendMode.dstFactors[1] = sBlendMode::eFactor::INV_SRC_COLOR;
-        _transparent = CreateRenderPass(&transparentRenderPassDesc);
+        //transparentRenderPassDesc.renderPass.viewport = cVector4(0.0f, 0.0f, windowSize);
+        transparentRenderPassDesc.renderPass.depthMode.useDepthTest = K_TRUE;
+        transparentRenderPassDesc.renderPass.depthMode.useDepthWrite = K_FALSE;
+        transparentRenderPassDesc.renderPass.blendMode.factorCount = 2;
+        transparentRenderPassDesc.renderPass.blendMode.srcFactors[0] = sBlendMode::eFactor::ONE;
+        transparentRenderPassDesc.renderPass.blendMode.dstFactors[0] = sBlendMode::eFactor::ONE;
+        transparentRenderPassDesc.renderPass.blendMode.srcFactors[1] = sBlendMode::eFactor::ZERO;
+        transparentRenderPassDesc.renderPass.blendMode.dstFactors[1] = sBlendMode::eFactor::INV_SRC_COLOR;
+        transparentRenderPassDesc.colorOutputs.emplace_back(accumulation);
+        transparentRenderPassDesc.colorOutputs.emplace_back(revealage);
+        transparentRenderPassDesc.depthOutput = depth;
+        _transparent = _renderGraph->GetRenderPass(_renderGraph->AddPass(transparentRenderPassDesc));
         
-        sRenderPassDescriptor textRenderPassDesc;
-        textRenderPassDesc.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE;
-        textRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetTextInstanceBuffer());
-        textRenderPassDesc.inputBuffers.emplace_back(cGraphics::GetTextMaterialBuffer());
-        textRenderPassDesc.shaderBase = nullptr;
-        textRenderPassDesc.shaderRenderPath = eCategory::RENDER_PATH_TEXT;
-        textRenderPassDesc.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
-        textRenderPassDesc.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
+        sRenderGraphPassDescriptor textRenderPassDesc;
+        textRenderPassDesc.renderPass.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE;
+        textRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetTextInstanceBuffer());
+        textRenderPassDesc.renderPass.inputBuffers.emplace_back(cGraphics::GetTextMaterialBuffer());
+        textRenderPassDesc.renderPass.shaderBase = nullptr;
+        textRenderPassDesc.renderPass.shaderRenderPath = eCategory::RENDER_PATH_TEXT;
+        textRenderPassDesc.renderPass.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
+        textRenderPassDesc.renderPass.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
         // TODO: Overload constructors for cVector4
-        //textRenderPassDesc.viewport = cVector4(0.0f, 0.0f, windowSize);
-        textRenderPassDesc.depthMode.useDepthTest = K_FALSE;
-        textRenderPassDesc.depthMode.useDepthWrite = K_FALSE;
-        _text = CreateRenderPass(&textRenderPassDesc);
+        //textRenderPassDesc.renderPass.viewport = cVector4(0.0f, 0.0f, windowSize);
+        textRenderPassDesc.renderPass.depthMode.useDepthTest = K_FALSE;
+        textRenderPassDesc.renderPass.depthMode.useDepthWrite = K_FALSE;
+        textRenderPassDesc.hasSideEffects = K_TRUE;
+        _text = _renderGraph->GetRenderPass(_renderGraph->AddPass(textRenderPassDesc));
         
-        sRenderPassDescriptor compositeTransparentRenderPassDesc;
-        auto& transparentColorAttachments = _transparentRenderTarget->GetColorAttachments();
-        compositeTransparentRenderPassDesc.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE;
-        compositeTransparentRenderPassDesc.inputTextures.emplace_back(transparentColorAttachments[0]);
+        sRenderGraphPassDescriptor compositeTransparentRenderPassDesc;
+        compositeTransparentRenderPassDesc.renderPass.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE;
+        compositeTransparentRenderPassDesc.inputTextures.emplace_back(accumulation);
         compositeTransparentRenderPassDesc.inputTextureNames.emplace_back("AccumulationTexture");
-        compositeTransparentRenderPassDesc.inputTextures.emplace_back(transparentColorAttachments[1]);
+        compositeTransparentRenderPassDesc.inputTextures.emplace_back(revealage);
         compositeTransparentRenderPassDesc.inputTextureNames.emplace_back("RevealageTexture");
-        compositeTransparentRenderPassDesc.shaderBase = nullptr;
-        compositeTransparentRenderPassDesc.shaderRenderPath = eCategory::RENDER_PATH_TRANSPARENT_COMPOSITE;
-        compositeTransparentRenderPassDesc.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
-        compositeTransparentRenderPassDesc.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
+        compositeTransparentRenderPassDesc.renderPass.shaderBase = nullptr;
+        compositeTransparentRenderPassDesc.renderPass.shaderRenderPath = eCategory::RENDER_PATH_TRANSPARENT_COMPOSITE;
+        compositeTransparentRenderPassDesc.renderPass.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
+        compositeTransparentRenderPassDesc.renderPass.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
         // TODO: Overload constructors for cVector4
-        //compositeTransparentRenderPassDesc.viewport = cVector4(0.0f, 0.0f, windowSize);
-        compositeTransparentRenderPassDesc.depthMode.useDepthTest = K_FALSE;
-        compositeTransparentRenderPassDesc.depthMode.useDepthWrite = K_FALSE;
-        compositeTransparentRenderPassDesc.blendMode.factorCount = 1;
-        compositeTransparentRenderPassDesc.blendMode.srcFactors[0] = sBlendMode::eFactor::SRC_ALPHA;
-        compositeTransparentRenderPassDesc.blendMode.dstFactors[0] = sBlendMode::eFactor::INV_SRC_ALPHA;
-        _compositeTransparent = CreateRenderPass(&compositeTransparentRenderPassDesc);
+        //compositeTransparentRenderPassDesc.renderPass.viewport = cVector4(0.0f, 0.0f, windowSize);
+        compositeTransparentRenderPassDesc.renderPass.depthMode.useDepthTest = K_FALSE;
+        compositeTransparentRenderPassDesc.renderPass.depthMode.useDepthWrite = K_FALSE;
+        compositeTransparentRenderPassDesc.renderPass.blendMode.factorCount = 1;
+        compositeTransparentRenderPassDesc.renderPass.blendMode.srcFactors[0] = sBlendMode::eFactor::SRC_ALPHA;
+        compositeTransparentRenderPassDesc.renderPass.blendMode.dstFactors[0] = sBlendMode::eFactor::INV_SRC_ALPHA;
+        // Blends the resolved transparency over the opaque color, so the final composite sees both
+        compositeTransparentRenderPassDesc.colorOutputs.emplace_back(color);
+        _compositeTransparent = _renderGraph->GetRenderPass(_renderGraph->AddPass(compositeTransparentRenderPassDesc));
         
-        sRenderPassDescriptor compositeFinalRenderPassDesc;
-        auto& opaqueColorAttachments = _opaqueRenderTarget->GetColorAttachments();
-        compositeFinalRenderPassDesc.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE;
-        compositeFinalRenderPassDesc.inputTextures.emplace_back(opaqueColorAttachments[0]);
+        sRenderGraphPassDescriptor compositeFinalRenderPassDesc;
+        compositeFinalRenderPassDesc.renderPass.inputVertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE;
+        compositeFinalRenderPassDesc.inputTextures.emplace_back(color);
         compositeFinalRenderPassDesc.inputTextureNames.emplace_back("ColorTexture");
-        compositeFinalRenderPassDesc.shaderBase = nullptr;
-        compositeFinalRenderPassDesc.shaderRenderPath = eCategory::RENDER_PATH_QUAD;
-        compositeFinalRenderPassDesc.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
-        compositeFinalRenderPassDesc.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
+        compositeFinalRenderPassDesc.renderPass.shaderBase = nullptr;
+        compositeFinalRenderPassDesc.renderPass.shaderRenderPath = eCategory::RENDER_PATH_QUAD;
+        compositeFinalRenderPassDesc.renderPass.shaderVertexPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_vertex.shader";
+        compositeFinalRenderPassDesc.renderPass.shaderFragmentPath = "C:/DDD/RealWare/out/build/x64-Debug/samples/Sample01/data/shaders/main_fragment.shader";
         // TODO: Overload constructors for cVector4
-        //compositeFinalRenderPassDesc.viewport = cVector4(0.0f, 0.0f, windowSize);
-        compositeFinalRenderPassDesc.depthMode.useDepthTest = K_FALSE;
-        compositeFinalRenderPassDesc.depthMode.useDepthWrite = K_FALSE;
-        compositeFinalRenderPassDesc.blendMode.factorCount = 1;
-        compositeFinalRenderPassDesc.blendMode.srcFactors[0] = sBlendMode::eFactor::ONE;
-        compositeFinalRenderPassDesc.blendMode.dstFactors[0] = sBlendMode::eFactor::ZERO;
-        _compositeFinal = CreateRenderPass(&compositeFinalRenderPassDesc);
+        //compositeFinalRenderPassDesc.renderPass.viewport = cVector4(0.0f, 0.0f, windowSize);
+        compositeFinalRenderPassDesc.renderPass.depthMode.useDepthTest = K_FALSE;
+        compositeFinalRenderPassDesc.renderPass.depthMode.useDepthWrite = K_FALSE;
+        compositeFinalRenderPassDesc.renderPass.blendMode.factorCount = 1;
+        compositeFinalRenderPassDesc.renderPass.blendMode.srcFactors[0] = sBlendMode::eFactor::ONE;
+        compositeFinalRenderPassDesc.renderPass.blendMode.dstFactors[0] = sBlendMode::eFactor::ZERO;
+        compositeFinalRenderPassDesc.hasSideEffects = K_TRUE;
+        _compositeFinal = _renderGraph->GetRenderPass(_renderGraph->AddPass(compositeFinalRenderPassDesc));
+
+        _renderGraph->Compile();
+
+        if (caps->printStartupStats == K_TRUE)
+        {
+            const sShaderCacheStats& shaderStats = gfx->GetShaderCacheStats();
+            const f32 milliseconds = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+            Print(
+                "Graphics: startup took " + std::to_string(milliseconds) + " ms, " + std::to_string(shaderStats.milliseconds) + " ms in shaders, " +
+                std::to_string(shaderStats.compiledCount) + " compiled, " + std::to_string(shaderStats.binaryLoadedCount) + " loaded from cache, " +
+                std::to_string(shaderStats.sharedCount) + " shared, " + std::to_string(shaderStats.pendingCount) + " pending"
+            );
+        }
     }
 
     cGraphics::~cGraphics()
     {
         cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
-        iGraphicsAPI* gfx = _context->GetSubsystem<cGraphics>()->GetAPI();
-
-        DestroyRenderPass(_compositeFinal);
-        DestroyRenderPass(_compositeTransparent);
-        DestroyRenderPass(_text);
-        DestroyRenderPass(_transparent);
-        DestroyRenderPass(_opaque);
+        iGraphicsAPI* gfx = _gfx;
 
-        gfx->DestroyRenderTarget(_transparentRenderTarget);
-        gfx->DestroyRenderTarget(_opaqueRenderTarget);
+        _context->Destroy<cLodSelector>(_lodSelector);
+        _context->Destroy<cLightCulling>(_lightCulling);
+        _context->Destroy<cInstanceBuilder>(_instanceBuilder);
+        _geometries->ForEach([memoryAllocator](sVertexBufferGeometry& geometry) {
+            if (geometry._meshlets != nullptr)
+                memoryAllocator->Deallocate(geometry._meshlets);
+            if (geometry._submeshes != nullptr)
+                memoryAllocator->Deallocate(geometry._submeshes);
+        });
+        _context->Destroy<cPool<sVertexBufferGeometry>>(_geometries);
 
-        gfx->DestroyTexture(_transparentRenderTarget->GetColorAttachments()[0]);
-        gfx->DestroyTexture(_transparentRenderTarget->GetColorAttachments()[1]);
-        gfx->DestroyTexture(_opaqueRenderTarget->GetColorAttachments()[0]);
-        gfx->DestroyTexture(_opaqueRenderTarget->GetDepthAttachment());
+        _context->Destroy<cRenderGraph>(_renderGraph);
 
         delete _materialsMap; // TODO: Temporary solution
 
+        memoryAllocator->Deallocate(_opaqueDrawCommands);
         memoryAllocator->Deallocate(_transparentTextureAtlasTextures);
         memoryAllocator->Deallocate(_opaqueTextureAtlasTextures);
         memoryAllocator->Deallocate(_lights);
         memoryAllocator->Deallocate(_textMaterials);
-        memoryAllocator->Deallocate(_transparentMaterials);
-        memoryAllocator->Deallocate(_opaqueMaterials);
         memoryAllocator->Deallocate(_textInstances);
-        memoryAllocator->Deallocate(_transparentInstances);
-        memoryAllocator->Deallocate(_opaqueInstances);
         memoryAllocator->Deallocate(_indices);
         memoryAllocator->Deallocate(_vertices);
+        _context->Destroy<cOffsetAllocator>(_indexHeap);
+        _context->Destroy<cOffsetAllocator>(_vertexHeap);
 
+        _context->Destroy<cUploadRing>(_transparentMaterialRing);
+        _context->Destroy<cUploadRing>(_opaqueMaterialRing);
+        _context->Destroy<cUploadRing>(_transparentInstanceRing);
+        _context->Destroy<cUploadRing>(_opaqueInstanceRing);
+
+        gfx->DestroyBuffer(_opaqueDrawCommandBuffer);
         gfx->DestroyBuffer(_transparentTextureAtlasTexturesBuffer);
         gfx->DestroyBuffer(_opaqueTextureAtlasTexturesBuffer);
+        gfx->DestroyBuffer(_lightIndexBuffer);
+        gfx->DestroyBuffer(_lightGridBuffer);
         gfx->DestroyBuffer(_lightBuffer);
-        gfx->DestroyBuffer(_transparentMaterialBuffer);
         gfx->DestroyBuffer(_textMaterialBuffer);
-        gfx->DestroyBuffer(_opaqueMaterialBuffer);
         gfx->DestroyBuffer(_textInstanceBuffer);
-        gfx->DestroyBuffer(_transparentInstanceBuffer);
-        gfx->DestroyBuffer(_opaqueInstanceBuffer);
         gfx->DestroyBuffer(_indexBuffer);
         gfx->DestroyBuffer(_vertexBuffer);
     }
@@ -344,40 +476,158 @@ namespace triton
         return vertexArray;
     }
 
-    sVertexBufferGeometry* cGraphics::CreateGeometry(eCategory format, usize verticesByteSize, const void* vertices, usize indicesByteSize, const void* indices)
+    sVertexBufferGeometry* cGraphics::CreateGeometry(eCategory format, usize verticesByteSize, const void* vertices, usize indicesByteSize, const void* indices, types::boolean computeBounds)
     {
-        sVertexBufferGeometry* geometry = _context->Create<sVertexBufferGeometry>(_context);
+        const usize vertexStride = GetVertexFormatStride(format);
+        if (vertexStride == 0)
+        {
+            Print("Error: unsupported vertex buffer format!");
+            return nullptr;
+        }
 
-        memcpy((void*)((usize)_vertices + _verticesByteSize), vertices, verticesByteSize);
-        memcpy((void*)((usize)_indices + _indicesByteSize), indices, indicesByteSize);
+        const sOffsetAllocation vertexAllocation = _vertexHeap->Allocate(verticesByteSize);
+        const sOffsetAllocation indexAllocation = _indexHeap->Allocate(indicesByteSize);
+        if (vertexAllocation.node == sOffsetAllocation::kInvalidNode || indexAllocation.node == sOffsetAllocation::kInvalidNode)
+        {
+            if (vertexAllocation.node != sOffsetAllocation::kInvalidNode)
+                _vertexHeap->Free(vertexAllocation);
+            if (indexAllocation.node != sOffsetAllocation::kInvalidNode)
+                _indexHeap->Free(indexAllocation);
 
-        _gfx->WriteBuffer(_vertexBuffer, _verticesByteSize, verticesByteSize, vertices);
-        _gfx->WriteBuffer(_indexBuffer, _indicesByteSize, indicesByteSize, indices);
+            Print("Error: geometry heap is full!");
+            return nullptr;
+        }
 
-        usize vertexCount = verticesByteSize;
-        usize vertexOffset = _verticesByteSize;
-        switch (format)
+        _defragmentDirty = K_TRUE;
+        sVertexBufferGeometry* geometry = _geometries->At(_geometries->Insert());
+        if (geometry == nullptr)
         {
-        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3:
-            vertexCount /= 32;
-            vertexOffset /= 32;
-            break;
+            _vertexHeap->Free(vertexAllocation);
+            _indexHeap->Free(indexAllocation);
 
-        default:
-            Print("Error: unsupported vertex buffer format!");
             return nullptr;
         }
 
+        if (_vertices != nullptr)
+            memcpy((void*)((usize)_vertices + vertexAllocation.offset), vertices, verticesByteSize);
+        if (_indices != nullptr)
+            memcpy((void*)((usize)_indices + indexAllocation.offset), indices, indicesByteSize);
+
+        _gfx->WriteBuffer(_vertexBuffer, vertexAllocation.offset, verticesByteSize, vertices);
+        _gfx->WriteBuffer(_indexBuffer, indexAllocation.offset, indicesByteSize, indices);
+
+        const usize vertexCount = verticesByteSize / vertexStride;
+
         geometry->_vertexCount = vertexCount;
         geometry->_indexCount = indicesByteSize / sizeof(u32);
         geometry->_vertexPtr = _vertices;
         geometry->_indexPtr = _indices;
-        geometry->_offsetVertex = vertexOffset;
-        geometry->_offsetIndex = _indicesByteSize;
+        geometry->_offsetVertex = vertexAllocation.offset / vertexStride;
+        geometry->_offsetIndex = indexAllocation.offset;
         geometry->_format = format;
+        geometry->_vertexAllocation = vertexAllocation;
+        geometry->_indexAllocation = indexAllocation;
+        geometry->_lodCount = 1;
+        geometry->_lods[0] = { 0, (u32)geometry->_indexCount, 0.0f };
+        geometry->_meshlets = nullptr;
+        geometry->_meshletCount = 0;
+        geometry->_submeshes = nullptr;
+        geometry->_submeshCount = 0;
+
+        // Bounds for culling, position is the first attribute of every vertex format
+        if (computeBounds == K_TRUE && vertexCount > 0)
+        {
+            const u8* positions = (const u8*)vertices;
+            glm::vec3 aabbMin = DecodeVertexPosition(format, positions);
+            glm::vec3 aabbMax = aabbMin;
+            for (usize i = 1; i < vertexCount; i++)
+            {
+                const glm::vec3 position = DecodeVertexPosition(format, positions + i * vertexStride);
+                aabbMin = glm::min(aabbMin, position);
+                aabbMax = glm::max(aabbMax, position);
+            }
+
+            const glm::vec3 center = (aabbMin + aabbMax) * 0.5f;
+            f32 radiusSquared = 0.0f;
+            for (usize i = 0; i < vertexCount; i++)
+            {
+                const glm::vec3 offset = DecodeVertexPosition(format, positions + i * vertexStride) - center;
+                radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+            }
+
+            geometry->_aabbMin = aabbMin;
+            geometry->_aabbMax = aabbMax;
+            geometry->_boundingSphere = glm::vec4(center, glm::sqrt(radiusSquared));
+        }
+
+        return geometry;
+    }
+
+    sVertexBufferGeometry* cGraphics::LoadGeometry(const std::string& path)
+    {
+        cFileSystem* fileSystem = _context->GetSubsystem<cFileSystem>();
+        cMappedFile* file = fileSystem->CreateMappedFile(path);
+        if (file == nullptr)
+            return nullptr;
+
+        const void* data = file->GetData();
+        if (IsMeshFileValid(data, file->GetByteSize()) == K_FALSE)
+        {
+            Print("Error: '" + path + "' is not a mesh file of version " + std::to_string(kMeshFileVersion) + "!");
+            fileSystem->DestroyMappedFile(file);
+
+            return nullptr;
+        }
+
+        const sMeshFileHeader* header = (const sMeshFileHeader*)data;
+
+        sVertexBufferGeometry* geometry = CreateGeometry(
+            (eCategory)header->vertexFormat,
+            header->vertexByteSize,
+            GetMeshFileVertices(data),
+            header->indexByteSize,
+            GetMeshFileIndices(data),
+            K_FALSE
+        );
+
+        if (geometry != nullptr)
+        {
+            geometry->_aabbMin = glm::vec3(header->aabbMin[0], header->aabbMin[1], header->aabbMin[2]);
+            geometry->_aabbMax = glm::vec3(header->aabbMax[0], header->aabbMax[1], header->aabbMax[2]);
+            geometry->_boundingSphere = glm::vec4(header->boundingSphere[0], header->boundingSphere[1], header->boundingSphere[2], header->boundingSphere[3]);
+
+            // The whole index blob is uploaded, draws only take the LOD 0 range unless a LOD is selected
+            geometry->_lodCount = header->lodCount < kMaxGeometryLodCount ? header->lodCount : kMaxGeometryLodCount;
+            for (usize i = 0; i < geometry->_lodCount; i++)
+                geometry->_lods[i] = { header->lods[i].firstIndex, header->lods[i].indexCount, header->lods[i].error };
+            geometry->_indexCount = geometry->_lods[0].indexCount;
 
-        _verticesByteSize += verticesByteSize;
-        _indicesByteSize += indicesByteSize;
+            const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+            cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+            if (header->meshletCount > 0)
+            {
+                geometry->_meshletCount = header->meshletCount;
+                geometry->_meshlets = (sMeshlet*)memoryAllocator->Allocate(header->meshletCount * sizeof(sMeshlet), caps->memoryAlignment);
+                memcpy(geometry->_meshlets, GetMeshFileMeshlets(data), header->meshletCount * sizeof(sMeshlet));
+            }
+
+            if (header->submeshCount > 0)
+            {
+                const sMeshFileSubmesh* submeshes = GetMeshFileSubmeshes(data);
+                geometry->_submeshCount = header->submeshCount;
+                geometry->_submeshes = (sGeometrySubmesh*)memoryAllocator->Allocate(header->submeshCount * sizeof(sGeometrySubmesh), caps->memoryAlignment);
+                for (usize i = 0; i < geometry->_submeshCount; i++)
+                {
+                    geometry->_submeshes[i].firstIndex = submeshes[i].firstIndex;
+                    geometry->_submeshes[i].indexCount = submeshes[i].indexCount;
+                    geometry->_submeshes[i].aabbMin = glm::vec3(submeshes[i].aabbMin[0], submeshes[i].aabbMin[1], submeshes[i].aabbMin[2]);
+                    geometry->_submeshes[i].aabbMax = glm::vec3(submeshes[i].aabbMax[0], submeshes[i].aabbMax[1], submeshes[i].aabbMax[2]);
+                }
+            }
+        }
+
+        fileSystem->DestroyMappedFile(file);
 
         return geometry;
     }
@@ -415,8 +665,8 @@ namespace triton
             primitiveObject->_vertices[2]._texcoord[0] = 1.0f; primitiveObject->_vertices[2]._texcoord[1] = 0.0f;
             primitiveObject->_vertices[2]._normal[0] = 0.0f; primitiveObject->_vertices[2]._normal[1] = 0.0f; primitiveObject->_vertices[2]._normal[2] = 1.0f;
             primitiveObject->_indices[0] = 0;
-            primitiveObject->_indices[1] = 1;
-            primitiveObject->_indices[2] = 2;
+            primitiveObject->_indices[1] = 2;
+            primitiveObject->_indices[2] = 1;
         }
         else if (primitive == eCategory::PRIMITIVE_QUAD)
         {
@@ -441,11 +691,11 @@ namespace triton
             primitiveObject->_vertices[3]._texcoord[0] = 1.0f; primitiveObject->_vertices[3]._texcoord[1] = 1.0f;
             primitiveObject->_vertices[3]._normal[0] = 0.0f; primitiveObject->_vertices[3]._normal[1] = 0.0f; primitiveObject->_vertices[3]._normal[2] = 1.0f;
             primitiveObject->_indices[0] = 0;
-            primitiveObject->_indices[1] = 1;
-            primitiveObject->_indices[2] = 2;
+            primitiveObject->_indices[1] = 2;
+            primitiveObject->_indices[2] = 1;
             primitiveObject->_indices[3] = 1;
-            primitiveObject->_indices[4] = 3;
-            primitiveObject->_indices[5] = 2;
+            primitiveObject->_indices[4] = 2;
+            primitiveObject->_indices[5] = 3;
         }
 
         return primitiveObject;
@@ -534,7 +784,14 @@ namespace triton
 
     void cGraphics::DestroyGeometry(sVertexBufferGeometry* geometry)
     {
-        _context->Destroy<sVertexBufferGeometry>(geometry);
+        if (geometry->_meshlets != nullptr)
+            _context->GetMemoryAllocator()->Deallocate(geometry->_meshlets);
+        if (geometry->_submeshes != nullptr)
+            _context->GetMemoryAllocator()->Deallocate(geometry->_submeshes);
+        _vertexHeap->Free(geometry->_vertexAllocation);
+        _indexHeap->Free(geometry->_indexAllocation);
+        _geometries->Erase(geometry);
+        _defragmentDirty = K_TRUE;
     }
 
     void cGraphics::DestroyRenderPass(cRenderPass* renderPass)
@@ -556,8 +813,60 @@ namespace triton
 
     void cGraphics::ClearGeometryBuffer()
     {
-        _verticesByteSize = 0;
-        _indicesByteSize = 0;
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+        _geometries->ForEach([memoryAllocator](sVertexBufferGeometry& geometry) {
+            if (geometry._meshlets != nullptr)
+                memoryAllocator->Deallocate(geometry._meshlets);
+            if (geometry._submeshes != nullptr)
+                memoryAllocator->Deallocate(geometry._submeshes);
+        });
+
+        _geometries->Clear();
+        _vertexHeap->Reset();
+        _indexHeap->Reset();
+        _defragmentDirty = K_TRUE;
+    }
+
+    usize cGraphics::DefragmentGeometry(usize maxByteSize)
+    {
+        // A finished pass that moved nothing stays finished until the heaps change
+        if (_defragmentCursor >= _defragmentOrder.size() && _defragmentPassByteSize > 0)
+            _defragmentDirty = K_TRUE;
+
+        if (_defragmentDirty == K_TRUE)
+        {
+            _defragmentDirty = K_FALSE;
+            _defragmentOrder.clear();
+            _defragmentCursor = 0;
+            _defragmentPassByteSize = 0;
+
+            const sOffsetAllocatorStats vertexStats = _vertexHeap->GetStats();
+            const sOffsetAllocatorStats indexStats = _indexHeap->GetStats();
+            if (vertexStats.freeRegionCount <= 1 && indexStats.freeRegionCount <= 1)
+                return 0;
+
+            // Geometries at the top of the heap go first, moving them down leaves the free space in one range at the end
+            _defragmentOrder.reserve(_geometries->GetSize());
+            _geometries->ForEach([this](sVertexBufferGeometry& geometry) {
+                _defragmentOrder.emplace_back(&geometry);
+            });
+            std::sort(_defragmentOrder.begin(), _defragmentOrder.end(), [](const sVertexBufferGeometry* a, const sVertexBufferGeometry* b) {
+                return a->_vertexAllocation.offset + a->_indexAllocation.offset > b->_vertexAllocation.offset + b->_indexAllocation.offset;
+            });
+        }
+
+        usize movedByteSize = 0;
+        while (_defragmentCursor < _defragmentOrder.size() && movedByteSize < maxByteSize)
+        {
+            sVertexBufferGeometry* geometry = _defragmentOrder[_defragmentCursor++];
+            movedByteSize += RelocateGeometryRange(_gfx, _vertexHeap, _vertexBuffer, _vertices, geometry->_vertexAllocation);
+            movedByteSize += RelocateGeometryRange(_gfx, _indexHeap, _indexBuffer, _indices, geometry->_indexAllocation);
+            geometry->_offsetVertex = geometry->_vertexAllocation.offset / GetVertexFormatStride(geometry->_format);
+            geometry->_offsetIndex = geometry->_indexAllocation.offset;
+        }
+        _defragmentPassByteSize += movedByteSize;
+
+        return movedByteSize;
     }
 
     void cGraphics::ClearRenderPass(const cRenderPass* renderPass, types::boolean clearColor, usize bufferIndex, const glm::vec4& color, types::boolean clearDepth, f32 depth)
@@ -584,36 +893,27 @@ namespace triton
         _gfx->ClearFramebufferColor(0, clearColor);
     }
 
-    void cGraphics::ResizeRenderTargets(const glm::vec2& size)
+    void cGraphics::BeginFrame()
     {
-        _gfx->UnbindRenderPass(_opaque);
-        _gfx->UnbindRenderPass(_transparent);
-
-        _opaque->ResizeViewport(size);
-        _opaque->ResizeColorAttachments(size);
-        _opaque->ResizeDepthAttachment(size);
-
-        _transparent->ResizeViewport(size);
-        _transparent->ResizeColorAttachments(size);
-        cTexture* opaqueDepthAttachment = _opaque->GetRenderTarget()->GetDepthAttachment();
-        _transparent->GetRenderTarget()->SetDepthAttachment(opaqueDepthAttachment);
-
-        _text->ResizeViewport(size);
+        const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+        if (caps->shaderHotReload == K_TRUE)
+        {
+            const std::vector<std::string> changedPaths = _context->GetSubsystem<cShaderPreprocessor>()->CollectChangedFiles();
+            if (!changedPaths.empty())
+                _gfx->ReloadShaders(changedPaths);
+        }
 
-        _gfx->UpdateRenderTargetBuffers(_opaque->GetRenderTarget());
-        _gfx->UpdateRenderTargetBuffers(_transparent->GetRenderTarget());
+        _gfx->UpdateShaders();
+        _renderGraph->Compile();
 
-        _compositeTransparent->ResizeViewport(size);
-        auto& transparentColorAttachments = _transparent->GetRenderTarget()->GetColorAttachments();
-        _compositeTransparent->SetInputTexture(0, transparentColorAttachments[0]);
-        _compositeTransparent->SetInputTexture(1, transparentColorAttachments[1]);
-        //_compositeTransparent->_desc._inputTextureNames[0] = "AccumulationTexture";
-        //_compositeTransparent->_desc._inputTextureNames[1] = "RevealageTexture";
+        if (_geometryDefragmentByteSizePerFrame > 0)
+            DefragmentGeometry(_geometryDefragmentByteSizePerFrame);
+    }
 
-        _compositeFinal->ResizeViewport(size);
-        auto& opaqueColorAttachments = _opaque->GetRenderTarget()->GetColorAttachments();
-        _compositeFinal->SetInputTexture(0, opaqueColorAttachments[0]);
-        //_compositeFinal->_desc._inputTextureNames[0] = "ColorTexture";
+    void cGraphics::ResizeRenderTargets(const glm::vec2& size)
+    {
+        // Window events can arrive several times a frame, the graph rebuilds its targets once in BeginFrame
+        _renderGraph->Resize(size);
     }
 
     void cGraphics::LoadShaderFiles(const std::string& vertexFuncPath, const std::string& fragmentFuncPath, std::string& vertexFunc, std::string& fragmentFunc)
@@ -630,83 +930,105 @@ namespace triton
         fileSystem->DestroyDataFile(fragmentFuncFile);
     }
 
-    void cGraphics::UpdateLights()
+    void cGraphics::SetLights(const sLightInstance* lights, usize count)
     {
-        /*_lightsByteSize = 16; // because vec4 (16 bytes) goes first (contains light count)
-        memset(_lights, 0, 16 + (sizeof(sLightInstance) * 16));
-
-        glm::uvec4 lightCount = glm::uvec4(0);
-
-        for (auto& it : _app->GetGameObjectManager()->GetObjects())
+        const usize maxLightCount = (_maxLightBufferByteSize - sizeof(glm::uvec4)) / sizeof(sLightInstance);
+        if (count > maxLightCount)
         {
-            if (it.GetLight() != nullptr)
-            {
-                sLightInstance li(&it);
+            Print("Error: light limit reached, extra lights are skipped!");
+            count = maxLightCount;
+        }
 
-                memcpy((void*)((usize)_lights + (usize)_lightsByteSize), &li, sizeof(sLightInstance));
-                _lightsByteSize += sizeof(sLightInstance);
+        const glm::uvec4 lightCount = glm::uvec4((u32)count, 0, 0, 0);
+        memcpy(_lights, &lightCount, sizeof(glm::uvec4));
+        memcpy((u8*)_lights + sizeof(glm::uvec4), lights, count * sizeof(sLightInstance));
+        _lightsByteSize = sizeof(glm::uvec4) + count * sizeof(sLightInstance);
+        _lightCount = count;
+        _gfx->WriteBuffer(_lightBuffer, 0, _lightsByteSize, _lights);
+    }
 
-                lightCount.x += 1;
-            }
-        }
+    void cGraphics::UpdateLights(const cMatrix4& view, const cMatrix4& projection, f32 zNear, f32 zFar)
+    {
+        const iApplication* app = _context->GetSubsystem<cEngine>()->GetApplication();
+        const sCapabilities* caps = app->GetCapabilities();
+        const cWindow* window = app->GetWindow();
+        const glm::vec2 viewportSize = window != nullptr ? glm::vec2(window->GetWidth(), window->GetHeight()) : glm::vec2(caps->windowWidth, caps->windowHeight);
 
-        memcpy((void*)(usize)_lights, &lightCount, sizeof(glm::uvec4));
+        const sLightInstance* lights = (const sLightInstance*)((const u8*)_lights + sizeof(glm::uvec4));
+        const usize lightIndexCount = _lightCulling->Cull(lights, _lightCount, view, projection, zNear, zFar, viewportSize);
 
-        _context->WriteBuffer(_lightBuffer, 0, _lightsByteSize, _lights);*/
+        _gfx->WriteBuffer(_lightGridBuffer, 0, sizeof(sLightGridHeader), &_lightCulling->GetHeader());
+        _gfx->WriteBuffer(_lightGridBuffer, sizeof(sLightGridHeader), _lightCulling->GetClusterCount() * sizeof(sLightCluster), _lightCulling->GetClusters());
+        if (lightIndexCount > 0)
+            _gfx->WriteBuffer(_lightIndexBuffer, 0, lightIndexCount * sizeof(u32), _lightCulling->GetLightIndices());
     }
 
-    // TODO: Implement new CPU->GPU geometry buffer communication
-    /*void cGraphics::WriteObjectsToOpaqueBuffers(cIdVector<cGameObject>& objects, cRenderPass* renderPass)
+    void cGraphics::WriteObjectsToOpaqueBuffers(const glm::mat4* worlds, cMaterial* const* materials, const u32* indices, usize count, cRenderPass* renderPass)
     {
-        _opaqueInstanceCount = 0;
-        _opaqueInstancesByteSize = 0;
-        _opaqueMaterialsByteSize = 0;
-        _opaqueTextureAtlasTexturesByteSize = 0;
-        _materialsMap->clear();
-
-        cGameObject* objectsArray = objects.GetElements();
+        iApplication* app = _context->GetSubsystem<cEngine>()->GetApplication();
+        const sCapabilities* caps = app->GetCapabilities();
 
-        for (usize i = 0; i < objects.GetElementCount(); i++)
+        if (count > caps->maxRenderOpaqueInstanceCount)
         {
-            const cGameObject& go = objectsArray[i];
+            Print("Error: opaque instance limit reached, extra instances are skipped!");
+            count = caps->maxRenderOpaqueInstanceCount;
+        }
 
-            cTransform transform(&go);
-            transform.Transform();
+        _opaqueInstanceRing->BeginFrame();
+        _opaqueMaterialRing->BeginFrame();
 
-            s32 materialIndex = -1;
-            cMaterial* material = go.GetMaterial();
-            sVertexBufferGeometry* geometry = go.GetGeometry();
+        sRenderInstance* instances = (sRenderInstance*)_opaqueInstanceRing->GetFrameData();
+        cMaterialInstance* materialInstances = (cMaterialInstance*)_opaqueMaterialRing->GetFrameData();
+        if (instances == nullptr || materialInstances == nullptr)
+            return;
 
-            if (geometry == nullptr)
-                continue;
+        _opaqueInstanceCount = _instanceBuilder->Build(worlds, materials, indices, count, instances, materialInstances);
+        _opaqueInstanceRing->Flush(_opaqueInstanceCount * sizeof(sRenderInstance));
+        _opaqueMaterialRing->Flush(_instanceBuilder->GetMaterialCount() * sizeof(cMaterialInstance));
+        _opaqueTextureAtlasTexturesByteSize = 0;
 
-            if (material != nullptr)
-            {
-                auto it = _materialsMap->find(material);
-                if (it == _materialsMap->end())
-                {
-                    materialIndex = _materialsMap->size();
+        const std::vector<cTextureAtlasTexture*>& renderPassTextureAtlasTextures = renderPass->GetInputTextureAtlasTextures();
+        for (const auto textureAtlasTexture : renderPassTextureAtlasTextures)
+        {
+            sTextureAtlasTextureGPU tatGPU;
+            tatGPU._textureInfo = glm::vec4(
+                textureAtlasTexture->GetOffset().x,
+                textureAtlasTexture->GetOffset().y,
+                textureAtlasTexture->GetSize().x,
+                textureAtlasTexture->GetSize().y
+            );
+            tatGPU._textureLayerInfo = textureAtlasTexture->GetOffset().z;
 
-                    cMaterialInstance mi(materialIndex, material);
+            memcpy((void*)((usize)_opaqueTextureAtlasTextures + _opaqueTextureAtlasTexturesByteSize), &tatGPU, sizeof(sTextureAtlasTextureGPU));
+            _opaqueTextureAtlasTexturesByteSize += sizeof(sTextureAtlasTextureGPU);
+        }
 
-                    _materialsMap->insert({ material, materialIndex });
+        _gfx->WriteBuffer(_opaqueTextureAtlasTexturesBuffer, 0, _opaqueTextureAtlasTexturesByteSize, _opaqueTextureAtlasTextures);
+    }
 
-                    memcpy((void*)((usize)_opaqueMaterials + (usize)_opaqueMaterialsByteSize), &mi, sizeof(cMaterialInstance));
-                    _opaqueMaterialsByteSize += sizeof(cMaterialInstance);
-                }
-                else
-                {
-                    materialIndex = it->second;
-                }
-            }
+    void cGraphics::WriteObjectsToTransparentBuffers(const glm::mat4* worlds, cMaterial* const* materials, const u32* indices, usize count, cRenderPass* renderPass)
+    {
+        iApplication* app = _context->GetSubsystem<cEngine>()->GetApplication();
+        const sCapabilities* caps = app->GetCapabilities();
 
-            const sRenderInstance ri(materialIndex, transform);
+        if (count > caps->maxRenderTransparentInstanceCount)
+        {
+            Print("Error: transparent instance limit reached, extra instances are skipped!");
+            count = caps->maxRenderTransparentInstanceCount;
+        }
 
-            memcpy((void*)((usize)_opaqueInstances + _opaqueInstancesByteSize), &ri, sizeof(sRenderInstance));
-            _opaqueInstancesByteSize += sizeof(sRenderInstance);
+        _transparentInstanceRing->BeginFrame();
+        _transparentMaterialRing->BeginFrame();
 
-            _opaqueInstanceCount += 1;
-        }
+        sRenderInstance* instances = (sRenderInstance*)_transparentInstanceRing->GetFrameData();
+        cMaterialInstance* materialInstances = (cMaterialInstance*)_transparentMaterialRing->GetFrameData();
+        if (instances == nullptr || materialInstances == nullptr)
+            return;
+
+        _transparentInstanceCount = _instanceBuilder->Build(worlds, materials, indices, count, instances, materialInstances);
+        _transparentInstanceRing->Flush(_transparentInstanceCount * sizeof(sRenderInstance));
+        _transparentMaterialRing->Flush(_instanceBuilder->GetMaterialCount() * sizeof(cMaterialInstance));
+        _transparentTextureAtlasTexturesByteSize = 0;
 
         const std::vector<cTextureAtlasTexture*>& renderPassTextureAtlasTextures = renderPass->GetInputTextureAtlasTextures();
         for (const auto textureAtlasTexture : renderPassTextureAtlasTextures)
@@ -720,98 +1042,225 @@ namespace triton
             );
             tatGPU._textureLayerInfo = textureAtlasTexture->GetOffset().z;
 
-            memcpy((void*)((usize)_opaqueTextureAtlasTextures + _opaqueTextureAtlasTexturesByteSize), &tatGPU, sizeof(sTextureAtlasTextureGPU));
-            _opaqueTextureAtlasTexturesByteSize += sizeof(sTextureAtlasTextureGPU);
+            memcpy((void*)((usize)_transparentTextureAtlasTextures + (usize)_transparentTextureAtlasTexturesByteSize), &tatGPU, sizeof(sTextureAtlasTextureGPU));
+            _transparentTextureAtlasTexturesByteSize += sizeof(sTextureAtlasTextureGPU);
         }
 
-        _gfx->WriteBuffer(_opaqueInstanceBuffer, 0, _opaqueInstancesByteSize, _opaqueInstances);
-        _gfx->WriteBuffer(_opaqueMaterialBuffer, 0, _opaqueMaterialsByteSize, _opaqueMaterials);
-        _gfx->WriteBuffer(_opaqueTextureAtlasTexturesBuffer, 0, _opaqueTextureAtlasTexturesByteSize, _opaqueTextureAtlasTextures);
+        _gfx->WriteBuffer(_transparentTextureAtlasTexturesBuffer, 0, _transparentTextureAtlasTexturesByteSize, _transparentTextureAtlasTextures);
     }
 
-    void cGraphics::WriteObjectsToTransparentBuffers(cIdVector<cGameObject>& objects, cRenderPass* renderPass)
+    static_assert(kMaxGeometryLodCount <= (1ull << cDrawList::kLodBitCount), "draw keys must hold every LOD");
+
+    void cGraphics::WriteOpaqueDrawCommands(const sVertexBufferGeometry* const* geometries, const u32* indices, usize count, const u8* lods)
     {
-        _transparentInstanceCount = 0;
-        _transparentInstancesByteSize = 0;
-        _transparentMaterialsByteSize = 0;
-        _materialsMap->clear();
+        _opaqueDrawCommandCount = 0;
+        memset(_opaqueDrawCommandCounts, 0, sizeof(_opaqueDrawCommandCounts));
 
-        cGameObject* objectsArray = objects.GetElements();
+        if (count > _opaqueInstanceCount)
+            count = _opaqueInstanceCount;
 
-        for (usize i = 0; i < objects.GetElementCount(); i++)
+        // One walk per vertex format so each format's commands are contiguous, formats no object uses are skipped
+        u32 pendingFormats = 1;
+        boolean full = K_FALSE;
+        for (usize format = 0; format < kVertexFormatCount && full == K_FALSE; format++)
         {
-            const cGameObject& go = objectsArray[i];
-
-            cTransform transform(&go);
-            transform.Transform();
-
-            s32 materialIndex = -1;
-            cMaterial* material = go.GetMaterial();
-            sVertexBufferGeometry* geometry = go.GetGeometry();
-
-            if (geometry == nullptr)
+            if ((pendingFormats & (1u << format)) == 0)
                 continue;
 
-            if (material != nullptr)
+            const usize firstCommand = _opaqueDrawCommandCount;
+            const sVertexBufferGeometry* runGeometry = nullptr;
+            usize runLod = 0;
+            for (usize i = 0; i < count; i++)
             {
-                auto it = _materialsMap->find(material);
-                if (it == _materialsMap->end())
+                const usize object = indices != nullptr ? indices[i] : i;
+                const sVertexBufferGeometry* geometry = geometries[object];
+                if (geometry == nullptr || geometry->_format != kVertexFormats[format])
+                {
+                    if (geometry != nullptr)
+                        pendingFormats |= 1u << GetVertexFormatIndex(geometry->_format);
+                    runGeometry = nullptr;
+                    continue;
+                }
+
+                const usize lod = lods != nullptr && lods[object] < geometry->_lodCount ? lods[object] : 0;
+                if (geometry == runGeometry && lod == runLod)
+                {
+                    _opaqueDrawCommands[_opaqueDrawCommandCount - 1].instanceCount += 1;
+                    continue;
+                }
+
+                if (_opaqueDrawCommandCount >= _maxDrawCommandCount)
                 {
-                    materialIndex = _materialsMap->size();
+                    Print("Error: draw command limit reached, extra draws are skipped!");
+                    full = K_TRUE;
+                    break;
+                }
+
+                runGeometry = geometry;
+                runLod = lod;
+                sDrawIndirectCommand& command = _opaqueDrawCommands[_opaqueDrawCommandCount++];
+                command.indexCount = geometry->_lods[lod].indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = (u32)(geometry->_offsetIndex / sizeof(u32)) + geometry->_lods[lod].firstIndex;
+                command.baseVertex = (s32)geometry->_offsetVertex;
+                command.baseInstance = (u32)i;
+            }
+            _opaqueDrawCommandCounts[format] = _opaqueDrawCommandCount - firstCommand;
+        }
+
+        _gfx->WriteBuffer(_opaqueDrawCommandBuffer, 0, _opaqueDrawCommandCount * sizeof(sDrawIndirectCommand), _opaqueDrawCommands);
+    }
+
+    void cGraphics::SelectLods(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const u32* objects, usize count, u8* lods)
+    {
+        cCameraSystem* cameraSystem = _context->GetSubsystem<cCameraSystem>();
+        if (cameraSystem == nullptr)
+            return;
+
+        const iApplication* app = _context->GetSubsystem<cEngine>()->GetApplication();
+        const cWindow* window = app->GetWindow();
+        const f32 viewportHeight = window != nullptr ? (f32)window->GetHeight() : (f32)app->GetCapabilities()->windowHeight;
+        const ecs::components::sCameraComponent* camera = cameraSystem->GetCamera();
+        const glm::vec3 cameraPosition = glm::vec3(glm::inverse(*(const glm::mat4*)camera->_view.GetData())[3]);
+
+        _lodSelector->Select(geometries, worlds, objects, count, cameraPosition, cLodSelector::MakeProjectionScale(cMath::DegreesToRadians(camera->_fov), viewportHeight), lods);
+    }
+
+    void cGraphics::WriteOpaqueDrawCommands(const cDrawList* drawList, const sVertexBufferGeometry* const* geometries, const u8* lods)
+    {
+        _opaqueDrawCommandCount = 0;
+        memset(_opaqueDrawCommandCounts, 0, sizeof(_opaqueDrawCommandCounts));
+
+        const u32* objects = drawList->GetSortedObjects();
 
-                    cMaterialInstance mi(materialIndex, material);
+        // Batches are walked once per vertex format so each format's commands are contiguous
+        const sDrawBatch* batches = drawList->GetBatches();
+        u32 pendingFormats = 1;
+        boolean full = K_FALSE;
+        for (usize format = 0; format < kVertexFormatCount && full == K_FALSE; format++)
+        {
+            if ((pendingFormats & (1u << format)) == 0)
+                continue;
 
-                    _materialsMap->insert({ material, materialIndex });
+            const usize firstCommand = _opaqueDrawCommandCount;
+            for (usize i = 0; i < drawList->GetBatchCount() && full == K_FALSE; i++)
+            {
+                const sDrawBatch& batch = batches[i];
+                if (batch.first >= _opaqueInstanceCount)
+                    break;
 
-                    memcpy((void*)((usize)_transparentMaterials + _transparentMaterialsByteSize), &mi, sizeof(cMaterialInstance));
-                    _transparentMaterialsByteSize += sizeof(cMaterialInstance);
+                const sVertexBufferGeometry* geometry = geometries[objects[batch.first]];
+                if (geometry == nullptr)
+                    continue;
+                if (geometry->_format != kVertexFormats[format])
+                {
+                    pendingFormats |= 1u << GetVertexFormatIndex(geometry->_format);
+                    continue;
                 }
-                else
+
+                // Keys made with the selected LOD give one run per batch, runs only split for keys made without it
+                const usize end = batch.first + batch.count <= _opaqueInstanceCount ? batch.first + batch.count : _opaqueInstanceCount;
+                usize runLod = kMaxGeometryLodCount;
+                for (usize j = batch.first; j < end; j++)
                 {
-                    materialIndex = it->second;
+                    const u32 object = objects[j];
+                    const usize lod = lods != nullptr && lods[object] < geometry->_lodCount ? lods[object] : 0;
+                    if (lod == runLod)
+                    {
+                        _opaqueDrawCommands[_opaqueDrawCommandCount - 1].instanceCount += 1;
+                        continue;
+                    }
+
+                    if (_opaqueDrawCommandCount >= _maxDrawCommandCount)
+                    {
+                        Print("Error: draw command limit reached, extra draws are skipped!");
+                        full = K_TRUE;
+                        break;
+                    }
+
+                    runLod = lod;
+                    sDrawIndirectCommand& command = _opaqueDrawCommands[_opaqueDrawCommandCount++];
+                    command.indexCount = geometry->_lods[lod].indexCount;
+                    command.instanceCount = 1;
+                    command.firstIndex = (u32)(geometry->_offsetIndex / sizeof(u32)) + geometry->_lods[lod].firstIndex;
+                    command.baseVertex = (s32)geometry->_offsetVertex;
+                    command.baseInstance = (u32)j;
                 }
             }
+            _opaqueDrawCommandCounts[format] = _opaqueDrawCommandCount - firstCommand;
+        }
 
-            const sRenderInstance ri(materialIndex, transform);
-
-            memcpy((void*)((usize)_transparentInstances + _transparentInstancesByteSize), &ri, sizeof(sRenderInstance));
-            _transparentInstancesByteSize += sizeof(sRenderInstance);
+        _gfx->WriteBuffer(_opaqueDrawCommandBuffer, 0, _opaqueDrawCommandCount * sizeof(sDrawIndirectCommand), _opaqueDrawCommands);
+    }
 
-            _transparentInstanceCount += 1;
+    void cGraphics::WriteOpaqueDrawCommands(const sDrawIndirectCommand* commands, usize count, eCategory vertexFormat)
+    {
+        const usize format = GetVertexFormatIndex(vertexFormat);
+        if (format == kVertexFormatCount)
+        {
+            Print("Error: unsupported vertex buffer format!");
+            return;
         }
 
-        const std::vector<cTextureAtlasTexture*>& renderPassTextureAtlasTextures = renderPass->GetInputTextureAtlasTextures();
-        for (const auto textureAtlasTexture : renderPassTextureAtlasTextures)
+        _opaqueDrawCommandCount = count < _maxDrawCommandCount ? count : _maxDrawCommandCount;
+        if (_opaqueDrawCommandCount < count)
+            Print("Error: draw command limit reached, extra draws are skipped!");
+        memset(_opaqueDrawCommandCounts, 0, sizeof(_opaqueDrawCommandCounts));
+        _opaqueDrawCommandCounts[format] = _opaqueDrawCommandCount;
+
+        memcpy(_opaqueDrawCommands, commands, _opaqueDrawCommandCount * sizeof(sDrawIndirectCommand));
+        _gfx->WriteBuffer(_opaqueDrawCommandBuffer, 0, _opaqueDrawCommandCount * sizeof(sDrawIndirectCommand), _opaqueDrawCommands);
+    }
+
+    usize cGraphics::ValidateDrawCommands(const sDrawIndirectCommand* commands, usize drawCount, const u32* indices, usize indexCount, usize vertexCount, usize instanceCount)
+    {
+        for (usize i = 0; i < drawCount; i++)
         {
-            sTextureAtlasTextureGPU tatGPU;
-            tatGPU._textureInfo = glm::vec4(
-                textureAtlasTexture->GetOffset().x,
-                textureAtlasTexture->GetOffset().y,
-                textureAtlasTexture->GetSize().x,
-                textureAtlasTexture->GetSize().y
-            );
-            tatGPU._textureLayerInfo = textureAtlasTexture->GetOffset().z;
+            const sDrawIndirectCommand& command = commands[i];
 
-            memcpy((void*)((usize)_transparentTextureAtlasTextures + (usize)_transparentTextureAtlasTexturesByteSize), &tatGPU, sizeof(sTextureAtlasTextureGPU));
-            _transparentTextureAtlasTexturesByteSize += sizeof(sTextureAtlasTextureGPU);
+            if ((usize)command.firstIndex + command.indexCount > indexCount)
+            {
+                Print("Error: draw command " + std::to_string(i) + " reads past the index buffer!");
+                return i;
+            }
+            if (command.baseVertex < 0 || (usize)command.baseVertex >= vertexCount)
+            {
+                Print("Error: draw command " + std::to_string(i) + " has base vertex outside of the vertex buffer!");
+                return i;
+            }
+            if ((usize)command.baseInstance + command.instanceCount > instanceCount)
+            {
+                Print("Error: draw command " + std::to_string(i) + " reads past the instance buffer!");
+                return i;
+            }
+
+            if (indices == nullptr)
+                continue;
+
+            for (usize j = command.firstIndex; j < (usize)command.firstIndex + command.indexCount; j++)
+            {
+                if ((usize)command.baseVertex + indices[j] >= vertexCount)
+                {
+                    Print("Error: draw command " + std::to_string(i) + " references a vertex outside of the vertex buffer!");
+                    return i;
+                }
+            }
         }
 
-        _gfx->WriteBuffer(_transparentInstanceBuffer, 0, _transparentInstancesByteSize, _transparentInstances);
-        _gfx->WriteBuffer(_transparentMaterialBuffer, 0, _transparentMaterialsByteSize, _transparentMaterials);
-        _gfx->WriteBuffer(_transparentTextureAtlasTexturesBuffer, 0, _transparentTextureAtlasTexturesByteSize, _transparentTextureAtlasTextures);
-    }*/
+        return drawCount;
+    }
 
     void cGraphics::DrawGeometryOpaque(const sVertexBufferGeometry* geometry, const cGameObject* cameraObject, cRenderPass* renderPass)
     {
         if (renderPass == nullptr)
         {
-            _gfx->BindRenderPass(_opaque);
-            _gfx->SetShaderUniform(_opaque->GetShader(), "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->BindRenderPass(_opaque, nullptr, geometry->_format);
+            _gfx->SetShaderUniform(_opaque->GetShader(geometry->_format), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
         }
         else
         {
-            _gfx->BindRenderPass(renderPass);
-            _gfx->SetShaderUniform(renderPass->GetShader(), "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->BindRenderPass(renderPass, nullptr, geometry->_format);
+            _gfx->SetShaderUniform(renderPass->GetShader(geometry->_format), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
         }
 
         _gfx->Draw(
@@ -829,12 +1278,12 @@ namespace triton
 
     void cGraphics::DrawGeometryOpaque(const sVertexBufferGeometry* geometry, const cGameObject* cameraObject, cShader* singleShader)
     {
-        _gfx->BindRenderPass(_opaque, singleShader);
+        _gfx->BindRenderPass(_opaque, singleShader, geometry->_format);
 
         if (singleShader == nullptr)
-            _gfx->SetShaderUniform(_opaque->GetShader(), "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->SetShaderUniform(_opaque->GetShader(geometry->_format), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
         else
-            _gfx->SetShaderUniform(singleShader, "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->SetShaderUniform(singleShader, kViewProjectionID, cameraObject->GetViewProjectionMatrix());
 
         _gfx->Draw(
             geometry->_indexCount,
@@ -846,17 +1295,42 @@ namespace triton
         _gfx->UnbindRenderPass(_opaque);
     }
 
+    void cGraphics::DrawGeometryOpaqueIndirect(const cGameObject* cameraObject, cRenderPass* renderPass)
+    {
+        if (_opaqueDrawCommandCount == 0)
+            return;
+
+        if (renderPass == nullptr)
+            renderPass = _opaque;
+
+        // One multi draw per vertex format, the pass is rebound with that format's input layout and shader
+        usize firstCommand = 0;
+        for (usize format = 0; format < kVertexFormatCount; format++)
+        {
+            const usize commandCount = _opaqueDrawCommandCounts[format];
+            if (commandCount == 0)
+                continue;
+
+            _gfx->BindRenderPass(renderPass, nullptr, kVertexFormats[format]);
+            _gfx->SetShaderUniform(renderPass->GetShader(kVertexFormats[format]), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
+            _gfx->DrawIndirect(_opaqueDrawCommandBuffer, firstCommand * sizeof(sDrawIndirectCommand), commandCount);
+            firstCommand += commandCount;
+        }
+
+        _gfx->UnbindRenderPass(renderPass);
+    }
+
     void cGraphics::DrawGeometryTransparent(const sVertexBufferGeometry* geometry, const std::vector<cGameObject>& objects, const cGameObject* cameraObject, cRenderPass* renderPass)
     {
         if (renderPass == nullptr)
         {
-            _gfx->BindRenderPass(_transparent);
-            _gfx->SetShaderUniform(_transparent->GetShader(), "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->BindRenderPass(_transparent, nullptr, geometry->_format);
+            _gfx->SetShaderUniform(_transparent->GetShader(geometry->_format), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
         }
         else
         {
-            _gfx->BindRenderPass(renderPass);
-            _gfx->SetShaderUniform(renderPass->GetShader(), "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->BindRenderPass(renderPass, nullptr, geometry->_format);
+            _gfx->SetShaderUniform(renderPass->GetShader(geometry->_format), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
         }
 
         _gfx->Draw(
@@ -876,12 +1350,12 @@ namespace triton
 
     void cGraphics::DrawGeometryTransparent(const sVertexBufferGeometry* geometry, const cGameObject* cameraObject, cShader* singleShader)
     {
-        _gfx->BindRenderPass(_transparent, singleShader);
+        _gfx->BindRenderPass(_transparent, singleShader, geometry->_format);
 
         if (singleShader != nullptr)
-            _gfx->SetShaderUniform(singleShader, "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->SetShaderUniform(singleShader, kViewProjectionID, cameraObject->GetViewProjectionMatrix());
         else
-            _gfx->SetShaderUniform(_transparent->GetShader(), "ViewProjection", cameraObject->GetViewProjectionMatrix());
+            _gfx->SetShaderUniform(_transparent->GetShader(geometry->_format), kViewProjectionID, cameraObject->GetViewProjectionMatrix());
 
         _gfx->Draw(
             geometry->_indexCount,
@@ -975,7 +1449,7 @@ namespace triton
             _gfx->WriteBuffer(_textMaterialBuffer, 0, _textMaterialsByteSize, _textMaterials);
 
             _gfx->BindRenderPass(_text);
-            _gfx->BindTexture(_text->GetShader(), "FontAtlas", atlas, 0);
+            _gfx->BindTexture(_text->GetShader(), kFontAtlasID, atlas, 0);
             _gfx->DrawQuads(actualCharCount);
             _gfx->UnbindRenderPass(_text);
         }
@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include "../../thirdparty/glm/glm/glm.hpp"
 #include "render_context.hpp"
+#include "offset_allocator.hpp"
 #include "category.hpp"
 #include "types.hpp"
 
@@ -22,6 +23,15 @@ namespace triton
     struct sRenderTarget;
     struct sRenderPass;
     struct sShader;
+    class cInstanceBuilder;
+    class cUploadRing;
+    class cDrawList;
+    class cRenderGraph;
+    class cLightCulling;
+    class cLodSelector;
+    struct sMeshlet;
+    template <typename TValue>
+    class cPool;
 
     using index = types::u32;
 
@@ -32,11 +42,28 @@ namespace triton
         glm::vec3 _normal = glm::vec3(0.0f);
     };
 
-    struct sVertexBufferGeometry : public iObject
+    static constexpr types::usize kMaxGeometryLodCount = 4;
+
+    // Index range of one LOD, relative to the first index of the geometry
+    struct sGeometryLod
+    {
+        types::u32 firstIndex = 0;
+        types::u32 indexCount = 0;
+        types::f32 error = 0.0f; // object space distance from LOD 0
+    };
+
+    // One source mesh of a loaded file, an index range of LOD 0 relative to the first index of the geometry
+    struct sGeometrySubmesh
     {
-        TRITON_OBJECT(sVertexBufferGeometry)
+        types::u32 firstIndex = 0;
+        types::u32 indexCount = 0;
+        glm::vec3 aabbMin = glm::vec3(0.0f);
+        glm::vec3 aabbMax = glm::vec3(0.0f);
+    };
 
-        explicit sVertexBufferGeometry(cContext* context) : iObject(context) {} // TODO: Temporary solution
+    struct sVertexBufferGeometry
+    {
+        TRITON_POD(sVertexBufferGeometry)
 
         types::usize _vertexCount = 0;
         types::usize _indexCount = 0;
@@ -45,6 +72,17 @@ namespace triton
         types::usize _offsetVertex = 0;
         types::usize _offsetIndex = 0;
         eCategory _format = eCategory::VERTEX_BUFFER_FORMAT_NONE;
+        glm::vec3 _aabbMin = glm::vec3(0.0f);
+        glm::vec3 _aabbMax = glm::vec3(0.0f);
+        glm::vec4 _boundingSphere = glm::vec4(0.0f); // xyz - center, w - radius
+        sOffsetAllocation _vertexAllocation = {};
+        sOffsetAllocation _indexAllocation = {};
+        types::usize _lodCount = 1; // _indexCount is the LOD 0 index count
+        sGeometryLod _lods[kMaxGeometryLodCount] = {};
+        sMeshlet* _meshlets = nullptr; // LOD 0 split for cClusterCulling, index ranges relative to the geometry
+        types::usize _meshletCount = 0;
+        sGeometrySubmesh* _submeshes = nullptr; // nullptr unless loaded from a mesh file
+        types::usize _submeshCount = 0;
     };
 
     struct sPrimitive : public iObject
@@ -128,9 +166,12 @@ namespace triton
         glm::vec4 _highlightColor = glm::vec4(0.0f);
     };
 
+    // Matches Light in clustered_lights.shader, _attenuation.w is the range the light is culled with
     struct sLightInstance
     {
+        sLightInstance() = default;
         sLightInstance(const cGameObject* object);
+        sLightInstance(const glm::vec3& position, const sLight& light);
 
         cVector4 _position = cVector4(0.0f);
         cVector4 _color = cVector4(0.0f);
@@ -155,19 +196,23 @@ namespace triton
         inline const std::vector<cTextureAtlasTexture*>& GetInputTextureAtlasTextures() const { return _desc->inputTextureAtlasTextures; }
         inline cVertexArray* GetVertexArray() const { return _renderPass->GetVertexArray(); }
         inline cShader* GetShader() const { return _renderPass->GetShader(); }
+        inline cShader* GetShader(eCategory vertexFormat) const { return _renderPass->GetShader(vertexFormat); }
         inline cRenderTarget* GetRenderTarget() const { return _renderPass->GetRenderTarget(); }
         inline const sViewport& GetViewport() const { return _desc->viewport; }
         inline const std::vector<cBuffer*>& GetInputBuffers() const { return _desc->inputBuffers; }
         inline const std::vector<cTexture*>& GetInputTextures() const { return _desc->inputTextures; }
         inline const std::vector<std::string>& GetInputTextureNames() const { return _desc->inputTextureNames; }
+        inline const std::vector<cUniformID>& GetInputTextureIDs() const { return _inputTextureIDs; }
         inline const sBlendMode& GetBlendMode() const { return _desc->blendMode; }
         inline const sDepthMode& GetDepthMode() const { return _desc->depthMode; }
+        inline types::boolean GetBackfaceCulling() const { return _desc->useBackfaceCulling; }
         inline cRenderPassGPU* GetRenderPassGPU() const { return _renderPass; }
         inline void SetInputTexture(types::usize textureIndex, cTexture* texture) { _desc->inputTextures[textureIndex] = texture; }
 
     private:
         sRenderPassDescriptor* _desc = nullptr;
         cRenderPassGPU* _renderPass = nullptr;
+        std::vector<cUniformID> _inputTextureIDs = {};
     };
 
 	class cGraphics : public iObject
@@ -179,7 +224,8 @@ namespace triton
 		{
 			NONE = 0,
 			OGL,
-			D3D11
+			D3D11,
+			NONE_RECORDING
 		};
 
 	public:
@@ -189,7 +235,10 @@ namespace triton
         // TODO: Remove material creation from cGraphics
         //cCacheObject<cMaterial> CreateMaterial(const std::string& id, cTextureAtlasTexture* diffuseTexture, const glm::vec4& diffuseColor, const glm::vec4& highlightColor, eCategory customShaderRenderPath = eCategory::RENDER_PATH_OPAQUE, const std::string& customVertexFuncPath = "", const std::string& customFragmentFuncPath = "");
         cVertexArray* CreateDefaultVertexArray();
-        sVertexBufferGeometry* CreateGeometry(eCategory format, types::usize verticesByteSize, const void* vertices, types::usize indicesByteSize, const void* indices);
+        // Bounds are computed from the vertices unless computeBounds is K_FALSE, the caller fills them in then
+        sVertexBufferGeometry* CreateGeometry(eCategory format, types::usize verticesByteSize, const void* vertices, types::usize indicesByteSize, const void* indices, types::boolean computeBounds = types::K_TRUE);
+        // Uploads a mesh cooked by MeshCooker straight from a memory mapping of the file
+        sVertexBufferGeometry* LoadGeometry(const std::string& path);
         cRenderPass* CreateRenderPass(sRenderPassDescriptor* desc);
         sPrimitive* CreatePrimitive(eCategory primitive);
         sModel* CreateModel(const std::string& filename);
@@ -205,19 +254,48 @@ namespace triton
         void DestroyPrimitive(sPrimitive* primitiveObject);
         void DestroyModel(sModel* model);
         
+        // Frees every geometry at once, geometries created before are invalid afterwards
         void ClearGeometryBuffer();
+        // Moves geometries into free ranges lower in the heaps until maxByteSize bytes were copied, returns the copied byte size.
+        // A pass visits every geometry once, top of the heap first, and continues where the last call stopped. The order is
+        // only rebuilt after geometries were created or destroyed, or when the last pass still moved something.
+        types::usize DefragmentGeometry(types::usize maxByteSize);
         void ClearRenderPass(const cRenderPass* renderPass, types::boolean clearColor, types::usize bufferIndex, const glm::vec4& color, types::boolean clearDepth, types::f32 depth);
         void ClearRenderPasses(const glm::vec4& clearColor, types::f32 clearDepth);
+        // Applies pending render graph changes such as a resize and runs the budgeted geometry defragmentation,
+        // call before the first pass of a frame
+        void BeginFrame();
         void ResizeRenderTargets(const glm::vec2& size);
         void LoadShaderFiles(const std::string& vertexFuncPath, const std::string& fragmentFuncPath, std::string& vertexFunc, std::string& fragmentFunc);
-        void UpdateLights();
+        // Uploads the lights of the scene, their froxel grid is built by the next UpdateLights
+        void SetLights(const sLightInstance* lights, types::usize count);
+        // Culls the lights into the froxel grid of the camera and uploads it, cCameraSystem calls it once per frame.
+        // The opaque and transparent passes light every fragment with the lights of its cluster only
+        void UpdateLights(const cMatrix4& view, const cMatrix4& projection, types::f32 zNear, types::f32 zFar);
         
-        // TODO: Implement new CPU->GPU geometry buffer communication
-        //void WriteObjectsToOpaqueBuffers(cIdVector<cGameObject>& objects, cRenderPass* renderPass);
-        //void WriteObjectsToTransparentBuffers(cIdVector<cGameObject>& objects, cRenderPass* renderPass);
+        // Instance i reads worlds[indices[i]] and materials[indices[i]], pass nullptr indices to take all count objects
+        void WriteObjectsToOpaqueBuffers(const glm::mat4* worlds, cMaterial* const* materials, const types::u32* indices, types::usize count, cRenderPass* renderPass);
+        void WriteObjectsToTransparentBuffers(const glm::mat4* worlds, cMaterial* const* materials, const types::u32* indices, types::usize count, cRenderPass* renderPass);
+        // Takes the same object list as WriteObjectsToOpaqueBuffers, objects sharing a geometry must be adjacent,
+        // every run becomes one indirect command whose base instance is the position of the run in the list.
+        // lods is indexed like geometries (see cLodSelector), runs also split where the LOD changes.
+        // Commands are grouped by vertex format, DrawGeometryOpaqueIndirect binds each format's layout once.
+        void WriteOpaqueDrawCommands(const sVertexBufferGeometry* const* geometries, const types::u32* indices, types::usize count, const types::u8* lods = nullptr);
+        // Selects the LODs of the listed objects for the camera of cCameraSystem, objects may be nullptr for 0..count-1.
+        // lods is indexed like geometries and keeps the choice between frames (see cLodSelector). Run it on the visible
+        // objects before the draw keys are made, so the LOD goes into the key and batches don't mix LODs.
+        void SelectLods(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const types::u32* objects, types::usize count, types::u8* lods);
+        // Takes a sorted draw list whose GetSortedObjects was fed to WriteObjectsToOpaqueBuffers, one indirect command per batch.
+        // lods are the ones SelectLods picked, batches split where the LOD changes when the keys were made without it.
+        void WriteOpaqueDrawCommands(const cDrawList* drawList, const sVertexBufferGeometry* const* geometries, const types::u8* lods = nullptr);
+        // Takes commands built elsewhere, e.g. by cClusterCulling, for geometry of a single vertex format
+        void WriteOpaqueDrawCommands(const sDrawIndirectCommand* commands, types::usize count, eCategory vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3);
+        // Returns the index of the first invalid command or drawCount when all are valid, indices may be nullptr to skip the per-index check
+        static types::usize ValidateDrawCommands(const sDrawIndirectCommand* commands, types::usize drawCount, const types::u32* indices, types::usize indexCount, types::usize vertexCount, types::usize instanceCount);
         
         void DrawGeometryOpaque(const sVertexBufferGeometry* geometry, const cGameObject* cameraObject, cRenderPass* renderPass);
         void DrawGeometryOpaque(const sVertexBufferGeometry* geometry, const cGameObject* cameraObject, cShader* singleShader = nullptr);
+        void DrawGeometryOpaqueIndirect(const cGameObject* cameraObject, cRenderPass* renderPass = nullptr);
         void DrawGeometryTransparent(const sVertexBufferGeometry* geometry, const std::vector<cGameObject>& objects, const cGameObject* cameraObject, cRenderPass* renderPass);
         void DrawGeometryTransparent(const sVertexBufferGeometry* geometry, const cGameObject* cameraObject, cShader* singleShader = nullptr);
         // TODO: Implement new text drawing approach
@@ -229,13 +307,22 @@ namespace triton
         inline iGraphicsAPI* GetAPI() const { return _gfx; }
         inline cBuffer* GetVertexBuffer() const { return _vertexBuffer; }
         inline cBuffer* GetIndexBuffer() const { return _indexBuffer; }
+        inline sOffsetAllocatorStats GetVertexHeapStats() const { return _vertexHeap->GetStats(); }
+        inline sOffsetAllocatorStats GetIndexHeapStats() const { return _indexHeap->GetStats(); }
         inline cBuffer* GetOpaqueInstanceBuffer() const { return _opaqueInstanceBuffer; }
         inline cBuffer* GetTextInstanceBuffer() const { return _textInstanceBuffer; }
         inline cBuffer* GetOpaqueMaterialBuffer() const { return _opaqueMaterialBuffer; }
+        inline cBuffer* GetOpaqueDrawCommandBuffer() const { return _opaqueDrawCommandBuffer; }
+        inline const sDrawIndirectCommand* GetOpaqueDrawCommands() const { return _opaqueDrawCommands; }
+        inline types::usize GetOpaqueDrawCommandCount() const { return _opaqueDrawCommandCount; }
         inline cBuffer* GetTransparentInstanceBuffer() const { return _transparentInstanceBuffer; }
         inline cBuffer* GetTransparentMaterialBuffer() const { return _transparentMaterialBuffer; }
         inline cBuffer* GetTextMaterialBuffer() const { return _textMaterialBuffer; }
         inline cBuffer* GetLightBuffer() const { return _lightBuffer; }
+        inline cBuffer* GetLightGridBuffer() const { return _lightGridBuffer; }
+        inline cBuffer* GetLightIndexBuffer() const { return _lightIndexBuffer; }
+        inline cLightCulling* GetLightCulling() const { return _lightCulling; }
+        inline cLodSelector* GetLodSelector() const { return _lodSelector; }
         inline cBuffer* GetOpaqueTextureAtlasTexturesBuffer() const { return _opaqueTextureAtlasTexturesBuffer; }
         inline cBuffer* GetTransparentTextureAtlasTexturesBuffer() const { return _transparentTextureAtlasTexturesBuffer; }
         inline cRenderPass* GetOpaqueRenderPass() const { return _opaque; }
@@ -243,8 +330,9 @@ namespace triton
         inline cRenderPass* GetTextRenderPass() const { return _text; }
         inline cRenderPass* GetCompositeTransparentRenderPass() const { return _compositeTransparent; }
         inline cRenderPass* GetCompositeFinalRenderPass() const { return _compositeFinal; }
-        inline cRenderTarget* GetOpaqueRenderTarget() const { return _opaqueRenderTarget; }
-        inline cRenderTarget* GetTransparentRenderTarget() const { return _transparentRenderTarget; }
+        inline cRenderTarget* GetOpaqueRenderTarget() const { return _opaque->GetRenderTarget(); }
+        inline cRenderTarget* GetTransparentRenderTarget() const { return _transparent->GetRenderTarget(); }
+        inline cRenderGraph* GetRenderGraph() const { return _renderGraph; }
 
 	private:
 		iGraphicsAPI* _gfx = nullptr;
@@ -254,6 +342,7 @@ namespace triton
         types::usize _maxMaterialBufferByteSize = 0;
         types::usize _maxLightBufferByteSize = 0;
         types::usize _maxTextureAtlasTexturesBufferByteSize = 0;
+        types::usize _maxDrawCommandCount = 0;
         cBuffer* _vertexBuffer = nullptr;
         cBuffer* _indexBuffer = nullptr;
         cBuffer* _opaqueInstanceBuffer = nullptr;
@@ -263,43 +352,56 @@ namespace triton
         cBuffer* _transparentMaterialBuffer = nullptr;
         cBuffer* _textMaterialBuffer = nullptr;
         cBuffer* _lightBuffer = nullptr;
+        cBuffer* _lightGridBuffer = nullptr;
+        cBuffer* _lightIndexBuffer = nullptr;
         cBuffer* _opaqueTextureAtlasTexturesBuffer = nullptr;
         cBuffer* _transparentTextureAtlasTexturesBuffer = nullptr;
         cBuffer* _textTextureAtlasTexturesBuffer = nullptr;
+        cBuffer* _opaqueDrawCommandBuffer = nullptr;
         types::usize _opaqueInstanceCount = 0;
         types::usize _transparentInstanceCount = 0;
+        cOffsetAllocator* _vertexHeap = nullptr;
+        cOffsetAllocator* _indexHeap = nullptr;
+        types::usize _geometryDefragmentByteSizePerFrame = 0;
+        std::vector<sVertexBufferGeometry*> _defragmentOrder = {};
+        types::usize _defragmentCursor = 0;
+        types::usize _defragmentPassByteSize = 0;
+        types::boolean _defragmentDirty = types::K_TRUE;
+        // Optional CPU copies of the heaps, nullptr unless keepGeometryCPUCopy is set
         void* _vertices = nullptr;
-        types::usize _verticesByteSize = 0;
         void* _indices = nullptr;
-        types::usize _indicesByteSize = 0;
-        void* _opaqueInstances = nullptr;
-        types::usize _opaqueInstancesByteSize = 0;
-        void* _transparentInstances = nullptr;
-        types::usize _transparentInstancesByteSize = 0;
+        cPool<sVertexBufferGeometry>* _geometries = nullptr;
+        cInstanceBuilder* _instanceBuilder = nullptr;
+        cLightCulling* _lightCulling = nullptr;
+        cLodSelector* _lodSelector = nullptr;
+        cUploadRing* _opaqueInstanceRing = nullptr;
+        cUploadRing* _transparentInstanceRing = nullptr;
+        cUploadRing* _opaqueMaterialRing = nullptr;
+        cUploadRing* _transparentMaterialRing = nullptr;
         void* _textInstances = nullptr;
         types::usize _textInstancesByteSize = 0;
-        void* _opaqueMaterials = nullptr;
-        types::usize _opaqueMaterialsByteSize = 0;
-        void* _transparentMaterials = nullptr;
-        types::usize _transparentMaterialsByteSize = 0;
         void* _textMaterials = nullptr;
         types::usize _textMaterialsByteSize = 0;
         void* _lights = nullptr;
         types::usize _lightsByteSize = 0;
+        types::usize _lightCount = 0;
         void* _opaqueTextureAtlasTextures = nullptr;
         types::usize _opaqueTextureAtlasTexturesByteSize = 0;
         void* _transparentTextureAtlasTextures = nullptr;
         types::usize _transparentTextureAtlasTexturesByteSize = 0;
         void* _textTextureAtlasTextures = nullptr;
         types::usize _textTextureAtlasTexturesByteSize = 0;
+        sDrawIndirectCommand* _opaqueDrawCommands = nullptr;
+        types::usize _opaqueDrawCommandCount = 0;
+        // Commands of each vertex format follow each other in kVertexFormats order
+        types::usize _opaqueDrawCommandCounts[kVertexFormatCount] = {};
         std::unordered_map<cMaterial*, types::s32>* _materialsMap = {};
         cRenderPass* _opaque = nullptr;
         cRenderPass* _transparent = nullptr;
         cRenderPass* _text = nullptr;
         cRenderPass* _compositeTransparent = nullptr;
         cRenderPass* _compositeFinal = nullptr;
-        cRenderTarget* _opaqueRenderTarget = nullptr;
-        cRenderTarget* _transparentRenderTarget = nullptr;
+        cRenderGraph* _renderGraph = nullptr;
         types::usize _materialCountCPU = 0;
 	};
 }
\ No newline at end of file
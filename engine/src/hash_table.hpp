@@ -17,9 +17,9 @@ namespace triton
 	class cHashTable;
 
 	template <typename TKey, typename TValue>
-	class cHashTablePair : public iObject
+	class cHashTablePair : public cStackValue
 	{
-		TRITON_OBJECT(cHashTablePair)
+		TRITON_POD(cHashTablePair)
 
 		friend class cHashTable<TKey, TValue>;
 
@@ -27,8 +27,9 @@ namespace triton
 		TValue _value = {};
 
 	public:
-		explicit cHashTablePair(cContext* context, const TKey& key, TValue&& value);
-		virtual ~cHashTablePair() override final = default;
+		explicit cHashTablePair(const TKey& key, TValue&& value);
+		cHashTablePair(cHashTablePair&& rhs) = default;
+		~cHashTablePair() = default;
 	};
 
 	template <typename TKey, typename TValue>
@@ -53,7 +54,7 @@ namespace triton
 		inline types::usize GetSize() const { return _elements->GetSize(); }
 
 	private:
-		void HashPair(const TKey& key, const TValue* value);
+		void HashPair(const TKey& key, const cHashTablePair<TKey, TValue>* pair);
 
 		sChunkAllocatorDescriptor _allocatorDesc = {};
 		cStack<cHashTablePair<TKey, TValue>>* _elements;
@@ -63,8 +64,8 @@ namespace triton
 	};
 
 	template <typename TKey, typename TValue>
-	cHashTablePair<TKey, TValue>::cHashTablePair(cContext* context, const TKey& key, TValue&& value)
-		: iObject(context), _key(key), _value(std::move(value)) {}
+	cHashTablePair<TKey, TValue>::cHashTablePair(const TKey& key, TValue&& value)
+		: _key(key), _value(std::move(value)) {}
 
 	template <typename TKey, typename TValue>
 	cHashTable<TKey, TValue>::cHashTable(cContext* context, const sChunkAllocatorDescriptor& allocatorDesc) : iObject(context)
@@ -94,7 +95,7 @@ namespace triton
 	TValue* cHashTable<TKey, TValue>::Insert(const TKey& key, Args&&... args)
 	{
 		TValue value(std::forward<Args>(args)...);
-		cHashTablePair<TKey, TValue> pair(_context, key, std::move(value));
+		cHashTablePair<TKey, TValue> pair(key, std::move(value));
 		cHashTablePair<TKey, TValue>* pPair = _elements->Push(std::move(pair));
 
 		if (pPair == nullptr)
@@ -102,7 +103,7 @@ namespace triton
 
 		TValue* object = &pPair->_value;
 
-		HashPair(key, object);
+		HashPair(key, pPair);
 
 		return object;
 	}*/
@@ -110,17 +111,15 @@ namespace triton
 	template <typename TKey, typename TValue>
 	TValue* cHashTable<TKey, TValue>::Insert(const TKey& key, TValue&& value)
 	{
-		cHashTablePair<TKey, TValue> pair(_context, std::move(key), std::move(value));
+		cHashTablePair<TKey, TValue> pair(key, std::move(value));
 		cHashTablePair<TKey, TValue>* pPair = _elements->Push(std::move(pair));
 
 		if (pPair == nullptr)
 			return nullptr;
 
-		TValue* object = &pPair->_value;
-
-		HashPair(key, object);
+		HashPair(key, pPair);
 
-		return object;
+		return &pPair->_value;
 	}
 
 	template <typename TKey, typename TValue>
@@ -177,12 +176,12 @@ namespace triton
 	}
 
 	template <typename TKey, typename TValue>
-	void cHashTable<TKey, TValue>::HashPair(const TKey& key, const TValue* value)
+	void cHashTable<TKey, TValue>::HashPair(const TKey& key, const cHashTablePair<TKey, TValue>* pair)
 	{
 		cStackValue sv = {};
-		sv.chunk = value->chunk;
-		sv.localPosition = value->localPosition;
-		sv.globalPosition = value->globalPosition;
+		sv.chunk = pair->chunk;
+		sv.localPosition = pair->localPosition;
+		sv.globalPosition = pair->globalPosition;
 
 		const types::u32 hash = cMath::Hash<TKey>(key, _hashMask);
 		_hashTable[hash] = sv;
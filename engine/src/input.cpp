@@ -74,7 +74,10 @@ namespace triton
 
     cInput::cInput(cContext* context) : iObject(context)
     {
-        if (_initialized == types::K_FALSE)
+        const sCapabilities* caps = context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+
+        // Headless graphics has no window, GLFW stays uninitialized
+        if (_initialized == types::K_FALSE && caps->headlessGraphics == types::K_FALSE)
         {
             _initialized = types::K_TRUE;
 
@@ -0,0 +1,162 @@
+// instance_builder.cpp
+
+#include <new>
+#include <thread>
+#include "instance_builder.hpp"
+#include "graphics.hpp"
+#include "thread_manager.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    static inline usize HashMaterial(const cMaterial* material)
+    {
+        const u64 value = (u64)(usize)material;
+
+        return (usize)((value >> 4) * 0x9E3779B97F4A7C15ull >> 32);
+    }
+
+    cInstanceBuilder::cInstanceBuilder(cContext* context, usize maxMaterialCount) : iObject(context), _maxMaterialCount(maxMaterialCount)
+    {
+        const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+        // Power of two with at most 50% load
+        _slotCount = 16;
+        while (_slotCount < _maxMaterialCount * 2)
+            _slotCount <<= 1;
+
+        _slotMaterials = (std::atomic<cMaterial*>*)memoryAllocator->Allocate(_slotCount * sizeof(std::atomic<cMaterial*>), caps->memoryAlignment);
+        _slotIndices = (std::atomic<s32>*)memoryAllocator->Allocate(_slotCount * sizeof(std::atomic<s32>), caps->memoryAlignment);
+        for (usize i = 0; i < _slotCount; i++)
+        {
+            new (&_slotMaterials[i]) std::atomic<cMaterial*>(nullptr);
+            new (&_slotIndices[i]) std::atomic<s32>(kPendingIndex);
+        }
+    }
+
+    cInstanceBuilder::~cInstanceBuilder()
+    {
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+        memoryAllocator->Deallocate(_slotIndices);
+        memoryAllocator->Deallocate(_slotMaterials);
+    }
+
+    usize cInstanceBuilder::Build(const glm::mat4* worlds, cMaterial* const* materials, const u32* indices, usize count, sRenderInstance* instances, cMaterialInstance* materialInstances)
+    {
+        for (usize i = 0; i < _slotCount; i++)
+        {
+            _slotMaterials[i].store(nullptr, std::memory_order_relaxed);
+            _slotIndices[i].store(kPendingIndex, std::memory_order_relaxed);
+        }
+        _nextMaterialIndex.store(0, std::memory_order_relaxed);
+        _overflow.store(K_FALSE, std::memory_order_relaxed);
+
+        cThread* threads = _context->GetSubsystem<cThread>();
+        const usize workerCount = threads != nullptr ? threads->GetThreadCount() + 1 : 1;
+        usize jobCount = (count + kMinInstanceCountPerJob - 1) / kMinInstanceCountPerJob;
+        if (jobCount > workerCount)
+            jobCount = workerCount;
+
+        if (jobCount <= 1 || threads == nullptr)
+        {
+            BuildRange(worlds, materials, indices, 0, count, instances, materialInstances);
+        }
+        else
+        {
+            const usize countPerJob = (count + jobCount - 1) / jobCount;
+            threads->Dispatch(jobCount, [&](usize jobIndex) {
+                const usize begin = jobIndex * countPerJob;
+                const usize end = begin + countPerJob < count ? begin + countPerJob : count;
+                if (begin < end)
+                    BuildRange(worlds, materials, indices, begin, end, instances, materialInstances);
+            });
+        }
+
+        const usize materialCount = (usize)_nextMaterialIndex.load(std::memory_order_acquire);
+        _materialCount = materialCount < _maxMaterialCount ? materialCount : _maxMaterialCount;
+
+        if (_overflow.load(std::memory_order_relaxed) == K_TRUE)
+            Print("Error: render material limit reached, instances use no material!");
+
+        return count;
+    }
+
+    void cInstanceBuilder::BuildRange(const glm::mat4* worlds, cMaterial* const* materials, const u32* indices, usize begin, usize end, sRenderInstance* instances, cMaterialInstance* materialInstances)
+    {
+        // Neighbouring instances mostly share a material, skip the table for repeats
+        cMaterial* lastMaterial = nullptr;
+        s32 lastMaterialIndex = -1;
+
+        for (usize i = begin; i < end; i++)
+        {
+            const usize source = indices != nullptr ? indices[i] : i;
+            cMaterial* material = materials[source];
+
+            if (material != lastMaterial)
+            {
+                lastMaterial = material;
+                lastMaterialIndex = material != nullptr ? ResolveMaterial(material, materialInstances) : -1;
+            }
+
+            sRenderInstance& instance = instances[i];
+            instance._use2D = 0.0f;
+            instance._materialIndex = lastMaterialIndex;
+            instance._world = cMatrix4(worlds[source]);
+        }
+    }
+
+    s32 cInstanceBuilder::ResolveMaterial(cMaterial* material, cMaterialInstance* materialInstances)
+    {
+        const usize mask = _slotCount - 1;
+        usize slot = HashMaterial(material) & mask;
+
+        for (usize probe = 0; probe < _slotCount; probe++)
+        {
+            cMaterial* slotMaterial = _slotMaterials[slot].load(std::memory_order_acquire);
+
+            if (slotMaterial == nullptr && _slotMaterials[slot].compare_exchange_strong(slotMaterial, material, std::memory_order_acq_rel))
+            {
+                s32 materialIndex = _nextMaterialIndex.fetch_add(1, std::memory_order_relaxed);
+                if ((usize)materialIndex < _maxMaterialCount)
+                {
+                    new (&materialInstances[materialIndex]) cMaterialInstance(materialIndex, material);
+                }
+                else
+                {
+                    materialIndex = -1;
+                    _overflow.store(K_TRUE, std::memory_order_relaxed);
+                }
+
+                _slotIndices[slot].store(materialIndex, std::memory_order_release);
+
+                return materialIndex;
+            }
+
+            if (slotMaterial == material)
+            {
+                // Another job claimed the slot, its material instance is about to be written
+                s32 materialIndex = _slotIndices[slot].load(std::memory_order_acquire);
+                while (materialIndex == kPendingIndex)
+                {
+                    std::this_thread::yield();
+                    materialIndex = _slotIndices[slot].load(std::memory_order_acquire);
+                }
+
+                return materialIndex;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+
+        _overflow.store(K_TRUE, std::memory_order_relaxed);
+
+        return -1;
+    }
+}
\ No newline at end of file
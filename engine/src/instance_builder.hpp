@@ -0,0 +1,50 @@
+// instance_builder.hpp
+
+#pragma once
+
+#include <atomic>
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "object.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    class cMaterial;
+    class cMaterialInstance;
+    struct sRenderInstance;
+
+    // Builds sRenderInstance/cMaterialInstance arrays as parallel jobs on cThread. Every job owns a
+    // contiguous slice of the output instances, so nothing has to be merged afterwards. Materials get
+    // dense buffer indices from a lock-free open addressing table: the thread that claims a slot takes
+    // the next index and writes the material instance, the others wait only for that slot.
+    class cInstanceBuilder : public iObject
+    {
+        TRITON_OBJECT(cInstanceBuilder)
+
+    public:
+        explicit cInstanceBuilder(cContext* context, types::usize maxMaterialCount);
+        virtual ~cInstanceBuilder() override final;
+
+        // Instance i reads worlds[indices[i]] and materials[indices[i]], indices may be nullptr for 0..count-1.
+        // Returns the written instance count, material count is available through GetMaterialCount.
+        types::usize Build(const glm::mat4* worlds, cMaterial* const* materials, const types::u32* indices, types::usize count, sRenderInstance* instances, cMaterialInstance* materialInstances);
+
+        inline types::usize GetMaterialCount() const { return _materialCount; }
+
+    private:
+        static constexpr types::usize kMinInstanceCountPerJob = 2048;
+        static constexpr types::s32 kPendingIndex = -2;
+
+        void BuildRange(const glm::mat4* worlds, cMaterial* const* materials, const types::u32* indices, types::usize begin, types::usize end, sRenderInstance* instances, cMaterialInstance* materialInstances);
+        types::s32 ResolveMaterial(cMaterial* material, cMaterialInstance* materialInstances);
+
+    private:
+        types::usize _maxMaterialCount = 0;
+        types::usize _slotCount = 0;
+        std::atomic<cMaterial*>* _slotMaterials = nullptr;
+        std::atomic<types::s32>* _slotIndices = nullptr;
+        std::atomic<types::s32> _nextMaterialIndex = 0;
+        std::atomic<types::boolean> _overflow = types::K_FALSE;
+        types::usize _materialCount = 0;
+    };
+}
\ No newline at end of file
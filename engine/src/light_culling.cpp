@@ -0,0 +1,257 @@
+// light_culling.cpp
+
+#include <cmath>
+#include <new>
+#include <cstring>
+#include "light_culling.hpp"
+#include "simd.hpp"
+#include "graphics.hpp"
+#include "thread_manager.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+	// Writes the positions of the spheres that touch the box to overlapping, returns their count
+	static usize OverlapSpheresBox(const f32* x, const f32* y, const f32* z, const f32* radius, usize count, const glm::vec3& boxMin, const glm::vec3& boxMax, u32* overlapping)
+	{
+		usize overlappingCount = 0;
+		usize i = 0;
+
+#if defined(TRITON_SIMD_AVX2)
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 minX = _mm256_set1_ps(boxMin.x);
+		const __m256 minY = _mm256_set1_ps(boxMin.y);
+		const __m256 minZ = _mm256_set1_ps(boxMin.z);
+		const __m256 maxX = _mm256_set1_ps(boxMax.x);
+		const __m256 maxY = _mm256_set1_ps(boxMax.y);
+		const __m256 maxZ = _mm256_set1_ps(boxMax.z);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 centerX = _mm256_loadu_ps(x + i);
+			const __m256 centerY = _mm256_loadu_ps(y + i);
+			const __m256 centerZ = _mm256_loadu_ps(z + i);
+			const __m256 sphereRadius = _mm256_loadu_ps(radius + i);
+
+			// Per axis distance from the center to the box, 0 when the center is inside the slab
+			const __m256 dx = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(minX, centerX), zero), _mm256_max_ps(_mm256_sub_ps(centerX, maxX), zero));
+			const __m256 dy = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(minY, centerY), zero), _mm256_max_ps(_mm256_sub_ps(centerY, maxY), zero));
+			const __m256 dz = _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(minZ, centerZ), zero), _mm256_max_ps(_mm256_sub_ps(centerZ, maxZ), zero));
+			__m256 distanceSquared = _mm256_mul_ps(dx, dx);
+			distanceSquared = _mm256_fmadd_ps(dy, dy, distanceSquared);
+			distanceSquared = _mm256_fmadd_ps(dz, dz, distanceSquared);
+
+			qword mask = (qword)_mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, _mm256_mul_ps(sphereRadius, sphereRadius), _CMP_LE_OQ));
+			while (mask != 0)
+			{
+				overlapping[overlappingCount++] = (u32)(i + cMath::CountTrailingZeros(mask));
+				mask &= mask - 1;
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			const f32 dx = glm::max(boxMin.x - x[i], 0.0f) + glm::max(x[i] - boxMax.x, 0.0f);
+			const f32 dy = glm::max(boxMin.y - y[i], 0.0f) + glm::max(y[i] - boxMax.y, 0.0f);
+			const f32 dz = glm::max(boxMin.z - z[i], 0.0f) + glm::max(z[i] - boxMax.z, 0.0f);
+
+			overlapping[overlappingCount] = (u32)i;
+			overlappingCount += dx * dx + dy * dy + dz * dz <= radius[i] * radius[i] ? 1 : 0;
+		}
+
+		return overlappingCount;
+	}
+
+	// View space extent of the tile edges between ndc a and b over the depth range of a slice
+	static void GetTileExtent(f32 a, f32 b, f32 tanHalfFov, f32 sliceNear, f32 sliceFar, f32& minimum, f32& maximum)
+	{
+		minimum = glm::min(a * tanHalfFov * sliceNear, a * tanHalfFov * sliceFar);
+		maximum = glm::max(b * tanHalfFov * sliceNear, b * tanHalfFov * sliceFar);
+	}
+
+	void cLightCulling::sLightSpheres::Clear()
+	{
+		x.clear();
+		y.clear();
+		z.clear();
+		radius.clear();
+		lights.clear();
+	}
+
+	void cLightCulling::sLightSpheres::Push(f32 centerX, f32 centerY, f32 centerZ, f32 sphereRadius, u32 light)
+	{
+		x.emplace_back(centerX);
+		y.emplace_back(centerY);
+		z.emplace_back(centerZ);
+		radius.emplace_back(sphereRadius);
+		lights.emplace_back(light);
+	}
+
+	cLightCulling::cLightCulling(cContext* context) : iObject(context)
+	{
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		_header.countX = (u32)caps->lightClusterCountX;
+		_header.countY = (u32)caps->lightClusterCountY;
+		_header.countZ = (u32)caps->lightClusterCountZ;
+		// Empty but valid grid until the first Cull, the shader skips lighting while the light count is 0
+		_header.zNear = 1.0f;
+		_header.zFar = 2.0f;
+		_header.sliceScale = (f32)_header.countZ / std::log(2.0f);
+		_header.sliceBias = 0.0f;
+		_clusterCount = caps->lightClusterCountX * caps->lightClusterCountY * caps->lightClusterCountZ;
+		_maxLightIndexCount = caps->maxLightClusterIndexCount;
+
+		_clusters = (sLightCluster*)memoryAllocator->Allocate(_clusterCount * sizeof(sLightCluster), caps->memoryAlignment);
+		_lightIndices = (u32*)memoryAllocator->Allocate(_maxLightIndexCount * sizeof(u32), caps->memoryAlignment);
+		for (usize i = 0; i < _clusterCount; i++)
+			new (&_clusters[i]) sLightCluster();
+
+		_slices.resize(caps->lightClusterCountZ);
+	}
+
+	cLightCulling::~cLightCulling()
+	{
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		memoryAllocator->Deallocate(_lightIndices);
+		memoryAllocator->Deallocate(_clusters);
+	}
+
+	usize cLightCulling::Cull(const sLightInstance* lights, usize count, const cMatrix4& view, const cMatrix4& projection, f32 zNear, f32 zFar, const glm::vec2& viewportSize)
+	{
+		const glm::mat4 viewMatrix = *(const glm::mat4*)view.GetData();
+		const f32* projectionData = projection.GetData();
+		// Symmetric perspective projection, the diagonal holds 1 / tan of the half field of view
+		const f32 tanHalfFovX = 1.0f / projectionData[0];
+		const f32 tanHalfFovY = 1.0f / projectionData[5];
+
+		const f32 logDepthRatio = std::log(zFar / zNear);
+		_header.lightCount = (u32)count;
+		_header.zNear = zNear;
+		_header.zFar = zFar;
+		_header.sliceScale = (f32)_header.countZ / logDepthRatio;
+		_header.sliceBias = -(f32)_header.countZ * std::log(zNear) / logDepthRatio;
+		_header.tileScaleX = (f32)_header.countX / viewportSize.x;
+		_header.tileScaleY = (f32)_header.countY / viewportSize.y;
+
+		_spheres.Clear();
+		for (usize i = 0; i < count; i++)
+		{
+			const sLightInstance& light = lights[i];
+			const glm::vec4 center = viewMatrix * glm::vec4(light._position.GetX(), light._position.GetY(), light._position.GetZ(), 1.0f);
+			_spheres.Push(center.x, center.y, center.z, light._attenuation.GetW(), (u32)i);
+		}
+
+		cThread* threads = _context->GetSubsystem<cThread>();
+		if (threads != nullptr && count > 0)
+		{
+			threads->Dispatch(_slices.size(), [this, tanHalfFovX, tanHalfFovY](usize sliceIndex) {
+				CullSlice(sliceIndex, tanHalfFovX, tanHalfFovY);
+			});
+		}
+		else
+		{
+			for (usize i = 0; i < _slices.size(); i++)
+				CullSlice(i, tanHalfFovX, tanHalfFovY);
+		}
+
+		// Slices are appended in order, cluster offsets move by the indices of the slices before them
+		const usize clusterCountPerSlice = (usize)_header.countX * _header.countY;
+		boolean full = K_FALSE;
+		_lightIndexCount = 0;
+		for (usize s = 0; s < _slices.size(); s++)
+		{
+			const sSliceScratch& scratch = _slices[s];
+			const usize base = _lightIndexCount;
+
+			usize sliceIndexCount = scratch.lightIndices.size();
+			if (base + sliceIndexCount > _maxLightIndexCount)
+			{
+				sliceIndexCount = _maxLightIndexCount - base;
+				full = K_TRUE;
+			}
+
+			if (sliceIndexCount > 0)
+				memcpy(_lightIndices + base, scratch.lightIndices.data(), sliceIndexCount * sizeof(u32));
+			_lightIndexCount += sliceIndexCount;
+
+			sLightCluster* clusters = _clusters + s * clusterCountPerSlice;
+			for (usize c = 0; c < clusterCountPerSlice; c++)
+			{
+				const usize begin = glm::min(base + scratch.clusters[c].offset, _lightIndexCount);
+				const usize end = glm::min(base + scratch.clusters[c].offset + scratch.clusters[c].count, _lightIndexCount);
+				clusters[c] = { (u32)begin, (u32)(end - begin) };
+			}
+		}
+
+		if (full == K_TRUE)
+			Print("Error: light cluster index limit reached, extra lights are skipped!");
+
+		return _lightIndexCount;
+	}
+
+	void cLightCulling::CullSlice(usize sliceIndex, f32 tanHalfFovX, f32 tanHalfFovY)
+	{
+		sSliceScratch& scratch = _slices[sliceIndex];
+		const usize countX = _header.countX;
+		const usize countY = _header.countY;
+
+		scratch.clusters.resize(countX * countY);
+		scratch.lightIndices.clear();
+		scratch.slice.Clear();
+		if (scratch.overlapping.size() < _spheres.lights.size())
+			scratch.overlapping.resize(_spheres.lights.size());
+
+		// Camera looks down -z, the slice covers view depth sliceNear..sliceFar
+		const f32 depthRatio = _header.zFar / _header.zNear;
+		const f32 sliceNear = _header.zNear * std::pow(depthRatio, (f32)sliceIndex / (f32)_header.countZ);
+		const f32 sliceFar = _header.zNear * std::pow(depthRatio, (f32)(sliceIndex + 1) / (f32)_header.countZ);
+
+		glm::vec3 boxMin = glm::vec3(-tanHalfFovX * sliceFar, -tanHalfFovY * sliceFar, -sliceFar);
+		glm::vec3 boxMax = glm::vec3(tanHalfFovX * sliceFar, tanHalfFovY * sliceFar, -sliceNear);
+
+		u32* overlapping = scratch.overlapping.data();
+		const usize sliceCount = OverlapSpheresBox(_spheres.x.data(), _spheres.y.data(), _spheres.z.data(), _spheres.radius.data(), _spheres.lights.size(), boxMin, boxMax, overlapping);
+		for (usize i = 0; i < sliceCount; i++)
+		{
+			const u32 p = overlapping[i];
+			scratch.slice.Push(_spheres.x[p], _spheres.y[p], _spheres.z[p], _spheres.radius[p], _spheres.lights[p]);
+		}
+
+		const sLightSpheres& slice = scratch.slice;
+		sLightSpheres& row = scratch.row;
+		for (usize y = 0; y < countY; y++)
+		{
+			GetTileExtent(-1.0f + 2.0f * (f32)y / (f32)countY, -1.0f + 2.0f * (f32)(y + 1) / (f32)countY, tanHalfFovY, sliceNear, sliceFar, boxMin.y, boxMax.y);
+			boxMin.x = -tanHalfFovX * sliceFar;
+			boxMax.x = tanHalfFovX * sliceFar;
+
+			row.Clear();
+			const usize rowCount = OverlapSpheresBox(slice.x.data(), slice.y.data(), slice.z.data(), slice.radius.data(), slice.lights.size(), boxMin, boxMax, overlapping);
+			for (usize i = 0; i < rowCount; i++)
+			{
+				const u32 p = overlapping[i];
+				row.Push(slice.x[p], slice.y[p], slice.z[p], slice.radius[p], slice.lights[p]);
+			}
+
+			for (usize x = 0; x < countX; x++)
+			{
+				GetTileExtent(-1.0f + 2.0f * (f32)x / (f32)countX, -1.0f + 2.0f * (f32)(x + 1) / (f32)countX, tanHalfFovX, sliceNear, sliceFar, boxMin.x, boxMax.x);
+
+				sLightCluster& cluster = scratch.clusters[y * countX + x];
+				cluster.offset = (u32)scratch.lightIndices.size();
+				cluster.count = (u32)OverlapSpheresBox(row.x.data(), row.y.data(), row.z.data(), row.radius.data(), row.lights.size(), boxMin, boxMax, overlapping);
+				for (usize i = 0; i < cluster.count; i++)
+					scratch.lightIndices.emplace_back(row.lights[overlapping[i]]);
+			}
+		}
+	}
+}
\ No newline at end of file
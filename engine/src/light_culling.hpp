@@ -0,0 +1,99 @@
+// light_culling.hpp
+
+#pragma once
+
+#include <vector>
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "object.hpp"
+#include "math.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+	struct sLightInstance;
+
+	// Start of the light grid buffer, the clusters follow it. Matches LightGridBuffer in clustered_lights.shader.
+	struct sLightGridHeader
+	{
+		types::u32 countX = 0;
+		types::u32 countY = 0;
+		types::u32 countZ = 0;
+		types::u32 lightCount = 0;
+		types::f32 zNear = 0.0f;
+		types::f32 zFar = 0.0f;
+		// slice = log(view depth) * sliceScale + sliceBias
+		types::f32 sliceScale = 0.0f;
+		types::f32 sliceBias = 0.0f;
+		// tile = fragment coordinate * tileScale
+		types::f32 tileScaleX = 0.0f;
+		types::f32 tileScaleY = 0.0f;
+		types::f32 padding[2] = {};
+	};
+
+	// Range of a cluster in the light index list
+	struct sLightCluster
+	{
+		types::u32 offset = 0;
+		types::u32 count = 0;
+	};
+
+	// Clustered forward lighting on the CPU. The view frustum is split into a froxel grid, tiles in screen space
+	// and exponential slices in depth. Every depth slice is a job on cThread: light spheres are tested against
+	// the AABB of the slice, the survivors against every row of tiles and those against every cluster of the row,
+	// each level 8 lights at a time. Clusters are laid out slice by slice, row by row, cluster
+	// (z * countY + y) * countX + x lists lightIndices[offset..offset+count-1].
+	class cLightCulling : public iObject
+	{
+		TRITON_OBJECT(cLightCulling)
+
+	public:
+		explicit cLightCulling(cContext* context);
+		virtual ~cLightCulling() override final;
+
+		// Lights are world space, _position is the center and _attenuation.w the range. Returns the index count.
+		types::usize Cull(const sLightInstance* lights, types::usize count, const cMatrix4& view, const cMatrix4& projection, types::f32 zNear, types::f32 zFar, const glm::vec2& viewportSize);
+
+		inline const sLightGridHeader& GetHeader() const { return _header; }
+		inline const sLightCluster* GetClusters() const { return _clusters; }
+		inline types::usize GetClusterCount() const { return _clusterCount; }
+		inline const types::u32* GetLightIndices() const { return _lightIndices; }
+		inline types::usize GetLightIndexCount() const { return _lightIndexCount; }
+		inline types::usize GetMaxLightIndexCount() const { return _maxLightIndexCount; }
+
+	private:
+		// Light spheres in view space, position is the light index in the list Cull got
+		struct sLightSpheres
+		{
+			void Clear();
+			void Push(types::f32 x, types::f32 y, types::f32 z, types::f32 radius, types::u32 light);
+
+			std::vector<types::f32> x = {};
+			std::vector<types::f32> y = {};
+			std::vector<types::f32> z = {};
+			std::vector<types::f32> radius = {};
+			std::vector<types::u32> lights = {};
+		};
+
+		// Scratch of one depth slice job, kept between frames so the vectors stop growing
+		struct sSliceScratch
+		{
+			sLightSpheres slice = {};
+			sLightSpheres row = {};
+			std::vector<types::u32> overlapping = {};
+			std::vector<sLightCluster> clusters = {};
+			std::vector<types::u32> lightIndices = {};
+		};
+
+		void CullSlice(types::usize sliceIndex, types::f32 tanHalfFovX, types::f32 tanHalfFovY);
+
+	private:
+		types::usize _clusterCount = 0;
+		types::usize _maxLightIndexCount = 0;
+		types::usize _lightIndexCount = 0;
+		sLightGridHeader _header = {};
+		sLightSpheres _spheres = {};
+		std::vector<sSliceScratch> _slices = {};
+		sLightCluster* _clusters = nullptr;
+		types::u32* _lightIndices = nullptr;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+// lod_selector.cpp
+
+#include <cmath>
+#include "lod_selector.hpp"
+#include "graphics.hpp"
+#include "thread_manager.hpp"
+#include "context.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    cLodSelector::cLodSelector(cContext* context, const sLodSelectorDescriptor& desc) : iObject(context), _desc(desc) {}
+
+    f32 cLodSelector::MakeProjectionScale(f32 fovY, f32 viewportHeight)
+    {
+        return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+    }
+
+    void cLodSelector::Select(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const u32* objects, usize count, const glm::vec3& cameraPosition, f32 projectionScale, u8* lods)
+    {
+        _fullTriangleCount.store(0, std::memory_order_relaxed);
+        _selectedTriangleCount.store(0, std::memory_order_relaxed);
+
+        cThread* threads = _context->GetSubsystem<cThread>();
+        const usize workerCount = threads != nullptr ? threads->GetThreadCount() + 1 : 1;
+        usize jobCount = (count + kMinObjectCountPerJob - 1) / kMinObjectCountPerJob;
+        if (jobCount > workerCount)
+            jobCount = workerCount;
+
+        if (jobCount <= 1 || threads == nullptr)
+        {
+            SelectRange(geometries, worlds, objects, 0, count, cameraPosition, projectionScale, lods);
+        }
+        else
+        {
+            const usize countPerJob = (count + jobCount - 1) / jobCount;
+            threads->Dispatch(jobCount, [&](usize jobIndex) {
+                const usize begin = jobIndex * countPerJob;
+                const usize end = begin + countPerJob < count ? begin + countPerJob : count;
+                if (begin < end)
+                    SelectRange(geometries, worlds, objects, begin, end, cameraPosition, projectionScale, lods);
+            });
+        }
+    }
+
+    void cLodSelector::SelectRange(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const u32* objects, usize begin, usize end, const glm::vec3& cameraPosition, f32 projectionScale, u8* lods)
+    {
+        const f32 coarserPixelError = _desc.maxPixelError * (1.0f - _desc.hysteresis);
+        usize fullTriangleCount = 0;
+        usize selectedTriangleCount = 0;
+
+        for (usize i = begin; i < end; i++)
+        {
+            const usize object = objects != nullptr ? objects[i] : i;
+            const sVertexBufferGeometry* geometry = geometries[object];
+            if (geometry == nullptr)
+                continue;
+
+            usize lod = lods[object] < geometry->_lodCount ? lods[object] : geometry->_lodCount - 1;
+
+            if (geometry->_lodCount > 1)
+            {
+                const glm::mat4& world = worlds[object];
+                const glm::vec3 center = glm::vec3(world * glm::vec4(glm::vec3(geometry->_boundingSphere), 1.0f));
+                const f32 scale = glm::sqrt(glm::max(
+                    glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                    glm::max(glm::dot(glm::vec3(world[1]), glm::vec3(world[1])), glm::dot(glm::vec3(world[2]), glm::vec3(world[2])))
+                ));
+
+                // Distance to the nearest point of the sphere, inside it everything gets LOD 0
+                const f32 distance = glm::length(center - cameraPosition) - geometry->_boundingSphere.w * scale;
+                if (distance <= 0.0f)
+                {
+                    lod = 0;
+                }
+                else
+                {
+                    const f32 pixelsPerUnit = scale * projectionScale / distance;
+                    while (lod > 0 && geometry->_lods[lod].error * pixelsPerUnit > _desc.maxPixelError)
+                        lod -= 1;
+                    while (lod + 1 < geometry->_lodCount && geometry->_lods[lod + 1].error * pixelsPerUnit <= coarserPixelError)
+                        lod += 1;
+                }
+            }
+
+            lods[object] = (u8)lod;
+            fullTriangleCount += geometry->_lods[0].indexCount / 3;
+            selectedTriangleCount += geometry->_lods[lod].indexCount / 3;
+        }
+
+        _fullTriangleCount.fetch_add(fullTriangleCount, std::memory_order_relaxed);
+        _selectedTriangleCount.fetch_add(selectedTriangleCount, std::memory_order_relaxed);
+    }
+}
\ No newline at end of file
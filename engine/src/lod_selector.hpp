@@ -0,0 +1,56 @@
+// lod_selector.hpp
+
+#pragma once
+
+#include <atomic>
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "object.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    struct sVertexBufferGeometry;
+
+    struct sLodSelectorDescriptor
+    {
+        types::f32 maxPixelError = 1.0f; // largest screen space error a LOD may have, in pixels
+        types::f32 hysteresis = 0.25f; // a coarser LOD needs error below maxPixelError * (1 - hysteresis)
+    };
+
+    // Picks a LOD per visible object from the projected error of each LOD, the object space error the
+    // cooker stored scaled by the world matrix and divided by the distance to the bounding sphere. The
+    // lods array is indexed by object and doubles as state: it holds last frame's choice on input, an
+    // object only moves to a coarser LOD once that one is clearly under the limit, so it doesn't pop
+    // back and forth at the threshold. Runs as jobs on cThread like cInstanceBuilder, cGraphics::SelectLods
+    // runs it for the visible objects before their draw keys are made.
+    class cLodSelector : public iObject
+    {
+        TRITON_OBJECT(cLodSelector)
+
+    public:
+        explicit cLodSelector(cContext* context, const sLodSelectorDescriptor& desc);
+        virtual ~cLodSelector() override final = default;
+
+        // Pixels per world unit at distance 1, viewportHeight / (2 * tan(fovY / 2))
+        static types::f32 MakeProjectionScale(types::f32 fovY, types::f32 viewportHeight);
+
+        // Object i of the list is objects[i], or i when objects is nullptr. geometries, worlds and lods are indexed by object.
+        void Select(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const types::u32* objects, types::usize count, const glm::vec3& cameraPosition, types::f32 projectionScale, types::u8* lods);
+
+        // Triangles of the last Select at LOD 0 and at the selected LODs
+        inline types::usize GetFullTriangleCount() const { return _fullTriangleCount.load(std::memory_order_relaxed); }
+        inline types::usize GetSelectedTriangleCount() const { return _selectedTriangleCount.load(std::memory_order_relaxed); }
+        inline types::usize GetSavedTriangleCount() const { return GetFullTriangleCount() - GetSelectedTriangleCount(); }
+        inline const sLodSelectorDescriptor& GetDescriptor() const { return _desc; }
+
+    private:
+        static constexpr types::usize kMinObjectCountPerJob = 2048;
+
+        void SelectRange(const sVertexBufferGeometry* const* geometries, const glm::mat4* worlds, const types::u32* objects, types::usize begin, types::usize end, const glm::vec3& cameraPosition, types::f32 projectionScale, types::u8* lods);
+
+    private:
+        sLodSelectorDescriptor _desc = {};
+        std::atomic<types::usize> _fullTriangleCount = 0;
+        std::atomic<types::usize> _selectedTriangleCount = 0;
+    };
+}
\ No newline at end of file
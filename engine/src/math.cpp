@@ -6,209 +6,158 @@ using namespace types;
 
 namespace triton
 {
-	cVector2::cVector2(const glm::vec2& vec) : _vec(vec) {}
-
-	cVector2::cVector2(f32 value) : _vec(glm::vec2(value, value)) {}
-
-	cVector2::cVector2(f32 x, f32 y) : _vec(glm::vec2(x, y)) {}
-
-	cVector2 cVector2::operator+(const cVector2& vec) const
-	{
-		return cVector2(_vec + vec._vec);
-	}
-
-	cVector2 cVector2::operator-(const cVector2& vec) const
-	{
-		return cVector2(_vec - vec._vec);
-	}
-
-	cVector2 cVector2::operator*(const cVector2& vec) const
-	{
-		return cVector2(_vec * vec._vec);
-	}
-
-	cVector2 cVector2::operator/(const cVector2& vec) const
-	{
-		return cVector2(_vec / vec._vec);
-	}
-
-	cVector2 cVector2::operator+(f32 val) const
-	{
-		return cVector2(_vec + val);
-	}
-
-	cVector2 cVector2::operator-(f32 val) const
-	{
-		return cVector2(_vec - val);
-	}
-
-	cVector2 cVector2::operator*(f32 val) const
-	{
-		return cVector2(_vec * val);
-	}
-
-	cVector2 cVector2::operator/(f32 val) const
-	{
-		return cVector2(_vec / val);
-	}
-
-	cVector3::cVector3(const glm::vec3& vec) : _vec(vec) {}
-
-	cVector3::cVector3(f32 value) : _vec(glm::vec3(value, value, value)) {}
-
-	cVector3::cVector3(f32 x, f32 y, f32 z) : _vec(glm::vec3(x, y, z)) {}
-
-	cVector3 cVector3::operator+(const cVector3& vec) const
-	{
-		return cVector3(_vec + vec._vec);
-	}
-
-	cVector3 cVector3::operator-(const cVector3& vec) const
-	{
-		return cVector3(_vec - vec._vec);
-	}
-
-	cVector3 cVector3::operator*(const cVector3& vec) const
-	{
-		return cVector3(_vec * vec._vec);
-	}
-
-	cVector3 cVector3::operator/(const cVector3& vec) const
-	{
-		return cVector3(_vec / vec._vec);
-	}
-
-	cVector3 cVector3::operator+(f32 val) const
+	void cTransform::Transform()
 	{
-		return cVector3(_vec + val);
+		const glm::quat quatX = glm::angleAxis(_rotation.GetX(), glm::vec3(1.0f, 0.0f, 0.0f));
+		const glm::quat quatY = glm::angleAxis(_rotation.GetY(), glm::vec3(0.0f, 1.0f, 0.0f));
+		const glm::quat quatZ = glm::angleAxis(_rotation.GetZ(), glm::vec3(0.0f, 0.0f, 1.0f));
+		_world._mat = glm::translate(glm::mat4(1.0f), _position._vec) * glm::toMat4(quatZ * quatY * quatX) * glm::scale(glm::mat4(1.0f), _scale._vec);
 	}
 
-	cVector3 cVector3::operator-(f32 val) const
+#if defined(TRITON_SIMD_SSE)
+	// 2x2 block helpers for Inverse, each __m128 holds a 2x2 matrix as (m00, m01, m10, m11)
+	static inline __m128 Matrix2Multiply(__m128 lhs, __m128 rhs)
 	{
-		return cVector3(_vec - val);
+		return _mm_add_ps(_mm_mul_ps(lhs, TRITON_SWIZZLE(rhs, 0, 3, 0, 3)), _mm_mul_ps(TRITON_SWIZZLE(lhs, 1, 0, 3, 2), TRITON_SWIZZLE(rhs, 2, 1, 2, 1)));
 	}
 
-	cVector3 cVector3::operator*(f32 val) const
+	static inline __m128 Matrix2AdjointMultiply(__m128 lhs, __m128 rhs)
 	{
-		return cVector3(_vec * val);
+		return _mm_sub_ps(_mm_mul_ps(TRITON_SWIZZLE(lhs, 3, 3, 0, 0), rhs), _mm_mul_ps(TRITON_SWIZZLE(lhs, 1, 1, 2, 2), TRITON_SWIZZLE(rhs, 2, 3, 0, 1)));
 	}
 
-	cVector3 cVector3::operator/(f32 val) const
+	static inline __m128 Matrix2MultiplyAdjoint(__m128 lhs, __m128 rhs)
 	{
-		return cVector3(_vec / val);
+		return _mm_sub_ps(_mm_mul_ps(lhs, TRITON_SWIZZLE(rhs, 3, 0, 3, 0)), _mm_mul_ps(TRITON_SWIZZLE(lhs, 1, 0, 3, 2), TRITON_SWIZZLE(rhs, 2, 1, 2, 1)));
 	}
+#endif
 
-	cVector3 cVector3::Cross(const cVector3& axis)
+	cMatrix4 cMatrix4::Inverse() const
 	{
-		_vec = glm::cross(_vec, axis._vec);
-
-		return cVector3(_vec);
-	}
-
-	cVector4::cVector4(const glm::vec4& vec) : _vec(vec) {}
+#if defined(TRITON_SIMD_SSE)
+		// Block inverse: the matrix is split into four 2x2 blocks and inverted with adjugates
+		const f32* src = &_mat[0][0];
+		const __m128 column0 = _mm_load_ps(src + 0);
+		const __m128 column1 = _mm_load_ps(src + 4);
+		const __m128 column2 = _mm_load_ps(src + 8);
+		const __m128 column3 = _mm_load_ps(src + 12);
 
-	cVector4::cVector4(f32 value) : _vec(glm::vec4(value, value, value, value)) {}
+		const __m128 a = _mm_movelh_ps(column0, column1);
+		const __m128 b = _mm_movehl_ps(column1, column0);
+		const __m128 c = _mm_movelh_ps(column2, column3);
+		const __m128 d = _mm_movehl_ps(column3, column2);
 
-	cVector4::cVector4(f32 x, f32 y, f32 z, f32 w) : _vec(glm::vec4(x, y, z, w)) {}
+		const __m128 determinants = _mm_sub_ps(
+			_mm_mul_ps(TRITON_SHUFFLE(column0, column2, 0, 2, 0, 2), TRITON_SHUFFLE(column1, column3, 1, 3, 1, 3)),
+			_mm_mul_ps(TRITON_SHUFFLE(column0, column2, 1, 3, 1, 3), TRITON_SHUFFLE(column1, column3, 0, 2, 0, 2)));
+		const __m128 determinantA = TRITON_SWIZZLE(determinants, 0, 0, 0, 0);
+		const __m128 determinantB = TRITON_SWIZZLE(determinants, 1, 1, 1, 1);
+		const __m128 determinantC = TRITON_SWIZZLE(determinants, 2, 2, 2, 2);
+		const __m128 determinantD = TRITON_SWIZZLE(determinants, 3, 3, 3, 3);
 
-	cVector4 cVector4::operator+(const cVector4& vec) const
-	{
-		return cVector4(_vec + vec._vec);
-	}
+		const __m128 dc = Matrix2AdjointMultiply(d, c);
+		const __m128 ab = Matrix2AdjointMultiply(a, b);
+		__m128 x = _mm_sub_ps(_mm_mul_ps(determinantD, a), Matrix2Multiply(b, dc));
+		__m128 w = _mm_sub_ps(_mm_mul_ps(determinantA, d), Matrix2Multiply(c, ab));
+		__m128 y = _mm_sub_ps(_mm_mul_ps(determinantB, c), Matrix2MultiplyAdjoint(d, ab));
+		__m128 z = _mm_sub_ps(_mm_mul_ps(determinantC, b), Matrix2MultiplyAdjoint(a, dc));
 
-	cVector4 cVector4::operator-(const cVector4& vec) const
-	{
-		return cVector4(_vec - vec._vec);
-	}
+		__m128 trace = _mm_mul_ps(ab, TRITON_SWIZZLE(dc, 0, 2, 1, 3));
+		trace = _mm_add_ps(trace, TRITON_SWIZZLE(trace, 1, 0, 3, 2));
+		trace = _mm_add_ps(trace, TRITON_SWIZZLE(trace, 2, 3, 0, 1));
 
-	cVector4 cVector4::operator*(const cVector4& vec) const
-	{
-		return cVector4(_vec * vec._vec);
-	}
+		__m128 determinant = _mm_add_ps(_mm_mul_ps(determinantA, determinantD), _mm_mul_ps(determinantB, determinantC));
+		determinant = _mm_sub_ps(determinant, trace);
 
-	cVector4 cVector4::operator/(const cVector4& vec) const
-	{
-		return cVector4(_vec / vec._vec);
-	}
+		const __m128 reciprocal = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+		x = _mm_mul_ps(x, reciprocal);
+		y = _mm_mul_ps(y, reciprocal);
+		z = _mm_mul_ps(z, reciprocal);
+		w = _mm_mul_ps(w, reciprocal);
 
-	cVector4 cVector4::operator+(f32 val) const
-	{
-		return cVector4(_vec + val);
-	}
+		cMatrix4 inverse(0.0f);
+		f32* dst = &inverse._mat[0][0];
+		_mm_store_ps(dst + 0, TRITON_SHUFFLE(x, y, 3, 1, 3, 1));
+		_mm_store_ps(dst + 4, TRITON_SHUFFLE(x, y, 2, 0, 2, 0));
+		_mm_store_ps(dst + 8, TRITON_SHUFFLE(z, w, 3, 1, 3, 1));
+		_mm_store_ps(dst + 12, TRITON_SHUFFLE(z, w, 2, 0, 2, 0));
 
-	cVector4 cVector4::operator-(f32 val) const
-	{
-		return cVector4(_vec - val);
+		return inverse;
+#else
+		return cMatrix4(glm::inverse(_mat));
+#endif
 	}
 
-	cVector4 cVector4::operator*(f32 val) const
-	{
-		return cVector4(_vec * val);
-	}
+	cMath::cMath(cContext* context) : iObject(context) {}
 
-	cVector4 cVector4::operator/(f32 val) const
+	f32 cMath::DegreesToRadians(f32 degrees)
 	{
-		return cVector4(_vec / val);
+		return glm::radians(degrees);
 	}
 
-	cQuaternion::cQuaternion(const glm::quat& quat) : _quat(quat) {}
-
-	cQuaternion::cQuaternion(f32 angle, const cVector3& axis) : _quat(glm::angleAxis(angle, axis._vec)) {}
-
-	cQuaternion::cQuaternion(types::f32 w, types::f32 x, types::f32 y, types::f32 z)
-		: _quat(glm::quat(w, x, y, z)) {}
-
-	cVector3 cQuaternion::operator*(const cVector3& vec) const
+	qword cMath::MakeHashMask(usize size)
 	{
-		return cVector3(_quat * vec._vec);
-	}
+		unsigned int count = __lzcnt((unsigned int)size);
+		qword mask = (qword)((1 << (31 - count)) - 1);
 
-	cQuaternion cQuaternion::operator*(const cQuaternion& quat) const
-	{
-		return cQuaternion(_quat * quat._quat);
+		return mask;
 	}
 
-	cVector3 cQuaternion::EulerAngles() const
+	void cMath::TransformPoints(const cMatrix4& matrix, const cVector4* points, cVector4* result, usize count)
 	{
-		return cVector3(glm::eulerAngles(_quat));
-	}
-
-	cMatrix4::cMatrix4(const glm::mat4& mat) : _mat(mat) {}
+		usize i = 0;
+		const f32* mat = &matrix._mat[0][0];
 
-	cMatrix4::cMatrix4(f32 value) : _mat(glm::mat4(value)) {}
-
-	cMatrix4::cMatrix4(const cVector3& position, const cVector3& direction, const cVector3& up)
-		: _mat(glm::lookAtRH(position._vec, position._vec + direction._vec, up._vec)) {}
-
-	cMatrix4::cMatrix4(f32 fov, f32 aspect, f32 zNear, f32 zFar) 
-		: _mat(glm::perspective(cMath::DegreesToRadians(fov), aspect, zNear, zFar)) {}
+#if defined(TRITON_SIMD_AVX2)
+		// Two points per iteration, each 128 bit lane holds one point
+		const __m256 column0 = _mm256_broadcast_ps((const __m128*)(mat + 0));
+		const __m256 column1 = _mm256_broadcast_ps((const __m128*)(mat + 4));
+		const __m256 column2 = _mm256_broadcast_ps((const __m128*)(mat + 8));
+		const __m256 column3 = _mm256_broadcast_ps((const __m128*)(mat + 12));
+		for (; i + 2 <= count; i += 2)
+		{
+			const __m256 point = _mm256_loadu_ps(&points[i]._vec.x);
+			__m256 transformed = _mm256_mul_ps(column0, _mm256_permute_ps(point, 0x00));
+			transformed = _mm256_fmadd_ps(column1, _mm256_permute_ps(point, 0x55), transformed);
+			transformed = _mm256_fmadd_ps(column2, _mm256_permute_ps(point, 0xAA), transformed);
+			transformed = _mm256_fmadd_ps(column3, _mm256_permute_ps(point, 0xFF), transformed);
+			_mm256_storeu_ps(&result[i]._vec.x, transformed);
+		}
+#endif
 
-	cMatrix4 cMatrix4::operator*(const cMatrix4& mat) const
-	{
-		return cMatrix4(_mat * mat._mat);
+		for (; i < count; i++)
+			result[i] = matrix * points[i];
 	}
 
-	void cTransform::Transform()
+	void cMath::MultiplyMatrices(const cMatrix4* lhs, const cMatrix4* rhs, cMatrix4* result, usize count)
 	{
-		const glm::quat quatX = glm::angleAxis(_rotation.GetX(), glm::vec3(1.0f, 0.0f, 0.0f));
-		const glm::quat quatY = glm::angleAxis(_rotation.GetY(), glm::vec3(0.0f, 1.0f, 0.0f));
-		const glm::quat quatZ = glm::angleAxis(_rotation.GetZ(), glm::vec3(0.0f, 0.0f, 1.0f));
-		_world._mat = glm::translate(glm::mat4(1.0f), _position._vec) * glm::toMat4(quatZ * quatY * quatX) * glm::scale(glm::mat4(1.0f), _scale._vec);
-	}
-
-	cMath::cMath(cContext* context) : iObject(context) {}
+		usize i = 0;
 
-	f32 cMath::DegreesToRadians(f32 degrees)
-	{
-		return glm::radians(degrees);
-	}
-
-	qword cMath::MakeHashMask(usize size)
-	{
-		unsigned int count = __lzcnt((unsigned int)size);
-		qword mask = (qword)((1 << (31 - count)) - 1);
+#if defined(TRITON_SIMD_AVX2)
+		// Two result columns per 256 bit register
+		for (; i < count; i++)
+		{
+			const f32* left = &lhs[i]._mat[0][0];
+			const f32* right = &rhs[i]._mat[0][0];
+			f32* dst = &result[i]._mat[0][0];
+			const __m256 column0 = _mm256_broadcast_ps((const __m128*)(left + 0));
+			const __m256 column1 = _mm256_broadcast_ps((const __m128*)(left + 4));
+			const __m256 column2 = _mm256_broadcast_ps((const __m128*)(left + 8));
+			const __m256 column3 = _mm256_broadcast_ps((const __m128*)(left + 12));
+			for (usize j = 0; j < 16; j += 8)
+			{
+				const __m256 columns = _mm256_loadu_ps(right + j);
+				__m256 product = _mm256_mul_ps(column0, _mm256_permute_ps(columns, 0x00));
+				product = _mm256_fmadd_ps(column1, _mm256_permute_ps(columns, 0x55), product);
+				product = _mm256_fmadd_ps(column2, _mm256_permute_ps(columns, 0xAA), product);
+				product = _mm256_fmadd_ps(column3, _mm256_permute_ps(columns, 0xFF), product);
+				_mm256_storeu_ps(dst + j, product);
+			}
+		}
+#endif
 
-		return mask;
+		for (; i < count; i++)
+			result[i] = lhs[i] * rhs[i];
 	}
 
 	qword cMath::HashBytes(const u8* data, usize dataByteSize, qword mask)
@@ -2,11 +2,15 @@
 
 #pragma once
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include "../../thirdparty/glm/glm/glm.hpp"
 #include "../../thirdparty/glm/glm/gtc/matrix_transform.hpp"
 #include "../../thirdparty/glm/glm/gtc/quaternion.hpp"
 #include "../../thirdparty/glm/glm/gtx/quaternion.hpp"
 #include "object.hpp"
+#include "simd.hpp"
 #include "types.hpp"
 
 namespace triton
@@ -83,9 +87,11 @@ namespace triton
 		glm::vec3 _vec = glm::vec3(0.0f);
 	};
 
-	class cVector4
+	class alignas(16) cVector4
 	{
 		friend class cVector4;
+		friend class cMatrix4;
+		friend class cMath;
 
 	public:
 		explicit cVector4(const glm::vec4& vec);
@@ -114,12 +120,13 @@ namespace triton
 		inline void AddY(types::f32 value) { _vec.y += value; }
 		inline void AddZ(types::f32 value) { _vec.z += value; }
 		inline void AddW(types::f32 value) { _vec.w += value; }
+		inline const types::f32* GetData() const { return &_vec.x; }
 
 	private:
 		glm::vec4 _vec = glm::vec4(0.0f);
 	};
 
-	class cQuaternion
+	class alignas(16) cQuaternion
 	{
 		friend class cQuaternion;
 
@@ -143,11 +150,12 @@ namespace triton
 		glm::quat _quat = {};
 	};
 
-	class cMatrix4
+	class alignas(16) cMatrix4
 	{
 		friend class cMatrix4;
 		friend class cTransform;
-		
+		friend class cMath;
+
 	public:
 		explicit cMatrix4(const glm::mat4& mat);
 		explicit cMatrix4(types::f32 value);
@@ -156,6 +164,11 @@ namespace triton
 		~cMatrix4() = default;
 
 		cMatrix4 operator*(const cMatrix4& mat) const;
+		cVector4 operator*(const cVector4& vec) const;
+
+		cMatrix4 Inverse() const;
+
+		inline const types::f32* GetData() const { return &_mat[0][0]; }
 
 	private:
 		glm::mat4 _mat = {};
@@ -196,6 +209,9 @@ namespace triton
 
 		static types::f32 DegreesToRadians(types::f32 degrees);
 		static types::qword MakeHashMask(types::usize size);
+		static inline types::u32 CountTrailingZeros(types::qword value);
+		static void TransformPoints(const cMatrix4& matrix, const cVector4* points, cVector4* result, types::usize count);
+		static void MultiplyMatrices(const cMatrix4* lhs, const cMatrix4* rhs, cMatrix4* result, types::usize count);
 
 		template <typename TValue>
 		static types::qword Hash(const TValue& value, types::qword mask);
@@ -223,4 +239,308 @@ namespace triton
 			static_assert(sizeof(TValue) == 0, "Error: unsupported key type");
 		}
 	}
+
+	types::u32 cMath::CountTrailingZeros(types::qword value)
+	{
+#if defined(_MSC_VER)
+		return (types::u32)_tzcnt_u64(value);
+#else
+		return (types::u32)__builtin_ctzll(value);
+#endif
+	}
+
+	inline cVector2::cVector2(const glm::vec2& vec) : _vec(vec) {}
+
+	inline cVector2::cVector2(types::f32 value) : _vec(glm::vec2(value, value)) {}
+
+	inline cVector2::cVector2(types::f32 x, types::f32 y) : _vec(glm::vec2(x, y)) {}
+
+	inline cVector2 cVector2::operator+(const cVector2& vec) const
+	{
+		return cVector2(_vec + vec._vec);
+	}
+
+	inline cVector2 cVector2::operator-(const cVector2& vec) const
+	{
+		return cVector2(_vec - vec._vec);
+	}
+
+	inline cVector2 cVector2::operator*(const cVector2& vec) const
+	{
+		return cVector2(_vec * vec._vec);
+	}
+
+	inline cVector2 cVector2::operator/(const cVector2& vec) const
+	{
+		return cVector2(_vec / vec._vec);
+	}
+
+	inline cVector2 cVector2::operator+(types::f32 val) const
+	{
+		return cVector2(_vec + val);
+	}
+
+	inline cVector2 cVector2::operator-(types::f32 val) const
+	{
+		return cVector2(_vec - val);
+	}
+
+	inline cVector2 cVector2::operator*(types::f32 val) const
+	{
+		return cVector2(_vec * val);
+	}
+
+	inline cVector2 cVector2::operator/(types::f32 val) const
+	{
+		return cVector2(_vec / val);
+	}
+
+	inline cVector3::cVector3(const glm::vec3& vec) : _vec(vec) {}
+
+	inline cVector3::cVector3(types::f32 value) : _vec(glm::vec3(value, value, value)) {}
+
+	inline cVector3::cVector3(types::f32 x, types::f32 y, types::f32 z) : _vec(glm::vec3(x, y, z)) {}
+
+	inline cVector3 cVector3::operator+(const cVector3& vec) const
+	{
+		return cVector3(_vec + vec._vec);
+	}
+
+	inline cVector3 cVector3::operator-(const cVector3& vec) const
+	{
+		return cVector3(_vec - vec._vec);
+	}
+
+	inline cVector3 cVector3::operator*(const cVector3& vec) const
+	{
+		return cVector3(_vec * vec._vec);
+	}
+
+	inline cVector3 cVector3::operator/(const cVector3& vec) const
+	{
+		return cVector3(_vec / vec._vec);
+	}
+
+	inline cVector3 cVector3::operator+(types::f32 val) const
+	{
+		return cVector3(_vec + val);
+	}
+
+	inline cVector3 cVector3::operator-(types::f32 val) const
+	{
+		return cVector3(_vec - val);
+	}
+
+	inline cVector3 cVector3::operator*(types::f32 val) const
+	{
+		return cVector3(_vec * val);
+	}
+
+	inline cVector3 cVector3::operator/(types::f32 val) const
+	{
+		return cVector3(_vec / val);
+	}
+
+	inline cVector3 cVector3::Cross(const cVector3& axis)
+	{
+		_vec = glm::cross(_vec, axis._vec);
+
+		return cVector3(_vec);
+	}
+
+	inline cVector4::cVector4(const glm::vec4& vec) : _vec(vec) {}
+
+	inline cVector4::cVector4(types::f32 value) : _vec(glm::vec4(value, value, value, value)) {}
+
+	inline cVector4::cVector4(types::f32 x, types::f32 y, types::f32 z, types::f32 w) : _vec(glm::vec4(x, y, z, w)) {}
+
+	inline cVector4 cVector4::operator+(const cVector4& vec) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_add_ps(_mm_load_ps(&_vec.x), _mm_load_ps(&vec._vec.x)));
+
+		return result;
+#else
+		return cVector4(_vec + vec._vec);
+#endif
+	}
+
+	inline cVector4 cVector4::operator-(const cVector4& vec) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_sub_ps(_mm_load_ps(&_vec.x), _mm_load_ps(&vec._vec.x)));
+
+		return result;
+#else
+		return cVector4(_vec - vec._vec);
+#endif
+	}
+
+	inline cVector4 cVector4::operator*(const cVector4& vec) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_mul_ps(_mm_load_ps(&_vec.x), _mm_load_ps(&vec._vec.x)));
+
+		return result;
+#else
+		return cVector4(_vec * vec._vec);
+#endif
+	}
+
+	inline cVector4 cVector4::operator/(const cVector4& vec) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_div_ps(_mm_load_ps(&_vec.x), _mm_load_ps(&vec._vec.x)));
+
+		return result;
+#else
+		return cVector4(_vec / vec._vec);
+#endif
+	}
+
+	inline cVector4 cVector4::operator+(types::f32 val) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_add_ps(_mm_load_ps(&_vec.x), _mm_set1_ps(val)));
+
+		return result;
+#else
+		return cVector4(_vec + val);
+#endif
+	}
+
+	inline cVector4 cVector4::operator-(types::f32 val) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_sub_ps(_mm_load_ps(&_vec.x), _mm_set1_ps(val)));
+
+		return result;
+#else
+		return cVector4(_vec - val);
+#endif
+	}
+
+	inline cVector4 cVector4::operator*(types::f32 val) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_mul_ps(_mm_load_ps(&_vec.x), _mm_set1_ps(val)));
+
+		return result;
+#else
+		return cVector4(_vec * val);
+#endif
+	}
+
+	inline cVector4 cVector4::operator/(types::f32 val) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		cVector4 result(0.0f);
+		_mm_store_ps(&result._vec.x, _mm_div_ps(_mm_load_ps(&_vec.x), _mm_set1_ps(val)));
+
+		return result;
+#else
+		return cVector4(_vec / val);
+#endif
+	}
+
+	inline cQuaternion::cQuaternion(const glm::quat& quat) : _quat(quat) {}
+
+	inline cQuaternion::cQuaternion(types::f32 angle, const cVector3& axis) : _quat(glm::angleAxis(angle, axis._vec)) {}
+
+	inline cQuaternion::cQuaternion(types::f32 w, types::f32 x, types::f32 y, types::f32 z)
+		: _quat(glm::quat(w, x, y, z)) {}
+
+	inline cVector3 cQuaternion::operator*(const cVector3& vec) const
+	{
+		return cVector3(_quat * vec._vec);
+	}
+
+	inline cQuaternion cQuaternion::operator*(const cQuaternion& quat) const
+	{
+#if defined(TRITON_SIMD_SSE) && !defined(GLM_FORCE_QUAT_DATA_XYZW)
+		// Hamilton product on (w, x, y, z) lanes, signs applied per broadcast component of the left side
+		const __m128 lhs = _mm_load_ps(&_quat.w);
+		const __m128 rhs = _mm_load_ps(&quat._quat.w);
+		__m128 result = _mm_mul_ps(TRITON_SWIZZLE(lhs, 0, 0, 0, 0), rhs);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_mul_ps(TRITON_SWIZZLE(lhs, 1, 1, 1, 1), TRITON_SWIZZLE(rhs, 1, 0, 3, 2)), _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_mul_ps(TRITON_SWIZZLE(lhs, 2, 2, 2, 2), TRITON_SWIZZLE(rhs, 2, 3, 0, 1)), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_mul_ps(TRITON_SWIZZLE(lhs, 3, 3, 3, 3), TRITON_SWIZZLE(rhs, 3, 2, 1, 0)), _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f)));
+
+		cQuaternion product(1.0f, 0.0f, 0.0f, 0.0f);
+		_mm_store_ps(&product._quat.w, result);
+
+		return product;
+#else
+		return cQuaternion(_quat * quat._quat);
+#endif
+	}
+
+	inline cVector3 cQuaternion::EulerAngles() const
+	{
+		return cVector3(glm::eulerAngles(_quat));
+	}
+
+	inline cMatrix4::cMatrix4(const glm::mat4& mat) : _mat(mat) {}
+
+	inline cMatrix4::cMatrix4(types::f32 value) : _mat(glm::mat4(value)) {}
+
+	inline cMatrix4::cMatrix4(const cVector3& position, const cVector3& direction, const cVector3& up)
+		: _mat(glm::lookAtRH(position._vec, position._vec + direction._vec, up._vec)) {}
+
+	inline cMatrix4::cMatrix4(types::f32 fov, types::f32 aspect, types::f32 zNear, types::f32 zFar) 
+		: _mat(glm::perspective(cMath::DegreesToRadians(fov), aspect, zNear, zFar)) {}
+
+	inline cMatrix4 cMatrix4::operator*(const cMatrix4& mat) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		const types::f32* lhs = &_mat[0][0];
+		const types::f32* rhs = &mat._mat[0][0];
+		const __m128 column0 = _mm_load_ps(lhs + 0);
+		const __m128 column1 = _mm_load_ps(lhs + 4);
+		const __m128 column2 = _mm_load_ps(lhs + 8);
+		const __m128 column3 = _mm_load_ps(lhs + 12);
+
+		cMatrix4 product(0.0f);
+		types::f32* dst = &product._mat[0][0];
+		for (types::usize i = 0; i < 4; i++)
+		{
+			const __m128 column = _mm_load_ps(rhs + i * 4);
+			__m128 result = _mm_mul_ps(column0, TRITON_SWIZZLE(column, 0, 0, 0, 0));
+			result = _mm_add_ps(result, _mm_mul_ps(column1, TRITON_SWIZZLE(column, 1, 1, 1, 1)));
+			result = _mm_add_ps(result, _mm_mul_ps(column2, TRITON_SWIZZLE(column, 2, 2, 2, 2)));
+			result = _mm_add_ps(result, _mm_mul_ps(column3, TRITON_SWIZZLE(column, 3, 3, 3, 3)));
+			_mm_store_ps(dst + i * 4, result);
+		}
+
+		return product;
+#else
+		return cMatrix4(_mat * mat._mat);
+#endif
+	}
+
+	inline cVector4 cMatrix4::operator*(const cVector4& vec) const
+	{
+#if defined(TRITON_SIMD_SSE)
+		const types::f32* lhs = &_mat[0][0];
+		const __m128 column = _mm_load_ps(&vec._vec.x);
+		__m128 result = _mm_mul_ps(_mm_load_ps(lhs + 0), TRITON_SWIZZLE(column, 0, 0, 0, 0));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_load_ps(lhs + 4), TRITON_SWIZZLE(column, 1, 1, 1, 1)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_load_ps(lhs + 8), TRITON_SWIZZLE(column, 2, 2, 2, 2)));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_load_ps(lhs + 12), TRITON_SWIZZLE(column, 3, 3, 3, 3)));
+
+		cVector4 product(0.0f);
+		_mm_store_ps(&product._vec.x, result);
+
+		return product;
+#else
+		return cVector4(_mat * vec._vec);
+#endif
+	}
 }
\ No newline at end of file
@@ -16,37 +16,34 @@ namespace triton
 		if (_bins)
 		{
 			for (usize i = 0; i < MAX_BIN_COUNT; i++)
-				std::free(_bins[i]._blocks);
+				std::free(_bins[i]._occupied);
+			std::free(_bins);
 		}
 
 		if (_memSizeToBin)
 			std::free(_memSizeToBin);
+
+		std::free(_binMemory);
 	}
 
 	void* cMemoryAllocator::Allocate(types::usize byteSize, types::usize alignment)
 	{
-		if (byteSize < MAX_ALLOCATION_BYTE_SIZE)
+		if (byteSize < MAX_ALLOCATION_BYTE_SIZE && alignment <= BIN_ALIGNMENT)
 		{
 			sAllocatorBin* bin = _memSizeToBin[byteSize];
 
 			for (usize i = 0; i < bin->_maxBlockCount; i++)
 			{
-				iObject* obj = (iObject*)((u8*)bin->_blocks + bin->_blockSize * i);
-
-				if (obj->_occupied == K_FALSE)
+				if (bin->_occupied[i] == K_FALSE)
 				{
-					obj->_occupied = K_TRUE;
+					bin->_occupied[i] = K_TRUE;
 
-					return (void*)obj;
+					return (void*)((u8*)bin->_blocks + bin->_blockSize * i);
 				}
 			}
-
-			return std::malloc(byteSize);
-		}
-		else
-		{
-			return std::malloc(byteSize);
 		}
+
+		return AllocateUnbinned(byteSize, alignment);
 	}
 
 	void cMemoryAllocator::Deallocate(void* ptr)
@@ -54,8 +51,32 @@ namespace triton
 		if (ptr == nullptr)
 			return;
 
-		iObject* obj = (iObject*)ptr;
-		obj->_occupied = K_FALSE;
+		u8* block = (u8*)ptr;
+		if (block >= _binBegin && block < _binEnd)
+		{
+			const usize offset = block - _binBegin;
+			sAllocatorBin* bin = &_bins[offset / _maxBinByteSize + 1];
+			bin->_occupied[(offset % _maxBinByteSize) / bin->_blockSize] = K_FALSE;
+
+			return;
+		}
+
+		std::free(((void**)ptr)[-1]);
+	}
+
+	void* cMemoryAllocator::AllocateUnbinned(types::usize byteSize, types::usize alignment)
+	{
+		if (alignment < sizeof(void*))
+			alignment = sizeof(void*);
+
+		u8* memory = (u8*)std::malloc(byteSize + sizeof(void*) + alignment - 1);
+		if (memory == nullptr)
+			return nullptr;
+
+		u8* block = (u8*)(((usize)memory + sizeof(void*) + alignment - 1) & ~(alignment - 1));
+		((void**)block)[-1] = memory;
+
+		return (void*)block;
 	}
 
 	void cMemoryAllocator::SetBins(usize maxBinByteSize)
@@ -66,6 +87,12 @@ namespace triton
 		_bins = (sAllocatorBin*)std::malloc(MAX_BIN_COUNT * sizeof(sAllocatorBin));
 		_memSizeToBin = (sAllocatorBin**)std::malloc(MAX_ALLOCATION_BYTE_SIZE * sizeof(sAllocatorBin*));
 
+		// Bin 0 only catches zero byte requests, it has no blocks and the others follow each other in one region
+		_maxBinByteSize = (maxBinByteSize + BIN_ALIGNMENT - 1) & ~(BIN_ALIGNMENT - 1);
+		_binMemory = std::malloc((MAX_BIN_COUNT - 1) * _maxBinByteSize + BIN_ALIGNMENT - 1);
+		_binBegin = (u8*)(((usize)_binMemory + BIN_ALIGNMENT - 1) & ~(BIN_ALIGNMENT - 1));
+		_binEnd = _binBegin + (MAX_BIN_COUNT - 1) * _maxBinByteSize;
+
 		static const usize blockSizes[MAX_BIN_COUNT] =
 		{
 			0, 512, 1024, 1536, 2048, 2560, 3072, 3584, 4096, 4608, 5120,
@@ -80,8 +107,9 @@ namespace triton
 		for (usize i = 0; i < MAX_BIN_COUNT; i++)
 		{
 			_bins[i]._blockSize = blockSizes[i];
-			_bins[i]._maxBlockCount = maxBinByteSize / _bins[i]._blockSize;
-			_bins[i]._blocks = std::malloc(maxBinByteSize);
+			_bins[i]._maxBlockCount = i == 0 ? 0 : _maxBinByteSize / _bins[i]._blockSize;
+			_bins[i]._blocks = i == 0 ? nullptr : _binBegin + (i - 1) * _maxBinByteSize;
+			_bins[i]._occupied = i == 0 ? nullptr : (u8*)std::calloc(_bins[i]._maxBlockCount, sizeof(u8));
 		}
 
 		for (usize i = 0; i < MAX_ALLOCATION_BYTE_SIZE; i++)
@@ -15,13 +15,18 @@ namespace triton
         types::usize _blockSize = 0;
         types::usize _maxBlockCount = 0;
         void* _blocks = nullptr;
+        types::u8* _occupied = nullptr;
     };
 
+    // Bins share one region and keep their occupied flags outside the blocks, so a block never
+    // depends on what its owner writes into it. Blocks are BIN_ALIGNMENT aligned, bigger or more
+    // aligned allocations go to malloc with the original pointer stored right before the block.
     class cMemoryAllocator
     {
     public:
         static constexpr types::usize MAX_BIN_COUNT = 64 + 1;
         static constexpr types::usize MAX_ALLOCATION_BYTE_SIZE = 32 * 1024;
+        static constexpr types::usize BIN_ALIGNMENT = 64;
 
     public:
         explicit cMemoryAllocator() = default;
@@ -32,8 +37,15 @@ namespace triton
 
         void SetBins(types::usize maxBinByteSize);
 
+    private:
+        void* AllocateUnbinned(types::usize byteSize, types::usize alignment);
+
     private:
         sAllocatorBin* _bins = nullptr;
         sAllocatorBin** _memSizeToBin = nullptr;
+        types::usize _maxBinByteSize = 0;
+        void* _binMemory = nullptr;
+        types::u8* _binBegin = nullptr;
+        types::u8* _binEnd = nullptr;
     };
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+// mesh_file.hpp
+
+#pragma once
+
+#include "mesh_optimizer.hpp"
+#include "vertex_format.hpp"
+#include "category.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    // Cooked mesh layout, written by the MeshCooker tool and read in place from a memory mapping:
+    // sMeshFileHeader, submeshCount x sMeshFileSubmesh, meshletCount x sMeshlet, vertex blob, index blob. Blobs start at
+    // kMeshFileAlignment so they can be uploaded straight from the mapping. Vertices use the layout
+    // named by vertexFormat (see vertex_format.hpp), indices are u32 and relative to the first vertex
+    // of the mesh, so all submeshes draw from one geometry. LOD 0 is the full mesh at the start of the index
+    // blob and the submesh and meshlet ranges point into it, coarser LODs follow it and index the same vertices.
+    static constexpr types::u32 kMeshFileMagic = 0x48534D54; // "TMSH"
+    static constexpr types::u32 kMeshFileVersion = 3;
+    static constexpr types::usize kMeshFileAlignment = 64;
+    static constexpr types::usize kMeshFileMaxLodCount = 4;
+
+    struct sMeshFileSubmesh
+    {
+        types::u32 firstIndex = 0;
+        types::u32 indexCount = 0;
+        types::u32 firstVertex = 0;
+        types::u32 vertexCount = 0;
+        types::f32 aabbMin[3] = {};
+        types::f32 aabbMax[3] = {};
+    };
+
+    struct sMeshFileLod
+    {
+        types::u32 firstIndex = 0;
+        types::u32 indexCount = 0;
+        types::f32 error = 0.0f; // object space distance from the full mesh
+        types::u32 padding = 0;
+    };
+
+    struct sMeshFileHeader
+    {
+        types::u32 magic = kMeshFileMagic;
+        types::u32 version = kMeshFileVersion;
+        types::u32 vertexFormat = 0;
+        types::u32 vertexStride = 0;
+        types::u32 vertexCount = 0;
+        types::u32 indexCount = 0;
+        types::u32 submeshCount = 0;
+        types::u32 lodCount = 0;
+        types::u32 meshletCount = 0;
+        types::u32 padding = 0;
+        types::u64 fileByteSize = 0;
+        types::u64 meshletOffset = 0;
+        types::u64 vertexOffset = 0;
+        types::u64 vertexByteSize = 0;
+        types::u64 indexOffset = 0;
+        types::u64 indexByteSize = 0;
+        types::f32 aabbMin[3] = {};
+        types::f32 aabbMax[3] = {};
+        types::f32 boundingSphere[4] = {}; // xyz - center, w - radius
+        sMeshFileLod lods[kMeshFileMaxLodCount] = {};
+    };
+
+    // Checks that the header belongs to this version, that every blob lies inside the file and that every range
+    // and index stays inside the data it points into. Reads the whole index blob.
+    inline types::boolean IsMeshFileValid(const void* data, types::usize byteSize)
+    {
+        if (data == nullptr || byteSize < sizeof(sMeshFileHeader))
+            return types::K_FALSE;
+
+        const sMeshFileHeader* header = (const sMeshFileHeader*)data;
+        if (header->magic != kMeshFileMagic || header->version != kMeshFileVersion || header->fileByteSize != byteSize)
+            return types::K_FALSE;
+        if (sizeof(sMeshFileHeader) + (types::u64)header->submeshCount * sizeof(sMeshFileSubmesh) > header->meshletOffset)
+            return types::K_FALSE;
+        if (header->meshletOffset % alignof(sMeshlet) != 0 || header->meshletOffset + (types::u64)header->meshletCount * sizeof(sMeshlet) > header->vertexOffset)
+            return types::K_FALSE;
+        if (header->vertexOffset % kMeshFileAlignment != 0 || header->indexOffset % kMeshFileAlignment != 0)
+            return types::K_FALSE;
+        if (header->vertexStride == 0 || header->vertexStride != GetVertexFormatStride((eCategory)header->vertexFormat))
+            return types::K_FALSE;
+        if (header->vertexByteSize != (types::u64)header->vertexCount * header->vertexStride || header->indexByteSize != (types::u64)header->indexCount * sizeof(types::u32))
+            return types::K_FALSE;
+        if (header->vertexOffset + header->vertexByteSize > header->indexOffset || header->indexOffset + header->indexByteSize > byteSize)
+            return types::K_FALSE;
+        if (header->lodCount == 0 || header->lodCount > kMeshFileMaxLodCount)
+            return types::K_FALSE;
+        for (types::u32 i = 0; i < header->lodCount; i++)
+        {
+            if ((types::u64)header->lods[i].firstIndex + header->lods[i].indexCount > header->indexCount)
+                return types::K_FALSE;
+        }
+
+        const sMeshFileSubmesh* submeshes = (const sMeshFileSubmesh*)((const types::u8*)data + sizeof(sMeshFileHeader));
+        for (types::u32 i = 0; i < header->submeshCount; i++)
+        {
+            if ((types::u64)submeshes[i].firstIndex + submeshes[i].indexCount > header->lods[0].indexCount)
+                return types::K_FALSE;
+        }
+
+        const sMeshlet* meshlets = (const sMeshlet*)((const types::u8*)data + header->meshletOffset);
+        for (types::u32 i = 0; i < header->meshletCount; i++)
+        {
+            if ((types::u64)meshlets[i].firstIndex + meshlets[i].indexCount > header->lods[0].indexCount)
+                return types::K_FALSE;
+        }
+
+        // An index past the vertex blob would read outside the geometry's vertex range on the GPU
+        const types::u32* indices = (const types::u32*)((const types::u8*)data + header->indexOffset);
+        for (types::u32 i = 0; i < header->indexCount; i++)
+        {
+            if (indices[i] >= header->vertexCount)
+                return types::K_FALSE;
+        }
+
+        return types::K_TRUE;
+    }
+
+    inline const sMeshFileSubmesh* GetMeshFileSubmeshes(const void* data)
+    {
+        return (const sMeshFileSubmesh*)((const types::u8*)data + sizeof(sMeshFileHeader));
+    }
+
+    inline const sMeshlet* GetMeshFileMeshlets(const void* data)
+    {
+        return (const sMeshlet*)((const types::u8*)data + ((const sMeshFileHeader*)data)->meshletOffset);
+    }
+
+    inline const void* GetMeshFileVertices(const void* data)
+    {
+        return (const types::u8*)data + ((const sMeshFileHeader*)data)->vertexOffset;
+    }
+
+    inline const void* GetMeshFileIndices(const void* data)
+    {
+        return (const types::u8*)data + ((const sMeshFileHeader*)data)->indexOffset;
+    }
+}
\ No newline at end of file
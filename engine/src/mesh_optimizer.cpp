@@ -0,0 +1,674 @@
+// mesh_optimizer.cpp
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include "mesh_optimizer.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    static constexpr u32 kInvalidVertex = 0xFFFFFFFF;
+
+    // Triangles using each vertex, offsets has vertexCount + 1 entries
+    struct sTriangleAdjacency
+    {
+        std::vector<u32> offsets = {};
+        std::vector<u32> triangles = {};
+        std::vector<u32> liveCounts = {};
+    };
+
+    static void BuildAdjacency(sTriangleAdjacency& adjacency, const u32* indices, usize indexCount, usize vertexCount)
+    {
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        adjacency.liveCounts.assign(vertexCount, 0);
+        adjacency.triangles.resize(indexCount);
+
+        for (usize i = 0; i < indexCount; i++)
+            adjacency.liveCounts[indices[i]] += 1;
+
+        u32 offset = 0;
+        for (usize v = 0; v < vertexCount; v++)
+        {
+            adjacency.offsets[v] = offset;
+            offset += adjacency.liveCounts[v];
+        }
+        adjacency.offsets[vertexCount] = offset;
+
+        std::vector<u32> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (usize i = 0; i < indexCount; i++)
+            adjacency.triangles[cursors[indices[i]]++] = (u32)(i / 3);
+    }
+
+    // Plane quadric, upper triangle of the symmetric 4x4 matrix
+    struct sQuadric
+    {
+        f32 a00 = 0.0f, a01 = 0.0f, a02 = 0.0f, a03 = 0.0f;
+        f32 a11 = 0.0f, a12 = 0.0f, a13 = 0.0f;
+        f32 a22 = 0.0f, a23 = 0.0f;
+        f32 a33 = 0.0f;
+        f32 weight = 0.0f;
+    };
+
+    static void AddPlaneQuadric(sQuadric& quadric, f32 a, f32 b, f32 c, f32 d, f32 weight)
+    {
+        quadric.a00 += a * a * weight; quadric.a01 += a * b * weight; quadric.a02 += a * c * weight; quadric.a03 += a * d * weight;
+        quadric.a11 += b * b * weight; quadric.a12 += b * c * weight; quadric.a13 += b * d * weight;
+        quadric.a22 += c * c * weight; quadric.a23 += c * d * weight;
+        quadric.a33 += d * d * weight;
+        quadric.weight += weight;
+    }
+
+    static void AddQuadric(sQuadric& quadric, const sQuadric& other)
+    {
+        quadric.a00 += other.a00; quadric.a01 += other.a01; quadric.a02 += other.a02; quadric.a03 += other.a03;
+        quadric.a11 += other.a11; quadric.a12 += other.a12; quadric.a13 += other.a13;
+        quadric.a22 += other.a22; quadric.a23 += other.a23;
+        quadric.a33 += other.a33;
+        quadric.weight += other.weight;
+    }
+
+    static f32 EvaluateQuadric(const sQuadric& q, const f32* p)
+    {
+        const f32 x = p[0], y = p[1], z = p[2];
+        const f32 error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + q.a33 +
+            2.0f * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z + q.a03 * x + q.a13 * y + q.a23 * z);
+
+        // Mean over the planes, a sum would grow with every merge and stop meaning a distance
+        return error > 0.0f && q.weight > 0.0f ? error / q.weight : 0.0f;
+    }
+
+    static void TriangleNormal(const f32* p0, const f32* p1, const f32* p2, f32* normal)
+    {
+        const f32 e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const f32 e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    cMeshOptimizer::cMeshOptimizer(cContext* context) : iObject(context) {}
+
+    sVertexCacheStats cMeshOptimizer::AnalyzeVertexCache(const u32* indices, usize indexCount, usize vertexCount, usize cacheSize)
+    {
+        sVertexCacheStats stats = {};
+        stats.triangleCount = indexCount / 3;
+
+        // A vertex is in the cache while fewer than cacheSize misses happened after it was loaded
+        std::vector<usize> loadTimes(vertexCount, 0);
+        std::vector<u8> referenced(vertexCount, 0);
+        usize time = cacheSize + 1;
+
+        for (usize i = 0; i < indexCount; i++)
+        {
+            const u32 vertex = indices[i];
+            if (time - loadTimes[vertex] > cacheSize)
+            {
+                loadTimes[vertex] = time++;
+                stats.missCount += 1;
+            }
+
+            stats.vertexCount += referenced[vertex] == 0 ? 1 : 0;
+            referenced[vertex] = 1;
+        }
+
+        stats.acmr = stats.triangleCount > 0 ? (f32)stats.missCount / (f32)stats.triangleCount : 0.0f;
+        stats.atvr = stats.vertexCount > 0 ? (f32)stats.missCount / (f32)stats.vertexCount : 0.0f;
+
+        return stats;
+    }
+
+    // Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007
+    void cMeshOptimizer::OptimizeVertexCache(u32* destination, const u32* indices, usize indexCount, usize vertexCount, usize cacheSize)
+    {
+        const usize triangleCount = indexCount / 3;
+        if (triangleCount == 0 || vertexCount == 0)
+            return;
+
+        // Input may be the destination
+        std::vector<u32> source(indices, indices + triangleCount * 3);
+
+        sTriangleAdjacency adjacency;
+        BuildAdjacency(adjacency, source.data(), triangleCount * 3, vertexCount);
+
+        std::vector<usize> loadTimes(vertexCount, 0);
+        std::vector<u8> emitted(triangleCount, 0);
+        std::vector<u32> deadEnds;
+        std::vector<u32> candidates;
+        deadEnds.reserve(triangleCount * 3);
+        candidates.reserve(64);
+
+        usize time = cacheSize + 1;
+        usize cursor = 0;
+        usize outputIndex = 0;
+        u32 fanning = 0;
+
+        while (fanning != kInvalidVertex)
+        {
+            candidates.clear();
+
+            for (u32 a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++)
+            {
+                const u32 triangle = adjacency.triangles[a];
+                if (emitted[triangle] != 0)
+                    continue;
+
+                for (usize k = 0; k < 3; k++)
+                {
+                    const u32 vertex = source[triangle * 3 + k];
+                    destination[outputIndex++] = vertex;
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    adjacency.liveCounts[vertex] -= 1;
+
+                    if (time - loadTimes[vertex] > cacheSize)
+                        loadTimes[vertex] = time++;
+                }
+
+                emitted[triangle] = 1;
+            }
+
+            // Prefer the candidate that stays in the cache while its remaining fan is emitted and was loaded earliest
+            u32 next = kInvalidVertex;
+            usize bestPriority = 0;
+            for (const u32 vertex : candidates)
+            {
+                if (adjacency.liveCounts[vertex] == 0)
+                    continue;
+
+                usize priority = 1;
+                const usize age = time - loadTimes[vertex];
+                if (age + 2 * adjacency.liveCounts[vertex] <= cacheSize)
+                    priority = age + 1;
+
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next = vertex;
+                }
+            }
+
+            // Dead end, go back to recently used vertices and then to the next unprocessed one in input order
+            while (next == kInvalidVertex && deadEnds.empty() == false)
+            {
+                const u32 vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (adjacency.liveCounts[vertex] > 0)
+                    next = vertex;
+            }
+
+            while (next == kInvalidVertex && cursor < vertexCount)
+            {
+                if (adjacency.liveCounts[cursor] > 0)
+                    next = (u32)cursor;
+                cursor += 1;
+            }
+
+            fanning = next;
+        }
+    }
+
+    void cMeshOptimizer::OptimizeOverdraw(u32* destination, const u32* indices, usize indexCount, const f32* positions, usize positionStride, usize vertexCount, f32 threshold, usize cacheSize)
+    {
+        const usize triangleCount = indexCount / 3;
+        if (triangleCount == 0 || vertexCount == 0)
+            return;
+
+        std::vector<u32> source(indices, indices + triangleCount * 3);
+        const usize stride = positionStride / sizeof(f32);
+
+        // Hard boundaries are where the cache order starts over, every vertex of the triangle misses
+        std::vector<usize> loadTimes(vertexCount, 0);
+        usize time = cacheSize + 1;
+        std::vector<usize> hardClusters;
+        for (usize t = 0; t < triangleCount; t++)
+        {
+            usize misses = 0;
+            for (usize k = 0; k < 3; k++)
+            {
+                const u32 vertex = source[t * 3 + k];
+                if (time - loadTimes[vertex] > cacheSize)
+                {
+                    loadTimes[vertex] = time++;
+                    misses += 1;
+                }
+            }
+
+            if (misses == 3 || t == 0)
+                hardClusters.push_back(t);
+        }
+        hardClusters.push_back(triangleCount);
+
+        // Soft boundaries split hard clusters where the running ACMR is still within threshold of the cluster ACMR,
+        // a split restarts the cache so the total ACMR can't grow by more than that
+        std::vector<usize> clusters;
+        for (usize c = 0; c + 1 < hardClusters.size(); c++)
+        {
+            const usize begin = hardClusters[c];
+            const usize end = hardClusters[c + 1];
+
+            // Moving time past the cache size empties the cache without touching loadTimes, clearing it per
+            // cluster made this quadratic on meshes with many clusters
+            time += cacheSize + 1;
+            usize hardMisses = 0;
+            for (usize i = begin * 3; i < end * 3; i++)
+            {
+                const u32 vertex = source[i];
+                if (time - loadTimes[vertex] > cacheSize)
+                {
+                    loadTimes[vertex] = time++;
+                    hardMisses += 1;
+                }
+            }
+            const f32 limit = (f32)hardMisses / (f32)(end - begin) * threshold;
+
+            time += cacheSize + 1;
+            usize clusterBegin = begin;
+            usize clusterMisses = 0;
+            clusters.push_back(begin);
+
+            for (usize t = begin; t < end; t++)
+            {
+                for (usize k = 0; k < 3; k++)
+                {
+                    const u32 vertex = source[t * 3 + k];
+                    if (time - loadTimes[vertex] > cacheSize)
+                    {
+                        loadTimes[vertex] = time++;
+                        clusterMisses += 1;
+                    }
+                }
+
+                const usize clusterTriangleCount = t + 1 - clusterBegin;
+                if (t + 1 < end && (f32)clusterMisses <= limit * (f32)clusterTriangleCount)
+                {
+                    clusterBegin = t + 1;
+                    clusterMisses = 0;
+                    clusters.push_back(clusterBegin);
+                    time += cacheSize + 1;
+                }
+            }
+        }
+        clusters.push_back(triangleCount);
+
+        // Area weighted centroid and normal per cluster, clusters further out along their normal occlude the rest
+        const usize clusterCount = clusters.size() - 1;
+        std::vector<f32> clusterData(clusterCount * 7, 0.0f);
+        f32 meshCentroid[3] = {};
+        f32 meshArea = 0.0f;
+
+        for (usize c = 0; c < clusterCount; c++)
+        {
+            f32* data = &clusterData[c * 7];
+            for (usize t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                const f32* p0 = &positions[source[t * 3 + 0] * stride];
+                const f32* p1 = &positions[source[t * 3 + 1] * stride];
+                const f32* p2 = &positions[source[t * 3 + 2] * stride];
+                const f32 e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                const f32 e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                const f32 normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+                const f32 area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+                for (usize i = 0; i < 3; i++)
+                {
+                    data[i] += (p0[i] + p1[i] + p2[i]) * (1.0f / 3.0f) * area;
+                    data[3 + i] += normal[i];
+                }
+                data[6] += area;
+            }
+
+            for (usize i = 0; i < 3; i++)
+                meshCentroid[i] += data[i];
+            meshArea += data[6];
+
+            if (data[6] > 0.0f)
+            {
+                for (usize i = 0; i < 3; i++)
+                    data[i] /= data[6];
+            }
+        }
+
+        if (meshArea > 0.0f)
+        {
+            for (usize i = 0; i < 3; i++)
+                meshCentroid[i] /= meshArea;
+        }
+
+        std::vector<f32> keys(clusterCount, 0.0f);
+        std::vector<u32> order(clusterCount);
+        for (usize c = 0; c < clusterCount; c++)
+        {
+            const f32* data = &clusterData[c * 7];
+            const f32 length = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+            if (length > 0.0f)
+                keys[c] = ((data[0] - meshCentroid[0]) * data[3] + (data[1] - meshCentroid[1]) * data[4] + (data[2] - meshCentroid[2]) * data[5]) / length;
+            order[c] = (u32)c;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&keys](u32 lhs, u32 rhs) { return keys[lhs] > keys[rhs]; });
+
+        usize outputIndex = 0;
+        for (const u32 c : order)
+        {
+            const usize byteSize = (clusters[c + 1] - clusters[c]) * 3 * sizeof(u32);
+            std::memcpy(&destination[outputIndex], &source[clusters[c] * 3], byteSize);
+            outputIndex += (clusters[c + 1] - clusters[c]) * 3;
+        }
+    }
+
+    usize cMeshOptimizer::OptimizeVertexFetch(void* destinationVertices, u32* indices, usize indexCount, const void* vertices, usize vertexCount, usize vertexStride)
+    {
+        std::vector<u32> remap(vertexCount, kInvalidVertex);
+        u32 nextVertex = 0;
+
+        for (usize i = 0; i < indexCount; i++)
+        {
+            const u32 vertex = indices[i];
+            if (remap[vertex] == kInvalidVertex)
+            {
+                remap[vertex] = nextVertex;
+                std::memcpy((u8*)destinationVertices + nextVertex * vertexStride, (const u8*)vertices + vertex * vertexStride, vertexStride);
+                nextVertex += 1;
+            }
+
+            indices[i] = remap[vertex];
+        }
+
+        return nextVertex;
+    }
+
+    usize cMeshOptimizer::Simplify(u32* destination, const u32* indices, usize indexCount, const f32* positions, usize positionStride, usize vertexCount, usize targetIndexCount, f32 targetError, f32* resultError)
+    {
+        const usize stride = positionStride / sizeof(f32);
+        std::vector<u32> result(indices, indices + indexCount / 3 * 3);
+        f32 maxError = 0.0f;
+
+        // Quadrics of the incident triangle planes, errors are mean squared distances to them
+        std::vector<sQuadric> quadrics(vertexCount);
+        for (usize i = 0; i < result.size(); i += 3)
+        {
+            const f32* p0 = &positions[result[i + 0] * stride];
+            f32 normal[3];
+            TriangleNormal(p0, &positions[result[i + 1] * stride], &positions[result[i + 2] * stride], normal);
+
+            const f32 length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length == 0.0f)
+                continue;
+
+            const f32 a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+            const f32 d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+            for (usize k = 0; k < 3; k++)
+                AddPlaneQuadric(quadrics[result[i + k]], a, b, c, d, 1.0f);
+        }
+
+        // Edges used by one triangle are mesh borders or attribute seams, their vertices never move
+        std::vector<u8> locked(vertexCount, 0);
+        {
+            std::unordered_map<u64, u32> edgeCounts;
+            edgeCounts.reserve(result.size());
+            for (usize i = 0; i < result.size(); i += 3)
+            {
+                for (usize k = 0; k < 3; k++)
+                {
+                    const u32 a = result[i + k];
+                    const u32 b = result[i + (k + 1) % 3];
+                    edgeCounts[a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a] += 1;
+                }
+            }
+
+            for (const auto& edge : edgeCounts)
+            {
+                if (edge.second == 1)
+                {
+                    locked[(u32)(edge.first >> 32)] = 1;
+                    locked[(u32)edge.first] = 1;
+                }
+            }
+        }
+
+        struct sCollapse
+        {
+            u32 from;
+            u32 to;
+            f32 error;
+        };
+
+        std::vector<sCollapse> collapses;
+        std::vector<u8> touched(vertexCount, 0);
+        sTriangleAdjacency adjacency;
+        const f32 maxQuadricError = targetError * targetError;
+
+        while (result.size() > targetIndexCount)
+        {
+            BuildAdjacency(adjacency, result.data(), result.size(), vertexCount);
+
+            collapses.clear();
+            for (usize i = 0; i < result.size(); i += 3)
+            {
+                for (usize k = 0; k < 3; k++)
+                {
+                    const u32 from = result[i + k];
+                    const u32 to = result[i + (k + 1) % 3];
+                    if (locked[from] != 0)
+                        continue;
+
+                    sQuadric quadric = quadrics[from];
+                    AddQuadric(quadric, quadrics[to]);
+                    const f32 error = EvaluateQuadric(quadric, &positions[to * stride]);
+                    if (error <= maxQuadricError)
+                        collapses.push_back({ from, to, error });
+                }
+            }
+
+            if (collapses.empty())
+                break;
+
+            std::sort(collapses.begin(), collapses.end(), [](const sCollapse& lhs, const sCollapse& rhs) { return lhs.error < rhs.error; });
+            std::fill(touched.begin(), touched.end(), 0);
+
+            usize triangleCount = result.size() / 3;
+            usize collapseCount = 0;
+            for (const sCollapse& collapse : collapses)
+            {
+                if (triangleCount * 3 <= targetIndexCount)
+                    break;
+                if (touched[collapse.from] != 0 || touched[collapse.to] != 0)
+                    continue;
+
+                // Reject collapses that flip a remaining triangle around from
+                boolean flips = K_FALSE;
+                usize removedCount = 0;
+                for (u32 a = adjacency.offsets[collapse.from]; a < adjacency.offsets[collapse.from + 1] && flips == K_FALSE; a++)
+                {
+                    const u32* triangle = &result[adjacency.triangles[a] * 3];
+                    if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                    {
+                        removedCount += 1;
+                        continue;
+                    }
+
+                    const f32* before[3];
+                    const f32* after[3];
+                    for (usize k = 0; k < 3; k++)
+                    {
+                        before[k] = &positions[triangle[k] * stride];
+                        after[k] = &positions[(triangle[k] == collapse.from ? collapse.to : triangle[k]) * stride];
+                    }
+
+                    f32 normalBefore[3], normalAfter[3];
+                    TriangleNormal(before[0], before[1], before[2], normalBefore);
+                    TriangleNormal(after[0], after[1], after[2], normalAfter);
+                    if (normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0f)
+                        flips = K_TRUE;
+                }
+
+                if (flips == K_TRUE)
+                    continue;
+
+                // Everything around the collapse is stale for the rest of the pass
+                for (u32 a = adjacency.offsets[collapse.from]; a < adjacency.offsets[collapse.from + 1]; a++)
+                {
+                    u32* triangle = &result[adjacency.triangles[a] * 3];
+                    for (usize k = 0; k < 3; k++)
+                    {
+                        touched[triangle[k]] = 1;
+                        if (triangle[k] == collapse.from)
+                            triangle[k] = collapse.to;
+                    }
+                }
+                for (u32 a = adjacency.offsets[collapse.to]; a < adjacency.offsets[collapse.to + 1]; a++)
+                {
+                    const u32* triangle = &result[adjacency.triangles[a] * 3];
+                    touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+                }
+
+                AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+                maxError = std::max(maxError, collapse.error);
+                triangleCount -= removedCount;
+                collapseCount += 1;
+            }
+
+            usize writeIndex = 0;
+            for (usize i = 0; i < result.size(); i += 3)
+            {
+                if (result[i] == result[i + 1] || result[i + 1] == result[i + 2] || result[i] == result[i + 2])
+                    continue;
+
+                result[writeIndex++] = result[i];
+                result[writeIndex++] = result[i + 1];
+                result[writeIndex++] = result[i + 2];
+            }
+            result.resize(writeIndex);
+
+            if (collapseCount == 0)
+                break;
+        }
+
+        if (result.empty() == false)
+            std::memcpy(destination, result.data(), result.size() * sizeof(u32));
+        if (resultError != nullptr)
+            *resultError = std::sqrt(maxError);
+
+        return result.size();
+    }
+
+    usize cMeshOptimizer::GetMaxMeshletCount(usize indexCount, usize maxVertexCount, usize maxTriangleCount)
+    {
+        // Every triangle brings at most 3 new vertices
+        usize trianglesPerMeshlet = maxVertexCount / 3 < maxTriangleCount ? maxVertexCount / 3 : maxTriangleCount;
+        if (trianglesPerMeshlet == 0)
+            trianglesPerMeshlet = 1;
+
+        return (indexCount / 3 + trianglesPerMeshlet - 1) / trianglesPerMeshlet;
+    }
+
+    static void FinishMeshlet(sMeshlet& meshlet, const u32* indices, const f32* positions, usize stride)
+    {
+        f32 aabbMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        f32 aabbMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        f32 axis[3] = {};
+        for (u32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+        {
+            f32 normal[3];
+            TriangleNormal(&positions[indices[i] * stride], &positions[indices[i + 1] * stride], &positions[indices[i + 2] * stride], normal);
+            const f32 length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (usize k = 0; k < 3; k++)
+            {
+                axis[k] += length > 0.0f ? normal[k] / length : 0.0f;
+
+                const f32* position = &positions[indices[i + k] * stride];
+                for (usize c = 0; c < 3; c++)
+                {
+                    aabbMin[c] = std::min(aabbMin[c], position[c]);
+                    aabbMax[c] = std::max(aabbMax[c], position[c]);
+                }
+            }
+        }
+
+        f32 radiusSquared = 0.0f;
+        for (usize c = 0; c < 3; c++)
+            meshlet.center[c] = (aabbMin[c] + aabbMax[c]) * 0.5f;
+        for (u32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++)
+        {
+            const f32* position = &positions[indices[i] * stride];
+            const f32 dx = position[0] - meshlet.center[0], dy = position[1] - meshlet.center[1], dz = position[2] - meshlet.center[2];
+            radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+        }
+        meshlet.radius = std::sqrt(radiusSquared);
+
+        // Cone around the average normal, a spread of 90 degrees or more can't be culled as a whole
+        const f32 axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        meshlet.coneCutoff = 1.0f;
+        if (axisLength == 0.0f)
+            return;
+
+        for (usize c = 0; c < 3; c++)
+            meshlet.coneAxis[c] = axis[c] / axisLength;
+
+        f32 minDot = 1.0f;
+        for (u32 i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+        {
+            f32 normal[3];
+            TriangleNormal(&positions[indices[i] * stride], &positions[indices[i + 1] * stride], &positions[indices[i + 2] * stride], normal);
+            const f32 length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length > 0.0f)
+                minDot = std::min(minDot, (normal[0] * meshlet.coneAxis[0] + normal[1] * meshlet.coneAxis[1] + normal[2] * meshlet.coneAxis[2]) / length);
+        }
+
+        if (minDot > 0.0f)
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    usize cMeshOptimizer::BuildMeshlets(sMeshlet* meshlets, const u32* indices, usize indexCount, const f32* positions, usize positionStride, usize vertexCount, usize maxVertexCount, usize maxTriangleCount)
+    {
+        const usize stride = positionStride / sizeof(f32);
+        const usize triangleCount = indexCount / 3;
+
+        // Meshlet a vertex was last added to, plus one so 0 means none
+        std::vector<u32> vertexMeshlets(vertexCount, 0);
+        usize meshletCount = 0;
+        sMeshlet* meshlet = nullptr;
+
+        for (usize t = 0; t < triangleCount; t++)
+        {
+            const u32* triangle = &indices[t * 3];
+            usize newVertexCount = 0;
+            for (usize k = 0; k < 3; k++)
+            {
+                const boolean repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]) ? K_TRUE : K_FALSE;
+                newVertexCount += vertexMeshlets[triangle[k]] != meshletCount && repeated == K_FALSE ? 1 : 0;
+            }
+
+            if (meshlet == nullptr || meshlet->vertexCount + newVertexCount > maxVertexCount || meshlet->indexCount / 3 >= maxTriangleCount)
+            {
+                if (meshlet != nullptr)
+                    FinishMeshlet(*meshlet, indices, positions, stride);
+
+                meshlet = &meshlets[meshletCount++];
+                *meshlet = {};
+                meshlet->firstIndex = (u32)(t * 3);
+            }
+
+            for (usize k = 0; k < 3; k++)
+            {
+                if (vertexMeshlets[triangle[k]] != meshletCount)
+                {
+                    vertexMeshlets[triangle[k]] = (u32)meshletCount;
+                    meshlet->vertexCount += 1;
+                }
+            }
+
+            meshlet->indexCount += 3;
+        }
+
+        if (meshlet != nullptr)
+            FinishMeshlet(*meshlet, indices, positions, stride);
+
+        return meshletCount;
+    }
+}
\ No newline at end of file
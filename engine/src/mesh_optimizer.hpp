@@ -0,0 +1,69 @@
+// mesh_optimizer.hpp
+
+#pragma once
+
+#include "object.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    struct sVertexCacheStats
+    {
+        types::usize triangleCount = 0;
+        types::usize vertexCount = 0; // referenced vertices
+        types::usize missCount = 0;
+        types::f32 acmr = 0.0f; // misses per triangle, 0.5 is the best a regular grid gets
+        types::f32 atvr = 0.0f; // misses per referenced vertex, 1.0 is optimal
+    };
+
+    // Contiguous triangle range of an index buffer with bounds for cluster culling
+    struct sMeshlet
+    {
+        types::u32 firstIndex = 0;
+        types::u32 indexCount = 0;
+        types::u32 vertexCount = 0;
+        types::u32 padding = 0;
+        types::f32 center[3] = {};
+        types::f32 radius = 0.0f;
+        types::f32 coneAxis[3] = {}; // mean normal of the counter-clockwise front faces
+        types::f32 coneCutoff = 1.0f; // sine of the normal cone half angle, 1 when the cone can't be backface culled
+    };
+
+    // Index and vertex reordering for triangle lists, meant to run once at import/cook time:
+    // OptimizeVertexCache (Tipsify), then OptimizeOverdraw on its output, then OptimizeVertexFetch. Simplify
+    // builds LOD index buffers over the same vertices.
+    // Every function works on u32 indices and accepts destination == indices.
+    class cMeshOptimizer : public iObject
+    {
+        TRITON_OBJECT(cMeshOptimizer)
+
+    public:
+        static constexpr types::usize kDefaultCacheSize = 16;
+
+        explicit cMeshOptimizer(cContext* context);
+        virtual ~cMeshOptimizer() override final = default;
+
+        // FIFO post-transform cache simulation
+        static sVertexCacheStats AnalyzeVertexCache(const types::u32* indices, types::usize indexCount, types::usize vertexCount, types::usize cacheSize = kDefaultCacheSize);
+        static void OptimizeVertexCache(types::u32* destination, const types::u32* indices, types::usize indexCount, types::usize vertexCount, types::usize cacheSize = kDefaultCacheSize);
+        // Splits the cache optimized order into clusters and draws the clusters facing outward first,
+        // threshold is how much worse than the input ACMR a cluster split is allowed to make the result
+        static void OptimizeOverdraw(types::u32* destination, const types::u32* indices, types::usize indexCount, const types::f32* positions, types::usize positionStride, types::usize vertexCount, types::f32 threshold = 1.05f, types::usize cacheSize = kDefaultCacheSize);
+        // Rewrites vertices in first use order and remaps indices, unreferenced vertices are dropped.
+        // Returns the new vertex count, destinationVertices must not alias vertices.
+        static types::usize OptimizeVertexFetch(void* destinationVertices, types::u32* indices, types::usize indexCount, const void* vertices, types::usize vertexCount, types::usize vertexStride);
+        // Quadric error edge collapse towards targetIndexCount, vertices only move onto their neighbours so the
+        // result indexes the same vertex buffer and can live next to the source as a LOD. Stops early once a
+        // collapse would cost more than targetError (object space distance). Border vertices stay in place.
+        // Returns the new index count, resultError gets the largest error of the collapses made.
+        static constexpr types::usize kMaxMeshletVertexCount = 64;
+        static constexpr types::usize kMaxMeshletTriangleCount = 124;
+
+        // Upper bound of the meshlet count BuildMeshlets can return
+        static types::usize GetMaxMeshletCount(types::usize indexCount, types::usize maxVertexCount = kMaxMeshletVertexCount, types::usize maxTriangleCount = kMaxMeshletTriangleCount);
+        // Splits the triangles into consecutive meshlets in their current order, run OptimizeVertexCache first so they
+        // come out compact. Meshlet index ranges point into indices. Returns the meshlet count.
+        static types::usize BuildMeshlets(sMeshlet* meshlets, const types::u32* indices, types::usize indexCount, const types::f32* positions, types::usize positionStride, types::usize vertexCount, types::usize maxVertexCount = kMaxMeshletVertexCount, types::usize maxTriangleCount = kMaxMeshletTriangleCount);
+        static types::usize Simplify(types::u32* destination, const types::u32* indices, types::usize indexCount, const types::f32* positions, types::usize positionStride, types::usize vertexCount, types::usize targetIndexCount, types::f32 targetError, types::f32* resultError = nullptr);
+    };
+}
\ No newline at end of file
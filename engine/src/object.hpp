@@ -24,6 +24,11 @@ namespace triton
 			static ClassType GetTypeStatic() { return #typeName; } \
 			virtual ClassType GetType() const override { return GetTypeStatic(); } \
 
+	// Header-less type created through cFactory into storage owned by a container, no vtable, context or tag
+	#define TRITON_POD(typeName) \
+		public: \
+			static ClassType GetTypeStatic() { return #typeName; } \
+
 	class cIdentifier
 	{
 	public:
@@ -43,7 +48,6 @@ namespace triton
 		friend class cIdVector;
 		template <typename T>
 		friend class cFactory;
-		friend class cMemoryAllocator;
 
 	public:
 		explicit iObject(cContext* context) : _context(context) {}
@@ -65,7 +69,6 @@ namespace triton
 
 	protected:
 		cContext* _context = nullptr;
-		types::boolean _occupied = types::K_FALSE;
 		types::s64 _allocatorIndex = 0;
 		types::boolean _allocatedUsingMemAllocator = types::K_FALSE;
 		cTag _id;
@@ -0,0 +1,402 @@
+// occlusion_system.cpp
+
+#include <cmath>
+#include <utility>
+#include "occlusion_system.hpp"
+#include "simd.hpp"
+#include "graphics.hpp"
+#include "vertex_format.hpp"
+#include "thread_manager.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+	static constexpr f32 kNearW = 1e-4f;
+
+	cOcclusionCulling::cOcclusionCulling(cContext* context) : iObject(context)
+	{
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		// Rows are processed 4 pixels at a time
+		_width = (caps->occlusionBufferWidth + 3) & ~(usize)3;
+		_height = caps->occlusionBufferHeight;
+		_tileCountX = (_width + kTileWidth - 1) / kTileWidth;
+		_tileCountY = (_height + kTileHeight - 1) / kTileHeight;
+		_maxTriangleCount = caps->maxOccluderTriangleCount;
+
+		_triangles = (glm::vec4*)memoryAllocator->Allocate(_maxTriangleCount * 3 * sizeof(glm::vec4), caps->memoryAlignment);
+		_rasterTriangles = (sRasterTriangle*)memoryAllocator->Allocate(_maxTriangleCount * sizeof(sRasterTriangle), caps->memoryAlignment);
+
+		usize mipWidth = _width;
+		usize mipHeight = _height;
+		while (_mipCount < kMaxMipCount)
+		{
+			_mipWidths[_mipCount] = mipWidth;
+			_mipHeights[_mipCount] = mipHeight;
+			_mips[_mipCount] = (f32*)memoryAllocator->Allocate(mipWidth * mipHeight * sizeof(f32), caps->memoryAlignment);
+			for (usize i = 0; i < mipWidth * mipHeight; i++)
+				_mips[_mipCount][i] = 1.0f;
+			_mipCount += 1;
+
+			if (mipWidth == 1 && mipHeight == 1)
+				break;
+
+			mipWidth = (mipWidth + 1) / 2;
+			mipHeight = (mipHeight + 1) / 2;
+		}
+	}
+
+	cOcclusionCulling::~cOcclusionCulling()
+	{
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		for (usize i = 0; i < _mipCount; i++)
+			memoryAllocator->Deallocate(_mips[i]);
+		memoryAllocator->Deallocate(_rasterTriangles);
+		memoryAllocator->Deallocate(_triangles);
+	}
+
+	void cOcclusionCulling::AddOccluder(const sVertexBufferGeometry* geometry, const glm::mat4& world)
+	{
+		if (geometry->_vertexPtr == nullptr || geometry->_indexPtr == nullptr)
+		{
+			Print("Error: occluder geometry has no CPU copy, enable keepGeometryCPUCopy!");
+			return;
+		}
+
+		const usize stride = GetVertexFormatStride(geometry->_format);
+		const usize vertices = (usize)geometry->_vertexPtr + geometry->_offsetVertex * stride;
+		const u32* indices = (const u32*)((usize)geometry->_indexPtr + geometry->_offsetIndex);
+
+		const usize triangleCount = geometry->_indexCount / 3;
+		if (_triangleCount + triangleCount > _maxTriangleCount)
+		{
+			Print("Error: occluder triangle limit reached!");
+			return;
+		}
+
+		// Positions of every vertex format are decoded to floats
+		glm::vec4* triangles = &_triangles[_triangleCount * 3];
+		for (usize i = 0; i < triangleCount * 3; i++)
+		{
+			const glm::vec3 position = DecodeVertexPosition(geometry->_format, (const void*)(vertices + indices[i] * stride));
+			triangles[i] = world * glm::vec4(position, 1.0f);
+		}
+
+		_triangleCount += triangleCount;
+	}
+
+	void cOcclusionCulling::AddOccluder(const glm::vec3* positions, usize positionStride, const u32* indices, usize indexCount, const glm::mat4& world)
+	{
+		const usize triangleCount = indexCount / 3;
+		if (_triangleCount + triangleCount > _maxTriangleCount)
+		{
+			Print("Error: occluder triangle limit reached!");
+			return;
+		}
+
+		glm::vec4* triangles = &_triangles[_triangleCount * 3];
+		for (usize i = 0; i < triangleCount * 3; i++)
+		{
+			const glm::vec3& position = *(const glm::vec3*)((usize)positions + indices[i] * positionStride);
+			triangles[i] = world * glm::vec4(position, 1.0f);
+		}
+
+		_triangleCount += triangleCount;
+	}
+
+	void cOcclusionCulling::ClearOccluders()
+	{
+		_triangleCount = 0;
+	}
+
+	void cOcclusionCulling::Render(const cMatrix4& viewProjection)
+	{
+		_viewProjection = *(const glm::mat4*)viewProjection.GetData();
+
+		SetupTriangles();
+
+		const usize tileCount = _tileCountX * _tileCountY;
+		cThread* threads = _context->GetSubsystem<cThread>();
+		if (threads != nullptr)
+		{
+			threads->Dispatch(tileCount, [this](usize tileIndex) {
+				RasterizeTile(tileIndex);
+			});
+		}
+		else
+		{
+			for (usize i = 0; i < tileCount; i++)
+				RasterizeTile(i);
+		}
+
+		BuildHierarchicalDepth();
+	}
+
+	void cOcclusionCulling::SetupTriangles()
+	{
+		const f32 width = (f32)_width;
+		const f32 height = (f32)_height;
+
+		_rasterTriangleCount = 0;
+
+		for (usize i = 0; i < _triangleCount; i++)
+		{
+			glm::vec3 screen[3];
+			boolean crossesNear = K_FALSE;
+			for (usize v = 0; v < 3; v++)
+			{
+				const glm::vec4 clip = _viewProjection * _triangles[i * 3 + v];
+				if (clip.w <= kNearW)
+				{
+					crossesNear = K_TRUE;
+					break;
+				}
+
+				const f32 invW = 1.0f / clip.w;
+				screen[v] = glm::vec3(
+					(clip.x * invW * 0.5f + 0.5f) * width,
+					(clip.y * invW * 0.5f + 0.5f) * height,
+					clip.z * invW * 0.5f + 0.5f
+				);
+			}
+			if (crossesNear == K_TRUE)
+				continue;
+
+			// Both windings are occluders, flip clockwise triangles so inside is always positive
+			f32 area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+			if (area < 0.0f)
+			{
+				std::swap(screen[1], screen[2]);
+				area = -area;
+			}
+			if (area <= 1e-6f)
+				continue;
+
+			sRasterTriangle& triangle = _rasterTriangles[_rasterTriangleCount];
+			triangle.minX = (s32)std::floor(glm::min(screen[0].x, glm::min(screen[1].x, screen[2].x)));
+			triangle.minY = (s32)std::floor(glm::min(screen[0].y, glm::min(screen[1].y, screen[2].y)));
+			triangle.maxX = (s32)std::ceil(glm::max(screen[0].x, glm::max(screen[1].x, screen[2].x)));
+			triangle.maxY = (s32)std::ceil(glm::max(screen[0].y, glm::max(screen[1].y, screen[2].y)));
+			triangle.minX = glm::max(triangle.minX, 0);
+			triangle.minY = glm::max(triangle.minY, 0);
+			triangle.maxX = glm::min(triangle.maxX, (s32)_width - 1);
+			triangle.maxY = glm::min(triangle.maxY, (s32)_height - 1);
+			if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+				continue;
+
+			// Edge i is opposite to vertex i, its value divided by area is the barycentric weight of that vertex
+			const f32 invArea = 1.0f / area;
+			triangle.depth[0] = 0.0f;
+			triangle.depth[1] = 0.0f;
+			triangle.depth[2] = 0.0f;
+			for (usize e = 0; e < 3; e++)
+			{
+				const glm::vec3& from = screen[(e + 1) % 3];
+				const glm::vec3& to = screen[(e + 2) % 3];
+				const f32 a = from.y - to.y;
+				const f32 b = to.x - from.x;
+				const f32 c = -(a * from.x + b * from.y);
+
+				triangle.edges[e][0] = a;
+				triangle.edges[e][1] = b;
+				triangle.edges[e][2] = c;
+				triangle.depth[0] += screen[e].z * a * invArea;
+				triangle.depth[1] += screen[e].z * b * invArea;
+				triangle.depth[2] += screen[e].z * c * invArea;
+			}
+
+			_rasterTriangleCount += 1;
+		}
+	}
+
+	void cOcclusionCulling::RasterizeTile(usize tileIndex)
+	{
+		const s32 tileMinX = (s32)((tileIndex % _tileCountX) * kTileWidth);
+		const s32 tileMinY = (s32)((tileIndex / _tileCountX) * kTileHeight);
+		const s32 tileMaxX = glm::min(tileMinX + (s32)kTileWidth, (s32)_width) - 1;
+		const s32 tileMaxY = glm::min(tileMinY + (s32)kTileHeight, (s32)_height) - 1;
+		f32* depth = _mips[0];
+
+		for (s32 y = tileMinY; y <= tileMaxY; y++)
+		{
+			f32* row = depth + y * _width;
+			for (s32 x = tileMinX; x <= tileMaxX; x++)
+				row[x] = 1.0f;
+		}
+
+		for (usize i = 0; i < _rasterTriangleCount; i++)
+		{
+			const sRasterTriangle& triangle = _rasterTriangles[i];
+			const s32 minX = glm::max(triangle.minX, tileMinX) & ~3;
+			const s32 maxX = glm::min(triangle.maxX, tileMaxX);
+			const s32 minY = glm::max(triangle.minY, tileMinY);
+			const s32 maxY = glm::min(triangle.maxY, tileMaxY);
+			if (minX > maxX || minY > maxY)
+				continue;
+
+#if defined(TRITON_SIMD_SSE)
+			const __m128 edgeA0 = _mm_set1_ps(triangle.edges[0][0]);
+			const __m128 edgeA1 = _mm_set1_ps(triangle.edges[1][0]);
+			const __m128 edgeA2 = _mm_set1_ps(triangle.edges[2][0]);
+			const __m128 depthA = _mm_set1_ps(triangle.depth[0]);
+			const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			const __m128 zero = _mm_setzero_ps();
+
+			for (s32 y = minY; y <= maxY; y++)
+			{
+				const f32 centerY = (f32)y + 0.5f;
+				const __m128 edgeRow0 = _mm_set1_ps(triangle.edges[0][1] * centerY + triangle.edges[0][2]);
+				const __m128 edgeRow1 = _mm_set1_ps(triangle.edges[1][1] * centerY + triangle.edges[1][2]);
+				const __m128 edgeRow2 = _mm_set1_ps(triangle.edges[2][1] * centerY + triangle.edges[2][2]);
+				const __m128 depthRow = _mm_set1_ps(triangle.depth[1] * centerY + triangle.depth[2]);
+				f32* row = depth + y * _width;
+
+				for (s32 x = minX; x <= maxX; x += 4)
+				{
+					const __m128 centerX = _mm_add_ps(_mm_set1_ps((f32)x), laneOffsets);
+					const __m128 edge0 = _mm_add_ps(_mm_mul_ps(edgeA0, centerX), edgeRow0);
+					const __m128 edge1 = _mm_add_ps(_mm_mul_ps(edgeA1, centerX), edgeRow1);
+					const __m128 edge2 = _mm_add_ps(_mm_mul_ps(edgeA2, centerX), edgeRow2);
+					const __m128 inside = _mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_and_ps(_mm_cmpge_ps(edge1, zero), _mm_cmpge_ps(edge2, zero)));
+					if (_mm_movemask_ps(inside) == 0)
+						continue;
+
+					const __m128 current = _mm_load_ps(row + x);
+					const __m128 nearest = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(depthA, centerX), depthRow));
+					_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+				}
+			}
+#else
+			for (s32 y = minY; y <= maxY; y++)
+			{
+				const f32 centerY = (f32)y + 0.5f;
+				f32* row = depth + y * _width;
+
+				for (s32 x = minX; x <= maxX; x++)
+				{
+					const f32 centerX = (f32)x + 0.5f;
+					boolean inside = K_TRUE;
+					for (usize e = 0; e < 3; e++)
+					{
+						if (triangle.edges[e][0] * centerX + triangle.edges[e][1] * centerY + triangle.edges[e][2] < 0.0f)
+							inside = K_FALSE;
+					}
+
+					if (inside == K_TRUE)
+						row[x] = glm::min(row[x], triangle.depth[0] * centerX + triangle.depth[1] * centerY + triangle.depth[2]);
+				}
+			}
+#endif
+		}
+	}
+
+	void cOcclusionCulling::BuildHierarchicalDepth()
+	{
+		for (usize mip = 1; mip < _mipCount; mip++)
+		{
+			const f32* source = _mips[mip - 1];
+			const usize sourceWidth = _mipWidths[mip - 1];
+			const usize sourceHeight = _mipHeights[mip - 1];
+			f32* destination = _mips[mip];
+
+			for (usize y = 0; y < _mipHeights[mip]; y++)
+			{
+				const usize y0 = y * 2;
+				const usize y1 = glm::min(y0 + 1, sourceHeight - 1);
+
+				for (usize x = 0; x < _mipWidths[mip]; x++)
+				{
+					const usize x0 = x * 2;
+					const usize x1 = glm::min(x0 + 1, sourceWidth - 1);
+
+					destination[y * _mipWidths[mip] + x] = glm::max(
+						glm::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+						glm::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1])
+					);
+				}
+			}
+		}
+	}
+
+	boolean cOcclusionCulling::IsVisible(const glm::mat4& world, const glm::vec3& aabbMin, const glm::vec3& aabbMax) const
+	{
+		const glm::mat4 worldViewProjection = _viewProjection * world;
+
+		f32 minX = (f32)_width;
+		f32 minY = (f32)_height;
+		f32 maxX = 0.0f;
+		f32 maxY = 0.0f;
+		f32 minDepth = 1.0f;
+
+		for (usize i = 0; i < 8; i++)
+		{
+			const glm::vec4 corner = glm::vec4(
+				(i & 1) ? aabbMax.x : aabbMin.x,
+				(i & 2) ? aabbMax.y : aabbMin.y,
+				(i & 4) ? aabbMax.z : aabbMin.z,
+				1.0f
+			);
+			const glm::vec4 clip = worldViewProjection * corner;
+			if (clip.w <= kNearW)
+				return K_TRUE;
+
+			const f32 invW = 1.0f / clip.w;
+			const f32 x = (clip.x * invW * 0.5f + 0.5f) * (f32)_width;
+			const f32 y = (clip.y * invW * 0.5f + 0.5f) * (f32)_height;
+			minX = glm::min(minX, x);
+			minY = glm::min(minY, y);
+			maxX = glm::max(maxX, x);
+			maxY = glm::max(maxY, y);
+			minDepth = glm::min(minDepth, clip.z * invW * 0.5f + 0.5f);
+		}
+
+		// Off screen boxes are left to frustum culling
+		if (maxX < 0.0f || maxY < 0.0f || minX >= (f32)_width || minY >= (f32)_height)
+			return K_TRUE;
+
+		const usize x0 = (usize)glm::max(minX, 0.0f);
+		const usize y0 = (usize)glm::max(minY, 0.0f);
+		const usize x1 = glm::min((usize)maxX, _width - 1);
+		const usize y1 = glm::min((usize)maxY, _height - 1);
+
+		usize mip = 0;
+		while (mip + 1 < _mipCount && ((x1 >> mip) - (x0 >> mip) > 1 || (y1 >> mip) - (y0 >> mip) > 1))
+			mip += 1;
+
+		const f32* depth = _mips[mip];
+		for (usize y = y0 >> mip; y <= (y1 >> mip); y++)
+		{
+			for (usize x = x0 >> mip; x <= (x1 >> mip); x++)
+			{
+				if (depth[y * _mipWidths[mip] + x] >= minDepth)
+					return K_TRUE;
+			}
+		}
+
+		return K_FALSE;
+	}
+
+	usize cOcclusionCulling::Filter(u32* objects, usize count, const glm::mat4* worlds, const sVertexBufferGeometry* const* geometries) const
+	{
+		usize visibleCount = 0;
+
+		for (usize i = 0; i < count; i++)
+		{
+			const u32 object = objects[i];
+			const sVertexBufferGeometry* geometry = geometries[object];
+
+			if (geometry == nullptr || IsVisible(worlds[object], geometry->_aabbMin, geometry->_aabbMax) == K_TRUE)
+				objects[visibleCount++] = object;
+		}
+
+		return visibleCount;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+// occlusion_system.hpp
+
+#pragma once
+
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "object.hpp"
+#include "math.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+	struct sVertexBufferGeometry;
+
+	// Occluder triangles are rasterized on the CPU into a small depth buffer, each tile of the buffer is a
+	// separate job on cThread. A max-depth mip chain is built on top and candidate AABBs are tested against
+	// the level where they cover at most 2x2 texels. Depth is 0 at the near plane and 1 at the far plane,
+	// triangles crossing the near plane are dropped, so the result never culls a visible object.
+	class cOcclusionCulling : public iObject
+	{
+		TRITON_OBJECT(cOcclusionCulling)
+
+	public:
+		static constexpr types::usize kTileWidth = 64;
+		static constexpr types::usize kTileHeight = 32;
+
+		explicit cOcclusionCulling(cContext* context);
+		virtual ~cOcclusionCulling() override final;
+
+		void AddOccluder(const sVertexBufferGeometry* geometry, const glm::mat4& world);
+		void AddOccluder(const glm::vec3* positions, types::usize positionStride, const types::u32* indices, types::usize indexCount, const glm::mat4& world);
+		void ClearOccluders();
+		// Rasterizes the occluders and rebuilds the hierarchical depth
+		void Render(const cMatrix4& viewProjection);
+		types::boolean IsVisible(const glm::mat4& world, const glm::vec3& aabbMin, const glm::vec3& aabbMax) const;
+		// Keeps the visible entries of objects in place and returns their count, objects index worlds and geometries
+		types::usize Filter(types::u32* objects, types::usize count, const glm::mat4* worlds, const sVertexBufferGeometry* const* geometries) const;
+
+		inline types::usize GetWidth() const { return _width; }
+		inline types::usize GetHeight() const { return _height; }
+		inline types::usize GetOccluderTriangleCount() const { return _triangleCount; }
+		inline types::usize GetMipCount() const { return _mipCount; }
+		inline const types::f32* GetDepth(types::usize mip = 0) const { return _mips[mip]; }
+
+	private:
+		struct sRasterTriangle
+		{
+			types::f32 edges[3][3]; // a * x + b * y + c >= 0 inside
+			types::f32 depth[3]; // depth plane a * x + b * y + c
+			types::s32 minX, minY, maxX, maxY;
+		};
+
+		static constexpr types::usize kMaxMipCount = 16;
+
+		void SetupTriangles();
+		void RasterizeTile(types::usize tileIndex);
+		void BuildHierarchicalDepth();
+
+	private:
+		types::usize _width = 0;
+		types::usize _height = 0;
+		types::usize _tileCountX = 0;
+		types::usize _tileCountY = 0;
+		types::usize _maxTriangleCount = 0;
+		types::usize _triangleCount = 0;
+		types::usize _rasterTriangleCount = 0;
+		glm::vec4* _triangles = nullptr;
+		sRasterTriangle* _rasterTriangles = nullptr;
+		glm::mat4 _viewProjection = glm::mat4(1.0f);
+		types::usize _mipCount = 0;
+		types::f32* _mips[kMaxMipCount] = {};
+		types::usize _mipWidths[kMaxMipCount] = {};
+		types::usize _mipHeights[kMaxMipCount] = {};
+	};
+}
\ No newline at end of file
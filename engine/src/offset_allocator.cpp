@@ -0,0 +1,346 @@
+// offset_allocator.cpp
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "offset_allocator.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    // value is never 0. _lzcnt_u32/_tzcnt_u32 would need LZCNT/BMI1, on older CPUs they run as BSR/BSF and return
+    // the bit index instead of the count.
+    static inline u32 CountLeadingZeros(u32 value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanReverse(&index, value);
+        return 31 - (u32)index;
+#else
+        return (u32)__builtin_clz(value);
+#endif
+    }
+
+    static inline u32 CountTrailingZeros(u32 value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward(&index, value);
+        return (u32)index;
+#else
+        return (u32)__builtin_ctz(value);
+#endif
+    }
+
+    cOffsetAllocator::cOffsetAllocator(cContext* context, usize byteSize, usize alignment, usize maxAllocationCount) : iObject(context), _alignment(alignment)
+    {
+        const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+        _unitCount = (u32)(byteSize / _alignment);
+        _byteSize = (usize)_unitCount * _alignment;
+        // Every allocation splits off at most one free region
+        _maxNodeCount = (u32)maxAllocationCount * 2 + 1;
+
+        _nodes = (sNode*)memoryAllocator->Allocate(_maxNodeCount * sizeof(sNode), caps->memoryAlignment);
+        _freeNodes = (u32*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u32), caps->memoryAlignment);
+
+        Reset();
+    }
+
+    cOffsetAllocator::~cOffsetAllocator()
+    {
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+        memoryAllocator->Deallocate(_freeNodes);
+        memoryAllocator->Deallocate(_nodes);
+    }
+
+    sOffsetAllocation cOffsetAllocator::Allocate(usize byteSize)
+    {
+        sOffsetAllocation allocation = {};
+
+        u32 size = (u32)((byteSize + _alignment - 1) / _alignment);
+        if (size == 0)
+            size = 1;
+
+        if (_freeNodeCount == 0 || size > _freeUnitCount)
+            return allocation;
+
+        // Round up so every region in the found bin is large enough
+        const u32 minBin = SizeToBinRoundUp(size);
+        u32 topBin = minBin >> kMantissaBitCount;
+        u32 leafBin = kInvalidNode;
+
+        if ((_usedBins & (1u << topBin)) != 0)
+            leafBin = FindLowestBitAfter(_usedLeafBins[topBin], minBin & (kLeafBinCount - 1));
+
+        if (leafBin == kInvalidNode)
+        {
+            topBin = FindLowestBitAfter(_usedBins, topBin + 1);
+            if (topBin == kInvalidNode)
+                return allocation;
+
+            leafBin = CountTrailingZeros(_usedLeafBins[topBin]);
+        }
+
+        const u32 nodeIndex = _binHeads[(topBin << kMantissaBitCount) | leafBin];
+        TakeFreeNode(nodeIndex, size);
+        _allocationCount += 1;
+
+        allocation.offset = (usize)_nodes[nodeIndex].offset * _alignment;
+        allocation.node = nodeIndex;
+
+        return allocation;
+    }
+
+    void cOffsetAllocator::Free(const sOffsetAllocation& allocation)
+    {
+        if (allocation.node == kInvalidNode || allocation.node >= _maxNodeCount || _nodes[allocation.node].used == K_FALSE)
+        {
+            Print("Error: freeing an invalid offset allocation!");
+            return;
+        }
+
+        const u32 nodeIndex = allocation.node;
+        sNode& node = _nodes[nodeIndex];
+        node.used = K_FALSE;
+
+        if (node.neighborPrev != kInvalidNode && _nodes[node.neighborPrev].used == K_FALSE)
+        {
+            const u32 prevIndex = node.neighborPrev;
+            const sNode& prev = _nodes[prevIndex];
+            UnlinkNode(prevIndex);
+
+            node.offset = prev.offset;
+            node.size += prev.size;
+            node.neighborPrev = prev.neighborPrev;
+            if (node.neighborPrev != kInvalidNode)
+                _nodes[node.neighborPrev].neighborNext = nodeIndex;
+
+            _freeNodes[_freeNodeCount++] = prevIndex;
+        }
+
+        if (node.neighborNext != kInvalidNode && _nodes[node.neighborNext].used == K_FALSE)
+        {
+            const u32 nextIndex = node.neighborNext;
+            const sNode& next = _nodes[nextIndex];
+            UnlinkNode(nextIndex);
+
+            node.size += next.size;
+            node.neighborNext = next.neighborNext;
+            if (node.neighborNext != kInvalidNode)
+                _nodes[node.neighborNext].neighborPrev = nodeIndex;
+
+            _freeNodes[_freeNodeCount++] = nextIndex;
+        }
+
+        LinkNode(nodeIndex);
+        _allocationCount -= 1;
+    }
+
+    sOffsetAllocation cOffsetAllocator::AllocateBelow(const sOffsetAllocation& allocation)
+    {
+        sOffsetAllocation newAllocation = {};
+        if (allocation.node == kInvalidNode || _freeNodeCount == 0)
+            return newAllocation;
+
+        // Walks the address ordered neighbour links, this is meant for budgeted defragmentation and not for the hot path
+        const u32 size = _nodes[allocation.node].size;
+        u32 lowestIndex = kInvalidNode;
+        for (u32 nodeIndex = _nodes[allocation.node].neighborPrev; nodeIndex != kInvalidNode; nodeIndex = _nodes[nodeIndex].neighborPrev)
+        {
+            if (_nodes[nodeIndex].used == K_FALSE && _nodes[nodeIndex].size >= size)
+                lowestIndex = nodeIndex;
+        }
+
+        if (lowestIndex == kInvalidNode)
+            return newAllocation;
+
+        TakeFreeNode(lowestIndex, size);
+        _allocationCount += 1;
+
+        newAllocation.offset = (usize)_nodes[lowestIndex].offset * _alignment;
+        newAllocation.node = lowestIndex;
+
+        return newAllocation;
+    }
+
+    void cOffsetAllocator::Reset()
+    {
+        _freeUnitCount = 0;
+        _allocationCount = 0;
+        _usedBins = 0;
+        for (u32 i = 0; i < kTopBinCount; i++)
+            _usedLeafBins[i] = 0;
+        for (u32 i = 0; i < kBinCount; i++)
+            _binHeads[i] = kInvalidNode;
+
+        _freeNodeCount = _maxNodeCount;
+        for (u32 i = 0; i < _maxNodeCount; i++)
+            _freeNodes[i] = _maxNodeCount - i - 1;
+
+        if (_unitCount == 0)
+            return;
+
+        const u32 nodeIndex = _freeNodes[--_freeNodeCount];
+        _nodes[nodeIndex] = sNode{};
+        _nodes[nodeIndex].size = _unitCount;
+        LinkNode(nodeIndex);
+    }
+
+    usize cOffsetAllocator::GetAllocationByteSize(const sOffsetAllocation& allocation) const
+    {
+        if (allocation.node == kInvalidNode)
+            return 0;
+
+        return (usize)_nodes[allocation.node].size * _alignment;
+    }
+
+    sOffsetAllocatorStats cOffsetAllocator::GetStats() const
+    {
+        sOffsetAllocatorStats stats = {};
+        stats.usedByteSize = (usize)(_unitCount - _freeUnitCount) * _alignment;
+        stats.freeByteSize = (usize)_freeUnitCount * _alignment;
+        stats.allocationCount = _allocationCount;
+
+        for (u32 bin = 0; bin < kBinCount; bin++)
+        {
+            for (u32 nodeIndex = _binHeads[bin]; nodeIndex != kInvalidNode; nodeIndex = _nodes[nodeIndex].binNext)
+            {
+                const usize byteSize = (usize)_nodes[nodeIndex].size * _alignment;
+                if (byteSize > stats.largestFreeByteSize)
+                    stats.largestFreeByteSize = byteSize;
+                stats.freeRegionCount += 1;
+            }
+        }
+
+        return stats;
+    }
+
+    u32 cOffsetAllocator::SizeToBinRoundUp(u32 size)
+    {
+        if (size < kLeafBinCount)
+            return size;
+
+        const u32 mantissaStartBit = 31 - CountLeadingZeros(size) - kMantissaBitCount;
+        const u32 exponent = mantissaStartBit + 1;
+        u32 mantissa = (size >> mantissaStartBit) & (kLeafBinCount - 1);
+        if ((size & ((1u << mantissaStartBit) - 1)) != 0)
+            mantissa += 1;
+
+        // A mantissa overflow carries into the exponent
+        return (exponent << kMantissaBitCount) + mantissa;
+    }
+
+    u32 cOffsetAllocator::SizeToBinRoundDown(u32 size)
+    {
+        if (size < kLeafBinCount)
+            return size;
+
+        const u32 mantissaStartBit = 31 - CountLeadingZeros(size) - kMantissaBitCount;
+        const u32 exponent = mantissaStartBit + 1;
+        const u32 mantissa = (size >> mantissaStartBit) & (kLeafBinCount - 1);
+
+        return (exponent << kMantissaBitCount) | mantissa;
+    }
+
+    u32 cOffsetAllocator::FindLowestBitAfter(u32 bits, u32 index)
+    {
+        if (index >= 32)
+            return kInvalidNode;
+
+        const u32 maskedBits = bits & ~((1u << index) - 1);
+        if (maskedBits == 0)
+            return kInvalidNode;
+
+        return CountTrailingZeros(maskedBits);
+    }
+
+    void cOffsetAllocator::LinkNode(u32 nodeIndex)
+    {
+        sNode& node = _nodes[nodeIndex];
+        const u32 bin = SizeToBinRoundDown(node.size);
+        const u32 topBin = bin >> kMantissaBitCount;
+        const u32 leafBin = bin & (kLeafBinCount - 1);
+
+        if (_binHeads[bin] == kInvalidNode)
+        {
+            _usedLeafBins[topBin] |= (u8)(1u << leafBin);
+            _usedBins |= 1u << topBin;
+        }
+
+        node.used = K_FALSE;
+        node.binPrev = kInvalidNode;
+        node.binNext = _binHeads[bin];
+        if (node.binNext != kInvalidNode)
+            _nodes[node.binNext].binPrev = nodeIndex;
+        _binHeads[bin] = nodeIndex;
+
+        _freeUnitCount += node.size;
+    }
+
+    void cOffsetAllocator::UnlinkNode(u32 nodeIndex)
+    {
+        sNode& node = _nodes[nodeIndex];
+
+        if (node.binPrev != kInvalidNode)
+        {
+            _nodes[node.binPrev].binNext = node.binNext;
+            if (node.binNext != kInvalidNode)
+                _nodes[node.binNext].binPrev = node.binPrev;
+        }
+        else
+        {
+            const u32 bin = SizeToBinRoundDown(node.size);
+            const u32 topBin = bin >> kMantissaBitCount;
+            const u32 leafBin = bin & (kLeafBinCount - 1);
+
+            _binHeads[bin] = node.binNext;
+            if (node.binNext != kInvalidNode)
+                _nodes[node.binNext].binPrev = kInvalidNode;
+
+            if (_binHeads[bin] == kInvalidNode)
+            {
+                _usedLeafBins[topBin] &= (u8)~(1u << leafBin);
+                if (_usedLeafBins[topBin] == 0)
+                    _usedBins &= ~(1u << topBin);
+            }
+        }
+
+        node.binPrev = kInvalidNode;
+        node.binNext = kInvalidNode;
+        _freeUnitCount -= node.size;
+    }
+
+    void cOffsetAllocator::TakeFreeNode(u32 nodeIndex, u32 size)
+    {
+        UnlinkNode(nodeIndex);
+
+        sNode& node = _nodes[nodeIndex];
+        const u32 remainder = node.size - size;
+        node.size = size;
+        node.used = K_TRUE;
+
+        if (remainder == 0)
+            return;
+
+        const u32 remainderIndex = _freeNodes[--_freeNodeCount];
+        sNode& remainderNode = _nodes[remainderIndex];
+        remainderNode = sNode{};
+        remainderNode.offset = node.offset + size;
+        remainderNode.size = remainder;
+        remainderNode.neighborPrev = nodeIndex;
+        remainderNode.neighborNext = node.neighborNext;
+        if (node.neighborNext != kInvalidNode)
+            _nodes[node.neighborNext].neighborPrev = remainderIndex;
+        node.neighborNext = remainderIndex;
+
+        LinkNode(remainderIndex);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+// offset_allocator.hpp
+
+#pragma once
+
+#include "object.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    struct sOffsetAllocation
+    {
+        static constexpr types::u32 kInvalidNode = 0xFFFFFFFF;
+
+        types::usize offset = 0;
+        types::u32 node = kInvalidNode;
+    };
+
+    struct sOffsetAllocatorStats
+    {
+        types::usize usedByteSize = 0;
+        types::usize freeByteSize = 0;
+        types::usize largestFreeByteSize = 0;
+        types::usize allocationCount = 0;
+        types::usize freeRegionCount = 0;
+    };
+
+    // Hands out ranges of a buffer that lives somewhere else, usually on the GPU. Free regions are kept in
+    // two level segregated lists (TLSF): the size picks one of 256 bins from its exponent and the top three
+    // mantissa bits, two bitmaps find the first non empty bin that fits in constant time. Neighbouring free
+    // regions merge on Free. Sizes and offsets are multiples of the alignment given at construction.
+    class cOffsetAllocator : public iObject
+    {
+        TRITON_OBJECT(cOffsetAllocator)
+
+    public:
+        explicit cOffsetAllocator(cContext* context, types::usize byteSize, types::usize alignment, types::usize maxAllocationCount);
+        virtual ~cOffsetAllocator() override final;
+
+        // Returns an allocation with kInvalidNode when no free region is large enough
+        sOffsetAllocation Allocate(types::usize byteSize);
+        void Free(const sOffsetAllocation& allocation);
+        // Moves the allocation into the lowest free region below it that fits, the old range stays allocated and the
+        // caller frees it once the contents are copied. Returns an allocation with kInvalidNode when there is none.
+        sOffsetAllocation AllocateBelow(const sOffsetAllocation& allocation);
+        void Reset();
+
+        types::usize GetAllocationByteSize(const sOffsetAllocation& allocation) const;
+        sOffsetAllocatorStats GetStats() const;
+
+        inline types::usize GetByteSize() const { return _byteSize; }
+        inline types::usize GetAlignment() const { return _alignment; }
+        inline types::usize GetFreeByteSize() const { return (types::usize)_freeUnitCount * _alignment; }
+
+    private:
+        static constexpr types::u32 kMantissaBitCount = 3;
+        static constexpr types::u32 kLeafBinCount = 1 << kMantissaBitCount;
+        static constexpr types::u32 kTopBinCount = 32;
+        static constexpr types::u32 kBinCount = kTopBinCount * kLeafBinCount;
+        static constexpr types::u32 kInvalidNode = sOffsetAllocation::kInvalidNode;
+
+        struct sNode
+        {
+            types::u32 offset = 0;
+            types::u32 size = 0;
+            types::u32 binPrev = kInvalidNode;
+            types::u32 binNext = kInvalidNode;
+            types::u32 neighborPrev = kInvalidNode;
+            types::u32 neighborNext = kInvalidNode;
+            types::boolean used = types::K_FALSE;
+        };
+
+        static types::u32 SizeToBinRoundUp(types::u32 size);
+        static types::u32 SizeToBinRoundDown(types::u32 size);
+        static types::u32 FindLowestBitAfter(types::u32 bits, types::u32 index);
+
+        void LinkNode(types::u32 nodeIndex);
+        void UnlinkNode(types::u32 nodeIndex);
+        // Marks the first size units of a free node used, the rest becomes a new free node after it
+        void TakeFreeNode(types::u32 nodeIndex, types::u32 size);
+
+    private:
+        types::usize _byteSize = 0;
+        types::usize _alignment = 0;
+        types::u32 _unitCount = 0;
+        types::u32 _maxNodeCount = 0;
+        types::u32 _freeUnitCount = 0;
+        types::u32 _allocationCount = 0;
+        types::u32 _usedBins = 0;
+        types::u8 _usedLeafBins[kTopBinCount] = {};
+        types::u32 _binHeads[kBinCount] = {};
+        sNode* _nodes = nullptr;
+        types::u32* _freeNodes = nullptr;
+        types::u32 _freeNodeCount = 0;
+    };
+}
\ No newline at end of file
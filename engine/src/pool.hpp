@@ -0,0 +1,422 @@
+// pool.hpp
+
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include "object.hpp"
+#include "context.hpp"
+#include "memory_pool.hpp"
+#include "stack.hpp"
+#include "handle.hpp"
+#include "math.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+	template <typename TValue>
+	class cPool;
+
+	class cPoolHandle : public cHandle
+	{
+		template <typename>
+		friend class cPool;
+
+	public:
+		inline index GetIndex() const { return idx; }
+		inline types::usize GetGeneration() const { return generation; }
+		inline types::boolean IsValid() const { return generation != 0; }
+	};
+
+	// Slots never move: erased slots go to the free list of their chunk and get a new generation,
+	// so stale handles resolve to nullptr. Insert always picks the lowest chunk that has a free slot,
+	// which keeps live objects packed and lets fully empty chunks give their memory back.
+	template <typename TValue>
+	class cPool : public iObject
+	{
+		TRITON_OBJECT(cPool)
+
+	public:
+		static_assert(sizeof(TValue) >= sizeof(types::u32), "TValue must be able to hold free list link");
+
+		explicit cPool(cContext* context, const sChunkAllocatorDescriptor& allocatorDesc);
+		virtual ~cPool() override final;
+
+		template <typename... Args>
+		cPoolHandle Insert(Args&&... args);
+		cPoolHandle Insert(TValue&& value);
+		TValue* At(const cPoolHandle& handle) const;
+		cPoolHandle Find(const TValue* object) const;
+		void Erase(const cPoolHandle& handle);
+		void Erase(const TValue* object);
+		void Clear();
+
+		template <typename TFunction>
+		void ForEach(TFunction&& function) const;
+
+		inline types::usize GetSize() const { return _elementCount; }
+		inline types::usize GetCapacity() const { return _allocatorDesc.maxChunkCount * _objectCountPerChunk; }
+		inline types::usize GetChunkCount() const { return _chunkCount; }
+
+	private:
+		static constexpr types::u32 kInvalidSlot = 0xFFFFFFFF;
+		static constexpr types::usize kMaxChunkMaskWordCount = 64;
+
+		struct sChunk
+		{
+			TValue* values = nullptr;
+			types::u32* generations = nullptr;
+			types::qword* occupancy = nullptr;
+			types::u32 freeHead = kInvalidSlot;
+			types::u32 liveCount = 0;
+		};
+
+		types::u32 AcquireSlot();
+		void ReleaseSlot(types::u32 chunkIndex, types::u32 localPosition);
+		types::boolean AllocateChunk(types::u32 chunkIndex);
+		void DeallocateChunk(types::u32 chunkIndex);
+		void SetChunkHasFreeSlots(types::u32 chunkIndex, types::boolean hasFreeSlots);
+		cPoolHandle MakeHandle(types::u32 chunkIndex, types::u32 localPosition) const;
+		template <typename... Args>
+		TValue* Construct(types::u32 chunkIndex, types::u32 localPosition, Args&&... args);
+		void Destruct(TValue* object);
+
+		inline types::u32& FreeLink(types::u32 chunkIndex, types::u32 localPosition) const { return *(types::u32*)&_chunks[chunkIndex].values[localPosition]; }
+
+	private:
+		sChunkAllocatorDescriptor _allocatorDesc = {};
+		types::usize _objectCountPerChunk = 0;
+		types::usize _occupancyWordCount = 0;
+		types::usize _chunkCount = 0;
+		types::usize _elementCount = 0;
+		sChunk* _chunks = nullptr;
+		types::qword _chunksWithFreeSlots[kMaxChunkMaskWordCount] = {};
+	};
+
+	template <typename TValue>
+	cPool<TValue>::cPool(cContext* context, const sChunkAllocatorDescriptor& allocatorDesc) : iObject(context)
+	{
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		_allocatorDesc = allocatorDesc;
+		if (_allocatorDesc.maxChunkCount > kMaxChunkMaskWordCount * 64)
+			_allocatorDesc.maxChunkCount = kMaxChunkMaskWordCount * 64;
+
+		_objectCountPerChunk = _allocatorDesc.chunkByteSize / sizeof(TValue);
+		if (_objectCountPerChunk == 0)
+		{
+			Print("Error: pool chunk byte size can't hold a single object, chunks hold one object!");
+			_objectCountPerChunk = 1;
+		}
+		if (_objectCountPerChunk > 64)
+			_objectCountPerChunk &= ~(types::usize)63;
+		_occupancyWordCount = (_objectCountPerChunk + 63) / 64;
+
+		_chunks = (sChunk*)memoryAllocator->Allocate(_allocatorDesc.maxChunkCount * sizeof(sChunk), caps->memoryAlignment);
+		for (types::usize i = 0; i < _allocatorDesc.maxChunkCount; i++)
+			new (&_chunks[i]) sChunk();
+
+		AllocateChunk(0);
+	}
+
+	template <typename TValue>
+	cPool<TValue>::~cPool()
+	{
+		Clear();
+
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		for (types::usize i = 0; i < _chunkCount; i++)
+		{
+			DeallocateChunk(i);
+			memoryAllocator->Deallocate(_chunks[i].generations);
+			memoryAllocator->Deallocate(_chunks[i].occupancy);
+		}
+		memoryAllocator->Deallocate(_chunks);
+	}
+
+	template <typename TValue>
+	template <typename... Args>
+	cPoolHandle cPool<TValue>::Insert(Args&&... args)
+	{
+		const types::u32 slot = AcquireSlot();
+		if (slot == kInvalidSlot)
+			return cPoolHandle();
+
+		const types::u32 chunkIndex = slot / _objectCountPerChunk;
+		const types::u32 localPosition = slot % _objectCountPerChunk;
+		Construct(chunkIndex, localPosition, std::forward<Args>(args)...);
+
+		return MakeHandle(chunkIndex, localPosition);
+	}
+
+	template <typename TValue>
+	cPoolHandle cPool<TValue>::Insert(TValue&& value)
+	{
+		const types::u32 slot = AcquireSlot();
+		if (slot == kInvalidSlot)
+			return cPoolHandle();
+
+		const types::u32 chunkIndex = slot / _objectCountPerChunk;
+		const types::u32 localPosition = slot % _objectCountPerChunk;
+		new (&_chunks[chunkIndex].values[localPosition]) TValue(std::move(value));
+
+		return MakeHandle(chunkIndex, localPosition);
+	}
+
+	template <typename TValue>
+	TValue* cPool<TValue>::At(const cPoolHandle& handle) const
+	{
+		if (handle.IsValid() == types::K_FALSE)
+			return nullptr;
+
+		const types::u32 chunkIndex = handle.idx / _objectCountPerChunk;
+		const types::u32 localPosition = handle.idx % _objectCountPerChunk;
+		if (chunkIndex >= _chunkCount)
+			return nullptr;
+
+		const sChunk& chunk = _chunks[chunkIndex];
+		if (chunk.values == nullptr || chunk.generations[localPosition] != handle.generation)
+			return nullptr;
+
+		return &chunk.values[localPosition];
+	}
+
+	template <typename TValue>
+	cPoolHandle cPool<TValue>::Find(const TValue* object) const
+	{
+		for (types::usize i = 0; i < _chunkCount; i++)
+		{
+			const sChunk& chunk = _chunks[i];
+			if (chunk.values == nullptr || object < chunk.values || object >= chunk.values + _objectCountPerChunk)
+				continue;
+
+			const types::u32 localPosition = (types::u32)(object - chunk.values);
+			if ((chunk.occupancy[localPosition / 64] & (1ull << (localPosition % 64))) == 0)
+				return cPoolHandle();
+
+			return MakeHandle(i, localPosition);
+		}
+
+		return cPoolHandle();
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::Erase(const cPoolHandle& handle)
+	{
+		TValue* object = At(handle);
+		if (object == nullptr)
+			return;
+
+		Destruct(object);
+		ReleaseSlot(handle.idx / _objectCountPerChunk, handle.idx % _objectCountPerChunk);
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::Erase(const TValue* object)
+	{
+		Erase(Find(object));
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::Clear()
+	{
+		for (types::usize i = 0; i < _chunkCount; i++)
+		{
+			const sChunk& chunk = _chunks[i];
+			if (chunk.values == nullptr)
+				continue;
+
+			for (types::usize word = 0; word < _occupancyWordCount; word++)
+			{
+				types::qword bits = chunk.occupancy[word];
+				while (bits != 0)
+				{
+					const types::u32 localPosition = (types::u32)(word * 64 + cMath::CountTrailingZeros(bits));
+					bits &= bits - 1;
+
+					Destruct(&chunk.values[localPosition]);
+					ReleaseSlot(i, localPosition);
+				}
+			}
+		}
+	}
+
+	template <typename TValue>
+	template <typename TFunction>
+	void cPool<TValue>::ForEach(TFunction&& function) const
+	{
+		for (types::usize i = 0; i < _chunkCount; i++)
+		{
+			const sChunk& chunk = _chunks[i];
+			if (chunk.liveCount == 0)
+				continue;
+
+			for (types::usize word = 0; word < _occupancyWordCount; word++)
+			{
+				types::qword bits = chunk.occupancy[word];
+				while (bits != 0)
+				{
+					const types::usize localPosition = word * 64 + cMath::CountTrailingZeros(bits);
+					bits &= bits - 1;
+
+					function(chunk.values[localPosition]);
+				}
+			}
+		}
+	}
+
+	template <typename TValue>
+	types::u32 cPool<TValue>::AcquireSlot()
+	{
+		types::u32 chunkIndex = kInvalidSlot;
+		for (types::usize word = 0; word < kMaxChunkMaskWordCount; word++)
+		{
+			if (_chunksWithFreeSlots[word] != 0)
+			{
+				chunkIndex = (types::u32)(word * 64 + cMath::CountTrailingZeros(_chunksWithFreeSlots[word]));
+				break;
+			}
+		}
+
+		if (chunkIndex == kInvalidSlot || chunkIndex >= _chunkCount)
+		{
+			if (_chunkCount >= _allocatorDesc.maxChunkCount)
+			{
+				Print("Error: can't allocate pool slot, chunk limit reached!");
+				return kInvalidSlot;
+			}
+
+			chunkIndex = (types::u32)_chunkCount;
+		}
+
+		sChunk& chunk = _chunks[chunkIndex];
+		if (chunk.values == nullptr && AllocateChunk(chunkIndex) == types::K_FALSE)
+			return kInvalidSlot;
+
+		const types::u32 localPosition = chunk.freeHead;
+		chunk.freeHead = FreeLink(chunkIndex, localPosition);
+		chunk.occupancy[localPosition / 64] |= 1ull << (localPosition % 64);
+		chunk.liveCount += 1;
+		_elementCount += 1;
+
+		if (chunk.freeHead == kInvalidSlot)
+			SetChunkHasFreeSlots(chunkIndex, types::K_FALSE);
+
+		return (types::u32)(chunkIndex * _objectCountPerChunk + localPosition);
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::ReleaseSlot(types::u32 chunkIndex, types::u32 localPosition)
+	{
+		sChunk& chunk = _chunks[chunkIndex];
+
+		chunk.occupancy[localPosition / 64] &= ~(1ull << (localPosition % 64));
+		chunk.generations[localPosition] += 1;
+		if (chunk.generations[localPosition] == 0)
+			chunk.generations[localPosition] = 1;
+
+		FreeLink(chunkIndex, localPosition) = chunk.freeHead;
+		chunk.freeHead = localPosition;
+		chunk.liveCount -= 1;
+		_elementCount -= 1;
+
+		SetChunkHasFreeSlots(chunkIndex, types::K_TRUE);
+
+		if (chunk.liveCount == 0 && chunkIndex != 0)
+			DeallocateChunk(chunkIndex);
+	}
+
+	template <typename TValue>
+	types::boolean cPool<TValue>::AllocateChunk(types::u32 chunkIndex)
+	{
+		if (chunkIndex >= _allocatorDesc.maxChunkCount)
+			return types::K_FALSE;
+
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		sChunk& chunk = _chunks[chunkIndex];
+
+		if (chunk.generations == nullptr)
+		{
+			chunk.generations = (types::u32*)memoryAllocator->Allocate(_objectCountPerChunk * sizeof(types::u32), caps->memoryAlignment);
+			chunk.occupancy = (types::qword*)memoryAllocator->Allocate(_occupancyWordCount * sizeof(types::qword), caps->memoryAlignment);
+			for (types::usize i = 0; i < _objectCountPerChunk; i++)
+				chunk.generations[i] = 1;
+		}
+
+		chunk.values = (TValue*)memoryAllocator->Allocate(_objectCountPerChunk * sizeof(TValue), caps->memoryAlignment);
+		for (types::usize i = 0; i < _occupancyWordCount; i++)
+			chunk.occupancy[i] = 0;
+
+		chunk.freeHead = kInvalidSlot;
+		for (types::usize i = _objectCountPerChunk; i > 0; i--)
+		{
+			FreeLink(chunkIndex, (types::u32)(i - 1)) = chunk.freeHead;
+			chunk.freeHead = (types::u32)(i - 1);
+		}
+		chunk.liveCount = 0;
+
+		if (chunkIndex >= _chunkCount)
+			_chunkCount = chunkIndex + 1;
+
+		SetChunkHasFreeSlots(chunkIndex, types::K_TRUE);
+
+		return types::K_TRUE;
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::DeallocateChunk(types::u32 chunkIndex)
+	{
+		sChunk& chunk = _chunks[chunkIndex];
+		if (chunk.values == nullptr)
+			return;
+
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		memoryAllocator->Deallocate(chunk.values);
+		chunk.values = nullptr;
+		chunk.freeHead = kInvalidSlot;
+
+		// Chunk without storage is reallocated on demand when it's the lowest candidate
+		SetChunkHasFreeSlots(chunkIndex, types::K_TRUE);
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::SetChunkHasFreeSlots(types::u32 chunkIndex, types::boolean hasFreeSlots)
+	{
+		const types::qword bit = 1ull << (chunkIndex % 64);
+		if (hasFreeSlots == types::K_TRUE)
+			_chunksWithFreeSlots[chunkIndex / 64] |= bit;
+		else
+			_chunksWithFreeSlots[chunkIndex / 64] &= ~bit;
+	}
+
+	template <typename TValue>
+	cPoolHandle cPool<TValue>::MakeHandle(types::u32 chunkIndex, types::u32 localPosition) const
+	{
+		cPoolHandle handle;
+		handle.idx = (cHandle::index)(chunkIndex * _objectCountPerChunk + localPosition);
+		handle.generation = _chunks[chunkIndex].generations[localPosition];
+
+		return handle;
+	}
+
+	template <typename TValue>
+	template <typename... Args>
+	TValue* cPool<TValue>::Construct(types::u32 chunkIndex, types::u32 localPosition, Args&&... args)
+	{
+		if constexpr (std::is_base_of_v<iObject, TValue>)
+			return _context->Create<TValue>((types::u8*)_chunks[chunkIndex].values, localPosition, std::forward<Args>(args)...);
+		else
+			return new (&_chunks[chunkIndex].values[localPosition]) TValue(std::forward<Args>(args)...);
+	}
+
+	template <typename TValue>
+	void cPool<TValue>::Destruct(TValue* object)
+	{
+		if constexpr (std::is_base_of_v<iObject, TValue>)
+			_context->Destroy<TValue>(object);
+		else
+			object->~TValue();
+	}
+}
\ No newline at end of file
@@ -1,9 +1,258 @@
 // render_context.cpp
 
 #include "render_context.hpp"
+#include "log.hpp"
+
+using namespace types;
 
 namespace triton
 {
+	const cShader::sUniform* cShader::FindUniform(cUniformID id) const
+	{
+		if (_uniforms.empty())
+			return nullptr;
+
+		const usize mask = _uniforms.size() - 1;
+		for (usize i = id.GetHash() & mask; ; i = (i + 1) & mask)
+		{
+			const sUniform& uniform = _uniforms[i];
+			if (uniform.hash == id.GetHash())
+				return &uniform;
+			if (uniform.hash == 0)
+				return nullptr;
+		}
+	}
+
+	void cShader::ReserveUniforms(usize count)
+	{
+		// Power of two with at most 50% load, so probing always hits an empty slot
+		usize size = 8;
+		while (size < count * 2)
+			size <<= 1;
+
+		_uniforms.assign(size, sUniform());
+		_uniformCount = 0;
+	}
+
+	void cShader::AddUniform(cUniformID id, eUniformType type, s32 location, s32 count, s32 binding)
+	{
+		if ((_uniformCount + 1) * 2 > _uniforms.size())
+		{
+			Print("Error: shader uniform table is full!");
+			return;
+		}
+
+		const usize mask = _uniforms.size() - 1;
+		usize i = id.GetHash() & mask;
+		while (_uniforms[i].hash != 0)
+		{
+			if (_uniforms[i].hash == id.GetHash())
+			{
+				Print("Error: shader uniform name hash collision!");
+				return;
+			}
+
+			i = (i + 1) & mask;
+		}
+
+		sUniform& uniform = _uniforms[i];
+		uniform.hash = id.GetHash();
+		uniform.type = type;
+		uniform.location = location;
+		uniform.count = count;
+		uniform.binding = binding;
+		_uniformCount += 1;
+	}
+
 	cRenderPassGPU::cRenderPassGPU(cContext* context, cVertexArray* vertexArray, cShader* shader, cRenderTarget* renderTarget)
 		: iObject(context), _vertexArray(vertexArray), _shader(shader), _renderTarget(renderTarget) {}
+
+	cVertexArray* cRenderPassGPU::GetVertexArray(eCategory format) const
+	{
+		const usize index = GetVertexFormatIndex(format);
+		if (index == kVertexFormatCount || _formatVertexArrays[index] == nullptr)
+			return _vertexArray;
+
+		return _formatVertexArrays[index];
+	}
+
+	cShader* cRenderPassGPU::GetShader(eCategory format) const
+	{
+		const usize index = GetVertexFormatIndex(format);
+		if (index == kVertexFormatCount || _formatShaders[index] == nullptr)
+			return _shader;
+
+		return _formatShaders[index];
+	}
+
+	cRenderStateCache::cRenderStateCache()
+	{
+		Invalidate();
+	}
+
+	boolean cRenderStateCache::Compare(boolean equal)
+	{
+		if (equal == K_TRUE)
+		{
+			_stats.skippedCount += 1;
+
+			return K_FALSE;
+		}
+
+		_stats.issuedCount += 1;
+
+		return K_TRUE;
+	}
+
+	boolean cRenderStateCache::SetShader(u32 instance)
+	{
+		const boolean equal = _shader == instance;
+		_shader = instance;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetVertexArray(u32 instance)
+	{
+		const boolean equal = _vertexArray == instance;
+		_vertexArray = instance;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetRenderTarget(u32 instance)
+	{
+		const boolean equal = _renderTarget == instance;
+		_renderTarget = instance;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetViewport(const cVector4& rect)
+	{
+		const boolean equal = _viewportKnown == K_TRUE &&
+			_viewport.GetX() == rect.GetX() && _viewport.GetY() == rect.GetY() &&
+			_viewport.GetZ() == rect.GetZ() && _viewport.GetW() == rect.GetW();
+		_viewportKnown = K_TRUE;
+		_viewport = rect;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetBuffer(cBuffer::eType type, s32 slot, u32 instance, usize offset, usize byteSize)
+	{
+		if (slot < 0 || (usize)slot >= kMaxBufferSlotCount || (type != cBuffer::eType::UNIFORM && type != cBuffer::eType::LARGE))
+			return Compare(K_FALSE);
+
+		sBufferBinding& binding = type == cBuffer::eType::UNIFORM ? _uniformBuffers[slot] : _largeBuffers[slot];
+		const boolean equal = binding.instance == instance && binding.offset == offset && binding.byteSize == byteSize;
+		binding.instance = instance;
+		binding.offset = offset;
+		binding.byteSize = byteSize;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetTexture(s32 slot, cTexture::eDimension dimension, u32 instance)
+	{
+		if (slot < 0 || (usize)slot >= kMaxTextureSlotCount || dimension == cTexture::eDimension::NONE)
+			return Compare(K_FALSE);
+
+		u32& binding = dimension == cTexture::eDimension::TEXTURE_2D ? _textures2D[slot] : _textures2DArray[slot];
+		const boolean equal = binding == instance;
+		binding = instance;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetDepthMode(const sDepthMode& depthMode)
+	{
+		const boolean equal = _depthTest == (u32)depthMode.useDepthTest && _depthWrite == (u32)depthMode.useDepthWrite;
+		_depthTest = (u32)depthMode.useDepthTest;
+		_depthWrite = (u32)depthMode.useDepthWrite;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetBackfaceCulling(boolean useBackfaceCulling)
+	{
+		const boolean equal = _backfaceCulling == (u32)useBackfaceCulling;
+		_backfaceCulling = (u32)useBackfaceCulling;
+
+		return Compare(equal);
+	}
+
+	boolean cRenderStateCache::SetBlendFactors(usize target, sBlendMode::eFactor srcFactor, sBlendMode::eFactor dstFactor)
+	{
+		if (target >= kMaxBlendTargetCount)
+			return Compare(K_FALSE);
+
+		const u32 factors = ((u32)srcFactor << 16) | (u32)dstFactor;
+		const boolean equal = _blendFactors[target] == factors;
+		_blendFactors[target] = factors;
+
+		return Compare(equal);
+	}
+
+	void cRenderStateCache::Invalidate()
+	{
+		_shader = kUnknown;
+		_vertexArray = kUnknown;
+		_renderTarget = kUnknown;
+		_viewportKnown = K_FALSE;
+		for (usize i = 0; i < kMaxBufferSlotCount; i++)
+		{
+			_uniformBuffers[i] = {};
+			_largeBuffers[i] = {};
+		}
+		for (usize i = 0; i < kMaxTextureSlotCount; i++)
+		{
+			_textures2D[i] = kUnknown;
+			_textures2DArray[i] = kUnknown;
+		}
+		_depthTest = kUnknown;
+		_depthWrite = kUnknown;
+		_backfaceCulling = kUnknown;
+		for (usize i = 0; i < kMaxBlendTargetCount; i++)
+			_blendFactors[i] = kUnknown;
+	}
+
+	void cRenderStateCache::InvalidateRenderTarget()
+	{
+		_renderTarget = kUnknown;
+	}
+
+	void cRenderStateCache::InvalidateTextureSlot(s32 slot)
+	{
+		if (slot < 0 || (usize)slot >= kMaxTextureSlotCount)
+			return;
+
+		_textures2D[slot] = kUnknown;
+		_textures2DArray[slot] = kUnknown;
+	}
+
+	void cRenderStateCache::ForgetObject(u32 instance)
+	{
+		// Names are only unique per object type, forgetting a few extra slots just costs a rebind
+		if (_shader == instance)
+			_shader = kUnknown;
+		if (_vertexArray == instance)
+			_vertexArray = kUnknown;
+		if (_renderTarget == instance)
+			_renderTarget = kUnknown;
+		for (usize i = 0; i < kMaxBufferSlotCount; i++)
+		{
+			if (_uniformBuffers[i].instance == instance)
+				_uniformBuffers[i] = {};
+			if (_largeBuffers[i].instance == instance)
+				_largeBuffers[i] = {};
+		}
+		for (usize i = 0; i < kMaxTextureSlotCount; i++)
+		{
+			if (_textures2D[i] == instance)
+				_textures2D[i] = kUnknown;
+			if (_textures2DArray[i] == instance)
+				_textures2DArray[i] = kUnknown;
+		}
+	}
 }
\ No newline at end of file
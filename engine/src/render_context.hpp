@@ -3,10 +3,14 @@
 #pragma once
 
 #include <vector>
+#include <unordered_map>
 #include <string>
+#include <atomic>
+#include <functional>
 #include "../../thirdparty/glm/glm/glm.hpp"
 #include "category.hpp"
 #include "object.hpp"
+#include "vertex_format.hpp"
 #include "math.hpp"
 #include "types.hpp"
 
@@ -33,6 +37,7 @@ namespace triton
         TRITON_OBJECT(cBuffer)
 
         friend class cOpenGLGraphicsAPI;
+        friend class cNullGraphicsAPI;
 
     public:
         enum class eType
@@ -41,7 +46,8 @@ namespace triton
             VERTEX = 1,
             INDEX = 2,
             UNIFORM = 3,
-            LARGE = 4
+            LARGE = 4,
+            INDIRECT = 5
         };
 
         explicit cBuffer(cContext* context) : cGPUResource(context) {}
@@ -49,11 +55,18 @@ namespace triton
         inline eType GetBufferType() const { return _type; }
         inline types::usize GetByteSize() const { return _byteSize; }
         inline types::s32 GetSlot() const { return _slot; }
+        inline void* GetMappedData() const { return _mappedData; }
+        inline types::usize GetBindOffset() const { return _bindOffset; }
+        inline types::usize GetBindByteSize() const { return _bindByteSize; }
 
     private:
         eType _type = eType::NONE;
         types::usize _byteSize = 0;
         types::s32 _slot = -1;
+        void* _mappedData = nullptr;
+        // Range used by BindBuffer for slot buffers, zero byte size binds the whole buffer
+        types::usize _bindOffset = 0;
+        types::usize _bindByteSize = 0;
     };
 
     class cVertexArray : public cGPUResource
@@ -61,16 +74,55 @@ namespace triton
         TRITON_OBJECT(cVertexArray)
 
         friend class cOpenGLGraphicsAPI;
+        friend class cNullGraphicsAPI;
 
     public:
         explicit cVertexArray(cContext* context) : cGPUResource(context) {}
     };
 
+    // Pre-hashed shader resource name, FNV-1a of the name as written in GLSL. Constructing one from a
+    // literal is constexpr, keep frequently used IDs in static constants so nothing is hashed per frame.
+    class cUniformID
+    {
+    public:
+        constexpr cUniformID(const char* name) : _hash(Hash(name, Length(name))) {}
+        constexpr cUniformID(const char* name, types::usize length) : _hash(Hash(name, length)) {}
+        explicit cUniformID(const std::string& name) : _hash(Hash(name.c_str(), name.size())) {}
+        ~cUniformID() = default;
+
+        inline constexpr bool operator==(const cUniformID& rhs) const { return _hash == rhs._hash; }
+        inline constexpr types::u32 GetHash() const { return _hash; }
+
+    private:
+        static constexpr types::usize Length(const char* name)
+        {
+            types::usize length = 0;
+            while (name[length] != 0)
+                length++;
+
+            return length;
+        }
+
+        static constexpr types::u32 Hash(const char* name, types::usize length)
+        {
+            types::u32 hash = 2166136261u;
+            for (types::usize i = 0; i < length; i++)
+                hash = (hash ^ (types::u8)name[i]) * 16777619u;
+
+            // 0 marks empty slots in the shader tables
+            return hash != 0 ? hash : 1;
+        }
+
+    private:
+        types::u32 _hash = 0;
+    };
+
     class cShader : public cGPUResource
     {
         TRITON_OBJECT(cShader)
 
         friend class cOpenGLGraphicsAPI;
+        friend class cNullGraphicsAPI;
 
     public:
         struct sDefinePair
@@ -82,11 +134,64 @@ namespace triton
             types::usize _index = 0;
         };
 
+        enum class eUniformType
+        {
+            VALUE = 0,
+            SAMPLER = 1,
+            UNIFORM_BLOCK = 2,
+            STORAGE_BLOCK = 3
+        };
+
+        struct sUniform
+        {
+            types::u32 hash = 0;
+            eUniformType type = eUniformType::VALUE;
+            types::s32 location = -1; // block index for blocks
+            types::s32 count = 0;
+            mutable types::s32 binding = -1; // texture unit last assigned to a sampler, binding point of a block
+        };
+
+        enum class eState : types::u32
+        {
+            PREPARING = 0, // source text is built on a worker
+            PREPARED = 1, // source text is done, nothing is sent to the driver yet
+            COMPILING = 2, // compile and link are issued, the result isn't read back yet
+            READY = 3
+        };
+
         explicit cShader(cContext* context) : cGPUResource(context) {}
 
+        // Filled by the backend when the program is linked, nullptr for names the program doesn't use
+        const sUniform* FindUniform(cUniformID id) const;
+
+        inline types::usize GetUniformCount() const { return _uniformCount; }
+        inline types::boolean IsReady() const { return _state.load(std::memory_order_acquire) == eState::READY ? types::K_TRUE : types::K_FALSE; }
+
+    private:
+        void ReserveUniforms(types::usize count);
+        void AddUniform(cUniformID id, eUniformType type, types::s32 location, types::s32 count, types::s32 binding);
+
     private:
         std::string _vertex = "";
         std::string _fragment = "";
+        std::string _vertexLabel = "";
+        std::string _fragmentLabel = "";
+        // Builds the text, hot reload runs it again when one of the source files changed
+        std::function<void(cShader*)> _prepare = {};
+        std::string _vertexPath = "";
+        std::string _fragmentPath = "";
+        std::vector<sUniform> _uniforms = {};
+        types::usize _uniformCount = 0;
+        std::atomic<eState> _state = { eState::READY };
+        // Drawn with instead of this shader until its program is linked
+        const cShader* _fallback = nullptr;
+        types::u32 _vertexStage = 0;
+        types::u32 _fragmentStage = 0;
+        // Identical programs are shared, a shader that turned out to be a duplicate forwards to the first one
+        // and holds a reference on it
+        types::u64 _programHash = 0;
+        types::usize _referenceCount = 1;
+        cShader* _shared = nullptr;
     };
 
     class cTexture : public cGPUResource
@@ -94,6 +199,7 @@ namespace triton
         TRITON_OBJECT(cTexture)
 
         friend class cOpenGLGraphicsAPI;
+        friend class cNullGraphicsAPI;
 
     public:
         enum class eDimension
@@ -139,6 +245,7 @@ namespace triton
         TRITON_OBJECT(cRenderTarget)
 
         friend class cOpenGLGraphicsAPI;
+        friend class cNullGraphicsAPI;
 
         inline std::vector<cTexture*>& GetColorAttachments() const { return _colorAttachments; }
         inline cTexture* GetDepthAttachment() const { return _depthAttachment; }
@@ -175,6 +282,16 @@ namespace triton
         eFactor dstFactors[8] = { eFactor::ZERO };
     };
 
+    // Same layout as GL DrawElementsIndirectCommand, firstIndex is in indices and baseInstance offsets the instance fetch
+    struct sDrawIndirectCommand
+    {
+        types::u32 indexCount = 0;
+        types::u32 instanceCount = 0;
+        types::u32 firstIndex = 0;
+        types::s32 baseVertex = 0;
+        types::u32 baseInstance = 0;
+    };
+
     struct sViewport
     {
         cVector4 rect = cVector4(0.0f);
@@ -196,7 +313,11 @@ namespace triton
         cShader* shaderBase = nullptr;
         sDepthMode depthMode = {};
         sBlendMode blendMode = {};
+        // Drops triangles wound clockwise on screen, front faces are counter-clockwise everywhere in the engine
+        types::boolean useBackfaceCulling = types::K_FALSE;
         sViewport viewport = {};
+        // Pass draws to the default framebuffer when nullptr
+        cRenderTarget* renderTarget = nullptr;
     };
 
     class cRenderPassGPU : public iObject
@@ -204,6 +325,7 @@ namespace triton
         TRITON_OBJECT(cRenderPassGPU)
 
         friend class cOpenGLGraphicsAPI;
+        friend class cNullGraphicsAPI;
 
     public:
         explicit cRenderPassGPU(cContext* context, cVertexArray* vertexArray, cShader* shader, cRenderTarget* renderTarget);
@@ -211,14 +333,98 @@ namespace triton
         
         inline cVertexArray* GetVertexArray() const { return _vertexArray; }
         inline cShader* GetShader() const { return _shader; }
+        cVertexArray* GetVertexArray(eCategory format) const;
+        cShader* GetShader(eCategory format) const;
         inline cRenderTarget* GetRenderTarget() const { return _renderTarget; }
+        inline void SetRenderTarget(cRenderTarget* renderTarget) { _renderTarget = renderTarget; }
 
     private:
         cVertexArray* _vertexArray = nullptr;
         cShader* _shader = nullptr;
+        // Mesh passes keep a variant for every vertex format other than the descriptor's, by kVertexFormats index
+        cVertexArray* _formatVertexArrays[kVertexFormatCount] = {};
+        cShader* _formatShaders[kVertexFormatCount] = {};
         cRenderTarget* _renderTarget = nullptr;
     };
 
+    // Shadow copy of the pipeline state a backend last set. Every Set* returns K_TRUE when the API call
+    // has to be issued and K_FALSE when the same state is already bound, both cases are counted. State
+    // starts unknown, so the first call for every slot is issued. Objects hold GL names, a deleted name
+    // can be reused right away, backends call ForgetObject before deleting anything.
+    class cRenderStateCache
+    {
+    public:
+        struct sStats
+        {
+            types::usize issuedCount = 0;
+            types::usize skippedCount = 0;
+        };
+
+        static constexpr types::usize kMaxBufferSlotCount = 16;
+        static constexpr types::usize kMaxTextureSlotCount = 32;
+        static constexpr types::usize kMaxBlendTargetCount = 8;
+
+        cRenderStateCache();
+        ~cRenderStateCache() = default;
+
+        types::boolean SetShader(types::u32 instance);
+        types::boolean SetVertexArray(types::u32 instance);
+        types::boolean SetRenderTarget(types::u32 instance);
+        types::boolean SetViewport(const cVector4& rect);
+        // Indexed UNIFORM and LARGE bindings, byteSize 0 binds the whole buffer
+        types::boolean SetBuffer(cBuffer::eType type, types::s32 slot, types::u32 instance, types::usize offset, types::usize byteSize);
+        types::boolean SetTexture(types::s32 slot, cTexture::eDimension dimension, types::u32 instance);
+        types::boolean SetDepthMode(const sDepthMode& depthMode);
+        types::boolean SetBackfaceCulling(types::boolean useBackfaceCulling);
+        types::boolean SetBlendFactors(types::usize target, sBlendMode::eFactor srcFactor, sBlendMode::eFactor dstFactor);
+
+        // Everything becomes unknown, call it after state was changed outside the backend
+        void Invalidate();
+        void InvalidateRenderTarget();
+        void InvalidateTextureSlot(types::s32 slot);
+        void ForgetObject(types::u32 instance);
+
+        inline const sStats& GetStats() const { return _stats; }
+        inline void ResetStats() { _stats = {}; }
+
+    private:
+        static constexpr types::u32 kUnknown = 0xFFFFFFFF;
+
+        struct sBufferBinding
+        {
+            types::u32 instance = kUnknown;
+            types::usize offset = 0;
+            types::usize byteSize = 0;
+        };
+
+        types::boolean Compare(types::boolean equal);
+
+    private:
+        sStats _stats = {};
+        types::u32 _shader = kUnknown;
+        types::u32 _vertexArray = kUnknown;
+        types::u32 _renderTarget = kUnknown;
+        types::boolean _viewportKnown = types::K_FALSE;
+        cVector4 _viewport = cVector4(0.0f);
+        sBufferBinding _uniformBuffers[kMaxBufferSlotCount] = {};
+        sBufferBinding _largeBuffers[kMaxBufferSlotCount] = {};
+        types::u32 _textures2D[kMaxTextureSlotCount] = {};
+        types::u32 _textures2DArray[kMaxTextureSlotCount] = {};
+        types::u32 _depthTest = kUnknown;
+        types::u32 _depthWrite = kUnknown;
+        types::u32 _backfaceCulling = kUnknown;
+        types::u32 _blendFactors[kMaxBlendTargetCount] = {};
+    };
+
+    struct sShaderCacheStats
+    {
+        types::usize compiledCount = 0;
+        types::usize binaryLoadedCount = 0;
+        types::usize sharedCount = 0;
+        types::usize pendingCount = 0;
+        types::f32 milliseconds = 0.0f;
+    };
+
     class iGraphicsAPI : public iObject
     {
         TRITON_OBJECT(iGraphicsAPI)
@@ -227,11 +433,24 @@ namespace triton
         explicit iGraphicsAPI(cContext* context) : iObject(context) {}
         virtual ~iGraphicsAPI() = default;
 
+        inline const cRenderStateCache& GetStateCache() const { return _stateCache; }
+        inline cRenderStateCache& GetStateCache() { return _stateCache; }
+        // Program creation counters and the time the calling thread spent on shaders since the backend was created
+        inline const sShaderCacheStats& GetShaderCacheStats() const { return _shaderCacheStats; }
+        // Decided once when the backend is created, without it CreatePersistentBuffer fails and callers write with WriteBuffer
+        inline types::boolean GetPersistentBufferSupport() const { return _persistentBufferSupport; }
+
         virtual cBuffer* CreateBuffer(types::usize byteSize, cBuffer::eType type, types::s32 slot, const void* data) = 0;
+        // Buffer stays mapped for writing until it's destroyed, see GetMappedData, synchronization is up to the caller
+        virtual cBuffer* CreatePersistentBuffer(types::usize byteSize, cBuffer::eType type, types::s32 slot) = 0;
+        // Binds a sub range of a slot buffer and keeps it as the range for later BindBuffer calls
+        virtual void BindBufferRange(cBuffer* buffer, types::usize offset, types::usize byteSize) = 0;
         virtual void BindBuffer(const cBuffer* buffer) = 0;
 		virtual void BindBufferNotVAO(const cBuffer* buffer) = 0;
         virtual void UnbindBuffer(const cBuffer* buffer) = 0;
         virtual void WriteBuffer(const cBuffer* buffer, types::usize offset, types::usize byteSize, const void* data) = 0;
+        // Ranges may be in the same buffer as long as they do not overlap
+        virtual void CopyBuffer(const cBuffer* srcBuffer, types::usize srcOffset, const cBuffer* dstBuffer, types::usize dstOffset, types::usize byteSize) = 0;
         virtual void DestroyBuffer(cBuffer* buffer) = 0;
         virtual cVertexArray* CreateVertexArray() = 0;
         virtual void BindVertexArray(const cVertexArray* vertexArray) = 0;
@@ -244,11 +463,17 @@ namespace triton
         virtual cShader* CreateShader(const cShader* baseShader, const std::string& vertexFunc, const std::string& fragmentFunc, const std::vector<cShader::sDefinePair>& definePairs = {}) = 0;
         virtual void DefineInShader(cShader* shader, const std::vector<cShader::sDefinePair>& definePairs) = 0;
         virtual void DestroyShader(cShader* shader) = 0;
-        virtual void SetShaderUniform(const cShader* shader, const std::string& name, const glm::mat4& matrix) = 0;
-        virtual void SetShaderUniform(const cShader* shader, const std::string& name, types::usize count, const types::f32* values) = 0;
+        // Moves queued shaders one step further without blocking, called once per frame. Shaders that aren't
+        // ready draw with their fallback, a shader without one is finished on its first use.
+        virtual void UpdateShaders() = 0;
+        // Rebuilds the shaders made from the given files and the material shaders derived from them, the old
+        // program stays in use when the new text doesn't link
+        virtual void ReloadShaders(const std::vector<std::string>& paths) = 0;
+        virtual void SetShaderUniform(const cShader* shader, cUniformID id, const glm::mat4& matrix) = 0;
+        virtual void SetShaderUniform(const cShader* shader, cUniformID id, types::usize count, const types::f32* values) = 0;
         virtual cTexture* CreateTexture(types::usize width, types::usize height, types::usize depth, cTexture::eDimension dimension, cTexture::eFormat format, const void* data) = 0;
         virtual cTexture* ResizeTexture(cTexture* texture, const glm::vec2& size) = 0;
-        virtual void BindTexture(const cShader* shader, const std::string& name, const cTexture* texture, types::s32 slot) = 0;
+        virtual void BindTexture(const cShader* shader, cUniformID id, const cTexture* texture, types::s32 slot) = 0;
         virtual void UnbindTexture(const cTexture* texture) = 0;
         virtual void WriteTexture(const cTexture* texture, const glm::vec3& offset, const glm::vec2& size, const void* data) = 0;
         virtual void WriteTextureToFile(const cTexture* texture, const std::string& filename) = 0;
@@ -262,11 +487,13 @@ namespace triton
         virtual void UnbindRenderTarget() = 0;
         virtual void DestroyRenderTarget(cRenderTarget* renderTarget) = 0;
         virtual cRenderPassGPU* CreateRenderPass(const sRenderPassDescriptor* desc) = 0;
-        virtual void BindRenderPass(const cRenderPass* renderPass, cShader* customShader = nullptr) = 0;
+        virtual void BindRenderPass(const cRenderPass* renderPass, cShader* customShader = nullptr, eCategory vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE) = 0;
         virtual void UnbindRenderPass(const cRenderPass* renderPass) = 0;
         virtual void DestroyRenderPass(cRenderPassGPU* renderPass) = 0;
         virtual void BindDefaultInputLayout() = 0;
+        virtual void BindInputLayout(eCategory format) = 0;
         virtual void BindDepthMode(const sDepthMode& blendMode) = 0;
+        virtual void BindBackfaceCulling(types::boolean useBackfaceCulling) = 0;
         virtual void BindBlendMode(const sBlendMode& blendMode) = 0;
         virtual void Viewport(const sViewport& viewport) = 0;
         virtual void ClearColor(const glm::vec4& color) = 0;
@@ -276,6 +503,16 @@ namespace triton
         virtual void Draw(types::usize indexCount, types::usize vertexOffset, types::usize indexOffset, types::usize instanceCount) = 0;
         virtual void DrawQuad() = 0;
         virtual void DrawQuads(types::usize count) = 0;
+        virtual void DrawIndirect(const cBuffer* commandBuffer, types::usize offset, types::usize drawCount) = 0;
+        // Fence is signaled once the GPU finished all commands issued before it
+        virtual types::u64 CreateFence() = 0;
+        virtual types::boolean WaitFence(types::u64 fence, types::u64 timeoutNanoseconds) = 0;
+        virtual void DestroyFence(types::u64 fence) = 0;
+
+    protected:
+        cRenderStateCache _stateCache;
+        sShaderCacheStats _shaderCacheStats;
+        types::boolean _persistentBufferSupport = types::K_TRUE;
     };
 
     class cOpenGLGraphicsAPI : public iGraphicsAPI
@@ -287,10 +524,173 @@ namespace triton
         virtual ~cOpenGLGraphicsAPI() override final;
 
         virtual cBuffer* CreateBuffer(types::usize byteSize, cBuffer::eType type, types::s32 slot, const void* data) override final;
+        virtual cBuffer* CreatePersistentBuffer(types::usize byteSize, cBuffer::eType type, types::s32 slot) override final;
+        virtual void BindBufferRange(cBuffer* buffer, types::usize offset, types::usize byteSize) override final;
+        virtual void BindBuffer(const cBuffer* buffer) override final;
+        virtual void BindBufferNotVAO(const cBuffer* buffer) override final;
+        virtual void UnbindBuffer(const cBuffer* buffer) override final;
+        virtual void WriteBuffer(const cBuffer* buffer, types::usize offset, types::usize byteSize, const void* data) override final;
+        virtual void CopyBuffer(const cBuffer* srcBuffer, types::usize srcOffset, const cBuffer* dstBuffer, types::usize dstOffset, types::usize byteSize) override final;
+        virtual void DestroyBuffer(cBuffer* buffer) override final;
+        virtual cVertexArray* CreateVertexArray() override final;
+        virtual void BindVertexArray(const cVertexArray* vertexArray) override final;
+        virtual void BindDefaultVertexArray(const std::vector<cBuffer*>& buffersToBind) override final;
+        virtual void UnbindVertexArray() override final;
+        virtual void DestroyVertexArray(cVertexArray* vertexArray) override final;
+        virtual void BindShader(const cShader* shader) override final;
+        virtual void UnbindShader() override final;
+        virtual cShader* CreateShader(eCategory renderPath, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<cShader::sDefinePair>& definePairs = {}) override final;
+        virtual cShader* CreateShader(const cShader* baseShader, const std::string& vertexFunc, const std::string& fragmentFunc, const std::vector<cShader::sDefinePair>& definePairs = {}) override final;
+        virtual void DefineInShader(cShader* shader, const std::vector<cShader::sDefinePair>& definePairs) override final;
+        virtual void DestroyShader(cShader* shader) override final;
+        virtual void UpdateShaders() override final;
+        virtual void ReloadShaders(const std::vector<std::string>& paths) override final;
+        virtual void SetShaderUniform(const cShader* shader, cUniformID id, const glm::mat4& matrix) override final;
+        virtual void SetShaderUniform(const cShader* shader, cUniformID id, types::usize count, const types::f32* values) override final;
+        virtual cTexture* CreateTexture(types::usize width, types::usize height, types::usize depth, cTexture::eDimension dimension, cTexture::eFormat format, const void* data) override final;
+        virtual cTexture* ResizeTexture(cTexture* texture, const glm::vec2& size) override final;
+        virtual void BindTexture(const cShader* shader, cUniformID id, const cTexture* texture, types::s32 slot) override final;
+        virtual void UnbindTexture(const cTexture* texture) override final;
+        virtual void WriteTexture(const cTexture* texture, const glm::vec3& offset, const glm::vec2& size, const void* data) override final;
+        virtual void WriteTextureToFile(const cTexture* texture, const std::string& filename) override final;
+        virtual void GenerateTextureMips(const cTexture* texture) override final;
+        virtual void DestroyTexture(cTexture* texture) override final;
+        virtual cRenderTarget* CreateRenderTarget(const std::vector<cTexture*>& colorAttachments, cTexture* depthAttachment) override final;
+        virtual void ResizeRenderTargetColors(cRenderTarget* renderTarget, const glm::vec2& size) override final;
+        virtual void ResizeRenderTargetDepth(cRenderTarget* renderTarget, const glm::vec2& size) override final;
+        virtual void UpdateRenderTargetBuffers(cRenderTarget* renderTarget) override final;
+        virtual void BindRenderTarget(const cRenderTarget* renderTarget) override final;
+        virtual void UnbindRenderTarget() override final;
+        virtual void DestroyRenderTarget(cRenderTarget* renderTarget) override final;
+        virtual cRenderPassGPU* CreateRenderPass(const sRenderPassDescriptor* desc) override final;
+        virtual void BindRenderPass(const cRenderPass* renderPass, cShader* customShader = nullptr, eCategory vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE) override final;
+        virtual void UnbindRenderPass(const cRenderPass* renderPass) override final;
+        virtual void DestroyRenderPass(cRenderPassGPU* renderPass) override final;
+        virtual void BindDefaultInputLayout() override final;
+        virtual void BindInputLayout(eCategory format) override final;
+        virtual void BindDepthMode(const sDepthMode& blendMode) override final;
+        virtual void BindBackfaceCulling(types::boolean useBackfaceCulling) override final;
+        virtual void BindBlendMode(const sBlendMode& blendMode) override final;
+        virtual void Viewport(const sViewport& viewport) override final;
+        virtual void ClearColor(const glm::vec4& color) override final;
+        virtual void ClearDepth(types::f32 depth) override final;
+        virtual void ClearFramebufferColor(types::usize bufferIndex, const glm::vec4& color) override final;
+        virtual void ClearFramebufferDepth(types::f32 depth) override final;
+        virtual void Draw(types::usize indexCount, types::usize vertexOffset, types::usize indexOffset, types::usize instanceCount) override final;
+        virtual void DrawQuad() override final;
+        virtual void DrawQuads(types::usize count) override final;
+        virtual void DrawIndirect(const cBuffer* commandBuffer, types::usize offset, types::usize drawCount) override final;
+        virtual types::u64 CreateFence() override final;
+        virtual types::boolean WaitFence(types::u64 fence, types::u64 timeoutNanoseconds) override final;
+        virtual void DestroyFence(types::u64 fence) override final;
+
+    private:
+        static void ReflectShader(cShader* shader);
+        cShader* QueueShader(cShader* shader, std::function<void(cShader*)>&& prepare);
+        void AdvanceShader(cShader* shader, types::boolean wait);
+        void IssueShader(cShader* shader);
+        void FinishShader(cShader* shader);
+        const cShader* ResolveShader(const cShader* shader, types::boolean advance);
+        types::u32 LoadProgramBinary(types::u64 hash);
+        void SaveProgramBinary(types::u32 program, types::u64 hash);
+
+    private:
+        cShader* CreateRenderPassShader(const sRenderPassDescriptor* desc, std::vector<cShader::sDefinePair> definePairs, eCategory format);
+        cVertexArray* CreateRenderPassVertexArray(const sRenderPassDescriptor* desc, eCategory format);
+
+    private:
+        std::string _driverName = "";
+        std::string _programCachePath = "";
+        types::boolean _parallelShaderCompile = types::K_FALSE;
+        types::boolean _shaderDrawParameters = types::K_FALSE;
+        const cShader* _boundShader = nullptr;
+        // CPU copies of the indirect buffers when multi draws are replayed one by one, by buffer instance
+        std::unordered_map<types::u64, std::vector<types::u8>> _drawCommandCopies = {};
+        std::unordered_map<types::u64, cShader*> _programs = {};
+        std::vector<cShader*> _pendingShaders = {};
+        // Live shaders in creation order, a material shader always comes after its base
+        std::vector<cShader*> _shaders = {};
+    };
+
+    // Headless backend: never touches a GPU, every call is appended to a compact binary command stream
+    // (sCommandHeader followed by the payload) and counted, so CPU side rendering can be profiled and
+    // compared deterministically on machines without a display.
+    class cNullGraphicsAPI : public iGraphicsAPI
+    {
+        TRITON_OBJECT(cNullGraphicsAPI)
+
+    public:
+        enum class eCommand : types::u16
+        {
+            NONE = 0,
+            CREATE_BUFFER,
+            BIND_BUFFER,
+            UNBIND_BUFFER,
+            WRITE_BUFFER,
+            COPY_BUFFER,
+            DESTROY_BUFFER,
+            CREATE_VERTEX_ARRAY,
+            BIND_VERTEX_ARRAY,
+            UNBIND_VERTEX_ARRAY,
+            DESTROY_VERTEX_ARRAY,
+            CREATE_SHADER,
+            BIND_SHADER,
+            UNBIND_SHADER,
+            DESTROY_SHADER,
+            SET_SHADER_UNIFORM,
+            CREATE_TEXTURE,
+            BIND_TEXTURE,
+            UNBIND_TEXTURE,
+            WRITE_TEXTURE,
+            GENERATE_TEXTURE_MIPS,
+            DESTROY_TEXTURE,
+            CREATE_RENDER_TARGET,
+            BIND_RENDER_TARGET,
+            UNBIND_RENDER_TARGET,
+            DESTROY_RENDER_TARGET,
+            BIND_INPUT_LAYOUT,
+            BIND_DEPTH_MODE,
+            BIND_BACKFACE_CULLING,
+            BIND_BLEND_MODE,
+            VIEWPORT,
+            CLEAR_COLOR,
+            CLEAR_DEPTH,
+            DRAW,
+            DRAW_QUADS,
+            DRAW_INDIRECT,
+            CREATE_FENCE,
+            WAIT_FENCE,
+            DESTROY_FENCE,
+            COUNT
+        };
+
+        struct sCommandHeader
+        {
+            eCommand command = eCommand::NONE;
+            types::u16 byteSize = 0;
+        };
+
+        struct sStats
+        {
+            types::usize callCounts[(types::usize)eCommand::COUNT] = {};
+            types::usize commandCount = 0;
+            types::usize uploadedByteCount = 0;
+            types::usize drawCount = 0;
+            types::usize indexCount = 0;
+            types::usize instanceCount = 0;
+        };
+
+        explicit cNullGraphicsAPI(cContext* context);
+        virtual ~cNullGraphicsAPI() override final = default;
+
+        virtual cBuffer* CreateBuffer(types::usize byteSize, cBuffer::eType type, types::s32 slot, const void* data) override final;
+        virtual cBuffer* CreatePersistentBuffer(types::usize byteSize, cBuffer::eType type, types::s32 slot) override final;
+        virtual void BindBufferRange(cBuffer* buffer, types::usize offset, types::usize byteSize) override final;
         virtual void BindBuffer(const cBuffer* buffer) override final;
         virtual void BindBufferNotVAO(const cBuffer* buffer) override final;
         virtual void UnbindBuffer(const cBuffer* buffer) override final;
         virtual void WriteBuffer(const cBuffer* buffer, types::usize offset, types::usize byteSize, const void* data) override final;
+        virtual void CopyBuffer(const cBuffer* srcBuffer, types::usize srcOffset, const cBuffer* dstBuffer, types::usize dstOffset, types::usize byteSize) override final;
         virtual void DestroyBuffer(cBuffer* buffer) override final;
         virtual cVertexArray* CreateVertexArray() override final;
         virtual void BindVertexArray(const cVertexArray* vertexArray) override final;
@@ -303,11 +703,13 @@ namespace triton
         virtual cShader* CreateShader(const cShader* baseShader, const std::string& vertexFunc, const std::string& fragmentFunc, const std::vector<cShader::sDefinePair>& definePairs = {}) override final;
         virtual void DefineInShader(cShader* shader, const std::vector<cShader::sDefinePair>& definePairs) override final;
         virtual void DestroyShader(cShader* shader) override final;
-        virtual void SetShaderUniform(const cShader* shader, const std::string& name, const glm::mat4& matrix) override final;
-        virtual void SetShaderUniform(const cShader* shader, const std::string& name, types::usize count, const types::f32* values) override final;
+        virtual void UpdateShaders() override final;
+        virtual void ReloadShaders(const std::vector<std::string>& paths) override final;
+        virtual void SetShaderUniform(const cShader* shader, cUniformID id, const glm::mat4& matrix) override final;
+        virtual void SetShaderUniform(const cShader* shader, cUniformID id, types::usize count, const types::f32* values) override final;
         virtual cTexture* CreateTexture(types::usize width, types::usize height, types::usize depth, cTexture::eDimension dimension, cTexture::eFormat format, const void* data) override final;
         virtual cTexture* ResizeTexture(cTexture* texture, const glm::vec2& size) override final;
-        virtual void BindTexture(const cShader* shader, const std::string& name, const cTexture* texture, types::s32 slot) override final;
+        virtual void BindTexture(const cShader* shader, cUniformID id, const cTexture* texture, types::s32 slot) override final;
         virtual void UnbindTexture(const cTexture* texture) override final;
         virtual void WriteTexture(const cTexture* texture, const glm::vec3& offset, const glm::vec2& size, const void* data) override final;
         virtual void WriteTextureToFile(const cTexture* texture, const std::string& filename) override final;
@@ -321,11 +723,13 @@ namespace triton
         virtual void UnbindRenderTarget() override final;
         virtual void DestroyRenderTarget(cRenderTarget* renderTarget) override final;
         virtual cRenderPassGPU* CreateRenderPass(const sRenderPassDescriptor* desc) override final;
-        virtual void BindRenderPass(const cRenderPass* renderPass, cShader* customShader = nullptr) override final;
+        virtual void BindRenderPass(const cRenderPass* renderPass, cShader* customShader = nullptr, eCategory vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_NONE) override final;
         virtual void UnbindRenderPass(const cRenderPass* renderPass) override final;
         virtual void DestroyRenderPass(cRenderPassGPU* renderPass) override final;
         virtual void BindDefaultInputLayout() override final;
+        virtual void BindInputLayout(eCategory format) override final;
         virtual void BindDepthMode(const sDepthMode& blendMode) override final;
+        virtual void BindBackfaceCulling(types::boolean useBackfaceCulling) override final;
         virtual void BindBlendMode(const sBlendMode& blendMode) override final;
         virtual void Viewport(const sViewport& viewport) override final;
         virtual void ClearColor(const glm::vec4& color) override final;
@@ -335,5 +739,31 @@ namespace triton
         virtual void Draw(types::usize indexCount, types::usize vertexOffset, types::usize indexOffset, types::usize instanceCount) override final;
         virtual void DrawQuad() override final;
         virtual void DrawQuads(types::usize count) override final;
+        virtual void DrawIndirect(const cBuffer* commandBuffer, types::usize offset, types::usize drawCount) override final;
+        virtual types::u64 CreateFence() override final;
+        virtual types::boolean WaitFence(types::u64 fence, types::u64 timeoutNanoseconds) override final;
+        virtual void DestroyFence(types::u64 fence) override final;
+
+        void ResetCommands();
+
+        inline const std::vector<types::u8>& GetCommands() const { return _commands; }
+        inline const sStats& GetStats() const { return _stats; }
+
+    private:
+        template <typename T>
+        void Record(eCommand command, const T& payload);
+        void Record(eCommand command);
+
+    private:
+        cShader* CreateRenderPassShader(const sRenderPassDescriptor* desc);
+        cVertexArray* CreateRenderPassVertexArray(const sRenderPassDescriptor* desc, eCategory format);
+
+    private:
+        types::u32 _instanceCounter = 0;
+        types::u64 _fenceCounter = 0;
+        std::vector<types::u8> _commands = {};
+        sStats _stats = {};
+        // Indirect buffers keep a CPU copy so DrawIndirect can account the draws it would issue
+        std::unordered_map<types::u32, std::vector<types::u8>> _indirectBuffers = {};
     };
 }
\ No newline at end of file
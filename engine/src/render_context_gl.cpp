@@ -1,8 +1,14 @@
 // render_context_gl.cpp
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <string>
+#include <thread>
+#include <fstream>
+#include <filesystem>
 #include <lodepng.h>
 #include <GL/glew.h>
 #include "buffer.hpp"
@@ -15,6 +21,9 @@
 #include "context.hpp"
 #include "engine.hpp"
 #include "graphics.hpp"
+#include "thread_manager.hpp"
+#include "vertex_format.hpp"
+#include "shader_preprocessor.hpp"
 #include "log.hpp"
 
 using namespace types;
@@ -34,6 +43,28 @@ namespace triton
         Print(message);
     }
 
+    // main_vertex reads the base instance from it when gl_BaseInstanceARB is missing
+    static constexpr cUniformID kBaseInstanceID = cUniformID("BaseInstance");
+
+    static GLenum GetBufferTarget(cBuffer::eType type)
+    {
+        switch (type)
+        {
+        case cBuffer::eType::VERTEX:
+            return GL_ARRAY_BUFFER;
+        case cBuffer::eType::INDEX:
+            return GL_ELEMENT_ARRAY_BUFFER;
+        case cBuffer::eType::UNIFORM:
+            return GL_UNIFORM_BUFFER;
+        case cBuffer::eType::LARGE:
+            return GL_SHADER_STORAGE_BUFFER;
+        case cBuffer::eType::INDIRECT:
+            return GL_DRAW_INDIRECT_BUFFER;
+        default:
+            return GL_NONE;
+        }
+    }
+
     std::string CleanShaderSource(const std::string& src)
     {
         std::string out;
@@ -47,6 +78,120 @@ namespace triton
         return out;
     }
 
+    static boolean IsSamplerType(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_INT_SAMPLER_2D:
+        case GL_INT_SAMPLER_2D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            return K_TRUE;
+        default:
+            return K_FALSE;
+        }
+    }
+
+    static constexpr u32 kProgramBinaryMagic = 0x42505254; // "TRPB"
+    static constexpr u32 kProgramBinaryVersion = 1;
+
+    // Header of a program binary in the shader cache directory, the driver blob follows it
+    struct sProgramBinaryHeader
+    {
+        u32 magic = kProgramBinaryMagic;
+        u32 version = kProgramBinaryVersion;
+        u64 hash = 0;
+        u32 format = 0;
+        u32 byteSize = 0;
+    };
+
+    // FNV-1a, the result names files of the shader cache so it has to stay the same between runs
+    static u64 HashShaderBytes(u64 hash, const void* data, usize byteSize)
+    {
+        const u8* bytes = (const u8*)data;
+        for (usize i = 0; i < byteSize; i++)
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+
+        return hash;
+    }
+
+    static u64 HashShaderString(u64 hash, const std::string& text)
+    {
+        const u64 byteSize = text.size();
+        hash = HashShaderBytes(hash, &byteSize, sizeof(byteSize));
+
+        return HashShaderBytes(hash, text.data(), text.size());
+    }
+
+    // Enumerates active uniforms, uniform blocks and storage blocks of a linked program into its lookup table
+    void cOpenGLGraphicsAPI::ReflectShader(cShader* shader)
+    {
+        const GLuint program = (GLuint)shader->_instance;
+
+        GLint uniformCount = 0;
+        GLint uniformBlockCount = 0;
+        GLint storageBlockCount = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &uniformBlockCount);
+        glGetProgramInterfaceiv(program, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &storageBlockCount);
+
+        shader->ReserveUniforms(uniformCount + uniformBlockCount + storageBlockCount);
+
+        GLchar name[256] = {};
+        for (GLint i = 0; i < uniformCount; i++)
+        {
+            GLsizei length = 0;
+            GLint count = 0;
+            GLenum type = GL_NONE;
+            glGetActiveUniform(program, (GLuint)i, sizeof(name), &length, &count, &type, name);
+
+            // Block members have no location, they are reached through their block
+            const GLint location = glGetUniformLocation(program, name);
+            if (location < 0)
+                continue;
+
+            // Arrays are reported as "Name[0]", lookups use the plain name
+            if (length > 3 && strcmp(&name[length - 3], "[0]") == 0)
+                length -= 3;
+
+            if (IsSamplerType(type) == K_TRUE)
+            {
+                GLint unit = 0;
+                glGetUniformiv(program, location, &unit);
+                shader->AddUniform(cUniformID(name, length), cShader::eUniformType::SAMPLER, location, count, unit);
+            }
+            else
+            {
+                shader->AddUniform(cUniformID(name, length), cShader::eUniformType::VALUE, location, count, -1);
+            }
+        }
+
+        for (GLint i = 0; i < uniformBlockCount; i++)
+        {
+            GLsizei length = 0;
+            GLint binding = -1;
+            glGetActiveUniformBlockName(program, (GLuint)i, sizeof(name), &length, name);
+            glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_BINDING, &binding);
+            shader->AddUniform(cUniformID(name, length), cShader::eUniformType::UNIFORM_BLOCK, i, 1, binding);
+        }
+
+        const GLenum bindingProperty = GL_BUFFER_BINDING;
+        for (GLint i = 0; i < storageBlockCount; i++)
+        {
+            GLsizei length = 0;
+            GLint binding = -1;
+            glGetProgramResourceName(program, GL_SHADER_STORAGE_BLOCK, (GLuint)i, sizeof(name), &length, name);
+            glGetProgramResourceiv(program, GL_SHADER_STORAGE_BLOCK, (GLuint)i, 1, &bindingProperty, 1, nullptr, &binding);
+            shader->AddUniform(cUniformID(name, length), cShader::eUniformType::STORAGE_BLOCK, i, 1, binding);
+        }
+    }
+
     cOpenGLGraphicsAPI::cOpenGLGraphicsAPI(cContext* context) : iGraphicsAPI(context)
     {
         if (glewInit() != GLEW_OK)
@@ -56,14 +201,45 @@ namespace triton
         }
 
         glEnable(GL_DEPTH_TEST);
-        //glEnable(GL_CULL_FACE);
         glEnable(GL_BLEND);
         glDepthFunc(GL_LESS);
-        //glCullFace(GL_BACK);
-        glFrontFace(GL_CW);
+        // Culling itself is per pass, see sRenderPassDescriptor::useBackfaceCulling. Counter-clockwise is what
+        // assimp imports, the built-in primitives use and the meshlet cones of cMeshOptimizer assume.
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
         glEnable(GL_DEBUG_OUTPUT);
         glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
         glDebugMessageCallback(GLDebugCallback, nullptr);
+
+        // Upload rings fall back to glBufferSubData from a staging copy without it
+        _persistentBufferSupport = GLEW_ARB_buffer_storage ? K_TRUE : K_FALSE;
+        // Without gl_BaseInstanceARB every multi draw command would read instance 0, DrawIndirect replays them instead
+        _shaderDrawParameters = GLEW_ARB_shader_draw_parameters ? K_TRUE : K_FALSE;
+        if (_shaderDrawParameters == K_FALSE)
+            Print("Warning: no ARB_shader_draw_parameters, indirect draws are issued one by one!");
+
+        // Binaries are only valid for the driver that produced them, its name goes into every program key
+        const char* vendor = (const char*)glGetString(GL_VENDOR);
+        const char* renderer = (const char*)glGetString(GL_RENDERER);
+        const char* version = (const char*)glGetString(GL_VERSION);
+        _driverName = std::string(vendor != nullptr ? vendor : "") + "|" + (renderer != nullptr ? renderer : "") + "|" + (version != nullptr ? version : "");
+
+        // Compiles and links return right away, GL_COMPLETION_STATUS_KHR tells when the driver threads are done
+        if (GLEW_KHR_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            _parallelShaderCompile = K_TRUE;
+        }
+        else if (GLEW_ARB_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            _parallelShaderCompile = K_TRUE;
+        }
+
+        GLint binaryFormatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+        if (binaryFormatCount > 0)
+            _programCachePath = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities()->shaderCachePath;
     }
 
     cOpenGLGraphicsAPI::~cOpenGLGraphicsAPI()
@@ -103,28 +279,72 @@ namespace triton
             glBufferData(GL_SHADER_STORAGE_BUFFER, byteSize, data, GL_STATIC_DRAW);
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
         }
+        else if (buffer->GetBufferType() == cBuffer::eType::INDIRECT)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, (GLuint)buffer->_instance);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, byteSize, data, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
 
         return buffer;
     }
 
+    cBuffer* cOpenGLGraphicsAPI::CreatePersistentBuffer(usize byteSize, cBuffer::eType type, s32 slot)
+    {
+        if (_persistentBufferSupport == K_FALSE)
+        {
+            Print("Error: persistent buffers require ARB_buffer_storage!");
+            return nullptr;
+        }
+
+        cBuffer* buffer = _context->Create<cBuffer>(_context);
+        buffer->_byteSize = byteSize;
+        buffer->_type = type;
+        buffer->_slot = slot;
+
+        const GLenum target = GetBufferTarget(type);
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+        glGenBuffers(1, (GLuint*)&buffer->_instance);
+        glBindBuffer(target, (GLuint)buffer->_instance);
+        glBufferStorage(target, byteSize, nullptr, flags);
+        buffer->_mappedData = glMapBufferRange(target, 0, byteSize, flags);
+        glBindBuffer(target, 0);
+
+        return buffer;
+    }
+
+    void cOpenGLGraphicsAPI::BindBufferRange(cBuffer* buffer, usize offset, usize byteSize)
+    {
+        buffer->_bindOffset = offset;
+        buffer->_bindByteSize = byteSize;
+
+        BindBuffer(buffer);
+    }
+
     void cOpenGLGraphicsAPI::BindBuffer(const cBuffer* buffer)
     {
         if (buffer->_type == cBuffer::eType::VERTEX)
             glBindBuffer(GL_ARRAY_BUFFER, (GLuint)buffer->_instance);
         else if (buffer->_type == cBuffer::eType::INDEX)
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, (GLuint)buffer->_instance);
-        else if (buffer->_type == cBuffer::eType::UNIFORM)
-            glBindBufferBase(GL_UNIFORM_BUFFER, buffer->_slot, (GLuint)buffer->_instance);
-        else if (buffer->_type == cBuffer::eType::LARGE)
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, buffer->_slot, buffer->_instance);
+        else if (buffer->_type == cBuffer::eType::UNIFORM || buffer->_type == cBuffer::eType::LARGE)
+            BindBufferNotVAO(buffer);
+        else if (buffer->_type == cBuffer::eType::INDIRECT)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, (GLuint)buffer->_instance);
     }
 		
 	void cOpenGLGraphicsAPI::BindBufferNotVAO(const cBuffer* buffer)
     {
-        if (buffer->_type == cBuffer::eType::UNIFORM)
-            glBindBufferBase(GL_UNIFORM_BUFFER, buffer->_slot, (GLuint)buffer->_instance);
-        else if (buffer->_type == cBuffer::eType::LARGE)
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, buffer->_slot, buffer->_instance);
+        if (buffer->_type != cBuffer::eType::UNIFORM && buffer->_type != cBuffer::eType::LARGE)
+            return;
+        if (_stateCache.SetBuffer(buffer->_type, buffer->_slot, buffer->_instance, buffer->_bindOffset, buffer->_bindByteSize) == K_FALSE)
+            return;
+
+        if (buffer->_bindByteSize != 0)
+            glBindBufferRange(GetBufferTarget(buffer->_type), buffer->_slot, (GLuint)buffer->_instance, buffer->_bindOffset, buffer->_bindByteSize);
+        else
+            glBindBufferBase(GetBufferTarget(buffer->_type), buffer->_slot, (GLuint)buffer->_instance);
     }
 
     void cOpenGLGraphicsAPI::UnbindBuffer(const cBuffer* buffer)
@@ -133,10 +353,13 @@ namespace triton
             glBindBuffer(GL_ARRAY_BUFFER, 0);
         else if (buffer->_type == cBuffer::eType::INDEX)
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        else if (buffer->_type == cBuffer::eType::UNIFORM)
-            glBindBufferBase(GL_UNIFORM_BUFFER, buffer->_slot, 0);
-        else if (buffer->_type == cBuffer::eType::LARGE)
-            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, buffer->_slot, 0);
+        else if (buffer->_type == cBuffer::eType::UNIFORM || buffer->_type == cBuffer::eType::LARGE)
+        {
+            if (_stateCache.SetBuffer(buffer->_type, buffer->_slot, 0, 0, 0) == K_TRUE)
+                glBindBufferBase(GetBufferTarget(buffer->_type), buffer->_slot, 0);
+        }
+        else if (buffer->_type == cBuffer::eType::INDIRECT)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
     }
 
     void cOpenGLGraphicsAPI::WriteBuffer(const cBuffer* buffer, usize offset, usize byteSize, const void* data)
@@ -165,6 +388,30 @@ namespace triton
             glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, byteSize, data);
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
         }
+        else if (buffer->_type == cBuffer::eType::INDIRECT)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer->_instance);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset, byteSize, data);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+            // DrawIndirect replays the commands from this copy, reading the buffer back would stall
+            if (_shaderDrawParameters == K_FALSE)
+            {
+                std::vector<u8>& commands = _drawCommandCopies[buffer->_instance];
+                if (commands.size() < buffer->_byteSize)
+                    commands.resize(buffer->_byteSize);
+                memcpy(&commands[offset], data, byteSize);
+            }
+        }
+    }
+
+    void cOpenGLGraphicsAPI::CopyBuffer(const cBuffer* srcBuffer, usize srcOffset, const cBuffer* dstBuffer, usize dstOffset, usize byteSize)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, srcBuffer->_instance);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, dstBuffer->_instance);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, srcOffset, dstOffset, byteSize);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
     }
 
     void cOpenGLGraphicsAPI::DestroyBuffer(cBuffer* buffer)
@@ -177,7 +424,20 @@ namespace triton
             glBindBuffer(GL_UNIFORM_BUFFER, 0);
         else if (buffer->_type == cBuffer::eType::LARGE)
             glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        else if (buffer->_type == cBuffer::eType::INDIRECT)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 
+        if (buffer->_mappedData != nullptr)
+        {
+            const GLenum target = GetBufferTarget(buffer->_type);
+            glBindBuffer(target, (GLuint)buffer->_instance);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+            buffer->_mappedData = nullptr;
+        }
+
+        _stateCache.ForgetObject(buffer->_instance);
+        _drawCommandCopies.erase(buffer->_instance);
         glDeleteBuffers(1, (GLuint*)&buffer->_instance);
 
         if (buffer != nullptr)
@@ -195,7 +455,8 @@ namespace triton
 
     void cOpenGLGraphicsAPI::BindVertexArray(const cVertexArray* vertexArray)
     {
-        glBindVertexArray((GLuint)vertexArray->_instance);
+        if (_stateCache.SetVertexArray(vertexArray->_instance) == K_TRUE)
+            glBindVertexArray((GLuint)vertexArray->_instance);
     }
 
     void cOpenGLGraphicsAPI::BindDefaultVertexArray(const std::vector<cBuffer*>& buffersToBind)
@@ -218,11 +479,13 @@ namespace triton
 
     void cOpenGLGraphicsAPI::UnbindVertexArray()
     {
-        glBindVertexArray(0);
+        if (_stateCache.SetVertexArray(0) == K_TRUE)
+            glBindVertexArray(0);
     }
 
     void cOpenGLGraphicsAPI::DestroyVertexArray(cVertexArray* vertexArray)
     {
+        _stateCache.ForgetObject(vertexArray->_instance);
         glDeleteVertexArrays(1, (GLuint*)&vertexArray->_instance);
 
         if (vertexArray != nullptr)
@@ -231,19 +494,43 @@ namespace triton
 
     void cOpenGLGraphicsAPI::BindShader(const cShader* shader)
     {
+        shader = ResolveShader(shader, K_TRUE);
+
         const GLuint shaderID = (GLuint)shader->_instance;
-        glUseProgram(shaderID);
+        _boundShader = shader;
+        if (_stateCache.SetShader(shaderID) == K_TRUE)
+            glUseProgram(shaderID);
     }
 
     void cOpenGLGraphicsAPI::UnbindShader()
     {
-        glUseProgram(0);
+        _boundShader = nullptr;
+        if (_stateCache.SetShader(0) == K_TRUE)
+            glUseProgram(0);
     }
 
-    cShader* cOpenGLGraphicsAPI::CreateShader(eCategory renderPath, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<cShader::sDefinePair>& definePairs)
+    static std::string MakeDefineString(const std::vector<cShader::sDefinePair>& definePairs)
     {
-        cShader* shader = _context->Create<cShader>(_context);
+        std::string defineStr = "";
+        for (const auto& define : definePairs)
+            defineStr += "#define " + define._name + " " + std::to_string(define._index) + "\n";
 
+        return defineStr;
+    }
+
+    // Swaps the empty stub of a material function for its body and drops the call of the passthrough version
+    static void InsertShaderFunction(std::string& source, const std::string& stub, const std::string& function, const std::string& passthroughCall)
+    {
+        const usize stubPos = source.find(stub);
+        if (stubPos != std::string::npos)
+            source.replace(stubPos, stub.length(), function);
+        const usize passthroughCallPos = source.find(passthroughCall);
+        if (passthroughCallPos != std::string::npos)
+            source.replace(passthroughCallPos, passthroughCall.length(), "");
+    }
+
+    cShader* cOpenGLGraphicsAPI::CreateShader(eCategory renderPath, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<cShader::sDefinePair>& definePairs)
+    {
         std::string header = "";
         switch (renderPath)
         {
@@ -272,181 +559,518 @@ namespace triton
                 break;
         }
 
-        const std::string appendStr = "#version 430\n\n#define " + header + "\n\n";
+        cShader* shader = _context->Create<cShader>(_context);
+        shader->_vertexLabel = "vertex shader, header: " + header + ", path: " + vertexPath;
+        shader->_fragmentLabel = "fragment shader, header: " + header + ", path: " + fragmentPath;
+        shader->_vertexPath = cShaderPreprocessor::NormalizePath(vertexPath);
+        shader->_fragmentPath = cShaderPreprocessor::NormalizePath(fragmentPath);
 
-        cFileSystem* fileSystem = _context->GetSubsystem<cFileSystem>();
-        cDataFile* vertexShaderFile = fileSystem->CreateDataFile(vertexPath, K_TRUE);
-        shader->_vertex = CleanShaderSource(std::string((const char*)vertexShaderFile->GetBuffer()->GetData()));
-        cDataFile* fragmentShaderFile = fileSystem->CreateDataFile(fragmentPath, K_TRUE);
-        shader->_fragment = CleanShaderSource(std::string((const char*)fragmentShaderFile->GetBuffer()->GetData()));
-            
-        DefineInShader(shader, definePairs);
+        // Defines go in by name, so a variant asked for with its keywords in another order is the same program
+        std::vector<cShader::sDefinePair> sortedDefinePairs = definePairs;
+        std::stable_sort(sortedDefinePairs.begin(), sortedDefinePairs.end(), [](const cShader::sDefinePair& a, const cShader::sDefinePair& b) {
+            return a._name < b._name;
+        });
 
-        shader->_vertex = appendStr + shader->_vertex;
-        shader->_fragment = appendStr + shader->_fragment;
+        const std::string prefix = "#version 430\n\n#define " + header + "\n\n" + MakeDefineString(sortedDefinePairs);
 
-        const char* vertex = shader->_vertex.c_str();
-        const char* fragment = shader->_fragment.c_str();
+        cShaderPreprocessor* preprocessor = _context->GetSubsystem<cShaderPreprocessor>();
 
-        const GLint vertexByteSize = strlen(vertex);
-        const GLint fragmentByteSize = strlen(fragment);
-        shader->_instance = glCreateProgram();
-        const GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        const GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(vertexShader, 1, &vertex, &vertexByteSize);
-        glShaderSource(fragmentShader, 1, &fragment, &fragmentByteSize);
-        glCompileShader(vertexShader);
-        glCompileShader(fragmentShader);
-        glAttachShader(shader->_instance, vertexShader);
-        glAttachShader(shader->_instance, fragmentShader);
-        glLinkProgram(shader->_instance);
-			
-        GLint success;
-        glGetProgramiv((GLuint)shader->_instance, GL_LINK_STATUS, &success);
-        if (!success)
-            Print("Error: can't link shader!");
-        if (!glIsProgram((GLuint)shader->_instance))
-            Print("Error: invalid shader!");
+        return QueueShader(shader, [preprocessor, header, prefix, definePairs](cShader* shader) {
+            shader->_vertex = prefix + CleanShaderSource(preprocessor->Expand(shader->_vertexPath));
+            shader->_fragment = prefix + CleanShaderSource(preprocessor->Expand(shader->_fragmentPath));
+
+            // A variant picks at most one keyword of every group the files declare
+            for (const std::string& path : { shader->_vertexPath, shader->_fragmentPath })
+            {
+                for (const auto& group : preprocessor->GetKeywordGroups(path))
+                {
+                    usize definedCount = (usize)std::count(group.begin(), group.end(), header);
+                    for (const auto& define : definePairs)
+                        definedCount += (usize)std::count(group.begin(), group.end(), define._name);
+
+                    if (definedCount > 1)
+                        Print("Error: shader '" + path + "' has more than one keyword of a group defined!");
+                }
+            }
+        });
+    }
+
+    cShader* cOpenGLGraphicsAPI::CreateShader(const cShader* baseShader, const std::string& vertexFunc, const std::string& fragmentFunc, const std::vector<cShader::sDefinePair>& definePairs)
+    {
+        // The base text has to be complete before it is read, it's ready right after the base is queued
+        cShader* base = const_cast<cShader*>(baseShader);
+        while (base->_state.load(std::memory_order_acquire) == cShader::eState::PREPARING)
+            std::this_thread::yield();
+
+        cShader* shader = _context->Create<cShader>(_context);
+        shader->_vertexLabel = "vertex shader";
+        shader->_fragmentLabel = "fragment shader";
+        // Material shaders only swap the functions of their pass shader, drawing with it until they link is safe.
+        // The fallback is kept alive until the material shader goes.
+        shader->_fallback = baseShader;
+        base->_referenceCount += 1;
+
+        const std::string defines = MakeDefineString(definePairs);
+
+        // The base is read when the text is built, a reload of the base carries over to its material shaders
+        return QueueShader(shader, [defines, vertexFunc, fragmentFunc, baseShader](cShader* shader) {
+            const std::string vertexFuncDefinition = "void Vertex_Func(in vec3 _positionLocal, in vec2 _texcoord, in vec3 _normal, in int _instanceID, in Instance _instance, in Material material, in float _use2D, out vec4 _glPosition){}";
+            const std::string vertexFuncPassthroughCall = "Vertex_Passthrough(InPositionLocal, instance, instance.Use2D, gl_Position);";
+            const std::string fragmentFuncDefinition = "void Fragment_Func(in vec2 _texcoord, in vec4 _textureColor, in vec4 _materialDiffuseColor, out vec4 _fragColor){}";
+            const std::string fragmentFuncPassthroughCall = "Fragment_Passthrough(textureColor, DiffuseColor, fragColor);";
+
+            shader->_vertex = baseShader->_vertex;
+            shader->_fragment = baseShader->_fragment;
+
+            InsertShaderFunction(shader->_vertex, vertexFuncDefinition, vertexFunc, vertexFuncPassthroughCall);
+            InsertShaderFunction(shader->_fragment, fragmentFuncDefinition, fragmentFunc, fragmentFuncPassthroughCall);
+
+            shader->_vertex = defines + CleanShaderSource(shader->_vertex);
+            shader->_fragment = defines + CleanShaderSource(shader->_fragment);
+
+            const usize vertexVersionPos = shader->_vertex.find("#version 430");
+            if (vertexVersionPos != std::string::npos)
+                shader->_vertex.replace(vertexVersionPos, std::string("#version 430").length(), "");
+            const usize fragmentVersionPos = shader->_fragment.find("#version 430");
+            if (fragmentVersionPos != std::string::npos)
+                shader->_fragment.replace(fragmentVersionPos, std::string("#version 430").length(), "");
+
+            shader->_vertex = "#version 430\n\n" + shader->_vertex;
+            shader->_fragment = "#version 430\n\n" + shader->_fragment;
+        });
+    }
+
+    void cOpenGLGraphicsAPI::DefineInShader(cShader* shader, const std::vector<cShader::sDefinePair>& definePairs)
+    {
+        if (!definePairs.empty())
+        {
+            const std::string defineStr = MakeDefineString(definePairs);
+
+            shader->_vertex = defineStr + shader->_vertex;
+            shader->_fragment = defineStr + shader->_fragment;
+        }
+    }
+
+    void cOpenGLGraphicsAPI::DestroyShader(cShader* shader)
+    {
+        shader->_referenceCount -= 1;
+        if (shader->_referenceCount > 0)
+            return;
 
-        GLint logBufferByteSize = 0;
-        GLchar logBuffer[1024] = {};
-        glGetShaderInfoLog(vertexShader, 1024, &logBufferByteSize, &logBuffer[0]);
-        if (logBufferByteSize > 0)
+        // The worker may still write the text
+        while (shader->_state.load(std::memory_order_acquire) == cShader::eState::PREPARING)
+            std::this_thread::yield();
+
+        if (_boundShader == shader)
+            _boundShader = nullptr;
+
+        const auto pending = std::find(_pendingShaders.begin(), _pendingShaders.end(), shader);
+        if (pending != _pendingShaders.end())
         {
-            Print("Error: vertex shader, header: " + header + ", path: " + vertexPath + "!");
-            Print(logBuffer);
+            _pendingShaders.erase(pending);
+            _shaderCacheStats.pendingCount = _pendingShaders.size();
         }
-        logBufferByteSize = 0;
-        glGetShaderInfoLog(fragmentShader, 1024, &logBufferByteSize, &logBuffer[0]);
-        if (logBufferByteSize > 0)
+
+        const auto live = std::find(_shaders.begin(), _shaders.end(), shader);
+        if (live != _shaders.end())
+            _shaders.erase(live);
+
+        if (shader->_vertexStage != 0)
+            glDeleteShader(shader->_vertexStage);
+        if (shader->_fragmentStage != 0)
+            glDeleteShader(shader->_fragmentStage);
+
+        if (shader->_fallback != nullptr)
+            DestroyShader(const_cast<cShader*>(shader->_fallback));
+
+        if (shader->_shared != nullptr)
         {
-            Print("Error: fragment shader, header: " + header + ", path: " + fragmentPath + "!");
-            Print(logBuffer);
+            DestroyShader(shader->_shared);
         }
-			
-		glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        else
+        {
+            const auto program = _programs.find(shader->_programHash);
+            if (program != _programs.end() && program->second == shader)
+                _programs.erase(program);
 
-        fileSystem->DestroyDataFile(vertexShaderFile);
-        fileSystem->DestroyDataFile(fragmentShaderFile);
+            if (shader->_instance != 0)
+            {
+                _stateCache.ForgetObject(shader->_instance);
+                glDeleteProgram(shader->_instance);
+            }
+        }
 
-        return shader;
+        if (shader != nullptr)
+            _context->Destroy<cShader>(shader);
     }
 
-    cShader* cOpenGLGraphicsAPI::CreateShader(const cShader* baseShader, const std::string& vertexFunc, const std::string& fragmentFunc, const std::vector<cShader::sDefinePair>& definePairs)
+    void cOpenGLGraphicsAPI::UpdateShaders()
     {
-        cShader* shader = _context->Create<cShader>(_context);
+        if (_pendingShaders.empty())
+            return;
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // Finished shaders leave the list, walk it backwards
+        for (usize i = _pendingShaders.size(); i > 0; i--)
+            AdvanceShader(_pendingShaders[i - 1], K_FALSE);
+
+        _shaderCacheStats.milliseconds += std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Shaders whose files changed are rebuilt on this thread in creation order, so a material shader reads the new
+    // text of its base. Every other program is left alone.
+    void cOpenGLGraphicsAPI::ReloadShaders(const std::vector<std::string>& paths)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // Workers may still read the text of a base that is about to change
+        while (!_pendingShaders.empty())
+            AdvanceShader(_pendingShaders.back(), K_TRUE);
+
+        std::vector<const cShader*> reloaded;
+        // Released after the walk, a last reference going away changes the shader list
+        std::vector<cShader*> releasedShared;
+        for (usize i = 0; i < _shaders.size(); i++)
+        {
+            cShader* shader = _shaders[i];
+            const boolean changed = std::find(paths.begin(), paths.end(), shader->_vertexPath) != paths.end() ||
+                std::find(paths.begin(), paths.end(), shader->_fragmentPath) != paths.end() ||
+                std::find(reloaded.begin(), reloaded.end(), shader->_fallback) != reloaded.end() ? K_TRUE : K_FALSE;
+            if (changed == K_FALSE)
+                continue;
+
+            reloaded.emplace_back(shader);
+
+            const u32 oldProgram = shader->_instance;
+            const u64 oldProgramHash = shader->_programHash;
+            cShader* oldShared = shader->_shared;
+            if (oldShared == nullptr)
+            {
+                const auto program = _programs.find(oldProgramHash);
+                if (program != _programs.end() && program->second == shader)
+                    _programs.erase(program);
+            }
+
+            shader->_instance = 0;
+            shader->_programHash = 0;
+            shader->_shared = nullptr;
+            shader->_prepare(shader);
+            shader->_state.store(cShader::eState::PREPARED, std::memory_order_release);
+            _pendingShaders.emplace_back(shader);
+            AdvanceShader(shader, K_TRUE);
+
+            GLint success = GL_TRUE;
+            if (shader->_shared == nullptr)
+                glGetProgramiv((GLuint)shader->_instance, GL_LINK_STATUS, &success);
+
+            if (!success)
+            {
+                // Keep drawing with the old program until the file is fixed
+                const auto program = _programs.find(shader->_programHash);
+                if (program != _programs.end() && program->second == shader)
+                    _programs.erase(program);
+                _stateCache.ForgetObject(shader->_instance);
+                glDeleteProgram(shader->_instance);
+
+                shader->_instance = oldProgram;
+                shader->_programHash = oldProgramHash;
+                shader->_shared = oldShared;
+                if (oldShared == nullptr && oldProgramHash != 0)
+                    _programs.emplace(oldProgramHash, shader);
+
+                continue;
+            }
 
-        const std::string vertexFuncDefinition = "void Vertex_Func(in vec3 _positionLocal, in vec2 _texcoord, in vec3 _normal, in int _instanceID, in Instance _instance, in Material material, in float _use2D, out vec4 _glPosition){}";
-        const std::string vertexFuncPassthroughCall = "Vertex_Passthrough(InPositionLocal, instance, instance.Use2D, gl_Position);";
-        const std::string fragmentFuncDefinition = "void Fragment_Func(in vec2 _texcoord, in vec4 _textureColor, in vec4 _materialDiffuseColor, out vec4 _fragColor){}";
-        const std::string fragmentFuncPassthroughCall = "Fragment_Passthrough(textureColor, DiffuseColor, fragColor);";
+            if (oldShared != nullptr)
+            {
+                releasedShared.emplace_back(oldShared);
+            }
+            else if (oldProgram != 0)
+            {
+                _stateCache.ForgetObject(oldProgram);
+                glDeleteProgram(oldProgram);
+            }
+        }
 
-        shader->_vertex = baseShader->_vertex;
-        shader->_fragment = baseShader->_fragment;
+        for (cShader* shared : releasedShared)
+            DestroyShader(shared);
 
-        const usize vertexFuncDefinitionPos = shader->_vertex.find(vertexFuncDefinition);
-        if (vertexFuncDefinitionPos != std::string::npos)
-            shader->_vertex.replace(vertexFuncDefinitionPos, vertexFuncDefinition.length(), vertexFunc);
-        const usize vertexFuncPasstroughCallPos = shader->_vertex.find(vertexFuncPassthroughCall);
-        if (vertexFuncPasstroughCallPos != std::string::npos)
-            shader->_vertex.replace(vertexFuncPasstroughCallPos, vertexFuncPassthroughCall.length(), "");
+        const f32 milliseconds = std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Print("Graphics: reloaded " + std::to_string(reloaded.size()) + " shaders in " + std::to_string(milliseconds) + " ms");
+    }
 
-        const usize fragmentFuncDefinitionPos = shader->_fragment.find(fragmentFuncDefinition);
-        if (fragmentFuncDefinitionPos != std::string::npos)
-            shader->_fragment.replace(fragmentFuncDefinitionPos, fragmentFuncDefinition.length(), fragmentFunc);
-        const usize fragmentFuncPassthroughPos = shader->_fragment.find(fragmentFuncPassthroughCall);
-        if (fragmentFuncPassthroughPos != std::string::npos)
-            shader->_fragment.replace(fragmentFuncPassthroughPos, fragmentFuncPassthroughCall.length(), "");
+    // Text preparation goes to a worker and the shader joins the pending list. GL calls stay on this thread,
+    // UpdateShaders or the first use of the shader issue the compile once the text is there.
+    cShader* cOpenGLGraphicsAPI::QueueShader(cShader* shader, std::function<void(cShader*)>&& prepare)
+    {
+        shader->_prepare = std::move(prepare);
+        shader->_state.store(cShader::eState::PREPARING, std::memory_order_relaxed);
+        _shaders.emplace_back(shader);
+        _pendingShaders.emplace_back(shader);
+        _shaderCacheStats.pendingCount = _pendingShaders.size();
+
+        cThread* threads = _context->GetSubsystem<cThread>();
+        if (threads == nullptr || threads->GetThreadCount() == 0)
+        {
+            shader->_prepare(shader);
+            shader->_state.store(cShader::eState::PREPARED, std::memory_order_release);
 
-        shader->_vertex = CleanShaderSource(shader->_vertex);
-        shader->_fragment = CleanShaderSource(shader->_fragment);
+            return shader;
+        }
 
-        DefineInShader(shader, definePairs);
+        cTask task(nullptr, [shader](cBuffer* const) {
+            shader->_prepare(shader);
+            shader->_state.store(cShader::eState::PREPARED, std::memory_order_release);
+        });
+        threads->Submit(task);
 
-        const usize vertexVersionPos = shader->_vertex.find("#version 430");
-        if (vertexVersionPos != std::string::npos)
-            shader->_vertex.replace(vertexVersionPos, std::string("#version 430").length(), "");
-        const usize fragmentVersionPos = shader->_fragment.find("#version 430");
-        if (fragmentVersionPos != std::string::npos)
-            shader->_fragment.replace(fragmentVersionPos, std::string("#version 430").length(), "");
+        return shader;
+    }
 
-        shader->_vertex = "#version 430\n\n" + shader->_vertex;
-        shader->_fragment = "#version 430\n\n" + shader->_fragment;
+    // Moves the shader one step, waiting runs it to the end. Without the parallel compile extension the link
+    // result is read one step after the compile was issued, drivers that compile lazily get that time for free.
+    void cOpenGLGraphicsAPI::AdvanceShader(cShader* shader, boolean wait)
+    {
+        do
+        {
+            const cShader::eState state = shader->_state.load(std::memory_order_acquire);
+            if (state == cShader::eState::PREPARING)
+            {
+                if (wait == K_TRUE)
+                    std::this_thread::yield();
+            }
+            else if (state == cShader::eState::PREPARED)
+            {
+                IssueShader(shader);
+            }
+            else if (state == cShader::eState::COMPILING)
+            {
+                GLint complete = GL_TRUE;
+                if (wait == K_FALSE && _parallelShaderCompile == K_TRUE)
+                    glGetProgramiv((GLuint)shader->_instance, GL_COMPLETION_STATUS_KHR, &complete);
+                if (complete == GL_TRUE)
+                    FinishShader(shader);
+            }
+        }
+        while (wait == K_TRUE && shader->IsReady() == K_FALSE);
+    }
+
+    // Final sources and the driver name are the program key. A program that exists already, even a pending
+    // one, is shared. Otherwise the binary cache is tried before the compile is handed to the driver.
+    void cOpenGLGraphicsAPI::IssueShader(cShader* shader)
+    {
+        u64 hash = HashShaderString(0xCBF29CE484222325ull, _driverName);
+        hash = HashShaderString(hash, shader->_vertex);
+        hash = HashShaderString(hash, shader->_fragment);
+        // Zero marks programs outside of the cache
+        hash = hash != 0 ? hash : 1;
+
+        const auto program = _programs.find(hash);
+        if (program != _programs.end())
+        {
+            shader->_shared = program->second;
+            shader->_shared->_referenceCount += 1;
+            _shaderCacheStats.sharedCount += 1;
+            FinishShader(shader);
+
+            return;
+        }
+
+        shader->_programHash = hash;
+        _programs.emplace(hash, shader);
+
+        shader->_instance = LoadProgramBinary(hash);
+        if (shader->_instance != 0)
+        {
+            _shaderCacheStats.binaryLoadedCount += 1;
+            FinishShader(shader);
+
+            return;
+        }
 
         const char* vertex = shader->_vertex.c_str();
         const char* fragment = shader->_fragment.c_str();
         const GLint vertexByteSize = strlen(vertex);
         const GLint fragmentByteSize = strlen(fragment);
         shader->_instance = glCreateProgram();
-        const GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-        const GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(vertexShader, 1, &vertex, &vertexByteSize);
-        glShaderSource(fragmentShader, 1, &fragment, &fragmentByteSize);
-        glCompileShader(vertexShader);
-        glCompileShader(fragmentShader);
-        glAttachShader(shader->_instance, vertexShader);
-        glAttachShader(shader->_instance, fragmentShader);
+        shader->_vertexStage = glCreateShader(GL_VERTEX_SHADER);
+        shader->_fragmentStage = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(shader->_vertexStage, 1, &vertex, &vertexByteSize);
+        glShaderSource(shader->_fragmentStage, 1, &fragment, &fragmentByteSize);
+        glCompileShader(shader->_vertexStage);
+        glCompileShader(shader->_fragmentStage);
+        glAttachShader(shader->_instance, shader->_vertexStage);
+        glAttachShader(shader->_instance, shader->_fragmentStage);
+        glProgramParameteri(shader->_instance, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(shader->_instance);
 
-        GLint success;
-        glGetProgramiv((GLuint)shader->_instance, GL_LINK_STATUS, &success);
-        if (!success)
-            Print("Error: can't link shader!");
-        if (!glIsProgram((GLuint)shader->_instance))
-            Print("Error: invalid shader!");
+        _shaderCacheStats.compiledCount += 1;
+        shader->_state.store(cShader::eState::COMPILING, std::memory_order_release);
+    }
 
-        GLint logBufferByteSize = 0;
-        GLchar logBuffer[1024] = {};
-        glGetShaderInfoLog(vertexShader, 1024, &logBufferByteSize, &logBuffer[0]);
-        if (logBufferByteSize > 0)
-        {
-            Print("Error: vertex shader!");
-            Print(logBuffer);
-        }
-        logBufferByteSize = 0;
-        glGetShaderInfoLog(fragmentShader, 1024, &logBufferByteSize, &logBuffer[0]);
-        if (logBufferByteSize > 0)
+    void cOpenGLGraphicsAPI::FinishShader(cShader* shader)
+    {
+        if (shader->_shared == nullptr)
         {
-            Print("Error: fragment shader!");
-            Print(logBuffer);
+            const boolean compiled = shader->_vertexStage != 0 ? K_TRUE : K_FALSE;
+
+            GLint success;
+            glGetProgramiv((GLuint)shader->_instance, GL_LINK_STATUS, &success);
+            if (!success)
+                Print("Error: can't link shader!");
+            if (!glIsProgram((GLuint)shader->_instance))
+                Print("Error: invalid shader!");
+            if (success)
+                ReflectShader(shader);
+
+            if (compiled == K_TRUE)
+            {
+                GLint logBufferByteSize = 0;
+                GLchar logBuffer[1024] = {};
+                glGetShaderInfoLog(shader->_vertexStage, 1024, &logBufferByteSize, &logBuffer[0]);
+                if (logBufferByteSize > 0)
+                {
+                    Print("Error: " + shader->_vertexLabel + "!");
+                    Print(logBuffer);
+                }
+                logBufferByteSize = 0;
+                glGetShaderInfoLog(shader->_fragmentStage, 1024, &logBufferByteSize, &logBuffer[0]);
+                if (logBufferByteSize > 0)
+                {
+                    Print("Error: " + shader->_fragmentLabel + "!");
+                    Print(logBuffer);
+                }
+
+                glDetachShader(shader->_instance, shader->_vertexStage);
+                glDetachShader(shader->_instance, shader->_fragmentStage);
+                glDeleteShader(shader->_vertexStage);
+                glDeleteShader(shader->_fragmentStage);
+                shader->_vertexStage = 0;
+                shader->_fragmentStage = 0;
+
+                if (success)
+                    SaveProgramBinary(shader->_instance, shader->_programHash);
+            }
         }
 
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
+        shader->_state.store(cShader::eState::READY, std::memory_order_release);
 
-        return shader;
+        const auto pending = std::find(_pendingShaders.begin(), _pendingShaders.end(), shader);
+        if (pending != _pendingShaders.end())
+            _pendingShaders.erase(pending);
+        _shaderCacheStats.pendingCount = _pendingShaders.size();
     }
 
-    void cOpenGLGraphicsAPI::DefineInShader(cShader* shader, const std::vector<cShader::sDefinePair>& definePairs)
+    // Shader whose program draws for the given one right now, pending shaders stand in with their fallback.
+    // Advancing is for binds, a pending shader gets a step and one without a fallback is finished on the spot.
+    const cShader* cOpenGLGraphicsAPI::ResolveShader(const cShader* shader, boolean advance)
     {
-        if (!definePairs.empty())
+        while (K_TRUE)
         {
-            std::string defineStr = "";
-            for (const auto& define : definePairs)
-                defineStr += "#define " + define._name + " " + std::to_string(define._index) + "\n";
+            if (advance == K_TRUE && shader->IsReady() == K_FALSE)
+            {
+                const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                AdvanceShader(const_cast<cShader*>(shader), shader->_fallback == nullptr ? K_TRUE : K_FALSE);
+                _shaderCacheStats.milliseconds += std::chrono::duration<f32, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
 
-            shader->_vertex = defineStr + shader->_vertex;
-            shader->_fragment = defineStr + shader->_fragment;
+            if (shader->IsReady() == K_FALSE && shader->_fallback != nullptr)
+                shader = shader->_fallback;
+            else if (shader->_shared != nullptr)
+                shader = shader->_shared;
+            else
+                return shader;
         }
     }
 
-    void cOpenGLGraphicsAPI::DestroyShader(cShader* shader)
+    u32 cOpenGLGraphicsAPI::LoadProgramBinary(u64 hash)
     {
-        glDeleteProgram(shader->_instance);
+        if (_programCachePath.empty())
+            return 0;
 
-        if (shader != nullptr)
-            _context->Destroy<cShader>(shader);
+        char name[32] = {};
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+
+        cFileSystem* fileSystem = _context->GetSubsystem<cFileSystem>();
+        cMappedFile* file = fileSystem->CreateMappedFile(_programCachePath + "/" + name);
+        if (file == nullptr)
+            return 0;
+
+        GLuint program = 0;
+        sProgramBinaryHeader header = {};
+        if (file->GetByteSize() >= sizeof(header))
+        {
+            memcpy(&header, file->GetData(), sizeof(header));
+            if (header.magic == kProgramBinaryMagic && header.version == kProgramBinaryVersion && header.hash == hash && file->GetByteSize() - sizeof(header) >= header.byteSize)
+            {
+                program = glCreateProgram();
+                glProgramBinary(program, (GLenum)header.format, (const u8*)file->GetData() + sizeof(header), (GLsizei)header.byteSize);
+
+                // Drivers reject binaries after updates that keep the version string, the source path takes over then
+                GLint success = 0;
+                glGetProgramiv(program, GL_LINK_STATUS, &success);
+                if (!success)
+                {
+                    glDeleteProgram(program);
+                    program = 0;
+                }
+            }
+        }
+
+        fileSystem->DestroyMappedFile(file);
+
+        return program;
     }
 
-    void cOpenGLGraphicsAPI::SetShaderUniform(const cShader* shader, const std::string& name, const glm::mat4& matrix)
+    void cOpenGLGraphicsAPI::SaveProgramBinary(u32 program, u64 hash)
     {
-        glUniformMatrix4fv(glGetUniformLocation(shader->_instance, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
+        if (_programCachePath.empty())
+            return;
+
+        GLint byteSize = 0;
+        glGetProgramiv((GLuint)program, GL_PROGRAM_BINARY_LENGTH, &byteSize);
+        if (byteSize <= 0)
+            return;
+
+        std::vector<u8> binary(sizeof(sProgramBinaryHeader) + byteSize);
+        sProgramBinaryHeader header = {};
+        GLenum format = GL_NONE;
+        glGetProgramBinary((GLuint)program, byteSize, nullptr, &format, binary.data() + sizeof(header));
+        header.hash = hash;
+        header.format = (u32)format;
+        header.byteSize = (u32)byteSize;
+        memcpy(binary.data(), &header, sizeof(header));
+
+        std::error_code error;
+        std::filesystem::create_directories(_programCachePath, error);
+
+        char name[32] = {};
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+        std::ofstream stream(_programCachePath + "/" + name, std::ios::binary);
+        if (!stream)
+        {
+            Print("Error: can't write shader cache file '" + _programCachePath + "/" + name + "'!");
+            return;
+        }
+
+        stream.write((const char*)binary.data(), binary.size());
+    }
+
+    void cOpenGLGraphicsAPI::SetShaderUniform(const cShader* shader, cUniformID id, const glm::mat4& matrix)
+    {
+        shader = ResolveShader(shader, K_FALSE);
+        const cShader::sUniform* uniform = shader->FindUniform(id);
+        if (uniform != nullptr && uniform->type == cShader::eUniformType::VALUE)
+            glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &matrix[0][0]);
     }
 
-    void cOpenGLGraphicsAPI::SetShaderUniform(const cShader* shader, const std::string& name, usize count, const f32* values)
+    void cOpenGLGraphicsAPI::SetShaderUniform(const cShader* shader, cUniformID id, usize count, const f32* values)
     {
-        glUniform4fv(glGetUniformLocation(shader->_instance, name.c_str()), count, &values[0]);
+        shader = ResolveShader(shader, K_FALSE);
+        const cShader::sUniform* uniform = shader->FindUniform(id);
+        if (uniform != nullptr && uniform->type == cShader::eUniformType::VALUE)
+            glUniform4fv(uniform->location, count, &values[0]);
     }
 
     cTexture* cOpenGLGraphicsAPI::CreateTexture(usize width, usize height, usize depth, cTexture::eDimension dimension, cTexture::eFormat format, const void* data)
@@ -545,6 +1169,9 @@ namespace triton
             glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
         }
 
+        // Updates go through texture unit 0 and leave nothing bound there
+        _stateCache.InvalidateTextureSlot(0);
+
         return texture;
     }
 
@@ -556,30 +1183,44 @@ namespace triton
         return newTexture;
     }
 
-    void cOpenGLGraphicsAPI::BindTexture(const cShader* shader, const std::string& name, const cTexture* texture, s32 slot)
+    void cOpenGLGraphicsAPI::BindTexture(const cShader* shader, cUniformID id, const cTexture* texture, s32 slot)
     {
         if (slot == -1)
             slot = texture->_slot;
 
+        shader = ResolveShader(shader, K_FALSE);
+
+        // Sampler units are program state, only write them when the unit changes
+        const cShader::sUniform* sampler = shader->FindUniform(id);
+        if (sampler != nullptr && sampler->type == cShader::eUniformType::SAMPLER && sampler->binding != slot)
+        {
+            glUniform1i(sampler->location, slot);
+            sampler->binding = slot;
+        }
+
         if (texture->GetDimension() == cTexture::eDimension::TEXTURE_2D)
         {
-            glUniform1i(glGetUniformLocation(shader->_instance, name.c_str()), slot);
-            glActiveTexture(GL_TEXTURE0 + slot);
-            glBindTexture(GL_TEXTURE_2D, texture->_instance);
-            glActiveTexture(GL_TEXTURE0);
+            if (_stateCache.SetTexture(slot, texture->GetDimension(), texture->_instance) == K_TRUE)
+            {
+                glActiveTexture(GL_TEXTURE0 + slot);
+                glBindTexture(GL_TEXTURE_2D, texture->_instance);
+                glActiveTexture(GL_TEXTURE0);
+            }
         }
         else if (texture->GetDimension() == cTexture::eDimension::TEXTURE_2D_ARRAY)
         {
-            glUniform1i(glGetUniformLocation(shader->_instance, name.c_str()), slot);
-            glActiveTexture(GL_TEXTURE0 + slot);
-            glBindTexture(GL_TEXTURE_2D_ARRAY, texture->_instance);
-            glActiveTexture(GL_TEXTURE0);
+            if (_stateCache.SetTexture(slot, texture->GetDimension(), texture->_instance) == K_TRUE)
+            {
+                glActiveTexture(GL_TEXTURE0 + slot);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, texture->_instance);
+                glActiveTexture(GL_TEXTURE0);
+            }
         }
     }
 
     void cOpenGLGraphicsAPI::UnbindTexture(const cTexture* texture)
     {
-        if (texture->GetDimension() == cTexture::eDimension::TEXTURE_2D_ARRAY)
+        if (texture->GetDimension() == cTexture::eDimension::TEXTURE_2D_ARRAY && _stateCache.SetTexture(0, texture->GetDimension(), 0) == K_TRUE)
             glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     }
 
@@ -641,6 +1282,8 @@ namespace triton
                 glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
             }
         }
+
+        _stateCache.InvalidateTextureSlot(0);
     }
 
     void cOpenGLGraphicsAPI::WriteTextureToFile(const cTexture* texture, const std::string& filename)
@@ -669,6 +1312,7 @@ namespace triton
             glBindTexture(GL_TEXTURE_2D, texture->_instance);
             glGetTexImage(GL_TEXTURE_2D, 0, channelsGL, formatComponentGL, pixels);
             glBindTexture(GL_TEXTURE_2D, 0);
+            _stateCache.InvalidateTextureSlot(0);
 
             lodepng_encode32_file(filename.c_str(), pixels, texture->_width, texture->_height);
 
@@ -690,6 +1334,8 @@ namespace triton
             glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
             glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
         }
+
+        _stateCache.InvalidateTextureSlot(0);
     }
 
     void cOpenGLGraphicsAPI::DestroyTexture(cTexture* texture)
@@ -699,6 +1345,8 @@ namespace triton
         else if (texture->GetDimension() == cTexture::eDimension::TEXTURE_2D_ARRAY)
             glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
+        _stateCache.InvalidateTextureSlot(0);
+        _stateCache.ForgetObject(texture->_instance);
         glDeleteTextures(1, (GLuint*)&texture->_instance);
 
         if (texture != nullptr)
@@ -720,10 +1368,12 @@ namespace triton
             buffs[i] = GL_COLOR_ATTACHMENT0 + i;
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, renderTarget->_colorAttachments[i]->_instance, 0);
         }
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, renderTarget->_depthAttachment->_instance, 0);
+        if (renderTarget->_depthAttachment != nullptr)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, renderTarget->_depthAttachment->_instance, 0);
         glDrawBuffers(renderTarget->_colorAttachments.size(), &buffs[0]);
         GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        _stateCache.InvalidateRenderTarget();
 			
 		if (status != GL_FRAMEBUFFER_COMPLETE)
             Print("Error: incomplete framebuffer!");
@@ -751,6 +1401,7 @@ namespace triton
         }
         glDrawBuffers(renderTarget->_colorAttachments.size(), &buffs[0]);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        _stateCache.InvalidateRenderTarget();
     }
 
     void cOpenGLGraphicsAPI::ResizeRenderTargetDepth(cRenderTarget* renderTarget, const glm::vec2& size)
@@ -763,6 +1414,7 @@ namespace triton
         glBindFramebuffer(GL_FRAMEBUFFER, renderTarget->_instance);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, renderTarget->_depthAttachment->_instance, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        _stateCache.InvalidateRenderTarget();
     }
 
     void cOpenGLGraphicsAPI::UpdateRenderTargetBuffers(cRenderTarget* renderTarget)
@@ -778,21 +1430,25 @@ namespace triton
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, renderTarget->_depthAttachment->_instance, 0);
         glDrawBuffers(renderTarget->_colorAttachments.size(), &buffs[0]);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        _stateCache.InvalidateRenderTarget();
     }
 
     void cOpenGLGraphicsAPI::BindRenderTarget(const cRenderTarget* renderTarget)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, renderTarget->_instance);
+        if (_stateCache.SetRenderTarget(renderTarget->_instance) == K_TRUE)
+            glBindFramebuffer(GL_FRAMEBUFFER, renderTarget->_instance);
     }
 
     void cOpenGLGraphicsAPI::UnbindRenderTarget()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (_stateCache.SetRenderTarget(0) == K_TRUE)
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
     void cOpenGLGraphicsAPI::DestroyRenderTarget(cRenderTarget* renderTarget)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        UnbindRenderTarget();
+        _stateCache.ForgetObject(renderTarget->_instance);
         glDeleteFramebuffers(1, (GLuint*)&renderTarget->_instance);
 
         if (renderTarget != nullptr)
@@ -802,9 +1458,7 @@ namespace triton
     cRenderPassGPU* cOpenGLGraphicsAPI::CreateRenderPass(const sRenderPassDescriptor* desc)
     {
         std::vector<cShader::sDefinePair> definePairs = {};
-        cVertexArray* vertexArray = nullptr;
-        cShader* shader = nullptr;
-        cRenderTarget* renderTarget = nullptr;
+        cRenderTarget* renderTarget = desc->renderTarget;
 
         if (desc->inputTextureAtlasTextures.size() != desc->inputTextureAtlasTextureNames.size())
         {
@@ -818,9 +1472,34 @@ namespace triton
             definePairs.push_back({ textureAtlasTextureName, textureAtlasTextureIndex });
         }
 
+        cShader* shader = CreateRenderPassShader(desc, definePairs, desc->inputVertexFormat);
+        cVertexArray* vertexArray = CreateRenderPassVertexArray(desc, desc->inputVertexFormat);
+        cRenderPassGPU* renderPass = _context->Create<cRenderPassGPU>(_context, vertexArray, shader, renderTarget);
+
+        // Geometry of any vertex format goes through mesh passes, the other formats get their own layout and shader
+        if (desc->inputVertexFormat != eCategory::VERTEX_BUFFER_FORMAT_NONE)
+        {
+            for (usize i = 0; i < kVertexFormatCount; i++)
+            {
+                if (kVertexFormats[i] == desc->inputVertexFormat)
+                    continue;
+
+                renderPass->_formatShaders[i] = CreateRenderPassShader(desc, definePairs, kVertexFormats[i]);
+                renderPass->_formatVertexArrays[i] = CreateRenderPassVertexArray(desc, kVertexFormats[i]);
+            }
+        }
+
+        return renderPass;
+    }
+
+    cShader* cOpenGLGraphicsAPI::CreateRenderPassShader(const sRenderPassDescriptor* desc, std::vector<cShader::sDefinePair> definePairs, eCategory format)
+    {
+        if (IsVertexFormatOctahedral(format) == K_TRUE)
+            definePairs.push_back({ "VERTEX_FORMAT_OCT_NORMAL", 1 });
+
         if (desc->shaderBase == nullptr)
         {
-            shader = CreateShader(
+            return CreateShader(
                 desc->shaderRenderPath,
                 desc->shaderVertexPath,
                 desc->shaderFragmentPath,
@@ -829,44 +1508,38 @@ namespace triton
         }
         else
         {
-            shader = CreateShader(
+            return CreateShader(
                 desc->shaderBase,
                 desc->shaderVertexFunc,
                 desc->shaderFragmentFunc,
                 definePairs
             );
         }
+    }
 
-        vertexArray = CreateVertexArray();
+    cVertexArray* cOpenGLGraphicsAPI::CreateRenderPassVertexArray(const sRenderPassDescriptor* desc, eCategory format)
+    {
+        cVertexArray* vertexArray = CreateVertexArray();
         BindVertexArray(vertexArray);
-        if (desc->inputVertexFormat == eCategory::VERTEX_BUFFER_FORMAT_NONE)
-        {
-            for (auto buffer : desc->inputBuffers)
-                BindBuffer(buffer);
-        }
-        else if (desc->inputVertexFormat == eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3)
-        {
-            for (auto buffer : desc->inputBuffers)
-                BindBuffer(buffer);
-
-            BindDefaultInputLayout();
-        }
-
+        for (auto buffer : desc->inputBuffers)
+            BindBuffer(buffer);
+        if (format != eCategory::VERTEX_BUFFER_FORMAT_NONE)
+            BindInputLayout(format);
         UnbindVertexArray();
 
-        return _context->Create<cRenderPassGPU>(_context, vertexArray, shader, renderTarget);
+        return vertexArray;
     }
 
-    void cOpenGLGraphicsAPI::BindRenderPass(const cRenderPass* renderPass, cShader* customShader)
+    void cOpenGLGraphicsAPI::BindRenderPass(const cRenderPass* renderPass, cShader* customShader, eCategory vertexFormat)
     {
         cShader* shader = nullptr;
         if (customShader == nullptr)
-            shader = renderPass->GetRenderPassGPU()->GetShader();
+            shader = renderPass->GetRenderPassGPU()->GetShader(vertexFormat);
         else
             shader = customShader;
 
         BindShader(shader);
-        BindVertexArray(renderPass->GetRenderPassGPU()->GetVertexArray());
+        BindVertexArray(renderPass->GetRenderPassGPU()->GetVertexArray(vertexFormat));
         if (renderPass->GetRenderPassGPU()->GetRenderTarget() != nullptr)
             BindRenderTarget(renderPass->GetRenderPassGPU()->GetRenderTarget());
         else
@@ -875,46 +1548,87 @@ namespace triton
         for (auto buffer : renderPass->GetInputBuffers())
             BindBufferNotVAO(buffer);
         BindDepthMode(renderPass->GetDepthMode());
+        BindBackfaceCulling(renderPass->GetBackfaceCulling());
         BindBlendMode(renderPass->GetBlendMode());
         for (usize i = 0; i < renderPass->GetInputTextures().size(); i++)
-            BindTexture(shader, renderPass->GetInputTextureNames()[i].c_str(), renderPass->GetInputTextures()[i], i);
+            BindTexture(shader, renderPass->GetInputTextureIDs()[i], renderPass->GetInputTextures()[i], i);
     }
 
     void cOpenGLGraphicsAPI::UnbindRenderPass(const cRenderPass* renderPass)
     {
+        // Slot buffers and textures stay bound, the next pass mostly binds the same ones and the state
+        // cache skips them. The vertex array has to go, index buffer writes would land in it otherwise.
         UnbindVertexArray();
         if (renderPass->GetRenderPassGPU()->GetRenderTarget() != nullptr)
             UnbindRenderTarget();
-        for (auto buffer : renderPass->GetInputBuffers())
-            UnbindBuffer(buffer);
-        for (auto texture : renderPass->GetInputTextures())
-            UnbindTexture(texture);
     }
 
     void cOpenGLGraphicsAPI::DestroyRenderPass(cRenderPassGPU* renderPass)
     {
-        glBindVertexArray(0);
+        UnbindVertexArray();
         DestroyVertexArray(renderPass->GetVertexArray());
+        for (usize i = 0; i < kVertexFormatCount; i++)
+        {
+            if (renderPass->_formatVertexArrays[i] != nullptr)
+                DestroyVertexArray(renderPass->_formatVertexArrays[i]);
+        }
         
         DestroyShader(renderPass->GetShader());
+        for (usize i = 0; i < kVertexFormatCount; i++)
+        {
+            if (renderPass->_formatShaders[i] != nullptr)
+                DestroyShader(renderPass->_formatShaders[i]);
+        }
         
         _context->Destroy<cRenderPassGPU>(renderPass);
     }
 
     void cOpenGLGraphicsAPI::BindDefaultInputLayout()
     {
+        BindInputLayout(eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3);
+    }
+
+    void cOpenGLGraphicsAPI::BindInputLayout(eCategory format)
+    {
+        // Locations are position, texcoord, normal for every format, compressed attributes are
+        // normalized by the fetch and the shader only decodes the octahedral normal
         glEnableVertexAttribArray(0);
         glEnableVertexAttribArray(1);
         glEnableVertexAttribArray(2);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 32, (void*)0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 32, (void*)12);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 32, (void*)20);
+
+        switch (format)
+        {
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 32, (void*)0);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 32, (void*)12);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 32, (void*)20);
+            break;
+
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2:
+            glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, 16, (void*)0);
+            glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, 16, (void*)8);
+            glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, 16, (void*)12);
+            break;
+
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2:
+            glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, 12, (void*)0);
+            glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, 12, (void*)8);
+            glVertexAttribPointer(2, 2, GL_BYTE, GL_TRUE, 12, (void*)6);
+            break;
+
+        default:
+            Print("Error: unsupported vertex buffer format!");
+            break;
+        }
     }
 
     void cOpenGLGraphicsAPI::BindBlendMode(const sBlendMode& blendMode)
     {
         for (usize i = 0; i < blendMode.factorCount; i++)
         {
+            if (_stateCache.SetBlendFactors(i, blendMode.srcFactors[i], blendMode.dstFactors[i]) == K_FALSE)
+                continue;
+
             GLuint srcFactor = GL_ZERO;
             GLuint dstFactor = GL_ZERO;
 
@@ -942,6 +1656,9 @@ namespace triton
 
     void cOpenGLGraphicsAPI::BindDepthMode(const sDepthMode& blendMode)
     {
+        if (_stateCache.SetDepthMode(blendMode) == K_FALSE)
+            return;
+
         if (blendMode.useDepthTest == K_TRUE)
             glEnable(GL_DEPTH_TEST);
         else
@@ -953,8 +1670,22 @@ namespace triton
             glDepthMask(GL_FALSE);
     }
 
+    void cOpenGLGraphicsAPI::BindBackfaceCulling(boolean useBackfaceCulling)
+    {
+        if (_stateCache.SetBackfaceCulling(useBackfaceCulling) == K_FALSE)
+            return;
+
+        if (useBackfaceCulling == K_TRUE)
+            glEnable(GL_CULL_FACE);
+        else
+            glDisable(GL_CULL_FACE);
+    }
+
     void cOpenGLGraphicsAPI::Viewport(const sViewport& viewport)
     {
+        if (_stateCache.SetViewport(viewport.rect) == K_FALSE)
+            return;
+
         glViewport(viewport.rect.GetX(), viewport.rect.GetY(), viewport.rect.GetZ(), viewport.rect.GetW());
     }
 
@@ -1002,4 +1733,68 @@ namespace triton
     {
         glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
     }
+
+    void cOpenGLGraphicsAPI::DrawIndirect(const cBuffer* commandBuffer, usize offset, usize drawCount)
+    {
+        if (_shaderDrawParameters == K_FALSE)
+        {
+            const auto it = _drawCommandCopies.find(commandBuffer->_instance);
+            if (it == _drawCommandCopies.end() || offset + drawCount * sizeof(sDrawIndirectCommand) > it->second.size())
+                return;
+
+            const cShader::sUniform* baseInstance = _boundShader != nullptr ? _boundShader->FindUniform(kBaseInstanceID) : nullptr;
+            const sDrawIndirectCommand* commands = (const sDrawIndirectCommand*)&it->second[offset];
+            for (usize i = 0; i < drawCount; i++)
+            {
+                const sDrawIndirectCommand& command = commands[i];
+                if (baseInstance != nullptr)
+                    glUniform1i(baseInstance->location, (GLint)command.baseInstance);
+                glDrawElementsInstancedBaseVertex(
+                    GL_TRIANGLES,
+                    command.indexCount,
+                    GL_UNSIGNED_INT,
+                    (const void*)((usize)command.firstIndex * sizeof(u32)),
+                    command.instanceCount,
+                    command.baseVertex
+                );
+            }
+
+            // Plain draws of the same program start at instance 0 again
+            if (baseInstance != nullptr)
+                glUniform1i(baseInstance->location, 0);
+
+            return;
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, (GLuint)commandBuffer->_instance);
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            (const void*)offset,
+            drawCount,
+            sizeof(sDrawIndirectCommand)
+        );
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    u64 cOpenGLGraphicsAPI::CreateFence()
+    {
+        return (u64)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    boolean cOpenGLGraphicsAPI::WaitFence(u64 fence, u64 timeoutNanoseconds)
+    {
+        if (fence == 0)
+            return K_TRUE;
+
+        const GLenum result = glClientWaitSync((GLsync)fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNanoseconds);
+
+        return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+    }
+
+    void cOpenGLGraphicsAPI::DestroyFence(u64 fence)
+    {
+        if (fence != 0)
+            glDeleteSync((GLsync)fence);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,776 @@
+// render_context_null.cpp
+
+#include <cstring>
+#include <string>
+#include "render_context.hpp"
+#include "graphics.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "types.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    struct sNullResourceCommand
+    {
+        u32 instance = 0;
+        u32 parameter = 0;
+    };
+
+    struct sNullBufferCommand
+    {
+        u32 instance = 0;
+        u32 type = 0;
+        s32 slot = 0;
+        u32 padding = 0;
+        u64 offset = 0;
+        u64 byteSize = 0;
+    };
+
+    struct sNullCopyBufferCommand
+    {
+        u32 srcInstance = 0;
+        u32 dstInstance = 0;
+        u64 srcOffset = 0;
+        u64 dstOffset = 0;
+        u64 byteSize = 0;
+    };
+
+    struct sNullTextureCommand
+    {
+        u32 instance = 0;
+        u32 format = 0;
+        u32 width = 0;
+        u32 height = 0;
+        u32 depth = 0;
+        s32 slot = 0;
+    };
+
+    struct sNullStateCommand
+    {
+        f32 values[4] = {};
+    };
+
+    struct sNullDrawCommand
+    {
+        u64 indexCount = 0;
+        u64 vertexOffset = 0;
+        u64 indexOffset = 0;
+        u64 instanceCount = 0;
+    };
+
+    cNullGraphicsAPI::cNullGraphicsAPI(cContext* context) : iGraphicsAPI(context) {}
+
+    cBuffer* cNullGraphicsAPI::CreateBuffer(usize byteSize, cBuffer::eType type, s32 slot, const void* data)
+    {
+        cBuffer* buffer = _context->Create<cBuffer>(_context);
+        buffer->_byteSize = byteSize;
+        buffer->_type = type;
+        buffer->_slot = slot;
+        buffer->_instance = ++_instanceCounter;
+
+        sNullBufferCommand payload = {};
+        payload.instance = buffer->_instance;
+        payload.type = (u32)type;
+        payload.slot = slot;
+        payload.byteSize = byteSize;
+        Record(eCommand::CREATE_BUFFER, payload);
+
+        if (type == cBuffer::eType::INDIRECT)
+        {
+            std::vector<u8>& contents = _indirectBuffers[buffer->_instance];
+            contents.resize(byteSize);
+            if (data != nullptr)
+                memcpy(contents.data(), data, byteSize);
+        }
+
+        if (data != nullptr)
+            _stats.uploadedByteCount += byteSize;
+
+        return buffer;
+    }
+
+    cBuffer* cNullGraphicsAPI::CreatePersistentBuffer(usize byteSize, cBuffer::eType type, s32 slot)
+    {
+        const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+
+        cBuffer* buffer = CreateBuffer(byteSize, type, slot, nullptr);
+        buffer->_mappedData = _context->GetMemoryAllocator()->Allocate(byteSize, caps->memoryAlignment);
+
+        return buffer;
+    }
+
+    void cNullGraphicsAPI::BindBufferRange(cBuffer* buffer, usize offset, usize byteSize)
+    {
+        buffer->_bindOffset = offset;
+        buffer->_bindByteSize = byteSize;
+
+        BindBuffer(buffer);
+    }
+
+    void cNullGraphicsAPI::BindBuffer(const cBuffer* buffer)
+    {
+        const boolean slotBuffer = buffer->_type == cBuffer::eType::UNIFORM || buffer->_type == cBuffer::eType::LARGE;
+        if (slotBuffer == K_TRUE && _stateCache.SetBuffer(buffer->_type, buffer->_slot, buffer->_instance, buffer->_bindOffset, buffer->_bindByteSize) == K_FALSE)
+            return;
+
+        sNullBufferCommand payload = {};
+        payload.instance = buffer->_instance;
+        payload.type = (u32)buffer->_type;
+        payload.slot = buffer->_slot;
+        payload.offset = buffer->_bindOffset;
+        payload.byteSize = buffer->_bindByteSize;
+        Record(eCommand::BIND_BUFFER, payload);
+    }
+
+    void cNullGraphicsAPI::BindBufferNotVAO(const cBuffer* buffer)
+    {
+        if (buffer->_type == cBuffer::eType::UNIFORM || buffer->_type == cBuffer::eType::LARGE)
+            BindBuffer(buffer);
+    }
+
+    void cNullGraphicsAPI::UnbindBuffer(const cBuffer* buffer)
+    {
+        const boolean slotBuffer = buffer->_type == cBuffer::eType::UNIFORM || buffer->_type == cBuffer::eType::LARGE;
+        if (slotBuffer == K_TRUE && _stateCache.SetBuffer(buffer->_type, buffer->_slot, 0, 0, 0) == K_FALSE)
+            return;
+
+        sNullBufferCommand payload = {};
+        payload.type = (u32)buffer->_type;
+        payload.slot = buffer->_slot;
+        Record(eCommand::UNBIND_BUFFER, payload);
+    }
+
+    void cNullGraphicsAPI::WriteBuffer(const cBuffer* buffer, usize offset, usize byteSize, const void* data)
+    {
+        if (offset + byteSize > buffer->_byteSize)
+        {
+            Print("Error: buffer write out of bounds!");
+
+            return;
+        }
+
+        sNullBufferCommand payload = {};
+        payload.instance = buffer->_instance;
+        payload.type = (u32)buffer->_type;
+        payload.slot = buffer->_slot;
+        payload.offset = offset;
+        payload.byteSize = byteSize;
+        Record(eCommand::WRITE_BUFFER, payload);
+
+        if (buffer->_type == cBuffer::eType::INDIRECT)
+            memcpy(_indirectBuffers[buffer->_instance].data() + offset, data, byteSize);
+
+        _stats.uploadedByteCount += byteSize;
+    }
+
+    void cNullGraphicsAPI::CopyBuffer(const cBuffer* srcBuffer, usize srcOffset, const cBuffer* dstBuffer, usize dstOffset, usize byteSize)
+    {
+        if (srcOffset + byteSize > srcBuffer->_byteSize || dstOffset + byteSize > dstBuffer->_byteSize)
+        {
+            Print("Error: buffer copy out of bounds!");
+
+            return;
+        }
+
+        sNullCopyBufferCommand payload = {};
+        payload.srcInstance = srcBuffer->_instance;
+        payload.dstInstance = dstBuffer->_instance;
+        payload.srcOffset = srcOffset;
+        payload.dstOffset = dstOffset;
+        payload.byteSize = byteSize;
+        Record(eCommand::COPY_BUFFER, payload);
+
+        if (srcBuffer->_type == cBuffer::eType::INDIRECT && dstBuffer->_type == cBuffer::eType::INDIRECT)
+            memmove(_indirectBuffers[dstBuffer->_instance].data() + dstOffset, _indirectBuffers[srcBuffer->_instance].data() + srcOffset, byteSize);
+        if (srcBuffer->_mappedData != nullptr && dstBuffer->_mappedData != nullptr)
+            memmove((u8*)dstBuffer->_mappedData + dstOffset, (const u8*)srcBuffer->_mappedData + srcOffset, byteSize);
+    }
+
+    void cNullGraphicsAPI::DestroyBuffer(cBuffer* buffer)
+    {
+        if (buffer == nullptr)
+            return;
+
+        Record(eCommand::DESTROY_BUFFER, sNullResourceCommand{ buffer->_instance, 0 });
+        _stateCache.ForgetObject(buffer->_instance);
+        _indirectBuffers.erase(buffer->_instance);
+
+        if (buffer->_mappedData != nullptr)
+            _context->GetMemoryAllocator()->Deallocate(buffer->_mappedData);
+
+        _context->Destroy<cBuffer>(buffer);
+    }
+
+    cVertexArray* cNullGraphicsAPI::CreateVertexArray()
+    {
+        cVertexArray* vertexArray = _context->Create<cVertexArray>(_context);
+        vertexArray->_instance = ++_instanceCounter;
+
+        Record(eCommand::CREATE_VERTEX_ARRAY, sNullResourceCommand{ vertexArray->_instance, 0 });
+
+        return vertexArray;
+    }
+
+    void cNullGraphicsAPI::BindVertexArray(const cVertexArray* vertexArray)
+    {
+        if (_stateCache.SetVertexArray(vertexArray->_instance) == K_FALSE)
+            return;
+
+        Record(eCommand::BIND_VERTEX_ARRAY, sNullResourceCommand{ vertexArray->_instance, 0 });
+    }
+
+    void cNullGraphicsAPI::BindDefaultVertexArray(const std::vector<cBuffer*>& buffersToBind)
+    {
+        for (auto buffer : buffersToBind)
+            BindBuffer(buffer);
+        BindDefaultInputLayout();
+    }
+
+    void cNullGraphicsAPI::UnbindVertexArray()
+    {
+        if (_stateCache.SetVertexArray(0) == K_FALSE)
+            return;
+
+        Record(eCommand::UNBIND_VERTEX_ARRAY);
+    }
+
+    void cNullGraphicsAPI::DestroyVertexArray(cVertexArray* vertexArray)
+    {
+        if (vertexArray == nullptr)
+            return;
+
+        Record(eCommand::DESTROY_VERTEX_ARRAY, sNullResourceCommand{ vertexArray->_instance, 0 });
+        _stateCache.ForgetObject(vertexArray->_instance);
+
+        _context->Destroy<cVertexArray>(vertexArray);
+    }
+
+    void cNullGraphicsAPI::BindShader(const cShader* shader)
+    {
+        if (_stateCache.SetShader(shader->_instance) == K_FALSE)
+            return;
+
+        Record(eCommand::BIND_SHADER, sNullResourceCommand{ shader->_instance, 0 });
+    }
+
+    void cNullGraphicsAPI::UnbindShader()
+    {
+        if (_stateCache.SetShader(0) == K_FALSE)
+            return;
+
+        Record(eCommand::UNBIND_SHADER);
+    }
+
+    cShader* cNullGraphicsAPI::CreateShader(eCategory renderPath, const std::string& vertexPath, const std::string& fragmentPath, const std::vector<cShader::sDefinePair>&)
+    {
+        cShader* shader = _context->Create<cShader>(_context);
+        shader->_instance = ++_instanceCounter;
+        shader->_vertex = vertexPath;
+        shader->_fragment = fragmentPath;
+
+        Record(eCommand::CREATE_SHADER, sNullResourceCommand{ shader->_instance, (u32)renderPath });
+
+        return shader;
+    }
+
+    cShader* cNullGraphicsAPI::CreateShader(const cShader* baseShader, const std::string&, const std::string&, const std::vector<cShader::sDefinePair>&)
+    {
+        cShader* shader = _context->Create<cShader>(_context);
+        shader->_instance = ++_instanceCounter;
+        shader->_vertex = baseShader->_vertex;
+        shader->_fragment = baseShader->_fragment;
+
+        Record(eCommand::CREATE_SHADER, sNullResourceCommand{ shader->_instance, baseShader->_instance });
+
+        return shader;
+    }
+
+    void cNullGraphicsAPI::DefineInShader(cShader*, const std::vector<cShader::sDefinePair>&)
+    {
+    }
+
+    void cNullGraphicsAPI::DestroyShader(cShader* shader)
+    {
+        if (shader == nullptr)
+            return;
+
+        Record(eCommand::DESTROY_SHADER, sNullResourceCommand{ shader->_instance, 0 });
+        _stateCache.ForgetObject(shader->_instance);
+
+        _context->Destroy<cShader>(shader);
+    }
+
+    void cNullGraphicsAPI::UpdateShaders()
+    {
+    }
+
+    void cNullGraphicsAPI::ReloadShaders(const std::vector<std::string>&)
+    {
+    }
+
+    void cNullGraphicsAPI::SetShaderUniform(const cShader* shader, cUniformID, const glm::mat4&)
+    {
+        Record(eCommand::SET_SHADER_UNIFORM, sNullResourceCommand{ shader->_instance, 16 });
+    }
+
+    void cNullGraphicsAPI::SetShaderUniform(const cShader* shader, cUniformID, usize count, const f32*)
+    {
+        Record(eCommand::SET_SHADER_UNIFORM, sNullResourceCommand{ shader->_instance, (u32)count });
+    }
+
+    cTexture* cNullGraphicsAPI::CreateTexture(usize width, usize height, usize depth, cTexture::eDimension dimension, cTexture::eFormat format, const void*)
+    {
+        cTexture* texture = _context->Create<cTexture>(_context);
+        texture->_instance = ++_instanceCounter;
+        texture->_width = width;
+        texture->_height = height;
+        texture->_depth = depth;
+        texture->_dimension = dimension;
+        texture->_format = format;
+
+        sNullTextureCommand payload = {};
+        payload.instance = texture->_instance;
+        payload.format = (u32)format;
+        payload.width = (u32)width;
+        payload.height = (u32)height;
+        payload.depth = (u32)depth;
+        Record(eCommand::CREATE_TEXTURE, payload);
+
+        return texture;
+    }
+
+    cTexture* cNullGraphicsAPI::ResizeTexture(cTexture* texture, const glm::vec2& size)
+    {
+        cTexture* newTexture = CreateTexture(size.x, size.y, texture->GetDepth(), texture->GetDimension(), texture->GetFormat(), nullptr);
+        DestroyTexture(texture);
+
+        return newTexture;
+    }
+
+    void cNullGraphicsAPI::BindTexture(const cShader*, cUniformID, const cTexture* texture, s32 slot)
+    {
+        if (slot == -1)
+            slot = texture->_slot;
+        if (_stateCache.SetTexture(slot, texture->GetDimension(), texture->_instance) == K_FALSE)
+            return;
+
+        sNullTextureCommand payload = {};
+        payload.instance = texture->_instance;
+        payload.slot = slot;
+        Record(eCommand::BIND_TEXTURE, payload);
+    }
+
+    void cNullGraphicsAPI::UnbindTexture(const cTexture* texture)
+    {
+        if (texture->GetDimension() != cTexture::eDimension::TEXTURE_2D_ARRAY || _stateCache.SetTexture(0, texture->GetDimension(), 0) == K_FALSE)
+            return;
+
+        Record(eCommand::UNBIND_TEXTURE, sNullResourceCommand{ texture->_instance, 0 });
+    }
+
+    void cNullGraphicsAPI::WriteTexture(const cTexture* texture, const glm::vec3& offset, const glm::vec2& size, const void*)
+    {
+        sNullTextureCommand payload = {};
+        payload.instance = texture->_instance;
+        payload.format = (u32)texture->_format;
+        payload.width = (u32)size.x;
+        payload.height = (u32)size.y;
+        payload.depth = (u32)offset.z;
+        Record(eCommand::WRITE_TEXTURE, payload);
+
+        const usize pixelByteSize = texture->_format == cTexture::eFormat::R8 ? 1 : 4;
+        _stats.uploadedByteCount += (usize)size.x * (usize)size.y * pixelByteSize;
+    }
+
+    void cNullGraphicsAPI::WriteTextureToFile(const cTexture*, const std::string&)
+    {
+    }
+
+    void cNullGraphicsAPI::GenerateTextureMips(const cTexture* texture)
+    {
+        Record(eCommand::GENERATE_TEXTURE_MIPS, sNullResourceCommand{ texture->_instance, 0 });
+    }
+
+    void cNullGraphicsAPI::DestroyTexture(cTexture* texture)
+    {
+        if (texture == nullptr)
+            return;
+
+        Record(eCommand::DESTROY_TEXTURE, sNullResourceCommand{ texture->_instance, 0 });
+        _stateCache.ForgetObject(texture->_instance);
+
+        _context->Destroy<cTexture>(texture);
+    }
+
+    cRenderTarget* cNullGraphicsAPI::CreateRenderTarget(const std::vector<cTexture*>& colorAttachments, cTexture* depthAttachment)
+    {
+        cRenderTarget* renderTarget = _context->Create<cRenderTarget>(_context);
+        renderTarget->_instance = ++_instanceCounter;
+        renderTarget->_colorAttachments = colorAttachments;
+        renderTarget->_depthAttachment = depthAttachment;
+
+        Record(eCommand::CREATE_RENDER_TARGET, sNullResourceCommand{ renderTarget->_instance, (u32)colorAttachments.size() });
+
+        return renderTarget;
+    }
+
+    void cNullGraphicsAPI::ResizeRenderTargetColors(cRenderTarget* renderTarget, const glm::vec2& size)
+    {
+        std::vector<cTexture*> newColorAttachments;
+        for (auto attachment : renderTarget->_colorAttachments)
+        {
+            newColorAttachments.emplace_back(CreateTexture(size.x, size.y, attachment->GetDepth(), attachment->GetDimension(), attachment->GetFormat(), nullptr));
+            DestroyTexture(attachment);
+        }
+        renderTarget->_colorAttachments = newColorAttachments;
+    }
+
+    void cNullGraphicsAPI::ResizeRenderTargetDepth(cRenderTarget* renderTarget, const glm::vec2& size)
+    {
+        cTexture* newDepthAttachment = CreateTexture(size.x, size.y, renderTarget->_depthAttachment->GetDepth(), renderTarget->_depthAttachment->GetDimension(), renderTarget->_depthAttachment->GetFormat(), nullptr);
+        DestroyTexture(renderTarget->_depthAttachment);
+        renderTarget->_depthAttachment = newDepthAttachment;
+    }
+
+    void cNullGraphicsAPI::UpdateRenderTargetBuffers(cRenderTarget*)
+    {
+    }
+
+    void cNullGraphicsAPI::BindRenderTarget(const cRenderTarget* renderTarget)
+    {
+        if (_stateCache.SetRenderTarget(renderTarget->_instance) == K_FALSE)
+            return;
+
+        Record(eCommand::BIND_RENDER_TARGET, sNullResourceCommand{ renderTarget->_instance, 0 });
+    }
+
+    void cNullGraphicsAPI::UnbindRenderTarget()
+    {
+        if (_stateCache.SetRenderTarget(0) == K_FALSE)
+            return;
+
+        Record(eCommand::UNBIND_RENDER_TARGET);
+    }
+
+    void cNullGraphicsAPI::DestroyRenderTarget(cRenderTarget* renderTarget)
+    {
+        if (renderTarget == nullptr)
+            return;
+
+        Record(eCommand::DESTROY_RENDER_TARGET, sNullResourceCommand{ renderTarget->_instance, 0 });
+        _stateCache.ForgetObject(renderTarget->_instance);
+
+        _context->Destroy<cRenderTarget>(renderTarget);
+    }
+
+    cRenderPassGPU* cNullGraphicsAPI::CreateRenderPass(const sRenderPassDescriptor* desc)
+    {
+        if (desc->inputTextureAtlasTextures.size() != desc->inputTextureAtlasTextureNames.size())
+        {
+            Print("Error: mismatch of render pass input texture atlas texture array and input texture atlas texture name array!");
+            return nullptr;
+        }
+
+        cShader* shader = CreateRenderPassShader(desc);
+        cVertexArray* vertexArray = CreateRenderPassVertexArray(desc, desc->inputVertexFormat);
+        cRenderPassGPU* renderPass = _context->Create<cRenderPassGPU>(_context, vertexArray, shader, desc->renderTarget);
+
+        // Same variants as the GL backend, one per vertex format for mesh passes
+        if (desc->inputVertexFormat != eCategory::VERTEX_BUFFER_FORMAT_NONE)
+        {
+            for (usize i = 0; i < kVertexFormatCount; i++)
+            {
+                if (kVertexFormats[i] == desc->inputVertexFormat)
+                    continue;
+
+                renderPass->_formatShaders[i] = CreateRenderPassShader(desc);
+                renderPass->_formatVertexArrays[i] = CreateRenderPassVertexArray(desc, kVertexFormats[i]);
+            }
+        }
+
+        return renderPass;
+    }
+
+    cShader* cNullGraphicsAPI::CreateRenderPassShader(const sRenderPassDescriptor* desc)
+    {
+        if (desc->shaderBase == nullptr)
+            return CreateShader(desc->shaderRenderPath, desc->shaderVertexPath, desc->shaderFragmentPath);
+        else
+            return CreateShader(desc->shaderBase, desc->shaderVertexFunc, desc->shaderFragmentFunc);
+    }
+
+    cVertexArray* cNullGraphicsAPI::CreateRenderPassVertexArray(const sRenderPassDescriptor* desc, eCategory format)
+    {
+        cVertexArray* vertexArray = CreateVertexArray();
+        BindVertexArray(vertexArray);
+        for (auto buffer : desc->inputBuffers)
+            BindBuffer(buffer);
+        if (format != eCategory::VERTEX_BUFFER_FORMAT_NONE)
+            BindInputLayout(format);
+        UnbindVertexArray();
+
+        return vertexArray;
+    }
+
+    void cNullGraphicsAPI::BindRenderPass(const cRenderPass* renderPass, cShader* customShader, eCategory vertexFormat)
+    {
+        cShader* shader = customShader == nullptr ? renderPass->GetRenderPassGPU()->GetShader(vertexFormat) : customShader;
+
+        BindShader(shader);
+        BindVertexArray(renderPass->GetRenderPassGPU()->GetVertexArray(vertexFormat));
+        if (renderPass->GetRenderPassGPU()->GetRenderTarget() != nullptr)
+            BindRenderTarget(renderPass->GetRenderPassGPU()->GetRenderTarget());
+        else
+            UnbindRenderTarget();
+        Viewport(renderPass->GetViewport());
+        for (auto buffer : renderPass->GetInputBuffers())
+            BindBufferNotVAO(buffer);
+        BindDepthMode(renderPass->GetDepthMode());
+        BindBackfaceCulling(renderPass->GetBackfaceCulling());
+        BindBlendMode(renderPass->GetBlendMode());
+        for (usize i = 0; i < renderPass->GetInputTextures().size(); i++)
+            BindTexture(shader, renderPass->GetInputTextureIDs()[i], renderPass->GetInputTextures()[i], i);
+    }
+
+    void cNullGraphicsAPI::UnbindRenderPass(const cRenderPass* renderPass)
+    {
+        // Same as the GL backend, slot buffers and textures stay bound for the next pass
+        UnbindVertexArray();
+        if (renderPass->GetRenderPassGPU()->GetRenderTarget() != nullptr)
+            UnbindRenderTarget();
+    }
+
+    void cNullGraphicsAPI::DestroyRenderPass(cRenderPassGPU* renderPass)
+    {
+        DestroyVertexArray(renderPass->GetVertexArray());
+        DestroyShader(renderPass->GetShader());
+        for (usize i = 0; i < kVertexFormatCount; i++)
+        {
+            if (renderPass->_formatVertexArrays[i] != nullptr)
+                DestroyVertexArray(renderPass->_formatVertexArrays[i]);
+            if (renderPass->_formatShaders[i] != nullptr)
+                DestroyShader(renderPass->_formatShaders[i]);
+        }
+
+        _context->Destroy<cRenderPassGPU>(renderPass);
+    }
+
+    void cNullGraphicsAPI::BindDefaultInputLayout()
+    {
+        BindInputLayout(eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3);
+    }
+
+    void cNullGraphicsAPI::BindInputLayout(eCategory format)
+    {
+        Record(eCommand::BIND_INPUT_LAYOUT, sNullResourceCommand{ 0, (u32)format });
+    }
+
+    void cNullGraphicsAPI::BindDepthMode(const sDepthMode& blendMode)
+    {
+        if (_stateCache.SetDepthMode(blendMode) == K_FALSE)
+            return;
+
+        Record(eCommand::BIND_DEPTH_MODE, sNullResourceCommand{ (u32)blendMode.useDepthTest, (u32)blendMode.useDepthWrite });
+    }
+
+    void cNullGraphicsAPI::BindBackfaceCulling(boolean useBackfaceCulling)
+    {
+        if (_stateCache.SetBackfaceCulling(useBackfaceCulling) == K_FALSE)
+            return;
+
+        Record(eCommand::BIND_BACKFACE_CULLING, sNullResourceCommand{ (u32)useBackfaceCulling, 0 });
+    }
+
+    void cNullGraphicsAPI::BindBlendMode(const sBlendMode& blendMode)
+    {
+        boolean changed = K_FALSE;
+        for (usize i = 0; i < blendMode.factorCount; i++)
+        {
+            if (_stateCache.SetBlendFactors(i, blendMode.srcFactors[i], blendMode.dstFactors[i]) == K_TRUE)
+                changed = K_TRUE;
+        }
+        if (changed == K_FALSE)
+            return;
+
+        u32 factors = 0;
+        for (usize i = 0; i < blendMode.factorCount && i < 4; i++)
+            factors |= (((u32)blendMode.srcFactors[i] << 4) | (u32)blendMode.dstFactors[i]) << (i * 8);
+
+        Record(eCommand::BIND_BLEND_MODE, sNullResourceCommand{ (u32)blendMode.factorCount, factors });
+    }
+
+    void cNullGraphicsAPI::Viewport(const sViewport& viewport)
+    {
+        if (_stateCache.SetViewport(viewport.rect) == K_FALSE)
+            return;
+
+        sNullStateCommand payload = {};
+        payload.values[0] = viewport.rect.GetX();
+        payload.values[1] = viewport.rect.GetY();
+        payload.values[2] = viewport.rect.GetZ();
+        payload.values[3] = viewport.rect.GetW();
+        Record(eCommand::VIEWPORT, payload);
+    }
+
+    void cNullGraphicsAPI::ClearColor(const glm::vec4& color)
+    {
+        sNullStateCommand payload = {};
+        payload.values[0] = color.x;
+        payload.values[1] = color.y;
+        payload.values[2] = color.z;
+        payload.values[3] = color.w;
+        Record(eCommand::CLEAR_COLOR, payload);
+    }
+
+    void cNullGraphicsAPI::ClearDepth(f32 depth)
+    {
+        sNullStateCommand payload = {};
+        payload.values[0] = depth;
+        Record(eCommand::CLEAR_DEPTH, payload);
+    }
+
+    void cNullGraphicsAPI::ClearFramebufferColor(usize, const glm::vec4& color)
+    {
+        sNullStateCommand payload = {};
+        payload.values[0] = color.x;
+        payload.values[1] = color.y;
+        payload.values[2] = color.z;
+        payload.values[3] = color.w;
+        Record(eCommand::CLEAR_COLOR, payload);
+    }
+
+    void cNullGraphicsAPI::ClearFramebufferDepth(f32 depth)
+    {
+        ClearDepth(depth);
+    }
+
+    void cNullGraphicsAPI::Draw(usize indexCount, usize vertexOffset, usize indexOffset, usize instanceCount)
+    {
+        sNullDrawCommand payload = {};
+        payload.indexCount = indexCount;
+        payload.vertexOffset = vertexOffset;
+        payload.indexOffset = indexOffset;
+        payload.instanceCount = instanceCount;
+        Record(eCommand::DRAW, payload);
+
+        _stats.drawCount += 1;
+        _stats.indexCount += indexCount * instanceCount;
+        _stats.instanceCount += instanceCount;
+    }
+
+    void cNullGraphicsAPI::DrawQuad()
+    {
+        DrawQuads(1);
+    }
+
+    void cNullGraphicsAPI::DrawQuads(usize count)
+    {
+        sNullDrawCommand payload = {};
+        payload.indexCount = 6;
+        payload.instanceCount = count;
+        Record(eCommand::DRAW_QUADS, payload);
+
+        _stats.drawCount += 1;
+        _stats.indexCount += 6 * count;
+        _stats.instanceCount += count;
+    }
+
+    void cNullGraphicsAPI::DrawIndirect(const cBuffer* commandBuffer, usize offset, usize drawCount)
+    {
+        if (offset + drawCount * sizeof(sDrawIndirectCommand) > commandBuffer->_byteSize)
+        {
+            Print("Error: indirect draw reads past the command buffer!");
+
+            return;
+        }
+
+        sNullBufferCommand payload = {};
+        payload.instance = commandBuffer->_instance;
+        payload.type = (u32)commandBuffer->_type;
+        payload.offset = offset;
+        payload.byteSize = drawCount * sizeof(sDrawIndirectCommand);
+        Record(eCommand::DRAW_INDIRECT, payload);
+
+        // Persistent command buffers are written through their mapping, never through WriteBuffer
+        const u8* data = (const u8*)commandBuffer->_mappedData;
+        if (data == nullptr)
+        {
+            const auto contents = _indirectBuffers.find(commandBuffer->_instance);
+            if (contents == _indirectBuffers.end())
+                return;
+            data = contents->second.data();
+        }
+
+        const sDrawIndirectCommand* commands = (const sDrawIndirectCommand*)(data + offset);
+        for (usize i = 0; i < drawCount; i++)
+        {
+            _stats.drawCount += 1;
+            _stats.indexCount += (usize)commands[i].indexCount * commands[i].instanceCount;
+            _stats.instanceCount += commands[i].instanceCount;
+        }
+    }
+
+    u64 cNullGraphicsAPI::CreateFence()
+    {
+        const u64 fence = ++_fenceCounter;
+        Record(eCommand::CREATE_FENCE, fence);
+
+        return fence;
+    }
+
+    boolean cNullGraphicsAPI::WaitFence(u64 fence, u64)
+    {
+        // Nothing runs asynchronously here, every fence is signaled as soon as it exists
+        Record(eCommand::WAIT_FENCE, fence);
+
+        return K_TRUE;
+    }
+
+    void cNullGraphicsAPI::DestroyFence(u64 fence)
+    {
+        Record(eCommand::DESTROY_FENCE, fence);
+    }
+
+    void cNullGraphicsAPI::ResetCommands()
+    {
+        _commands.clear();
+        _stats = {};
+        _stateCache.ResetStats();
+    }
+
+    template <typename T>
+    void cNullGraphicsAPI::Record(eCommand command, const T& payload)
+    {
+        static_assert(sizeof(T) <= 0xFFFF, "Command payload is too large");
+
+        sCommandHeader header = {};
+        header.command = command;
+        header.byteSize = sizeof(T);
+
+        const usize position = _commands.size();
+        _commands.resize(position + sizeof(sCommandHeader) + sizeof(T));
+        std::memcpy(&_commands[position], &header, sizeof(sCommandHeader));
+        std::memcpy(&_commands[position + sizeof(sCommandHeader)], &payload, sizeof(T));
+
+        _stats.callCounts[(usize)command] += 1;
+        _stats.commandCount += 1;
+    }
+
+    void cNullGraphicsAPI::Record(eCommand command)
+    {
+        sCommandHeader header = {};
+        header.command = command;
+
+        const usize position = _commands.size();
+        _commands.resize(position + sizeof(sCommandHeader));
+        std::memcpy(&_commands[position], &header, sizeof(sCommandHeader));
+
+        _stats.callCounts[(usize)command] += 1;
+        _stats.commandCount += 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+// render_graph.cpp
+
+#include <algorithm>
+#include "render_graph.hpp"
+#include "graphics.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    static usize GetTexelByteSize(cTexture::eFormat format)
+    {
+        switch (format)
+        {
+            case cTexture::eFormat::R8: return 1;
+            case cTexture::eFormat::R8F: return 1;
+            case cTexture::eFormat::RGBA8: return 4;
+            case cTexture::eFormat::RGB16F: return 6;
+            case cTexture::eFormat::RGBA16F: return 8;
+            case cTexture::eFormat::DEPTH_STENCIL: return 4;
+            case cTexture::eFormat::RGBA8_MIPS: return 4;
+            default: return 0;
+        }
+    }
+
+    cRenderGraph::cRenderGraph(cContext* context, iGraphicsAPI* gfx, const glm::vec2& size) : iObject(context), _gfx(gfx), _size(size)
+    {
+    }
+
+    cRenderGraph::~cRenderGraph()
+    {
+        ReleaseTextures();
+
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+        for (auto& pass : _passes)
+        {
+            _gfx->DestroyRenderPass(pass.renderPass->GetRenderPassGPU());
+            _context->Destroy<cRenderPass>(pass.renderPass);
+            pass.renderPassDesc->~sRenderPassDescriptor();
+            memoryAllocator->Deallocate(pass.renderPassDesc);
+        }
+    }
+
+    u32 cRenderGraph::CreateTexture(const sRenderGraphTextureDescriptor& desc)
+    {
+        sTexture texture = {};
+        texture.desc = desc;
+        _textures.emplace_back(texture);
+        _dirty = K_TRUE;
+
+        return (u32)_textures.size() - 1;
+    }
+
+    u32 cRenderGraph::AddPass(const sRenderGraphPassDescriptor& desc)
+    {
+        if (desc.inputTextures.size() != desc.inputTextureNames.size())
+        {
+            Print("Error: mismatch of render graph pass input texture array and input texture name array!");
+            return kRenderGraphInvalidHandle;
+        }
+
+        const f32 outputScale = desc.colorOutputs.empty() == false ? _textures[desc.colorOutputs[0]].desc.scale :
+            (desc.depthOutput != kRenderGraphInvalidHandle ? _textures[desc.depthOutput].desc.scale : 1.0f);
+        boolean sameScale = desc.depthOutput == kRenderGraphInvalidHandle || _textures[desc.depthOutput].desc.scale == outputScale;
+        for (auto output : desc.colorOutputs)
+            sameScale = _textures[output].desc.scale == outputScale ? sameScale : K_FALSE;
+        if (sameScale == K_FALSE)
+        {
+            Print("Error: render graph pass outputs have different scales!");
+            return kRenderGraphInvalidHandle;
+        }
+
+        const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+        cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+        sPass pass = {};
+        pass.desc = desc;
+        pass.renderPassDesc = (sRenderPassDescriptor*)memoryAllocator->Allocate(sizeof(sRenderPassDescriptor), caps->memoryAlignment);
+        new (pass.renderPassDesc) sRenderPassDescriptor(desc.renderPass);
+        pass.renderPassDesc->renderTarget = nullptr;
+
+        // Graph textures go after the ones of the descriptor, they are assigned on every Compile
+        pass.firstInputTexture = pass.renderPassDesc->inputTextures.size();
+        for (usize i = 0; i < desc.inputTextures.size(); i++)
+        {
+            pass.renderPassDesc->inputTextures.emplace_back(nullptr);
+            pass.renderPassDesc->inputTextureNames.emplace_back(desc.inputTextureNames[i]);
+        }
+
+        cRenderPassGPU* renderPassGPU = _gfx->CreateRenderPass(pass.renderPassDesc);
+        pass.renderPass = _context->Create<cRenderPass>(_context, pass.renderPassDesc, renderPassGPU);
+        _passes.emplace_back(pass);
+        _dirty = K_TRUE;
+
+        return (u32)_passes.size() - 1;
+    }
+
+    void cRenderGraph::Resize(const glm::vec2& size)
+    {
+        if (size == _size)
+            return;
+
+        _size = size;
+        _dirty = K_TRUE;
+    }
+
+    void cRenderGraph::Compile()
+    {
+        if (_dirty == K_FALSE)
+            return;
+
+        ReleaseTextures();
+        CullPasses();
+        AllocateTextures();
+
+        for (auto& pass : _passes)
+        {
+            if (pass.desc.colorOutputs.empty() == false)
+                pass.renderPass->ResizeViewport(GetTextureSize(pass.desc.colorOutputs[0]));
+            else if (pass.desc.depthOutput != kRenderGraphInvalidHandle)
+                pass.renderPass->ResizeViewport(GetTextureSize(pass.desc.depthOutput));
+            else
+                pass.renderPass->ResizeViewport(_size);
+
+            if (pass.culled == K_TRUE)
+                continue;
+
+            for (usize i = 0; i < pass.desc.inputTextures.size(); i++)
+                pass.renderPass->SetInputTexture(pass.firstInputTexture + i, GetTexture(pass.desc.inputTextures[i]));
+
+            if (pass.desc.colorOutputs.empty() && pass.desc.depthOutput == kRenderGraphInvalidHandle)
+                continue;
+
+            std::vector<cTexture*> colorAttachments;
+            for (auto output : pass.desc.colorOutputs)
+                colorAttachments.emplace_back(GetTexture(output));
+            cTexture* depthAttachment = pass.desc.depthOutput != kRenderGraphInvalidHandle ? GetTexture(pass.desc.depthOutput) : nullptr;
+
+            pass.renderTarget = _gfx->CreateRenderTarget(colorAttachments, depthAttachment);
+            pass.renderPass->GetRenderPassGPU()->SetRenderTarget(pass.renderTarget);
+        }
+
+        _dirty = K_FALSE;
+    }
+
+    void cRenderGraph::Execute()
+    {
+        Compile();
+
+        for (auto& pass : _passes)
+        {
+            if (pass.culled == K_TRUE || pass.desc.execute == nullptr)
+                continue;
+
+            _gfx->BindRenderPass(pass.renderPass);
+            pass.desc.execute(pass.renderPass);
+            _gfx->UnbindRenderPass(pass.renderPass);
+        }
+    }
+
+    glm::vec2 cRenderGraph::GetTextureSize(u32 texture) const
+    {
+        const f32 scale = _textures[texture].desc.scale;
+
+        return glm::vec2((f32)glm::max((usize)(_size.x * scale), (usize)1), (f32)glm::max((usize)(_size.y * scale), (usize)1));
+    }
+
+    void cRenderGraph::CullPasses()
+    {
+        // A pass lives when it has side effects or writes a texture a live pass after it uses
+        std::vector<boolean> needed(_textures.size(), K_FALSE);
+
+        for (usize i = _passes.size(); i-- > 0;)
+        {
+            sPass& pass = _passes[i];
+
+            boolean live = pass.desc.hasSideEffects;
+            for (auto output : pass.desc.colorOutputs)
+                live = needed[output] == K_TRUE ? K_TRUE : live;
+            if (pass.desc.depthOutput != kRenderGraphInvalidHandle && needed[pass.desc.depthOutput] == K_TRUE)
+                live = K_TRUE;
+
+            pass.culled = live == K_TRUE ? K_FALSE : K_TRUE;
+            if (live == K_FALSE)
+                continue;
+
+            for (auto input : pass.desc.inputTextures)
+                needed[input] = K_TRUE;
+            for (auto output : pass.desc.colorOutputs)
+                needed[output] = K_TRUE;
+            if (pass.desc.depthOutput != kRenderGraphInvalidHandle)
+                needed[pass.desc.depthOutput] = K_TRUE;
+        }
+    }
+
+    void cRenderGraph::AllocateTextures()
+    {
+        for (auto& texture : _textures)
+        {
+            texture.used = K_FALSE;
+            texture.physical = kRenderGraphInvalidHandle;
+        }
+
+        for (usize i = 0; i < _passes.size(); i++)
+        {
+            const sPass& pass = _passes[i];
+            if (pass.culled == K_TRUE)
+                continue;
+
+            auto use = [this, i](u32 handle) {
+                sTexture& texture = _textures[handle];
+                if (texture.used == K_FALSE)
+                    texture.firstPass = i;
+                texture.lastPass = i;
+                texture.used = K_TRUE;
+            };
+
+            for (auto input : pass.desc.inputTextures)
+                use(input);
+            for (auto output : pass.desc.colorOutputs)
+                use(output);
+            if (pass.desc.depthOutput != kRenderGraphInvalidHandle)
+                use(pass.desc.depthOutput);
+        }
+
+        // Handles are visited by first use so a physical texture is always reused by the earliest free candidate
+        std::vector<u32> order;
+        for (u32 i = 0; i < (u32)_textures.size(); i++)
+        {
+            if (_textures[i].used == K_TRUE)
+                order.emplace_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [this](u32 a, u32 b) { return _textures[a].firstPass < _textures[b].firstPass; });
+
+        for (auto handle : order)
+        {
+            sTexture& texture = _textures[handle];
+            const glm::vec2 size = GetTextureSize(handle);
+            const usize width = (usize)size.x;
+            const usize height = (usize)size.y;
+
+            for (u32 i = 0; i < (u32)_physicalTextures.size(); i++)
+            {
+                sPhysicalTexture& physical = _physicalTextures[i];
+                if (physical.format == texture.desc.format && physical.width == width && physical.height == height && physical.lastPass < texture.firstPass)
+                {
+                    texture.physical = i;
+                    physical.lastPass = texture.lastPass;
+                    break;
+                }
+            }
+
+            if (texture.physical != kRenderGraphInvalidHandle)
+                continue;
+
+            sPhysicalTexture physical = {};
+            physical.texture = _gfx->CreateTexture(width, height, 0, cTexture::eDimension::TEXTURE_2D, texture.desc.format, nullptr);
+            physical.format = texture.desc.format;
+            physical.width = width;
+            physical.height = height;
+            physical.lastPass = texture.lastPass;
+            _physicalTextures.emplace_back(physical);
+            _physicalByteSize += width * height * GetTexelByteSize(texture.desc.format);
+
+            texture.physical = (u32)_physicalTextures.size() - 1;
+        }
+    }
+
+    void cRenderGraph::ReleaseTextures()
+    {
+        for (auto& pass : _passes)
+        {
+            if (pass.renderTarget == nullptr)
+                continue;
+
+            pass.renderPass->GetRenderPassGPU()->SetRenderTarget(nullptr);
+            _gfx->DestroyRenderTarget(pass.renderTarget);
+            pass.renderTarget = nullptr;
+        }
+
+        for (auto& physical : _physicalTextures)
+            _gfx->DestroyTexture(physical.texture);
+
+        _physicalTextures.clear();
+        _physicalByteSize = 0;
+
+        for (auto& texture : _textures)
+            texture.physical = kRenderGraphInvalidHandle;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+// render_graph.hpp
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "object.hpp"
+#include "render_context.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    class cRenderPass;
+
+    static constexpr types::u32 kRenderGraphInvalidHandle = 0xFFFFFFFF;
+
+    // Transient texture owned by the graph, its size follows the graph size
+    struct sRenderGraphTextureDescriptor
+    {
+        cTexture::eFormat format = cTexture::eFormat::RGBA8;
+        types::f32 scale = 1.0f;
+    };
+
+    using RenderGraphExecuteFunction = std::function<void(cRenderPass* renderPass)>;
+
+    struct sRenderGraphPassDescriptor
+    {
+        // Render target and graph textures of renderPass are filled in by the graph
+        sRenderPassDescriptor renderPass = {};
+        std::vector<types::u32> inputTextures = {};
+        std::vector<std::string> inputTextureNames = {};
+        std::vector<types::u32> colorOutputs = {};
+        types::u32 depthOutput = kRenderGraphInvalidHandle;
+        // Passes drawing to the default framebuffer are never culled
+        types::boolean hasSideEffects = types::K_FALSE;
+        // Optional, passes without it are drawn by their owner through GetRenderPass
+        RenderGraphExecuteFunction execute = nullptr;
+    };
+
+    // Passes are declared in execution order together with the graph textures they read and write. Compile walks
+    // them backwards from the passes with side effects and culls every pass whose outputs nobody reads. Textures
+    // of the remaining passes get a lifetime from their first to their last use, textures of the same format and
+    // size whose lifetimes do not overlap share one GPU texture. Writes keep the previous contents, so a pass
+    // blending into a texture depends on its earlier writers. Resize only records the new size, the textures and
+    // render targets are rebuilt once by the next Compile no matter how many resize events came in between. The
+    // viewport of a pass covers its outputs, all of them must have the same scale, passes without outputs get the
+    // graph size.
+    class cRenderGraph : public iObject
+    {
+        TRITON_OBJECT(cRenderGraph)
+
+    public:
+        explicit cRenderGraph(cContext* context, iGraphicsAPI* gfx, const glm::vec2& size);
+        virtual ~cRenderGraph() override final;
+
+        types::u32 CreateTexture(const sRenderGraphTextureDescriptor& desc);
+        types::u32 AddPass(const sRenderGraphPassDescriptor& desc);
+        void Resize(const glm::vec2& size);
+        // Does nothing unless passes were added or the graph was resized since the last call
+        void Compile();
+        // Compiles when needed and runs the execute functions of the passes that survived culling
+        void Execute();
+
+        inline cRenderPass* GetRenderPass(types::u32 pass) const { return _passes[pass].renderPass; }
+        inline types::boolean IsPassCulled(types::u32 pass) const { return _passes[pass].culled; }
+        inline cTexture* GetTexture(types::u32 texture) const { return _textures[texture].physical != kRenderGraphInvalidHandle ? _physicalTextures[_textures[texture].physical].texture : nullptr; }
+        inline types::usize GetPassCount() const { return _passes.size(); }
+        inline types::usize GetTextureCount() const { return _textures.size(); }
+        inline types::usize GetPhysicalTextureCount() const { return _physicalTextures.size(); }
+        inline types::usize GetPhysicalByteSize() const { return _physicalByteSize; }
+        inline const glm::vec2& GetSize() const { return _size; }
+
+    private:
+        struct sTexture
+        {
+            sRenderGraphTextureDescriptor desc = {};
+            types::usize firstPass = 0;
+            types::usize lastPass = 0;
+            types::boolean used = types::K_FALSE;
+            types::u32 physical = kRenderGraphInvalidHandle;
+        };
+
+        struct sPhysicalTexture
+        {
+            cTexture* texture = nullptr;
+            cTexture::eFormat format = cTexture::eFormat::NONE;
+            types::usize width = 0;
+            types::usize height = 0;
+            types::usize lastPass = 0;
+        };
+
+        struct sPass
+        {
+            sRenderGraphPassDescriptor desc = {};
+            sRenderPassDescriptor* renderPassDesc = nullptr;
+            cRenderPass* renderPass = nullptr;
+            types::usize firstInputTexture = 0;
+            cRenderTarget* renderTarget = nullptr;
+            types::boolean culled = types::K_FALSE;
+        };
+
+        glm::vec2 GetTextureSize(types::u32 texture) const;
+        void CullPasses();
+        void AllocateTextures();
+        void ReleaseTextures();
+
+    private:
+        iGraphicsAPI* _gfx = nullptr;
+        glm::vec2 _size = glm::vec2(0.0f);
+        types::boolean _dirty = types::K_TRUE;
+        std::vector<sTexture> _textures = {};
+        std::vector<sPhysicalTexture> _physicalTextures = {};
+        std::vector<sPass> _passes = {};
+        types::usize _physicalByteSize = 0;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,274 @@
+// shader_preprocessor.cpp
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "shader_preprocessor.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    // Directive name of a line like "  #  include", empty for lines that aren't directives
+    static std::string GetDirective(const std::string& line, usize& end)
+    {
+        usize i = line.find_first_not_of(" \t");
+        if (i == std::string::npos || line[i] != '#')
+            return "";
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string::npos)
+            return "";
+        end = line.find_first_of(" \t\"", i);
+        if (end == std::string::npos)
+            end = line.size();
+
+        return line.substr(i, end - i);
+    }
+
+    // Path of an include line relative to the including file, empty when the line isn't an include
+    static std::string GetIncludePath(const std::string& line, const std::string& includingPath)
+    {
+        usize end = 0;
+        if (GetDirective(line, end) != "include")
+            return "";
+
+        const usize open = line.find('"', end);
+        const usize close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+        if (close == std::string::npos)
+            return "";
+
+        const std::filesystem::path directory = std::filesystem::path(includingPath).parent_path();
+
+        return cShaderPreprocessor::NormalizePath((directory / line.substr(open + 1, close - open - 1)).generic_string());
+    }
+
+    // Keywords of a '#pragma keywords' line, false when the line is something else
+    static boolean GetKeywordGroup(const std::string& line, std::vector<std::string>& keywords)
+    {
+        usize end = 0;
+        if (GetDirective(line, end) != "pragma")
+            return K_FALSE;
+
+        std::istringstream stream(line.substr(end));
+        std::string word = "";
+        if (!(stream >> word) || word != "keywords")
+            return K_FALSE;
+
+        keywords.clear();
+        while (stream >> word)
+        {
+            if (std::find(keywords.begin(), keywords.end(), word) == keywords.end())
+                keywords.emplace_back(word);
+        }
+
+        return K_TRUE;
+    }
+
+    cShaderPreprocessor::cShaderPreprocessor(cContext* context) : iObject(context) {}
+
+    std::string cShaderPreprocessor::NormalizePath(const std::string& path)
+    {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+
+    std::string cShaderPreprocessor::Expand(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const std::string root = NormalizePath(path);
+        if (std::find(_roots.begin(), _roots.end(), root) == _roots.end())
+            _roots.emplace_back(root);
+
+        std::vector<std::string> stack;
+        std::vector<std::string> expanded;
+        std::string result = "";
+        if (ExpandFile(root, stack, expanded, result, nullptr) == K_FALSE)
+            return "";
+
+        return result;
+    }
+
+    std::vector<std::vector<std::string>> cShaderPreprocessor::GetKeywordGroups(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::vector<std::string> stack;
+        std::vector<std::string> expanded;
+        std::string result = "";
+        std::vector<std::vector<std::string>> keywordGroups;
+        ExpandFile(NormalizePath(path), stack, expanded, result, &keywordGroups);
+
+        return keywordGroups;
+    }
+
+    usize cShaderPreprocessor::GetVariantCount(const std::string& path)
+    {
+        usize count = 1;
+        for (const auto& group : GetKeywordGroups(path))
+            count *= group.size();
+
+        return count;
+    }
+
+    std::vector<std::string> cShaderPreprocessor::GetVariantKeywords(const std::string& path, usize variantIndex)
+    {
+        std::vector<std::string> keywords;
+        for (const auto& group : GetKeywordGroups(path))
+        {
+            const std::string& keyword = group[variantIndex % group.size()];
+            variantIndex /= group.size();
+
+            if (keyword != "_")
+                keywords.emplace_back(keyword);
+        }
+
+        return keywords;
+    }
+
+    std::vector<std::string> cShaderPreprocessor::CollectChangedFiles()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        std::vector<std::string> changedRoots;
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - _lastPoll < kPollInterval)
+            return changedRoots;
+        _lastPoll = now;
+
+        std::vector<std::string> changed;
+        for (auto& file : _files)
+        {
+            std::error_code error;
+            const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file.first, error);
+            if (error || writeTime == file.second.writeTime)
+                continue;
+
+            // Text and includes stay until the next load, the includes are still needed for the walk below
+            file.second.valid = K_FALSE;
+            changed.emplace_back(file.first);
+        }
+
+        if (changed.empty())
+            return changedRoots;
+
+        for (const auto& root : _roots)
+        {
+            std::vector<std::string> visited;
+            if (Reaches(root, changed, visited) == K_TRUE)
+                changedRoots.emplace_back(root);
+        }
+
+        return changedRoots;
+    }
+
+    const cShaderPreprocessor::sFile* cShaderPreprocessor::LoadFile(const std::string& path)
+    {
+        sFile& file = _files[path];
+        if (file.valid == K_TRUE)
+            return &file;
+
+        std::error_code error;
+        file.writeTime = std::filesystem::last_write_time(path, error);
+        file.includes.clear();
+        file.text.clear();
+
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream)
+        {
+            Print("Error: can't open shader file '" + path + "'!");
+            return nullptr;
+        }
+
+        std::ostringstream text;
+        text << stream.rdbuf();
+        file.text = text.str();
+        file.valid = K_TRUE;
+
+        std::istringstream lines(file.text);
+        std::string line = "";
+        while (std::getline(lines, line))
+        {
+            const std::string includePath = GetIncludePath(line, path);
+            if (!includePath.empty())
+                file.includes.emplace_back(includePath);
+        }
+
+        return &file;
+    }
+
+    boolean cShaderPreprocessor::ExpandFile(const std::string& path, std::vector<std::string>& stack, std::vector<std::string>& expanded, std::string& result, std::vector<std::vector<std::string>>* keywordGroups)
+    {
+        if (std::find(stack.begin(), stack.end(), path) != stack.end())
+        {
+            Print("Error: shader file '" + path + "' is part of an include cycle!");
+            return K_FALSE;
+        }
+        if (std::find(expanded.begin(), expanded.end(), path) != expanded.end())
+            return K_TRUE;
+
+        const sFile* file = LoadFile(path);
+        if (file == nullptr)
+            return K_FALSE;
+
+        stack.emplace_back(path);
+        expanded.emplace_back(path);
+
+        // The cached file may be reloaded by a nested include, work on a copy
+        const std::string text = file->text;
+        std::istringstream lines(text);
+        std::string line = "";
+        std::vector<std::string> keywords;
+        while (std::getline(lines, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            const std::string includePath = GetIncludePath(line, path);
+            if (!includePath.empty())
+            {
+                if (ExpandFile(includePath, stack, expanded, result, keywordGroups) == K_FALSE)
+                {
+                    stack.pop_back();
+                    return K_FALSE;
+                }
+            }
+            else if (GetKeywordGroup(line, keywords) == K_TRUE)
+            {
+                if (keywordGroups != nullptr && !keywords.empty())
+                    keywordGroups->emplace_back(keywords);
+            }
+            else
+            {
+                result += line;
+                result += '\n';
+            }
+        }
+
+        stack.pop_back();
+
+        return K_TRUE;
+    }
+
+    boolean cShaderPreprocessor::Reaches(const std::string& path, const std::vector<std::string>& changed, std::vector<std::string>& visited) const
+    {
+        if (std::find(visited.begin(), visited.end(), path) != visited.end())
+            return K_FALSE;
+        visited.emplace_back(path);
+
+        if (std::find(changed.begin(), changed.end(), path) != changed.end())
+            return K_TRUE;
+
+        const auto file = _files.find(path);
+        if (file == _files.end())
+            return K_FALSE;
+
+        for (const auto& include : file->second.includes)
+        {
+            if (Reaches(include, changed, visited) == K_TRUE)
+                return K_TRUE;
+        }
+
+        return K_FALSE;
+    }
+}
\ No newline at end of file
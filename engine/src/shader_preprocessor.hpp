@@ -0,0 +1,67 @@
+// shader_preprocessor.hpp
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "object.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    // Expands '#include "file"' lines in shader files, the path is relative to the including file and every
+    // file goes in once per expansion. '#pragma keywords A B C' declares a group of variant keywords, a variant
+    // defines at most one keyword of every group, '_' in a group stands for none of them. Files are cached
+    // with their write time and direct includes, which is the dependency graph hot reload walks to find the
+    // expanded files a change reaches. Expand and the keyword queries are called from the shader preparation
+    // tasks, they are thread safe.
+    class cShaderPreprocessor : public iObject
+    {
+        TRITON_OBJECT(cShaderPreprocessor)
+
+    public:
+        explicit cShaderPreprocessor(cContext* context);
+        virtual ~cShaderPreprocessor() override final = default;
+
+        // Form paths are compared in, CollectChangedFiles returns paths like this
+        static std::string NormalizePath(const std::string& path);
+
+        // Returns the file with every include expanded and keyword declarations removed, empty if it can't be read
+        std::string Expand(const std::string& path);
+        // Keyword groups of the file and its includes in declaration order
+        std::vector<std::vector<std::string>> GetKeywordGroups(const std::string& path);
+        // Product of the group sizes, variants are numbered with the first group varying fastest
+        types::usize GetVariantCount(const std::string& path);
+        // Keywords a variant defines, '_' choices are left out
+        std::vector<std::string> GetVariantKeywords(const std::string& path, types::usize variantIndex);
+        // Expanded files that include a file changed on disk since the last call, at most one check per
+        // kPollInterval. Changed files are read again on their next use.
+        std::vector<std::string> CollectChangedFiles();
+
+    private:
+        static constexpr std::chrono::milliseconds kPollInterval = std::chrono::milliseconds(250);
+
+        struct sFile
+        {
+            std::string text = "";
+            std::vector<std::string> includes = {};
+            std::filesystem::file_time_type writeTime = {};
+            types::boolean valid = types::K_FALSE;
+        };
+
+        const sFile* LoadFile(const std::string& path);
+        types::boolean ExpandFile(const std::string& path, std::vector<std::string>& stack, std::vector<std::string>& expanded, std::string& result, std::vector<std::vector<std::string>>* keywordGroups);
+        types::boolean Reaches(const std::string& path, const std::vector<std::string>& changed, std::vector<std::string>& visited) const;
+
+    private:
+        std::mutex _mutex;
+        std::unordered_map<std::string, sFile> _files = {};
+        // Files Expand was called with, hot reload reports these
+        std::vector<std::string> _roots = {};
+        std::chrono::steady_clock::time_point _lastPoll = {};
+    };
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+// simd.hpp
+
+#pragma once
+
+// x64 always has SSE2, AVX2 and FMA come from the compiler flags (/arch:AVX2 or -mavx2 -mfma) the TRITON_AVX2
+// CMake option adds
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define TRITON_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__) && (defined(_MSC_VER) || defined(__FMA__))
+#define TRITON_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(TRITON_SIMD_SSE)
+#define TRITON_SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define TRITON_SWIZZLE(vec, x, y, z, w) _mm_shuffle_ps(vec, vec, TRITON_SHUFFLE_MASK(x, y, z, w))
+#define TRITON_SHUFFLE(vec1, vec2, x, y, z, w) _mm_shuffle_ps(vec1, vec2, TRITON_SHUFFLE_MASK(x, y, z, w))
+#endif
\ No newline at end of file
@@ -0,0 +1,286 @@
+// soa.hpp
+
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "object.hpp"
+#include "context.hpp"
+#include "memory_pool.hpp"
+#include "stack.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+	// Every field lives in its own array inside a chunk, each array starts on a 64 byte boundary
+	// and the per-chunk element count is a multiple of 8, so hot loops only pull the fields they read
+	// and can run full AVX lanes over a chunk. Elements are dense: Erase moves the last element into the hole.
+	template <typename... TFields>
+	class cSoA : public iObject
+	{
+		TRITON_OBJECT(cSoA)
+
+	public:
+		static_assert(sizeof...(TFields) > 0, "cSoA needs at least one field");
+		static_assert((std::is_trivially_copyable_v<TFields> && ...), "cSoA fields must be trivially copyable");
+
+		template <types::usize Index>
+		using Field = std::tuple_element_t<Index, std::tuple<TFields...>>;
+
+		static constexpr types::usize kFieldCount = sizeof...(TFields);
+		static constexpr types::usize kFieldAlignment = 64;
+		static constexpr types::usize kElementGranularity = 8;
+
+		explicit cSoA(cContext* context, const sChunkAllocatorDescriptor& allocatorDesc);
+		virtual ~cSoA() override final;
+
+		types::u32 Push(const TFields&... values);
+		void Erase(types::u32 index);
+		void Pop();
+		void Clear();
+
+		template <types::usize Index>
+		Field<Index>& Get(types::u32 index) const;
+		template <types::usize Index>
+		Field<Index>* GetChunkData(types::u32 chunkIndex) const;
+		types::usize GetChunkElementCount(types::u32 chunkIndex) const;
+
+		// function(TFields&... fields) per element
+		template <typename TFunction>
+		void ForEach(TFunction&& function) const;
+		// function(types::usize count, TFields*... arrays) per chunk, for SIMD loops
+		template <typename TFunction>
+		void ForEachChunk(TFunction&& function) const;
+
+		inline types::usize GetSize() const { return _elementCount; }
+		inline types::usize GetChunkCount() const { return _chunkCount; }
+		inline types::usize GetElementCountPerChunk() const { return _objectCountPerChunk; }
+		inline types::usize GetCapacity() const { return _allocatorDesc.maxChunkCount * _objectCountPerChunk; }
+
+	private:
+		template <types::usize... Indices>
+		void Write(types::u8* chunk, types::u32 localPosition, std::index_sequence<Indices...>, const TFields&... values);
+		template <types::usize... Indices>
+		void Move(types::u8* dstChunk, types::u32 dstPosition, types::u8* srcChunk, types::u32 srcPosition, std::index_sequence<Indices...>);
+		template <typename TFunction, types::usize... Indices>
+		void VisitChunk(types::u8* chunk, types::usize count, TFunction& function, std::index_sequence<Indices...>) const;
+		template <typename TFunction, types::usize... Indices>
+		void VisitElements(types::u8* chunk, types::usize count, TFunction& function, std::index_sequence<Indices...>) const;
+		types::u32 AllocateChunk();
+		void DeallocateChunk(types::u32 chunkIndex);
+
+		template <types::usize Index>
+		inline Field<Index>* FieldArray(types::u8* chunk) const { return (Field<Index>*)(chunk + _fieldOffsets[Index]); }
+
+	private:
+		sChunkAllocatorDescriptor _allocatorDesc = {};
+		types::usize _fieldOffsets[kFieldCount] = {};
+		types::usize _chunkByteSize = 0;
+		types::usize _objectCountPerChunk = 0;
+		types::usize _chunkCount = 0;
+		types::usize _elementCount = 0;
+		types::u8** _chunks = nullptr;
+	};
+
+	template <typename... TFields>
+	cSoA<TFields...>::cSoA(cContext* context, const sChunkAllocatorDescriptor& allocatorDesc) : iObject(context)
+	{
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		_allocatorDesc = allocatorDesc;
+
+		const types::usize fieldSizes[kFieldCount] = { sizeof(TFields)... };
+		types::usize elementByteSize = 0;
+		for (types::usize i = 0; i < kFieldCount; i++)
+			elementByteSize += fieldSizes[i];
+
+		const types::usize paddingByteSize = kFieldCount * kFieldAlignment;
+		if (_allocatorDesc.chunkByteSize > paddingByteSize)
+			_objectCountPerChunk = (_allocatorDesc.chunkByteSize - paddingByteSize) / elementByteSize;
+		_objectCountPerChunk &= ~(kElementGranularity - 1);
+		if (_objectCountPerChunk == 0)
+			_objectCountPerChunk = kElementGranularity;
+
+		types::usize offset = 0;
+		for (types::usize i = 0; i < kFieldCount; i++)
+		{
+			_fieldOffsets[i] = offset;
+			offset += (fieldSizes[i] * _objectCountPerChunk + kFieldAlignment - 1) & ~(kFieldAlignment - 1);
+		}
+		_chunkByteSize = offset;
+
+		_chunks = (types::u8**)memoryAllocator->Allocate(_allocatorDesc.maxChunkCount * sizeof(types::u8*), caps->memoryAlignment);
+	}
+
+	template <typename... TFields>
+	cSoA<TFields...>::~cSoA()
+	{
+		Clear();
+
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		memoryAllocator->Deallocate(_chunks);
+	}
+
+	template <typename... TFields>
+	types::u32 cSoA<TFields...>::Push(const TFields&... values)
+	{
+		const types::u32 index = _elementCount;
+		const types::u32 chunkIndex = index / _objectCountPerChunk;
+		const types::u32 localPosition = index - chunkIndex * _objectCountPerChunk;
+
+		if (chunkIndex >= _chunkCount && AllocateChunk() != chunkIndex)
+		{
+			Print("Error: can't allocate SoA chunk, chunk limit reached!");
+
+			return 0xFFFFFFFF;
+		}
+
+		Write(_chunks[chunkIndex], localPosition, std::index_sequence_for<TFields...>{}, values...);
+		_elementCount += 1;
+
+		return index;
+	}
+
+	template <typename... TFields>
+	void cSoA<TFields...>::Erase(types::u32 index)
+	{
+		if (index >= _elementCount)
+			return;
+
+		const types::u32 lastIndex = _elementCount - 1;
+		const types::u32 lastChunkIndex = lastIndex / _objectCountPerChunk;
+		const types::u32 lastLocalPosition = lastIndex - lastChunkIndex * _objectCountPerChunk;
+
+		if (index != lastIndex)
+		{
+			const types::u32 chunkIndex = index / _objectCountPerChunk;
+			const types::u32 localPosition = index - chunkIndex * _objectCountPerChunk;
+			Move(_chunks[chunkIndex], localPosition, _chunks[lastChunkIndex], lastLocalPosition, std::index_sequence_for<TFields...>{});
+		}
+		_elementCount -= 1;
+
+		if (lastLocalPosition == 0)
+			DeallocateChunk(lastChunkIndex);
+	}
+
+	template <typename... TFields>
+	void cSoA<TFields...>::Pop()
+	{
+		if (_elementCount > 0)
+			Erase(_elementCount - 1);
+	}
+
+	template <typename... TFields>
+	void cSoA<TFields...>::Clear()
+	{
+		while (_chunkCount > 0)
+			DeallocateChunk(_chunkCount - 1);
+		_elementCount = 0;
+	}
+
+	template <typename... TFields>
+	template <types::usize Index>
+	typename cSoA<TFields...>::template Field<Index>& cSoA<TFields...>::Get(types::u32 index) const
+	{
+		const types::u32 chunkIndex = index / _objectCountPerChunk;
+		const types::u32 localPosition = index - chunkIndex * _objectCountPerChunk;
+
+		return FieldArray<Index>(_chunks[chunkIndex])[localPosition];
+	}
+
+	template <typename... TFields>
+	template <types::usize Index>
+	typename cSoA<TFields...>::template Field<Index>* cSoA<TFields...>::GetChunkData(types::u32 chunkIndex) const
+	{
+		if (chunkIndex >= _chunkCount)
+			return nullptr;
+
+		return FieldArray<Index>(_chunks[chunkIndex]);
+	}
+
+	template <typename... TFields>
+	types::usize cSoA<TFields...>::GetChunkElementCount(types::u32 chunkIndex) const
+	{
+		if (chunkIndex >= _chunkCount)
+			return 0;
+		if (chunkIndex + 1 < _chunkCount)
+			return _objectCountPerChunk;
+
+		return _elementCount - chunkIndex * _objectCountPerChunk;
+	}
+
+	template <typename... TFields>
+	template <typename TFunction>
+	void cSoA<TFields...>::ForEach(TFunction&& function) const
+	{
+		for (types::u32 i = 0; i < _chunkCount; i++)
+			VisitElements(_chunks[i], GetChunkElementCount(i), function, std::index_sequence_for<TFields...>{});
+	}
+
+	template <typename... TFields>
+	template <typename TFunction>
+	void cSoA<TFields...>::ForEachChunk(TFunction&& function) const
+	{
+		for (types::u32 i = 0; i < _chunkCount; i++)
+			VisitChunk(_chunks[i], GetChunkElementCount(i), function, std::index_sequence_for<TFields...>{});
+	}
+
+	template <typename... TFields>
+	template <types::usize... Indices>
+	void cSoA<TFields...>::Write(types::u8* chunk, types::u32 localPosition, std::index_sequence<Indices...>, const TFields&... values)
+	{
+		((FieldArray<Indices>(chunk)[localPosition] = values), ...);
+	}
+
+	template <typename... TFields>
+	template <types::usize... Indices>
+	void cSoA<TFields...>::Move(types::u8* dstChunk, types::u32 dstPosition, types::u8* srcChunk, types::u32 srcPosition, std::index_sequence<Indices...>)
+	{
+		(std::memcpy(&FieldArray<Indices>(dstChunk)[dstPosition], &FieldArray<Indices>(srcChunk)[srcPosition], sizeof(Field<Indices>)), ...);
+	}
+
+	template <typename... TFields>
+	template <typename TFunction, types::usize... Indices>
+	void cSoA<TFields...>::VisitChunk(types::u8* chunk, types::usize count, TFunction& function, std::index_sequence<Indices...>) const
+	{
+		function(count, FieldArray<Indices>(chunk)...);
+	}
+
+	template <typename... TFields>
+	template <typename TFunction, types::usize... Indices>
+	void cSoA<TFields...>::VisitElements(types::u8* chunk, types::usize count, TFunction& function, std::index_sequence<Indices...>) const
+	{
+		for (types::usize i = 0; i < count; i++)
+			function(FieldArray<Indices>(chunk)[i]...);
+	}
+
+	template <typename... TFields>
+	types::u32 cSoA<TFields...>::AllocateChunk()
+	{
+		if (_chunkCount >= _allocatorDesc.maxChunkCount)
+			return 0xFFFFFFFF;
+
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		const types::usize alignment = caps->memoryAlignment > kFieldAlignment ? caps->memoryAlignment : kFieldAlignment;
+		_chunks[_chunkCount] = (types::u8*)memoryAllocator->Allocate(_chunkByteSize, alignment);
+		assert(((types::usize)_chunks[_chunkCount] & (kFieldAlignment - 1)) == 0);
+
+		return _chunkCount++;
+	}
+
+	template <typename... TFields>
+	void cSoA<TFields...>::DeallocateChunk(types::u32 chunkIndex)
+	{
+		if (chunkIndex + 1 != _chunkCount)
+			return;
+
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+		memoryAllocator->Deallocate(_chunks[chunkIndex]);
+		_chunkCount -= 1;
+	}
+}
\ No newline at end of file
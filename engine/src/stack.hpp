@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <cstring>
+#include <new>
 #include <type_traits>
 #include "object.hpp"
 #include "context.hpp"
@@ -27,8 +29,12 @@ namespace triton
 		static_assert(std::is_base_of_v<cStackValue, TValue>, "TValue must inherit from cStackValue");
 
 		explicit cStack(cContext* context, const sChunkAllocatorDescriptor& allocatorDesc);
+		cStack(cStack&& rhs) noexcept;
+		cStack(const cStack& rhs) = delete;
 		virtual ~cStack() override final;
 
+		cStack& operator=(const cStack& rhs) = delete;
+
 		template<typename... Args>
 		TValue* Push(Args&&... args);
 		TValue* Push(TValue&& value);
@@ -70,14 +76,34 @@ namespace triton
 		AllocateChunk();
 	}
 
+	// Takes the chunks, the moved from stack is left empty and owns nothing
+	template <typename TValue>
+	cStack<TValue>::cStack(cStack&& rhs) noexcept : iObject(rhs._context)
+	{
+		_allocatorDesc = rhs._allocatorDesc;
+		_chunkCount = rhs._chunkCount;
+		_objectByteSize = rhs._objectByteSize;
+		_objectCountPerChunk = rhs._objectCountPerChunk;
+		_elementCount = rhs._elementCount;
+		_chunks = rhs._chunks;
+
+		rhs._chunkCount = 0;
+		rhs._elementCount = 0;
+		rhs._chunks = nullptr;
+	}
+
 	template <typename TValue>
 	cStack<TValue>::~cStack()
 	{
-		for (types::usize i = 0; i < _elementCount; i++)
+		if (_chunks == nullptr)
+			return;
+
+		while (_elementCount > 0)
 			Pop();
 
 		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
 		memoryAllocator->Deallocate(_chunks);
+		_chunks = nullptr;
 	}
 
 	template <typename TValue>
@@ -99,9 +125,7 @@ namespace triton
 	{
 		cStackValue se = New();
 
-		_chunks[se.chunk][se.localPosition] = std::move(value);
-
-		TValue* object = &_chunks[se.chunk][se.localPosition];
+		TValue* object = new (&_chunks[se.chunk][se.localPosition]) TValue(std::move(value));
 		object->chunk = se.chunk;
 		object->localPosition = se.localPosition;
 		object->globalPosition = se.globalPosition;
@@ -152,8 +176,27 @@ namespace triton
 		if (chunkIndex >= _chunkCount || (isLastChunk == types::K_TRUE && localPosition >= lastChunkObjectCount))
 			return;
 
-		_chunks[chunkIndex][localPosition].~TValue();
-		_chunks[chunkIndex][localPosition] = _chunks[lastChunkIndex][lastLocalPosition];
+		TValue* hole = &_chunks[chunkIndex][localPosition];
+		TValue* last = &_chunks[lastChunkIndex][lastLocalPosition];
+
+		hole->~TValue();
+		if (hole != last)
+		{
+			// Header-less trivially copyable values are relocated as raw bytes
+			if constexpr (std::is_trivially_copyable_v<TValue>)
+			{
+				std::memcpy((void*)hole, (const void*)last, sizeof(TValue));
+			}
+			else
+			{
+				new (hole) TValue(std::move(*last));
+				last->~TValue();
+			}
+
+			hole->chunk = chunkIndex;
+			hole->localPosition = localPosition;
+			hole->globalPosition = index;
+		}
 		_elementCount -= 1;
 
 		if (lastChunkObjectCount == 1)
@@ -78,6 +78,56 @@ namespace triton
         _cv.notify_one();
     }
 
+    void cThread::Dispatch(usize jobCount, const JobFunction& job)
+    {
+        if (jobCount == 0)
+            return;
+
+        if (_threads.empty())
+        {
+            for (usize i = 0; i < jobCount; i++)
+                job(i);
+
+            return;
+        }
+
+        // Helpers reached after Dispatch returned find no job left, the counters outlive the call for them
+        struct sDispatchState
+        {
+            std::atomic<usize> next = 0;
+            std::atomic<usize> done = 0;
+        };
+
+        std::shared_ptr<sDispatchState> state = std::make_shared<sDispatchState>();
+        const JobFunction* jobFunction = &job;
+        const auto runJobs = [state, jobFunction, jobCount]() {
+            for (usize i = state->next.fetch_add(1, std::memory_order_relaxed); i < jobCount; i = state->next.fetch_add(1, std::memory_order_relaxed))
+            {
+                (*jobFunction)(i);
+                state->done.fetch_add(1, std::memory_order_release);
+            }
+        };
+
+        const usize helperCount = jobCount - 1 < _threads.size() ? jobCount - 1 : _threads.size();
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            for (usize i = 0; i < helperCount; i++)
+            {
+                _tasks.emplace(nullptr, [runJobs](cBuffer* const data) {
+                    runJobs();
+                });
+            }
+        }
+
+        _cv.notify_all();
+
+        runJobs();
+
+        // Every job is taken, wait for the ones still running on workers
+        while (state->done.load(std::memory_order_acquire) != jobCount)
+            std::this_thread::yield();
+    }
+
     void cThread::Stop()
     {
         std::unique_lock<std::mutex> lock(_mtx);
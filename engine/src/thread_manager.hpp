@@ -6,6 +6,7 @@
 #include <queue>
 #include <functional>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
 #include <atomic>
 #include "object.hpp"
@@ -17,6 +18,7 @@ namespace triton
     class cBuffer;
 
     using TaskFunction = std::function<void(cBuffer* const data)>;
+    using JobFunction = std::function<void(types::usize jobIndex)>;
 
     class cTask
     {
@@ -43,10 +45,16 @@ namespace triton
         ~cThread();
         
         void Submit(cTask& task);
+        // Runs job(0..jobCount-1) on the workers and the calling thread, returns once every job finished.
+        // The caller takes jobs from a shared counter too, so it never waits behind unrelated tasks and
+        // runs everything itself when the workers are busy or paused.
+        void Dispatch(types::usize jobCount, const JobFunction& job);
         void Pause();
         void Resume();
         void Stop();
 
+        inline types::usize GetThreadCount() const { return _threads.size(); }
+
     private:
         std::vector<std::thread> _threads = {};
         std::queue<cTask> _tasks = {};
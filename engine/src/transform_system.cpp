@@ -0,0 +1,503 @@
+// transform_system.cpp
+
+#include <cstring>
+#include <xmmintrin.h>
+#include "transform_system.hpp"
+#include "simd.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+	// Scaled rotation and translation columns of up to 4 nodes at once. Quaternions, positions and scales are
+	// transposed so every register holds one component of the 4 nodes, the columns are transposed back on store.
+	static inline void ComposeLocals(const glm::vec4* positions, const glm::quat* rotations, const glm::vec4* scales, const u32* nodes, usize count, glm::mat4* locals)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+
+		// A short group repeats its last node instead of reading past the list
+		u32 lanes[4];
+		for (usize j = 0; j < 4; j++)
+			lanes[j] = nodes[j < count ? j : count - 1];
+
+		__m128 r0 = _mm_load_ps((const f32*)&rotations[lanes[0]]);
+		__m128 r1 = _mm_load_ps((const f32*)&rotations[lanes[1]]);
+		__m128 r2 = _mm_load_ps((const f32*)&rotations[lanes[2]]);
+		__m128 r3 = _mm_load_ps((const f32*)&rotations[lanes[3]]);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+#if defined(GLM_FORCE_QUAT_DATA_XYZW)
+		const __m128 x = r0, y = r1, z = r2, w = r3;
+#else
+		const __m128 w = r0, x = r1, y = r2, z = r3;
+#endif
+
+		__m128 px = _mm_load_ps(&positions[lanes[0]].x);
+		__m128 py = _mm_load_ps(&positions[lanes[1]].x);
+		__m128 pz = _mm_load_ps(&positions[lanes[2]].x);
+		__m128 pw = _mm_load_ps(&positions[lanes[3]].x);
+		_MM_TRANSPOSE4_PS(px, py, pz, pw);
+
+		__m128 sx = _mm_load_ps(&scales[lanes[0]].x);
+		__m128 sy = _mm_load_ps(&scales[lanes[1]].x);
+		__m128 sz = _mm_load_ps(&scales[lanes[2]].x);
+		__m128 sw = _mm_load_ps(&scales[lanes[3]].x);
+		_MM_TRANSPOSE4_PS(sx, sy, sz, sw);
+
+		const __m128 xx = _mm_mul_ps(x, x);
+		const __m128 yy = _mm_mul_ps(y, y);
+		const __m128 zz = _mm_mul_ps(z, z);
+		const __m128 xy = _mm_mul_ps(x, y);
+		const __m128 xz = _mm_mul_ps(x, z);
+		const __m128 yz = _mm_mul_ps(y, z);
+		const __m128 wx = _mm_mul_ps(w, x);
+		const __m128 wy = _mm_mul_ps(w, y);
+		const __m128 wz = _mm_mul_ps(w, z);
+
+		__m128 columns[4][4] = {
+			{
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+				zero
+			},
+			{
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+				zero
+			},
+			{
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+				zero
+			},
+			{ px, py, pz, one }
+		};
+
+		for (usize c = 0; c < 4; c++)
+		{
+			_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (usize j = 0; j < count; j++)
+				_mm_store_ps(&locals[j][c][0], columns[c][j]);
+		}
+	}
+
+	cTransformHierarchy::cTransformHierarchy(cContext* context) : iObject(context)
+	{
+		const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		_maxNodeCount = caps->maxTransformCount;
+		_positions = (glm::vec4*)memoryAllocator->Allocate(_maxNodeCount * sizeof(glm::vec4), caps->memoryAlignment);
+		_rotations = (glm::quat*)memoryAllocator->Allocate(_maxNodeCount * sizeof(glm::quat), caps->memoryAlignment);
+		_scales = (glm::vec4*)memoryAllocator->Allocate(_maxNodeCount * sizeof(glm::vec4), caps->memoryAlignment);
+		_worlds = (glm::mat4*)memoryAllocator->Allocate(_maxNodeCount * sizeof(glm::mat4), caps->memoryAlignment);
+		_parents = (u32*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u32), caps->memoryAlignment);
+		_depths = (u32*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u32), caps->memoryAlignment);
+		_dirty = (u8*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u8), caps->memoryAlignment);
+		_denseToHandle = (u32*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u32), caps->memoryAlignment);
+		_handleToDense = (u32*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u32), caps->memoryAlignment);
+		_generations = (u32*)memoryAllocator->Allocate(_maxNodeCount * sizeof(u32), caps->memoryAlignment);
+		_scratch = (u8*)memoryAllocator->Allocate(_maxNodeCount * (sizeof(glm::mat4) + sizeof(u32) * 2), caps->memoryAlignment);
+
+		for (usize i = 0; i < _maxNodeCount; i++)
+			_generations[i] = 1;
+	}
+
+	cTransformHierarchy::~cTransformHierarchy()
+	{
+		cMemoryAllocator* memoryAllocator = _context->GetMemoryAllocator();
+
+		memoryAllocator->Deallocate(_scratch);
+		memoryAllocator->Deallocate(_generations);
+		memoryAllocator->Deallocate(_handleToDense);
+		memoryAllocator->Deallocate(_denseToHandle);
+		memoryAllocator->Deallocate(_dirty);
+		memoryAllocator->Deallocate(_depths);
+		memoryAllocator->Deallocate(_parents);
+		memoryAllocator->Deallocate(_worlds);
+		memoryAllocator->Deallocate(_scales);
+		memoryAllocator->Deallocate(_rotations);
+		memoryAllocator->Deallocate(_positions);
+	}
+
+	cTransformHandle cTransformHierarchy::Create(const cTransformHandle& parent)
+	{
+		if (_nodeCount >= _maxNodeCount)
+		{
+			Print("Error: can't create transform, node limit reached!");
+
+			return cTransformHandle();
+		}
+
+		u32 parentIndex = kInvalidIndex;
+		if (parent.IsValid())
+		{
+			parentIndex = Resolve(parent);
+			if (parentIndex == kInvalidIndex)
+			{
+				Print("Error: can't create transform, parent is not valid!");
+
+				return cTransformHandle();
+			}
+		}
+
+		u32 slot = 0;
+		if (_freeHandleHead != kInvalidIndex)
+		{
+			slot = _freeHandleHead;
+			_freeHandleHead = _handleToDense[slot];
+		}
+		else
+		{
+			slot = _handleCount++;
+		}
+
+		const u32 dense = _nodeCount++;
+		_positions[dense] = glm::vec4(0.0f);
+		_rotations[dense] = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		_scales[dense] = glm::vec4(1.0f);
+		_worlds[dense] = glm::mat4(1.0f);
+		_parents[dense] = parentIndex;
+		_depths[dense] = parentIndex == kInvalidIndex ? 0 : _depths[parentIndex] + 1;
+		_dirty[dense] = 1;
+		_denseToHandle[dense] = slot;
+		_handleToDense[slot] = dense;
+
+		cTransformHandle handle;
+		handle.idx = slot;
+		handle.generation = _generations[slot];
+
+		return handle;
+	}
+
+	void cTransformHierarchy::Destroy(const cTransformHandle& node)
+	{
+		if (Resolve(node) == kInvalidIndex)
+			return;
+
+		if (_orderDirty == K_TRUE)
+			SortByDepth();
+
+		// Descendants always follow their parent, so one forward pass marks the whole subtree
+		const u32 root = Resolve(node);
+		u32* remap = (u32*)(_scratch + _maxNodeCount * sizeof(glm::mat4));
+		for (u32 i = 0; i < _nodeCount; i++)
+		{
+			if (i == root || (i > root && _parents[i] != kInvalidIndex && remap[_parents[i]] == kInvalidIndex))
+				remap[i] = kInvalidIndex;
+			else
+				remap[i] = 0;
+		}
+
+		u32 write = 0;
+		for (u32 i = 0; i < _nodeCount; i++)
+		{
+			if (remap[i] == kInvalidIndex)
+			{
+				const u32 slot = _denseToHandle[i];
+				_generations[slot] += 1;
+				if (_generations[slot] == 0)
+					_generations[slot] = 1;
+				_handleToDense[slot] = _freeHandleHead;
+				_freeHandleHead = slot;
+
+				continue;
+			}
+
+			const u32 parentIndex = _parents[i];
+			remap[i] = write;
+			if (write != i)
+			{
+				_positions[write] = _positions[i];
+				_rotations[write] = _rotations[i];
+				_scales[write] = _scales[i];
+				_worlds[write] = _worlds[i];
+				_depths[write] = _depths[i];
+				_dirty[write] = _dirty[i];
+				_denseToHandle[write] = _denseToHandle[i];
+				_handleToDense[_denseToHandle[write]] = write;
+			}
+			_parents[write] = parentIndex == kInvalidIndex ? kInvalidIndex : remap[parentIndex];
+			write += 1;
+		}
+		_nodeCount = write;
+	}
+
+	void cTransformHierarchy::SetParent(const cTransformHandle& node, const cTransformHandle& parent)
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return;
+
+		u32 parentIndex = kInvalidIndex;
+		if (parent.IsValid())
+		{
+			parentIndex = Resolve(parent);
+			if (parentIndex == kInvalidIndex)
+				return;
+
+			for (u32 i = parentIndex; i != kInvalidIndex; i = _parents[i])
+			{
+				if (i == nodeIndex)
+				{
+					Print("Error: can't parent transform to its own descendant!");
+
+					return;
+				}
+			}
+		}
+
+		_parents[nodeIndex] = parentIndex;
+		_dirty[nodeIndex] = 1;
+		_orderDirty = K_TRUE;
+	}
+
+	void cTransformHierarchy::SetPosition(const cTransformHandle& node, const cVector3& position)
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return;
+
+		_positions[nodeIndex] = glm::vec4(position.GetX(), position.GetY(), position.GetZ(), 0.0f);
+		_dirty[nodeIndex] = 1;
+	}
+
+	void cTransformHierarchy::SetRotation(const cTransformHandle& node, const cQuaternion& rotation)
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return;
+
+		_rotations[nodeIndex] = glm::quat(rotation.GetW(), rotation.GetX(), rotation.GetY(), rotation.GetZ());
+		_dirty[nodeIndex] = 1;
+	}
+
+	void cTransformHierarchy::SetScale(const cTransformHandle& node, const cVector3& scale)
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return;
+
+		_scales[nodeIndex] = glm::vec4(scale.GetX(), scale.GetY(), scale.GetZ(), 0.0f);
+		_dirty[nodeIndex] = 1;
+	}
+
+	cVector3 cTransformHierarchy::GetPosition(const cTransformHandle& node) const
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return cVector3(0.0f);
+
+		return cVector3(glm::vec3(_positions[nodeIndex]));
+	}
+
+	cQuaternion cTransformHierarchy::GetRotation(const cTransformHandle& node) const
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return cQuaternion(1.0f, 0.0f, 0.0f, 0.0f);
+
+		return cQuaternion(_rotations[nodeIndex]);
+	}
+
+	cVector3 cTransformHierarchy::GetScale(const cTransformHandle& node) const
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return cVector3(1.0f);
+
+		return cVector3(glm::vec3(_scales[nodeIndex]));
+	}
+
+	cMatrix4 cTransformHierarchy::GetWorld(const cTransformHandle& node) const
+	{
+		const glm::mat4* world = GetWorldMatrix(node);
+		if (world == nullptr)
+			return cMatrix4(1.0f);
+
+		return cMatrix4(*world);
+	}
+
+	const glm::mat4* cTransformHierarchy::GetWorldMatrix(const cTransformHandle& node) const
+	{
+		const u32 nodeIndex = Resolve(node);
+		if (nodeIndex == kInvalidIndex)
+			return nullptr;
+
+		return &_worlds[nodeIndex];
+	}
+
+	void cTransformHierarchy::Update()
+	{
+		if (_orderDirty == K_TRUE)
+			SortByDepth();
+
+		ComposeDirty();
+	}
+
+	u32 cTransformHierarchy::Resolve(const cTransformHandle& node) const
+	{
+		if (node.IsValid() == K_FALSE || node.idx >= _handleCount || _generations[node.idx] != node.generation)
+			return kInvalidIndex;
+
+		return _handleToDense[node.idx];
+	}
+
+	void cTransformHierarchy::SortByDepth()
+	{
+		u32* order = (u32*)(_scratch + _maxNodeCount * sizeof(glm::mat4));
+		u32* counts = order + _maxNodeCount;
+
+		// Reparenting may have broken the parent-first order, so depths are rebuilt by walking parent chains
+		for (u32 i = 0; i < _nodeCount; i++)
+			_depths[i] = kInvalidIndex;
+
+		u32 maxDepth = 0;
+		for (u32 i = 0; i < _nodeCount; i++)
+		{
+			if (_depths[i] != kInvalidIndex)
+				continue;
+
+			u32 chainLength = 0;
+			u32 top = i;
+			while (top != kInvalidIndex && _depths[top] == kInvalidIndex)
+			{
+				top = _parents[top];
+				chainLength += 1;
+			}
+
+			const u32 baseDepth = top == kInvalidIndex ? 0 : _depths[top] + 1;
+			u32 current = i;
+			for (u32 j = 0; j < chainLength; j++)
+			{
+				_depths[current] = baseDepth + chainLength - 1 - j;
+				current = _parents[current];
+			}
+
+			if (_depths[i] > maxDepth)
+				maxDepth = _depths[i];
+		}
+
+		// Stable counting sort by depth, counts then become the old to new index remap
+		memset(counts, 0, (maxDepth + 1) * sizeof(u32));
+		for (u32 i = 0; i < _nodeCount; i++)
+			counts[_depths[i]] += 1;
+
+		u32 offset = 0;
+		for (u32 i = 0; i <= maxDepth; i++)
+		{
+			const u32 count = counts[i];
+			counts[i] = offset;
+			offset += count;
+		}
+
+		for (u32 i = 0; i < _nodeCount; i++)
+			order[counts[_depths[i]]++] = i;
+
+		for (u32 i = 0; i < _nodeCount; i++)
+			counts[order[i]] = i;
+
+		Permute(_positions, order);
+		Permute(_rotations, order);
+		Permute(_scales, order);
+		Permute(_worlds, order);
+		Permute(_parents, order);
+		Permute(_depths, order);
+		Permute(_dirty, order);
+		Permute(_denseToHandle, order);
+
+		for (u32 i = 0; i < _nodeCount; i++)
+		{
+			if (_parents[i] != kInvalidIndex)
+				_parents[i] = counts[_parents[i]];
+			_handleToDense[_denseToHandle[i]] = i;
+		}
+
+		_orderDirty = K_FALSE;
+	}
+
+	void cTransformHierarchy::ComposeDirty()
+	{
+		u32* dirtyNodes = (u32*)(_scratch + _maxNodeCount * sizeof(glm::mat4));
+		usize dirtyCount = 0;
+		for (u32 i = 0; i < _nodeCount; i++)
+		{
+			if (_parents[i] != kInvalidIndex)
+				_dirty[i] |= _dirty[_parents[i]];
+			if (_dirty[i] != 0)
+				dirtyNodes[dirtyCount++] = i;
+		}
+
+		// Locals of a group don't depend on each other, the parent multiply goes in array order afterwards. A parent
+		// comes before its children, even inside a group, so its world matrix is already final.
+		alignas(32) glm::mat4 locals[4];
+		for (usize i = 0; i < dirtyCount; i++)
+		{
+			if (i % 4 == 0)
+				ComposeLocals(_positions, _rotations, _scales, dirtyNodes + i, dirtyCount - i < 4 ? dirtyCount - i : 4, locals);
+
+			const u32 node = dirtyNodes[i];
+			const f32* local = &locals[i % 4][0][0];
+			f32* dst = &_worlds[node][0][0];
+
+			if (_parents[node] == kInvalidIndex)
+			{
+				memcpy(dst, local, sizeof(glm::mat4));
+				continue;
+			}
+
+			const f32* parent = &_worlds[_parents[node]][0][0];
+#if defined(TRITON_SIMD_AVX2)
+			// Two columns per 256 bit register, unaligned accesses so _worlds only needs the 16 bytes SSE does
+			const __m256 parent0 = _mm256_broadcast_ps((const __m128*)(parent + 0));
+			const __m256 parent1 = _mm256_broadcast_ps((const __m128*)(parent + 4));
+			const __m256 parent2 = _mm256_broadcast_ps((const __m128*)(parent + 8));
+			const __m256 parent3 = _mm256_broadcast_ps((const __m128*)(parent + 12));
+			for (usize j = 0; j < 16; j += 8)
+			{
+				const __m256 columns = _mm256_loadu_ps(local + j);
+				__m256 result = _mm256_mul_ps(parent0, _mm256_permute_ps(columns, 0x00));
+				result = _mm256_fmadd_ps(parent1, _mm256_permute_ps(columns, 0x55), result);
+				result = _mm256_fmadd_ps(parent2, _mm256_permute_ps(columns, 0xAA), result);
+				result = _mm256_fmadd_ps(parent3, _mm256_permute_ps(columns, 0xFF), result);
+				_mm256_storeu_ps(dst + j, result);
+			}
+#else
+			const __m128 parent0 = _mm_load_ps(parent + 0);
+			const __m128 parent1 = _mm_load_ps(parent + 4);
+			const __m128 parent2 = _mm_load_ps(parent + 8);
+			const __m128 parent3 = _mm_load_ps(parent + 12);
+			for (usize j = 0; j < 16; j += 4)
+			{
+				const __m128 column = _mm_load_ps(local + j);
+				__m128 result = _mm_mul_ps(parent0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+				result = _mm_add_ps(result, _mm_mul_ps(parent1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+				result = _mm_add_ps(result, _mm_mul_ps(parent2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+				result = _mm_add_ps(result, _mm_mul_ps(parent3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+				_mm_store_ps(dst + j, result);
+			}
+#endif
+		}
+
+		memset(_dirty, 0, _nodeCount * sizeof(u8));
+	}
+
+	template <typename T>
+	void cTransformHierarchy::Permute(T* values, const u32* order)
+	{
+		T* permuted = (T*)_scratch;
+		for (u32 i = 0; i < _nodeCount; i++)
+			permuted[i] = values[order[i]];
+
+		memcpy(values, permuted, _nodeCount * sizeof(T));
+	}
+}
\ No newline at end of file
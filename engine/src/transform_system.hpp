@@ -0,0 +1,80 @@
+// transform_system.hpp
+
+#pragma once
+
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "../../thirdparty/glm/glm/gtc/quaternion.hpp"
+#include "object.hpp"
+#include "handle.hpp"
+#include "math.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+	class cTransformHierarchy;
+
+	class cTransformHandle : public cHandle
+	{
+		friend class cTransformHierarchy;
+
+	public:
+		inline index GetIndex() const { return idx; }
+		inline types::usize GetGeneration() const { return generation; }
+		inline types::boolean IsValid() const { return generation != 0; }
+	};
+
+	// Nodes live in flat arrays where every parent is stored before its children, reparenting re-sorts
+	// them by depth. Update walks the arrays once: dirty flags flow from parent to child and only dirty
+	// nodes rebuild their local TRS, 4 at a time, and multiply it by the already final parent world matrix.
+	class cTransformHierarchy : public iObject
+	{
+		TRITON_OBJECT(cTransformHierarchy)
+
+	public:
+		explicit cTransformHierarchy(cContext* context);
+		virtual ~cTransformHierarchy() override final;
+
+		cTransformHandle Create(const cTransformHandle& parent = cTransformHandle());
+		void Destroy(const cTransformHandle& node);
+		void SetParent(const cTransformHandle& node, const cTransformHandle& parent);
+		void SetPosition(const cTransformHandle& node, const cVector3& position);
+		void SetRotation(const cTransformHandle& node, const cQuaternion& rotation);
+		void SetScale(const cTransformHandle& node, const cVector3& scale);
+		cVector3 GetPosition(const cTransformHandle& node) const;
+		cQuaternion GetRotation(const cTransformHandle& node) const;
+		cVector3 GetScale(const cTransformHandle& node) const;
+		cMatrix4 GetWorld(const cTransformHandle& node) const;
+		const glm::mat4* GetWorldMatrix(const cTransformHandle& node) const;
+		void Update();
+
+		inline types::usize GetSize() const { return _nodeCount; }
+		inline const glm::mat4* GetWorldMatrices() const { return _worlds; }
+
+	private:
+		static constexpr types::u32 kInvalidIndex = 0xFFFFFFFF;
+
+		types::u32 Resolve(const cTransformHandle& node) const;
+		void SortByDepth();
+		void ComposeDirty();
+		template <typename T>
+		void Permute(T* values, const types::u32* order);
+
+	private:
+		types::usize _maxNodeCount = 0;
+		types::usize _nodeCount = 0;
+		types::boolean _orderDirty = types::K_FALSE;
+		glm::vec4* _positions = nullptr;
+		glm::quat* _rotations = nullptr;
+		glm::vec4* _scales = nullptr;
+		glm::mat4* _worlds = nullptr;
+		types::u32* _parents = nullptr;
+		types::u32* _depths = nullptr;
+		types::u8* _dirty = nullptr;
+		types::u32* _denseToHandle = nullptr;
+		types::u32* _handleToDense = nullptr;
+		types::u32* _generations = nullptr;
+		types::u32 _handleCount = 0;
+		types::u32 _freeHandleHead = kInvalidIndex;
+		types::u8* _scratch = nullptr;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+// upload_ring.cpp
+
+#include "upload_ring.hpp"
+#include "context.hpp"
+#include "engine.hpp"
+#include "application.hpp"
+#include "memory_pool.hpp"
+#include "log.hpp"
+
+using namespace types;
+
+namespace triton
+{
+    cUploadRing::cUploadRing(cContext* context, iGraphicsAPI* gfx, usize frameByteSize, cBuffer::eType type, s32 slot, usize frameCount) : iObject(context), _gfx(gfx)
+    {
+        // Ranged uniform and storage bindings need offsets aligned to the implementation limit, 256 covers all of them
+        _frameByteSize = (frameByteSize + kFrameAlignment - 1) & ~(kFrameAlignment - 1);
+        _frameCount = frameCount < 1 ? 1 : (frameCount > kMaxFrameCount ? kMaxFrameCount : frameCount);
+        _persistent = _gfx->GetPersistentBufferSupport();
+
+        if (_persistent == K_TRUE)
+        {
+            _frameIndex = _frameCount - 1;
+            _buffer = _gfx->CreatePersistentBuffer(_frameByteSize * _frameCount, type, slot);
+            if (_buffer == nullptr || _buffer->GetMappedData() == nullptr)
+                Print("Error: can't create upload ring buffer!");
+        }
+        else
+        {
+            // WriteBuffer leaves the data in flight to the driver, no regions or fences are needed
+            const sCapabilities* caps = _context->GetSubsystem<cEngine>()->GetApplication()->GetCapabilities();
+            _frameCount = 1;
+            _frameIndex = 0;
+            _buffer = _gfx->CreateBuffer(_frameByteSize, type, slot, nullptr);
+            _staging = _context->GetMemoryAllocator()->Allocate(_frameByteSize, caps->memoryAlignment);
+        }
+    }
+
+    cUploadRing::~cUploadRing()
+    {
+        for (usize i = 0; i < _frameCount; i++)
+        {
+            if (_fences[i] != 0)
+            {
+                _gfx->WaitFence(_fences[i], kFenceTimeout);
+                _gfx->DestroyFence(_fences[i]);
+            }
+        }
+
+        if (_buffer != nullptr)
+            _gfx->DestroyBuffer(_buffer);
+        if (_staging != nullptr)
+            _context->GetMemoryAllocator()->Deallocate(_staging);
+    }
+
+    void cUploadRing::BeginFrame()
+    {
+        if (_buffer == nullptr)
+            return;
+
+        // Draws reading the previous region were issued before this call, fence them now
+        if (_frameActive == K_TRUE && _persistent == K_TRUE)
+            _fences[_frameIndex] = _gfx->CreateFence();
+
+        _frameIndex = (_frameIndex + 1) % _frameCount;
+        _head = 0;
+        _frameActive = K_TRUE;
+
+        if (_fences[_frameIndex] != 0)
+        {
+            if (_gfx->WaitFence(_fences[_frameIndex], kFenceTimeout) == K_FALSE)
+                Print("Error: upload ring fence wait timed out!");
+            _gfx->DestroyFence(_fences[_frameIndex]);
+            _fences[_frameIndex] = 0;
+        }
+
+        _gfx->BindBufferRange(_buffer, GetFrameOffset(), _frameByteSize);
+    }
+
+    void* cUploadRing::Allocate(usize byteSize, usize alignment)
+    {
+        if (_buffer == nullptr)
+            return nullptr;
+
+        const usize offset = (_head + alignment - 1) & ~(alignment - 1);
+        if (offset + byteSize > _frameByteSize)
+        {
+            Print("Error: upload ring frame is full!");
+
+            return nullptr;
+        }
+
+        _head = offset + byteSize;
+
+        return (u8*)GetFrameData() + offset;
+    }
+
+    void cUploadRing::Flush(usize byteSize)
+    {
+        if (_persistent == K_TRUE || _buffer == nullptr || byteSize == 0)
+            return;
+
+        _gfx->WriteBuffer(_buffer, 0, byteSize < _frameByteSize ? byteSize : _frameByteSize, _staging);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+// upload_ring.hpp
+
+#pragma once
+
+#include "object.hpp"
+#include "render_context.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    // One persistently mapped buffer split into frameCount regions. Each frame the CPU writes straight into
+    // the mapping of its own region while the GPU still reads the previous ones, a fence per region keeps
+    // the CPU from overwriting data of a frame that has not been consumed yet. Shaders see the active region
+    // through a ranged binding, so offsets inside a frame start at 0. Backends without persistent buffers get
+    // a plain buffer with one region instead, frames are written to a staging copy and uploaded by Flush.
+    class cUploadRing : public iObject
+    {
+        TRITON_OBJECT(cUploadRing)
+
+    public:
+        explicit cUploadRing(cContext* context, iGraphicsAPI* gfx, types::usize frameByteSize, cBuffer::eType type, types::s32 slot, types::usize frameCount = 3);
+        virtual ~cUploadRing() override final;
+
+        // Fences the region of the previous frame, waits until the next region is free and binds it
+        void BeginFrame();
+        // Returns nullptr when the frame region is full
+        void* Allocate(types::usize byteSize, types::usize alignment = 16);
+        // Uploads the first byteSize bytes of the frame before it's drawn, persistently mapped rings have nothing to do
+        void Flush(types::usize byteSize);
+
+        inline cBuffer* GetBuffer() const { return _buffer; }
+        inline void* GetFrameData() const { return _buffer == nullptr ? nullptr : (_persistent == types::K_TRUE ? (types::u8*)_buffer->GetMappedData() + GetFrameOffset() : _staging); }
+        inline types::boolean IsPersistent() const { return _persistent; }
+        inline types::usize GetFrameOffset() const { return _frameIndex * _frameByteSize; }
+        inline types::usize GetFrameByteSize() const { return _frameByteSize; }
+        inline types::usize GetFrameUsedByteSize() const { return _head; }
+
+    private:
+        static constexpr types::usize kMaxFrameCount = 4;
+        static constexpr types::usize kFrameAlignment = 256;
+        static constexpr types::u64 kFenceTimeout = 1000000000;
+
+    private:
+        iGraphicsAPI* _gfx = nullptr;
+        cBuffer* _buffer = nullptr;
+        types::boolean _persistent = types::K_TRUE;
+        void* _staging = nullptr;
+        types::usize _frameByteSize = 0;
+        types::usize _frameCount = 0;
+        types::usize _frameIndex = 0;
+        types::usize _head = 0;
+        types::boolean _frameActive = types::K_FALSE;
+        types::u64 _fences[kMaxFrameCount] = {};
+    };
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+// vertex_format.hpp
+
+#pragma once
+
+#include "../../thirdparty/glm/glm/glm.hpp"
+#include "../../thirdparty/glm/glm/gtc/packing.hpp"
+#include "category.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    // Compressed layouts next to the 32 byte VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3. Positions are half
+    // floats so no per-geometry decode constants are needed, texcoords are unorm16 (the texture atlas already
+    // limits them to 0..1) and normals are octahedral encoded. Shaders get VERTEX_FORMAT_OCT_NORMAL defined.
+    struct sVertexHalf16 // VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2
+    {
+        types::u16 position[4]; // w is 1
+        types::u16 texcoord[2];
+        types::s16 normal[2];
+    };
+
+    struct sVertexHalf12 // VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2
+    {
+        types::u16 position[3];
+        types::s8 normal[2];
+        types::u16 texcoord[2];
+    };
+
+    // Largest finite half float, compressed positions past it would turn into infinities
+    static constexpr types::f32 kHalfFloatMax = 65504.0f;
+
+    // Every format's stride divides it, vertex heap offsets stay whole vertices whatever format a geometry uses.
+    // All formats share one vertex buffer bound at offset 0 and the defragmenter moves ranges to any free offset,
+    // so this is the heap granularity, a geometry loses less than 96 bytes to it.
+    static constexpr types::usize kVertexFormatAlignment = 96;
+
+    // Mesh formats the render passes draw, a pass has one input layout and shader variant for each
+    static constexpr types::usize kVertexFormatCount = 3;
+    static constexpr eCategory kVertexFormats[kVertexFormatCount] = {
+        eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3,
+        eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2,
+        eCategory::VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2
+    };
+
+    // Index into kVertexFormats, kVertexFormatCount for formats that aren't mesh formats
+    inline types::usize GetVertexFormatIndex(eCategory format)
+    {
+        for (types::usize i = 0; i < kVertexFormatCount; i++)
+        {
+            if (kVertexFormats[i] == format)
+                return i;
+        }
+
+        return kVertexFormatCount;
+    }
+
+    inline types::usize GetVertexFormatStride(eCategory format)
+    {
+        switch (format)
+        {
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3:
+            return 32;
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2:
+            return sizeof(sVertexHalf16);
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2:
+            return sizeof(sVertexHalf12);
+
+        default:
+            return 0;
+        }
+    }
+
+    inline types::boolean IsVertexFormatOctahedral(eCategory format)
+    {
+        return format == eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2 || format == eCategory::VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2 ? types::K_TRUE : types::K_FALSE;
+    }
+
+    // K_FALSE when a compressed format can't hold the position, such geometry has to stay 32 byte
+    inline types::boolean IsVertexPositionInRange(eCategory format, const glm::vec3& position)
+    {
+        if (format == eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3)
+            return types::K_TRUE;
+
+        const glm::vec3 magnitude = glm::abs(position);
+
+        return magnitude.x <= kHalfFloatMax && magnitude.y <= kHalfFloatMax && magnitude.z <= kHalfFloatMax ? types::K_TRUE : types::K_FALSE;
+    }
+
+    // Unit vector to the [-1, 1] square, the lower hemisphere is folded over the diagonals
+    inline glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+    {
+        const glm::vec3 n = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+        if (n.z >= 0.0f)
+            return glm::vec2(n.x, n.y);
+
+        return glm::vec2(
+            (1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+        );
+    }
+
+    inline glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+    {
+        glm::vec3 n = glm::vec3(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+        if (n.z < 0.0f)
+        {
+            const glm::vec2 folded = glm::vec2(
+                (1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+            );
+            n.x = folded.x;
+            n.y = folded.y;
+        }
+
+        return glm::normalize(n);
+    }
+
+    // Writes one vertex of format to destination, returns K_FALSE for formats without an encoder and for
+    // positions the format can't hold
+    inline types::boolean EncodeVertex(eCategory format, const glm::vec3& position, const glm::vec2& texcoord, const glm::vec3& normal, void* destination)
+    {
+        if (IsVertexPositionInRange(format, position) == types::K_FALSE)
+            return types::K_FALSE;
+
+        const glm::vec2 uv = glm::clamp(texcoord, glm::vec2(0.0f), glm::vec2(1.0f));
+        const glm::vec2 octahedral = EncodeOctahedral(normal);
+
+        switch (format)
+        {
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3:
+        {
+            types::f32* vertex = (types::f32*)destination;
+            vertex[0] = position.x;
+            vertex[1] = position.y;
+            vertex[2] = position.z;
+            vertex[3] = texcoord.x;
+            vertex[4] = texcoord.y;
+            vertex[5] = normal.x;
+            vertex[6] = normal.y;
+            vertex[7] = normal.z;
+
+            return types::K_TRUE;
+        }
+
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2:
+        {
+            sVertexHalf16* vertex = (sVertexHalf16*)destination;
+            vertex->position[0] = glm::packHalf1x16(position.x);
+            vertex->position[1] = glm::packHalf1x16(position.y);
+            vertex->position[2] = glm::packHalf1x16(position.z);
+            vertex->position[3] = glm::packHalf1x16(1.0f);
+            vertex->texcoord[0] = glm::packUnorm1x16(uv.x);
+            vertex->texcoord[1] = glm::packUnorm1x16(uv.y);
+            vertex->normal[0] = (types::s16)glm::packSnorm1x16(octahedral.x);
+            vertex->normal[1] = (types::s16)glm::packSnorm1x16(octahedral.y);
+
+            return types::K_TRUE;
+        }
+
+        case eCategory::VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2:
+        {
+            sVertexHalf12* vertex = (sVertexHalf12*)destination;
+            vertex->position[0] = glm::packHalf1x16(position.x);
+            vertex->position[1] = glm::packHalf1x16(position.y);
+            vertex->position[2] = glm::packHalf1x16(position.z);
+            vertex->normal[0] = (types::s8)glm::packSnorm1x8(octahedral.x);
+            vertex->normal[1] = (types::s8)glm::packSnorm1x8(octahedral.y);
+            vertex->texcoord[0] = glm::packUnorm1x16(uv.x);
+            vertex->texcoord[1] = glm::packUnorm1x16(uv.y);
+
+            return types::K_TRUE;
+        }
+
+        default:
+            return types::K_FALSE;
+        }
+    }
+
+    // Position is the first attribute of every format
+    inline glm::vec3 DecodeVertexPosition(eCategory format, const void* vertex)
+    {
+        if (format == eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3)
+            return *(const glm::vec3*)vertex;
+
+        const types::u16* position = (const types::u16*)vertex;
+
+        return glm::vec3(glm::unpackHalf1x16(position[0]), glm::unpackHalf1x16(position[1]), glm::unpackHalf1x16(position[2]));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
+// Lights and the froxel grid cLightCulling builds on the CPU, see light_culling.hpp
+struct Light
+{
+	vec4 Position;
+	vec4 Color;
+	vec4 DirectionAndScale;
+	vec4 Attenuation; // constant, linear, quadratic, range
+};
+
+layout(std430, binding = 2) buffer LightBuffer { uvec4 LightCount; Light lights[]; };
+// Size is the cluster count per axis and the light count, slice info is near, far, slice scale, slice bias
+layout(std430, binding = 4) buffer LightGridBuffer { uvec4 LightGridSize; vec4 LightSliceInfo; vec4 LightTileInfo; uvec2 lightClusters[]; };
+layout(std430, binding = 5) buffer LightIndexBuffer { uint lightIndices[]; };
+
+// Diffuse light of the lights in the cluster of this fragment
+vec3 Fragment_ClusterLights(in vec3 _positionWorld, in vec3 _normalWorld)
+{
+	// No lights, the grid may not be built yet
+	if (LightGridSize.w == 0u) {
+		return vec3(0.0);
+	}
+
+	float zNear = LightSliceInfo.x;
+	float zFar = LightSliceInfo.y;
+	float viewDepth = 2.0 * zNear * zFar / (zFar + zNear - (gl_FragCoord.z * 2.0 - 1.0) * (zFar - zNear));
+
+	uint x = min(uint(gl_FragCoord.x * LightTileInfo.x), LightGridSize.x - 1u);
+	uint y = min(uint(gl_FragCoord.y * LightTileInfo.y), LightGridSize.y - 1u);
+	uint z = uint(clamp(log(viewDepth) * LightSliceInfo.z + LightSliceInfo.w, 0.0, float(LightGridSize.z - 1u)));
+	uvec2 cluster = lightClusters[(z * LightGridSize.y + y) * LightGridSize.x + x];
+
+	vec3 normal = normalize(_normalWorld);
+	vec3 result = vec3(0.0);
+	for (uint i = 0u; i < cluster.y; i++)
+	{
+		Light light = lights[lightIndices[cluster.x + i]];
+		vec3 toLight = light.Position.xyz - _positionWorld;
+		float distance = length(toLight);
+		if (distance >= light.Attenuation.w) {
+			continue;
+		}
+
+		float attenuation = 1.0 / max(light.Attenuation.x + light.Attenuation.y * distance + light.Attenuation.z * distance * distance, 0.0001);
+		result += light.Color.rgb * max(dot(normal, toLight / max(distance, 0.0001)), 0.0) * attenuation;
+	}
+
+	return result;
+}
+#endif
\ No newline at end of file
@@ -1,3 +1,5 @@
+#pragma keywords RENDER_PATH_OPAQUE RENDER_PATH_TRANSPARENT RENDER_PATH_TEXT RENDER_PATH_TRANSPARENT_COMPOSITE RENDER_PATH_QUAD
+
 #if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_QUAD) || defined(RENDER_PATH_TRANSPARENT_COMPOSITE) || defined(RENDER_PATH_TEXT)
 layout(location = 0) out vec4 FragColor;
 #endif
@@ -14,6 +16,10 @@ flat in vec4 DiffuseColor;
 flat in vec4 GlyphInfo;
 flat in vec4 GlyphAtlasInfos;
 #endif
+#if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
+in vec3 PositionWorld;
+in vec3 NormalWorld;
+#endif
 
 struct TextureAtlasTexture
 {
@@ -39,6 +45,8 @@ uniform sampler2D RevealageTexture;
 uniform sampler2D FontAtlas;
 #endif
 
+#include "clustered_lights.shader"
+
 #if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
 void Fragment_Passthrough(in vec4 _textureColor, in vec4 _materialDiffuseColor, out vec4 _fragColor)
 {
@@ -56,6 +64,7 @@ void main()
 	
 	Fragment_Passthrough(textureColor, DiffuseColor, fragColor);
 	Fragment_Func(TexcoordOrig, textureColor, DiffuseColor, fragColor);
+	fragColor.rgb += textureColor.rgb * DiffuseColor.rgb * Fragment_ClusterLights(PositionWorld, NormalWorld);
 	FragColor = fragColor;
 	#endif
 	
@@ -65,6 +74,7 @@ void main()
 	
 	Fragment_Passthrough(textureColor, DiffuseColor, fragColor);
 	Fragment_Func(TexcoordOrig, textureColor, DiffuseColor, fragColor);
+	fragColor.rgb += textureColor.rgb * DiffuseColor.rgb * Fragment_ClusterLights(PositionWorld, NormalWorld);
 
 	float weight = clamp(pow(min(1.0, fragColor.a * 10.0) + 0.01, 3.0) * 1e8 *
 	   pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
@@ -1,8 +1,24 @@
+#pragma keywords RENDER_PATH_OPAQUE RENDER_PATH_TRANSPARENT RENDER_PATH_TEXT RENDER_PATH_TRANSPARENT_COMPOSITE RENDER_PATH_QUAD
+#pragma keywords _ VERTEX_FORMAT_OCT_NORMAL
+
+#extension GL_ARB_shader_draw_parameters : enable
+#if defined(GL_ARB_shader_draw_parameters)
+#define BASE_INSTANCE gl_BaseInstanceARB
+#else
+// Set per draw by cOpenGLGraphicsAPI::DrawIndirect, which issues the commands one by one without the extension
+uniform int BaseInstance;
+#define BASE_INSTANCE BaseInstance
+#endif
+
 #if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
 layout(location = 0) in vec3 InPositionLocal;
 layout(location = 1) in vec2 InTexcoord;
+#if defined(VERTEX_FORMAT_OCT_NORMAL)
+layout(location = 2) in vec2 InNormalOctahedral;
+#else
 layout(location = 2) in vec3 InNormal;
 #endif
+#endif
 
 out vec3 TexcoordAtlas;
 out vec2 TexcoordOrig;
@@ -11,6 +27,10 @@ flat out vec4 DiffuseColor;
 flat out vec4 GlyphInfo;
 flat out vec4 GlyphAtlasInfo;
 #endif
+#if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
+out vec3 PositionWorld;
+out vec3 NormalWorld;
+#endif
 
 #if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
 uniform mat4 ViewProjection;
@@ -69,13 +89,29 @@ void Vertex_Passthrough(in vec3 _positionLocal, in Instance _instance, in float
 	Vertex_Transform(_positionLocal, _instance, _use2D, _glPosition);
 }
 
+// Compressed vertex formats store the normal octahedral encoded, see vertex_format.hpp
+vec3 Vertex_Normal()
+{
+	#if defined(VERTEX_FORMAT_OCT_NORMAL)
+	vec3 normal = vec3(InNormalOctahedral, 1.0 - abs(InNormalOctahedral.x) - abs(InNormalOctahedral.y));
+	if (normal.z < 0.0) {
+		normal.xy = (1.0 - abs(normal.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(normal.xy, vec2(0.0)));
+	}
+	return normalize(normal);
+	#else
+	return InNormal;
+	#endif
+}
+
 void Vertex_Func(in vec3 _positionLocal, in vec2 _texcoord, in vec3 _normal, in int _instanceID, in Instance _instance, in Material material, in float _use2D, out vec4 _glPosition){}
 #endif
 
 void main()
 {
 	#if defined(RENDER_PATH_OPAQUE) || defined(RENDER_PATH_TRANSPARENT)
-	Instance instance = instances[gl_InstanceID];
+	// Multi-draw-indirect offsets every draw by its base instance, regular draws have a base instance of 0
+	int instanceID = BASE_INSTANCE + gl_InstanceID;
+	Instance instance = instances[instanceID];
 	Material material = materials[instance.MaterialIndex];
 
 	TexcoordAtlas = vec3(InTexcoord.x, 1.0 - InTexcoord.y, material.DiffuseTextureLayerInfo);
@@ -83,9 +119,11 @@ void main()
 	TexcoordAtlas.xy += material.DiffuseTextureInfo.xy;
 	TexcoordOrig = InTexcoord;
 	DiffuseColor = material.DiffuseColor;
+	PositionWorld = vec3(instance.World * vec4(InPositionLocal, 1.0));
+	NormalWorld = mat3(instance.World) * Vertex_Normal();
 
 	Vertex_Passthrough(InPositionLocal, instance, instance.Use2D, gl_Position);
-	Vertex_Func(InPositionLocal, TexcoordOrig, InNormal, gl_InstanceID, instance, material, instance.Use2D, gl_Position);
+	Vertex_Func(InPositionLocal, TexcoordOrig, Vertex_Normal(), instanceID, instance, material, instance.Use2D, gl_Position);
 	#endif
 	
 	#if defined(RENDER_PATH_QUAD) || defined(RENDER_PATH_TRANSPARENT_COMPOSITE)
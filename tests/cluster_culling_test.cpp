@@ -0,0 +1,167 @@
+// cluster_culling_test.cpp
+
+#include <vector>
+#include "culling_system.hpp"
+#include "mesh_optimizer.hpp"
+#include "graphics.hpp"
+#include "math.hpp"
+#include "test.hpp"
+
+using namespace triton;
+using namespace types;
+
+// Two flat 2x2 quad patches, one meshlet each: the first at z = 0 facing +z, the second at z = -1 facing -z.
+// Front faces are counter-clockwise, the same winding cMeshOptimizer builds the cones from.
+struct sTestMesh
+{
+    std::vector<f32> positions = {};
+    std::vector<u32> indices = {};
+    std::vector<sMeshlet> meshlets = {};
+    sVertexBufferGeometry geometry = {};
+};
+
+static void AddPatch(sTestMesh& mesh, f32 z, boolean facingPositiveZ)
+{
+    const u32 firstVertex = (u32)(mesh.positions.size() / 3);
+    for (u32 y = 0; y <= 2; y++)
+    {
+        for (u32 x = 0; x <= 2; x++)
+        {
+            mesh.positions.push_back((f32)x);
+            mesh.positions.push_back((f32)y);
+            mesh.positions.push_back(z);
+        }
+    }
+
+    for (u32 y = 0; y < 2; y++)
+    {
+        for (u32 x = 0; x < 2; x++)
+        {
+            const u32 a = firstVertex + y * 3 + x;
+            const u32 b = a + 1;
+            const u32 c = a + 3;
+            const u32 d = c + 1;
+            if (facingPositiveZ == K_TRUE)
+                mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+            else
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+        }
+    }
+}
+
+static void BuildTestMesh(sTestMesh& mesh)
+{
+    AddPatch(mesh, 0.0f, K_TRUE);
+    AddPatch(mesh, -1.0f, K_FALSE);
+
+    mesh.meshlets.resize(cMeshOptimizer::GetMaxMeshletCount(mesh.indices.size(), 64, 8));
+    const usize meshletCount = cMeshOptimizer::BuildMeshlets(mesh.meshlets.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(f32) * 3, mesh.positions.size() / 3, 64, 8);
+    mesh.meshlets.resize(meshletCount);
+
+    mesh.geometry._indexCount = mesh.indices.size();
+    mesh.geometry._meshlets = mesh.meshlets.data();
+    mesh.geometry._meshletCount = mesh.meshlets.size();
+}
+
+static void TestMeshletCones(const sTestMesh& mesh)
+{
+    TRITON_CHECK(mesh.meshlets.size() == 2);
+    TRITON_CHECK(mesh.meshlets[0].coneAxis[2] > 0.99f);
+    TRITON_CHECK(mesh.meshlets[1].coneAxis[2] < -0.99f);
+    TRITON_CHECK(mesh.meshlets[0].coneCutoff < 0.01f);
+    TRITON_CHECK(mesh.meshlets[1].coneCutoff < 0.01f);
+}
+
+static void TestCull(const sTestMesh& mesh)
+{
+    // Object 0 as built, object 1 turned around so its patches swap facing, object 2 far to the side
+    const sVertexBufferGeometry* geometries[3] = { &mesh.geometry, &mesh.geometry, &mesh.geometry };
+    const glm::mat4 worlds[3] = {
+        glm::mat4(1.0f),
+        glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, -1.0f)) * glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+        glm::translate(glm::mat4(1.0f), glm::vec3(100.0f, 0.0f, 0.0f))
+    };
+
+    const glm::vec3 cameraPosition = glm::vec3(1.0f, 1.0f, 6.0f);
+    const cMatrix4 viewProjection = cMatrix4(60.0f, 1.0f, 0.1f, 100.0f) *
+        cMatrix4(cVector3(cameraPosition.x, cameraPosition.y, cameraPosition.z), cVector3(0.0f, 0.0f, -1.0f), cVector3(0.0f, 1.0f, 0.0f));
+
+    cClusterCulling culling(nullptr);
+    sDrawIndirectCommand commands[8] = {};
+
+    // Without back face culling in the pass every meshlet in the frustum is drawn, adjacent ones merged
+    usize commandCount = culling.Cull(geometries, worlds, nullptr, 3, viewProjection, cameraPosition, K_FALSE, commands, 8);
+    TRITON_CHECK(commandCount == 2);
+    TRITON_CHECK(culling.GetTestedMeshletCount() == 6);
+    TRITON_CHECK(culling.GetVisibleMeshletCount() == 4);
+    TRITON_CHECK(culling.GetVisibleTriangleCount() == 32);
+    TRITON_CHECK(commands[0].firstIndex == 0 && commands[0].indexCount == 48 && commands[0].baseInstance == 0);
+    TRITON_CHECK(commands[1].firstIndex == 0 && commands[1].indexCount == 48 && commands[1].baseInstance == 1);
+
+    // With it only the patch facing the camera is left of each object
+    commandCount = culling.Cull(geometries, worlds, nullptr, 3, viewProjection, cameraPosition, K_TRUE, commands, 8);
+    TRITON_CHECK(commandCount == 2);
+    TRITON_CHECK(culling.GetVisibleMeshletCount() == 2);
+    TRITON_CHECK(culling.GetVisibleTriangleCount() == 16);
+    TRITON_CHECK(commands[0].firstIndex == 0 && commands[0].indexCount == 24 && commands[0].baseInstance == 0);
+    TRITON_CHECK(commands[1].firstIndex == 24 && commands[1].indexCount == 24 && commands[1].baseInstance == 1);
+
+    // From behind the facing flips
+    const glm::vec3 behindPosition = glm::vec3(1.0f, 1.0f, -7.0f);
+    const cMatrix4 behindViewProjection = cMatrix4(60.0f, 1.0f, 0.1f, 100.0f) *
+        cMatrix4(cVector3(behindPosition.x, behindPosition.y, behindPosition.z), cVector3(0.0f, 0.0f, 1.0f), cVector3(0.0f, 1.0f, 0.0f));
+    commandCount = culling.Cull(geometries, worlds, nullptr, 3, behindViewProjection, behindPosition, K_TRUE, commands, 8);
+    TRITON_CHECK(commandCount == 2);
+    TRITON_CHECK(commands[0].firstIndex == 24 && commands[0].indexCount == 24 && commands[0].baseInstance == 0);
+    TRITON_CHECK(commands[1].firstIndex == 0 && commands[1].indexCount == 24 && commands[1].baseInstance == 1);
+
+    // The visible object list maps to instances in list order
+    const u32 objects[2] = { 2, 1 };
+    commandCount = culling.Cull(geometries, worlds, objects, 2, viewProjection, cameraPosition, K_TRUE, commands, 8);
+    TRITON_CHECK(commandCount == 1);
+    TRITON_CHECK(culling.GetTestedMeshletCount() == 4);
+    TRITON_CHECK(commands[0].firstIndex == 24 && commands[0].baseInstance == 1);
+}
+
+static void TestFrustumCulling(cContext* context)
+{
+    context->RegisterFactory<cCullingBounds>();
+    context->RegisterFactory<cFrustumCulling>();
+    cFrustumCulling* culling = context->Create<cFrustumCulling>(context);
+
+    // Unit spheres: in front of the camera, behind it, scaled up next to the left plane, removed
+    const glm::mat4 worlds[4] = {
+        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)),
+        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10.0f)),
+        glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-12.0f, 0.0f, -10.0f)), glm::vec3(8.0f)),
+        glm::mat4(1.0f)
+    };
+    for (u32 i = 0; i < 4; i++)
+        culling->Add(i, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    culling->Remove(3);
+    culling->UpdateBounds(worlds);
+    TRITON_CHECK(culling->GetSize() == 3);
+
+    const cMatrix4 viewProjection = cMatrix4(60.0f, 1.0f, 0.1f, 100.0f) *
+        cMatrix4(cVector3(0.0f, 0.0f, 0.0f), cVector3(0.0f, 0.0f, -1.0f), cVector3(0.0f, 1.0f, 0.0f));
+    u32 visibleObjects[3] = {};
+    const usize visibleCount = culling->Cull(viewProjection, visibleObjects);
+    TRITON_CHECK(visibleCount == 2);
+    TRITON_CHECK((visibleObjects[0] == 0 && visibleObjects[1] == 2) || (visibleObjects[0] == 2 && visibleObjects[1] == 0));
+
+    context->Destroy<cFrustumCulling>(culling);
+}
+
+int main()
+{
+    tests::cTestEnvironment environment;
+    TestFrustumCulling(environment.GetContext());
+
+    sTestMesh mesh;
+    BuildTestMesh(mesh);
+
+    TestMeshletCones(mesh);
+    TestCull(mesh);
+
+    return TRITON_TEST_RESULT;
+}
\ No newline at end of file
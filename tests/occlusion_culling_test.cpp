@@ -0,0 +1,73 @@
+// occlusion_culling_test.cpp
+
+#include "occlusion_system.hpp"
+#include "graphics.hpp"
+#include "math.hpp"
+#include "test.hpp"
+
+using namespace triton;
+using namespace types;
+
+// A 4x4 quad 5 units in front of a camera at the origin looking down -Z is the only occluder. Unit boxes
+// are tested behind it, beside it and in front of it.
+static void TestOcclusionCulling(cContext* context)
+{
+    context->RegisterFactory<cOcclusionCulling>();
+    cOcclusionCulling* culling = context->Create<cOcclusionCulling>(context);
+
+    const glm::vec3 positions[4] = {
+        glm::vec3(-2.0f, -2.0f, 0.0f),
+        glm::vec3(2.0f, -2.0f, 0.0f),
+        glm::vec3(2.0f, 2.0f, 0.0f),
+        glm::vec3(-2.0f, 2.0f, 0.0f)
+    };
+    const u32 indices[6] = { 0, 1, 2, 0, 2, 3 };
+    culling->AddOccluder(positions, sizeof(glm::vec3), indices, 6, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f)));
+    TRITON_CHECK(culling->GetOccluderTriangleCount() == 2);
+
+    const cMatrix4 viewProjection = cMatrix4(60.0f, 2.0f, 0.1f, 100.0f) *
+        cMatrix4(cVector3(0.0f, 0.0f, 0.0f), cVector3(0.0f, 0.0f, -1.0f), cVector3(0.0f, 1.0f, 0.0f));
+    culling->Render(viewProjection);
+
+    // The occluder is written at its depth, the corners of the buffer stay at the far plane
+    const usize width = culling->GetWidth();
+    const usize height = culling->GetHeight();
+    const f32* depth = culling->GetDepth();
+    TRITON_CHECK(depth[(height / 2) * width + width / 2] < 1.0f);
+    TRITON_CHECK(depth[0] == 1.0f);
+
+    const glm::vec3 aabbMin = glm::vec3(-0.5f);
+    const glm::vec3 aabbMax = glm::vec3(0.5f);
+    const glm::mat4 behind = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f));
+    const glm::mat4 beside = glm::translate(glm::mat4(1.0f), glm::vec3(8.0f, 0.0f, -10.0f));
+    const glm::mat4 inFront = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -3.0f));
+    TRITON_CHECK(culling->IsVisible(behind, aabbMin, aabbMax) == K_FALSE);
+    TRITON_CHECK(culling->IsVisible(beside, aabbMin, aabbMax) == K_TRUE);
+    TRITON_CHECK(culling->IsVisible(inFront, aabbMin, aabbMax) == K_TRUE);
+
+    // Filter keeps the visible objects in order
+    sVertexBufferGeometry geometry = {};
+    geometry._aabbMin = aabbMin;
+    geometry._aabbMax = aabbMax;
+    const sVertexBufferGeometry* geometries[3] = { &geometry, &geometry, &geometry };
+    const glm::mat4 worlds[3] = { behind, beside, inFront };
+    u32 objects[3] = { 0, 1, 2 };
+    const usize visibleCount = culling->Filter(objects, 3, worlds, geometries);
+    TRITON_CHECK(visibleCount == 2);
+    TRITON_CHECK(objects[0] == 1 && objects[1] == 2);
+
+    // Without occluders nothing is culled
+    culling->ClearOccluders();
+    culling->Render(viewProjection);
+    TRITON_CHECK(culling->IsVisible(behind, aabbMin, aabbMax) == K_TRUE);
+
+    context->Destroy<cOcclusionCulling>(culling);
+}
+
+int main()
+{
+    tests::cTestEnvironment environment;
+    TestOcclusionCulling(environment.GetContext());
+
+    return TRITON_TEST_RESULT;
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+// render_graph_test.cpp
+
+#include "render_graph.hpp"
+#include "render_context.hpp"
+#include "graphics.hpp"
+#include "test.hpp"
+
+using namespace triton;
+using namespace types;
+
+static usize GetCallCount(const cNullGraphicsAPI& gfx, cNullGraphicsAPI::eCommand command)
+{
+    return gfx.GetStats().callCounts[(usize)command];
+}
+
+static void RegisterFactories(cContext* context)
+{
+    context->RegisterFactory<cBuffer>();
+    context->RegisterFactory<cVertexArray>();
+    context->RegisterFactory<cShader>();
+    context->RegisterFactory<cTexture>();
+    context->RegisterFactory<cRenderTarget>();
+    context->RegisterFactory<cRenderPassGPU>();
+    context->RegisterFactory<cRenderPass>();
+    context->RegisterFactory<cRenderGraph>();
+}
+
+// Opaque and transparent passes feed a composite, bloom and post processing follow at half size, the final
+// pass draws to the default framebuffer. One pass writes a texture nobody reads.
+static void TestCullingAndAliasing(cContext* context)
+{
+    cNullGraphicsAPI gfx(context);
+    cRenderGraph* graph = context->Create<cRenderGraph>(context, (iGraphicsAPI*)&gfx, glm::vec2(800.0f, 600.0f));
+
+    sRenderGraphTextureDescriptor textureDesc = {};
+    textureDesc.format = cTexture::eFormat::RGBA8;
+    const u32 color = graph->CreateTexture(textureDesc);
+    const u32 unused = graph->CreateTexture(textureDesc);
+    textureDesc.format = cTexture::eFormat::RGBA16F;
+    const u32 accumulation = graph->CreateTexture(textureDesc);
+    textureDesc.format = cTexture::eFormat::R8F;
+    const u32 revealage = graph->CreateTexture(textureDesc);
+    textureDesc.format = cTexture::eFormat::DEPTH_STENCIL;
+    const u32 depth = graph->CreateTexture(textureDesc);
+    textureDesc.format = cTexture::eFormat::RGBA8;
+    textureDesc.scale = 0.5f;
+    const u32 bloom = graph->CreateTexture(textureDesc);
+    const u32 post = graph->CreateTexture(textureDesc);
+
+    usize executedCount = 0;
+    sRenderGraphPassDescriptor passDesc = {};
+    passDesc.colorOutputs = { color };
+    passDesc.depthOutput = depth;
+    const u32 opaque = graph->AddPass(passDesc);
+
+    passDesc = {};
+    passDesc.colorOutputs = { accumulation, revealage };
+    passDesc.depthOutput = depth;
+    const u32 transparent = graph->AddPass(passDesc);
+
+    passDesc = {};
+    passDesc.inputTextures = { accumulation, revealage };
+    passDesc.inputTextureNames = { "Accumulation", "Revealage" };
+    passDesc.colorOutputs = { color };
+    const u32 composite = graph->AddPass(passDesc);
+
+    passDesc = {};
+    passDesc.inputTextures = { color };
+    passDesc.inputTextureNames = { "Color" };
+    passDesc.colorOutputs = { bloom };
+    const u32 bloomPass = graph->AddPass(passDesc);
+
+    passDesc = {};
+    passDesc.inputTextures = { bloom };
+    passDesc.inputTextureNames = { "Bloom" };
+    passDesc.colorOutputs = { post };
+    const u32 postPass = graph->AddPass(passDesc);
+
+    passDesc = {};
+    passDesc.colorOutputs = { unused };
+    const u32 dead = graph->AddPass(passDesc);
+
+    passDesc = {};
+    passDesc.inputTextures = { post };
+    passDesc.inputTextureNames = { "Post" };
+    passDesc.hasSideEffects = K_TRUE;
+    passDesc.execute = [&executedCount](cRenderPass* renderPass) { executedCount += 1; };
+    const u32 final = graph->AddPass(passDesc);
+
+    // Outputs of different sizes can't share a render target
+    passDesc = {};
+    passDesc.colorOutputs = { color, bloom };
+    TRITON_CHECK(graph->AddPass(passDesc) == kRenderGraphInvalidHandle);
+
+    graph->Execute();
+    TRITON_CHECK(executedCount == 1);
+    TRITON_CHECK(graph->IsPassCulled(opaque) == K_FALSE);
+    TRITON_CHECK(graph->IsPassCulled(transparent) == K_FALSE);
+    TRITON_CHECK(graph->IsPassCulled(composite) == K_FALSE);
+    TRITON_CHECK(graph->IsPassCulled(bloomPass) == K_FALSE);
+    TRITON_CHECK(graph->IsPassCulled(postPass) == K_FALSE);
+    TRITON_CHECK(graph->IsPassCulled(dead) == K_TRUE);
+    TRITON_CHECK(graph->IsPassCulled(final) == K_FALSE);
+
+    // bloom is done once post is written, the two half size textures can't alias, the culled pass gets nothing
+    TRITON_CHECK(graph->GetTexture(unused) == nullptr);
+    TRITON_CHECK(graph->GetTexture(bloom) != graph->GetTexture(post));
+    TRITON_CHECK(graph->GetPhysicalTextureCount() == 6);
+    TRITON_CHECK(graph->GetTexture(bloom)->GetWidth() == 400 && graph->GetTexture(bloom)->GetHeight() == 300);
+
+    // Viewports follow the outputs, the final pass covers the whole graph
+    TRITON_CHECK(graph->GetRenderPass(opaque)->GetViewport().rect.GetZ() == 800.0f);
+    TRITON_CHECK(graph->GetRenderPass(bloomPass)->GetViewport().rect.GetZ() == 400.0f);
+    TRITON_CHECK(graph->GetRenderPass(bloomPass)->GetViewport().rect.GetW() == 300.0f);
+    TRITON_CHECK(graph->GetRenderPass(final)->GetViewport().rect.GetZ() == 800.0f);
+    TRITON_CHECK(graph->GetRenderPass(final)->GetRenderTarget() == nullptr);
+    TRITON_CHECK(graph->GetRenderPass(composite)->GetRenderTarget() != nullptr);
+
+    // Resizes are folded into one rebuild
+    const usize createdCount = GetCallCount(gfx, cNullGraphicsAPI::eCommand::CREATE_TEXTURE);
+    graph->Resize(glm::vec2(1024.0f, 768.0f));
+    graph->Resize(glm::vec2(1280.0f, 720.0f));
+    graph->Resize(glm::vec2(1920.0f, 1080.0f));
+    TRITON_CHECK(GetCallCount(gfx, cNullGraphicsAPI::eCommand::CREATE_TEXTURE) == createdCount);
+    graph->Compile();
+    graph->Compile();
+    TRITON_CHECK(GetCallCount(gfx, cNullGraphicsAPI::eCommand::CREATE_TEXTURE) == createdCount + 6);
+    TRITON_CHECK(graph->GetTexture(color)->GetWidth() == 1920);
+    TRITON_CHECK(graph->GetRenderPass(postPass)->GetViewport().rect.GetZ() == 960.0f);
+
+    graph->Execute();
+    TRITON_CHECK(executedCount == 2);
+
+    context->Destroy<cRenderGraph>(graph);
+    TRITON_CHECK(GetCallCount(gfx, cNullGraphicsAPI::eCommand::DESTROY_TEXTURE) == GetCallCount(gfx, cNullGraphicsAPI::eCommand::CREATE_TEXTURE));
+    TRITON_CHECK(GetCallCount(gfx, cNullGraphicsAPI::eCommand::DESTROY_RENDER_TARGET) == GetCallCount(gfx, cNullGraphicsAPI::eCommand::CREATE_RENDER_TARGET));
+}
+
+// Textures of the same format and size alias once the lifetime of the first one ended
+static void TestAliasing(cContext* context)
+{
+    cNullGraphicsAPI gfx(context);
+    cRenderGraph* graph = context->Create<cRenderGraph>(context, (iGraphicsAPI*)&gfx, glm::vec2(256.0f, 256.0f));
+
+    sRenderGraphTextureDescriptor textureDesc = {};
+    const u32 a = graph->CreateTexture(textureDesc);
+    const u32 b = graph->CreateTexture(textureDesc);
+    const u32 c = graph->CreateTexture(textureDesc);
+
+    sRenderGraphPassDescriptor passDesc = {};
+    passDesc.colorOutputs = { a };
+    graph->AddPass(passDesc);
+    passDesc.inputTextures = { a };
+    passDesc.inputTextureNames = { "A" };
+    passDesc.colorOutputs = { b };
+    graph->AddPass(passDesc);
+    passDesc.inputTextures = { b };
+    passDesc.inputTextureNames = { "B" };
+    passDesc.colorOutputs = { c };
+    graph->AddPass(passDesc);
+    passDesc.inputTextures = { c };
+    passDesc.inputTextureNames = { "C" };
+    passDesc.colorOutputs = {};
+    passDesc.hasSideEffects = K_TRUE;
+    graph->AddPass(passDesc);
+
+    graph->Compile();
+    TRITON_CHECK(graph->GetPhysicalTextureCount() == 2);
+    TRITON_CHECK(graph->GetTexture(a) == graph->GetTexture(c));
+    TRITON_CHECK(graph->GetTexture(a) != graph->GetTexture(b));
+    TRITON_CHECK(graph->GetPhysicalByteSize() == 2 * 256 * 256 * 4);
+
+    context->Destroy<cRenderGraph>(graph);
+}
+
+int main()
+{
+    tests::cTestEnvironment environment;
+    RegisterFactories(environment.GetContext());
+
+    TestCullingAndAliasing(environment.GetContext());
+    TestAliasing(environment.GetContext());
+
+    return TRITON_TEST_RESULT;
+}
\ No newline at end of file
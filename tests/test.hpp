@@ -0,0 +1,77 @@
+// test.hpp
+
+#pragma once
+
+#include <iostream>
+#include "capabilities.hpp"
+#include "context.hpp"
+#include "application.hpp"
+#include "engine.hpp"
+#include "types.hpp"
+
+namespace triton
+{
+    namespace tests
+    {
+        inline types::usize& GetFailedCheckCount()
+        {
+            static types::usize failedCheckCount = 0;
+
+            return failedCheckCount;
+        }
+
+        class cTestApplication final : public iApplication
+        {
+        public:
+            explicit cTestApplication(cContext* context, const sCapabilities* caps) : iApplication(context, caps) {}
+            virtual ~cTestApplication() override final = default;
+
+            virtual void Setup() override final {}
+            virtual void Stop() override final {}
+        };
+
+        // Context with an allocator and a registered cEngine that never runs Initialize, so objects can read
+        // the capabilities without a window or a GL context. Tests register the factories they need, the
+        // engine factory stays unregistered so the application doesn't create a second engine.
+        class cTestEnvironment
+        {
+        public:
+            cTestEnvironment()
+            {
+                _caps.headlessGraphics = types::K_TRUE;
+                _context.CreateMemoryAllocator();
+                _application = new cTestApplication(&_context, &_caps);
+                _engine = new cEngine(&_context, _application);
+                _context.RegisterSubsystem(_engine);
+            }
+
+            ~cTestEnvironment()
+            {
+                delete _engine;
+                delete _application;
+            }
+
+            inline cContext* GetContext() { return &_context; }
+            inline sCapabilities* GetCapabilities() { return &_caps; }
+
+        private:
+            sCapabilities _caps = {};
+            cContext _context;
+            cTestApplication* _application = nullptr;
+            cEngine* _engine = nullptr;
+        };
+    }
+}
+
+// Reports a failed condition and keeps going, main returns TRITON_TEST_RESULT
+#define TRITON_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+            triton::tests::GetFailedCheckCount() += 1; \
+        } \
+    } while (0)
+
+#define TRITON_TEST_RESULT (triton::tests::GetFailedCheckCount() == 0 ? 0 : 1)
\ No newline at end of file
@@ -0,0 +1,446 @@
+// main.cpp
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <unordered_map>
+#include "transform_system.hpp"
+#include "culling_system.hpp"
+#include "draw_list.hpp"
+#include "instance_builder.hpp"
+#include "graphics.hpp"
+#include "thread_manager.hpp"
+#include "capabilities.hpp"
+#include "context.hpp"
+#include "application.hpp"
+#include "engine.hpp"
+#include "math.hpp"
+#include "types.hpp"
+
+using namespace triton;
+using namespace types;
+
+// Benchmarks of the engine systems that run without a window or a GL context. Every benchmark prints the best
+// time of a few runs next to the code path it replaced. Numbers are only comparable on the same machine and build.
+
+static constexpr usize kRunCount = 16;
+static constexpr usize kTransformNodeCount = 100000;
+static constexpr usize kMathElementCount = 65536;
+static constexpr usize kCullingObjectCount = 1000000;
+static constexpr usize kDrawListKeyCount = 100000;
+static constexpr usize kInstanceCount = 65536;
+static constexpr usize kInstanceMaterialCount = 256;
+
+class cBenchmarkApplication final : public iApplication
+{
+public:
+    explicit cBenchmarkApplication(cContext* context, const sCapabilities* caps) : iApplication(context, caps) {}
+    virtual ~cBenchmarkApplication() override final = default;
+
+    virtual void Setup() override final {}
+    virtual void Stop() override final {}
+};
+
+// prepare runs before every timed run and isn't measured, returns milliseconds
+static f64 MeasureBest(const std::function<void()>& prepare, const std::function<void()>& run)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    f64 best = 0.0;
+    for (usize i = 0; i < kRunCount; i++)
+    {
+        prepare();
+        const auto start = clock::now();
+        run();
+        const f64 milliseconds = std::chrono::duration<f64, std::milli>(clock::now() - start).count();
+        best = i == 0 || milliseconds < best ? milliseconds : best;
+    }
+
+    return best;
+}
+
+// Every tenth node is a root, the others hang below one of the 16 nodes created before them. All nodes are dirty
+// on every run. The reference is what a scene graph on cTransform does, Transform per node, then the parent
+// world times the local one.
+static void BenchmarkTransformHierarchy(cContext* context)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<f32> distribution(-1.0f, 1.0f);
+
+    cTransformHierarchy* hierarchy = context->Create<cTransformHierarchy>(context);
+    std::vector<cTransformHandle> nodes(kTransformNodeCount);
+    std::vector<s32> parents(kTransformNodeCount);
+    std::vector<cTransform> transforms(kTransformNodeCount);
+    std::vector<cMatrix4> worlds(kTransformNodeCount, cMatrix4(1.0f));
+
+    for (usize i = 0; i < kTransformNodeCount; i++)
+    {
+        parents[i] = i < 16 || random() % 10 == 0 ? -1 : (s32)(i - 1 - random() % 16);
+        nodes[i] = hierarchy->Create(parents[i] < 0 ? cTransformHandle() : nodes[parents[i]]);
+
+        const cVector3 position = cVector3(distribution(random), distribution(random), distribution(random));
+        const cVector3 rotation = cVector3(distribution(random), distribution(random), distribution(random));
+        const cVector3 scale = cVector3(1.0f + 0.1f * distribution(random));
+        const glm::quat quatX = glm::angleAxis(rotation.GetX(), glm::vec3(1.0f, 0.0f, 0.0f));
+        const glm::quat quatY = glm::angleAxis(rotation.GetY(), glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::quat quatZ = glm::angleAxis(rotation.GetZ(), glm::vec3(0.0f, 0.0f, 1.0f));
+        hierarchy->SetPosition(nodes[i], position);
+        hierarchy->SetRotation(nodes[i], cQuaternion(quatZ * quatY * quatX));
+        hierarchy->SetScale(nodes[i], scale);
+        transforms[i].SetPosition(position);
+        transforms[i].SetRotation(rotation);
+        transforms[i].SetScale(scale);
+    }
+
+    const f64 hierarchyTime = MeasureBest([&]() {
+        for (usize i = 0; i < kTransformNodeCount; i++)
+        {
+            if (parents[i] < 0)
+                hierarchy->SetScale(nodes[i], hierarchy->GetScale(nodes[i]));
+        }
+    }, [&]() {
+        hierarchy->Update();
+    });
+
+    const f64 transformTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kTransformNodeCount; i++)
+        {
+            transforms[i].Transform();
+            worlds[i] = parents[i] < 0 ? transforms[i].GetWorld() : worlds[parents[i]] * transforms[i].GetWorld();
+        }
+    });
+
+    f32 maxError = 0.0f;
+    for (usize i = 0; i < kTransformNodeCount; i++)
+    {
+        const f32* lhs = (const f32*)hierarchy->GetWorldMatrix(nodes[i]);
+        const f32* rhs = worlds[i].GetData();
+        for (usize j = 0; j < 16; j++)
+            maxError = glm::max(maxError, glm::abs(lhs[j] - rhs[j]));
+    }
+
+    std::cout << "transform hierarchy, " << kTransformNodeCount << " dirty nodes: Update " << hierarchyTime << " ms, cTransform "
+        << transformTime << " ms, max difference " << maxError << std::endl;
+
+    context->Destroy<cTransformHierarchy>(hierarchy);
+}
+
+static f32 GetMaxDifference(const f32* lhs, const f32* rhs, usize count)
+{
+    f32 maxDifference = 0.0f;
+    for (usize i = 0; i < count; i++)
+        maxDifference = glm::max(maxDifference, glm::abs(lhs[i] - rhs[i]) / (1.0f + glm::abs(rhs[i])));
+
+    return maxDifference;
+}
+
+// The SIMD operators of math.hpp and the batch functions of cMath against the same glm operations on random
+// matrices, points and quaternions. Differences are relative to the glm results.
+static void BenchmarkMath()
+{
+    std::mt19937 random(2);
+    std::uniform_real_distribution<f32> distribution(-1.0f, 1.0f);
+
+    std::vector<glm::mat4> glmMatrices(kMathElementCount * 2);
+    std::vector<glm::vec4> glmPoints(kMathElementCount);
+    std::vector<glm::quat> glmQuaternions(kMathElementCount * 2);
+    for (auto& matrix : glmMatrices)
+    {
+        // Diagonally dominant so every matrix has a well conditioned inverse
+        for (usize column = 0; column < 4; column++)
+            matrix[column] = glm::vec4(distribution(random), distribution(random), distribution(random), distribution(random));
+        matrix += glm::mat4(4.0f);
+    }
+    for (auto& point : glmPoints)
+        point = glm::vec4(distribution(random), distribution(random), distribution(random), 1.0f);
+    for (auto& quaternion : glmQuaternions)
+        quaternion = glm::normalize(glm::quat(distribution(random), distribution(random), distribution(random), distribution(random)));
+
+    std::vector<cMatrix4> matrices;
+    std::vector<cVector4> points;
+    std::vector<cQuaternion> quaternions;
+    for (const auto& matrix : glmMatrices)
+        matrices.emplace_back(matrix);
+    for (const auto& point : glmPoints)
+        points.emplace_back(point);
+    for (const auto& quaternion : glmQuaternions)
+        quaternions.emplace_back(quaternion);
+
+    const cMatrix4* lhs = &matrices[0];
+    const cMatrix4* rhs = &matrices[kMathElementCount];
+    std::vector<glm::mat4> glmMatrixResults(kMathElementCount);
+    std::vector<cMatrix4> matrixResults(kMathElementCount, cMatrix4(1.0f));
+    std::vector<glm::vec4> glmPointResults(kMathElementCount);
+    std::vector<cVector4> pointResults(kMathElementCount, cVector4(0.0f));
+    std::vector<glm::quat> glmQuaternionResults(kMathElementCount);
+    std::vector<cQuaternion> quaternionResults(kMathElementCount, cQuaternion(1.0f, 0.0f, 0.0f, 0.0f));
+
+    const f64 glmMultiplyTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            glmMatrixResults[i] = glmMatrices[i] * glmMatrices[kMathElementCount + i];
+    });
+    const f64 multiplyTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            matrixResults[i] = lhs[i] * rhs[i];
+    });
+    const f32 multiplyDifference = GetMaxDifference(matrixResults[0].GetData(), &glmMatrixResults[0][0][0], kMathElementCount * 16);
+    const f64 batchMultiplyTime = MeasureBest([]() {}, [&]() {
+        cMath::MultiplyMatrices(lhs, rhs, matrixResults.data(), kMathElementCount);
+    });
+    const f32 batchMultiplyDifference = GetMaxDifference(matrixResults[0].GetData(), &glmMatrixResults[0][0][0], kMathElementCount * 16);
+
+    const f64 glmInverseTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            glmMatrixResults[i] = glm::inverse(glmMatrices[i]);
+    });
+    const f64 inverseTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            matrixResults[i] = lhs[i].Inverse();
+    });
+    const f32 inverseDifference = GetMaxDifference(matrixResults[0].GetData(), &glmMatrixResults[0][0][0], kMathElementCount * 16);
+
+    const f64 glmTransformTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            glmPointResults[i] = glmMatrices[0] * glmPoints[i];
+    });
+    const f64 transformTime = MeasureBest([]() {}, [&]() {
+        cMath::TransformPoints(lhs[0], points.data(), pointResults.data(), kMathElementCount);
+    });
+    const f32 transformDifference = GetMaxDifference(pointResults[0].GetData(), &glmPointResults[0].x, kMathElementCount * 4);
+
+    const f64 glmQuaternionTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            glmQuaternionResults[i] = glmQuaternions[i] * glmQuaternions[kMathElementCount + i];
+    });
+    const f64 quaternionTime = MeasureBest([]() {}, [&]() {
+        for (usize i = 0; i < kMathElementCount; i++)
+            quaternionResults[i] = quaternions[i] * quaternions[kMathElementCount + i];
+    });
+    f32 quaternionDifference = 0.0f;
+    for (usize i = 0; i < kMathElementCount; i++)
+    {
+        const glm::vec4 result = glm::vec4(quaternionResults[i].GetX(), quaternionResults[i].GetY(), quaternionResults[i].GetZ(), quaternionResults[i].GetW());
+        const glm::vec4 reference = glm::vec4(glmQuaternionResults[i].x, glmQuaternionResults[i].y, glmQuaternionResults[i].z, glmQuaternionResults[i].w);
+        quaternionDifference = glm::max(quaternionDifference, GetMaxDifference(&result.x, &reference.x, 4));
+    }
+
+    std::cout << "math, " << kMathElementCount << " elements, best ms and max difference to glm:" << std::endl;
+    std::cout << "  matrix multiply: cMatrix4 " << multiplyTime << " (" << multiplyDifference << "), MultiplyMatrices " << batchMultiplyTime
+        << " (" << batchMultiplyDifference << "), glm " << glmMultiplyTime << std::endl;
+    std::cout << "  matrix inverse: cMatrix4 " << inverseTime << " (" << inverseDifference << "), glm " << glmInverseTime << std::endl;
+    std::cout << "  point transform: TransformPoints " << transformTime << " (" << transformDifference << "), glm " << glmTransformTime << std::endl;
+    std::cout << "  quaternion product: cQuaternion " << quaternionTime << " (" << quaternionDifference << "), glm " << glmQuaternionTime << std::endl;
+}
+
+// Spheres spread over a 1000 unit cube around a camera at the origin looking down -Z. The reference is a plain
+// loop over the objects that moves every sphere to world space and tests it against the 6 frustum planes.
+static void BenchmarkFrustumCulling(cContext* context)
+{
+    std::mt19937 random(3);
+    std::uniform_real_distribution<f32> distribution(-1.0f, 1.0f);
+
+    cFrustumCulling* culling = context->Create<cFrustumCulling>(context);
+    std::vector<glm::vec4> spheres(kCullingObjectCount);
+    std::vector<glm::mat4> worlds(kCullingObjectCount);
+    std::vector<u32> visibleObjects(kCullingObjectCount);
+    for (usize i = 0; i < kCullingObjectCount; i++)
+    {
+        spheres[i] = glm::vec4(distribution(random), distribution(random), distribution(random), 1.5f + distribution(random) * 0.5f);
+        worlds[i] = glm::translate(glm::mat4(1.0f), glm::vec3(distribution(random), distribution(random), distribution(random)) * 500.0f);
+        culling->Add((u32)i, spheres[i]);
+    }
+
+    const cMatrix4 viewProjection = cMatrix4(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f) *
+        cMatrix4(cVector3(0.0f), cVector3(0.0f, 0.0f, -1.0f), cVector3(0.0f, 1.0f, 0.0f));
+
+    usize visibleCount = 0;
+    const f64 updateTime = MeasureBest([]() {}, [&]() {
+        culling->UpdateBounds(worlds.data());
+    });
+    const f64 cullTime = MeasureBest([]() {}, [&]() {
+        visibleCount = culling->Cull(viewProjection, visibleObjects.data());
+    });
+
+    const f32* m = viewProjection.GetData();
+    glm::vec4 planes[6];
+    for (usize i = 0; i < 3; i++)
+    {
+        planes[i * 2 + 0] = glm::vec4(m[3] + m[i], m[7] + m[4 + i], m[11] + m[8 + i], m[15] + m[12 + i]);
+        planes[i * 2 + 1] = glm::vec4(m[3] - m[i], m[7] - m[4 + i], m[11] - m[8 + i], m[15] - m[12 + i]);
+    }
+    for (auto& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    usize referenceVisibleCount = 0;
+    const f64 referenceTime = MeasureBest([]() {}, [&]() {
+        referenceVisibleCount = 0;
+        for (usize i = 0; i < kCullingObjectCount; i++)
+        {
+            const glm::vec4 center = worlds[i] * glm::vec4(glm::vec3(spheres[i]), 1.0f);
+            boolean inside = K_TRUE;
+            for (usize p = 0; p < 6 && inside == K_TRUE; p++)
+                inside = glm::dot(glm::vec3(planes[p]), glm::vec3(center)) + planes[p].w >= -spheres[i].w ? K_TRUE : K_FALSE;
+
+            visibleObjects[referenceVisibleCount] = (u32)i;
+            referenceVisibleCount += inside == K_TRUE ? 1 : 0;
+        }
+    });
+
+    std::cout << "frustum culling, " << kCullingObjectCount << " objects: UpdateBounds " << updateTime << " ms, Cull " << cullTime << " ms, "
+        << visibleCount << " visible, plain loop " << referenceTime << " ms, " << referenceVisibleCount << " visible" << std::endl;
+
+    context->Destroy<cFrustumCulling>(culling);
+}
+
+// Opaque keys of 100k draws over 64 shaders, 4096 geometries of 4 LODs and 1024 materials at random depths. Pushing the
+// keys isn't measured. The reference is std::sort of the same items by key.
+static void BenchmarkDrawList(cContext* context)
+{
+    std::mt19937 random(4);
+    std::uniform_real_distribution<f32> distribution(0.0f, 1.0f);
+
+    sDrawListDescriptor desc;
+    desc.maxItemCount = kDrawListKeyCount;
+    cDrawList* drawList = context->Create<cDrawList>(context, desc);
+    std::vector<sDrawItem> items(kDrawListKeyCount);
+    for (usize i = 0; i < kDrawListKeyCount; i++)
+    {
+        items[i].key = drawList->MakeKey(0, random() % 64, random() % 4096, random() % 4, random() % 1024, distribution(random));
+        items[i].object = (u32)i;
+    }
+
+    const f64 sortTime = MeasureBest([&]() {
+        drawList->Clear();
+        for (const auto& item : items)
+            drawList->Push(item.key, item.object);
+    }, [&]() {
+        drawList->Sort();
+    });
+
+    std::vector<sDrawItem> referenceItems;
+    const f64 referenceTime = MeasureBest([&]() {
+        referenceItems = items;
+    }, [&]() {
+        std::sort(referenceItems.begin(), referenceItems.end(), [](const sDrawItem& lhs, const sDrawItem& rhs) {
+            return lhs.key < rhs.key;
+        });
+    });
+
+    usize mismatchCount = 0;
+    for (usize i = 0; i < kDrawListKeyCount; i++)
+        mismatchCount += drawList->GetItems()[i].key != referenceItems[i].key ? 1 : 0;
+
+    std::cout << "draw list, " << kDrawListKeyCount << " keys: Sort " << sortTime << " ms, " << drawList->GetBatchCount() << " batches, std::sort "
+        << referenceTime << " ms, " << mismatchCount << " keys out of order" << std::endl;
+
+    context->Destroy<cDrawList>(drawList);
+}
+
+// Instances with random worlds and one of 256 materials each, run without and with cThread. The reference is
+// the serial loop cInstanceBuilder replaced, a std::unordered_map lookup per instance and a material instance
+// for every new material.
+static void BenchmarkInstanceBuilder(cContext* context)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<f32> distribution(-1.0f, 1.0f);
+
+    std::vector<cMaterial*> materialList(kInstanceMaterialCount);
+    for (auto& material : materialList)
+        material = context->Create<cMaterial>(context, nullptr, glm::vec4(distribution(random)), glm::vec4(distribution(random)), nullptr);
+
+    std::vector<glm::mat4> worlds(kInstanceCount);
+    std::vector<cMaterial*> materials(kInstanceCount);
+    for (usize i = 0; i < kInstanceCount; i++)
+    {
+        worlds[i] = glm::translate(glm::mat4(1.0f), glm::vec3(distribution(random), distribution(random), distribution(random)) * 100.0f);
+        materials[i] = materialList[random() % kInstanceMaterialCount];
+    }
+
+    cInstanceBuilder* builder = context->Create<cInstanceBuilder>(context, kInstanceMaterialCount);
+    std::vector<sRenderInstance> instances(kInstanceCount, sRenderInstance(-1, cTransform()));
+    std::vector<cMaterialInstance> materialInstances(kInstanceMaterialCount, cMaterialInstance(-1, materialList[0]));
+    const f64 buildTime = MeasureBest([]() {}, [&]() {
+        builder->Build(worlds.data(), materials.data(), nullptr, kInstanceCount, instances.data(), materialInstances.data());
+    });
+
+    std::vector<sRenderInstance> referenceInstances(kInstanceCount, sRenderInstance(-1, cTransform()));
+    std::vector<cMaterialInstance> referenceMaterialInstances(kInstanceMaterialCount, cMaterialInstance(-1, materialList[0]));
+    std::unordered_map<cMaterial*, s32> materialsMap;
+    const f64 referenceTime = MeasureBest([&]() {
+        materialsMap.clear();
+    }, [&]() {
+        for (usize i = 0; i < kInstanceCount; i++)
+        {
+            s32 materialIndex = -1;
+            auto it = materialsMap.find(materials[i]);
+            if (it == materialsMap.end())
+            {
+                materialIndex = (s32)materialsMap.size();
+                materialsMap.insert({ materials[i], materialIndex });
+                referenceMaterialInstances[materialIndex] = cMaterialInstance(materialIndex, materials[i]);
+            }
+            else
+            {
+                materialIndex = it->second;
+            }
+
+            referenceInstances[i]._materialIndex = materialIndex;
+            referenceInstances[i]._world = cMatrix4(worlds[i]);
+        }
+    });
+
+    f32 maxError = 0.0f;
+    for (usize i = 0; i < kInstanceCount; i++)
+        maxError = glm::max(maxError, GetMaxDifference(instances[i]._world.GetData(), referenceInstances[i]._world.GetData(), 16));
+
+    const cThread* threads = context->GetSubsystem<cThread>();
+    std::cout << "instance builder, " << kInstanceCount << " instances, " << (threads != nullptr ? threads->GetThreadCount() : 0) << " worker threads: Build "
+        << buildTime << " ms, " << builder->GetMaterialCount() << " materials, plain loop " << referenceTime << " ms, " << materialsMap.size()
+        << " materials, max difference " << maxError << std::endl;
+
+    context->Destroy<cInstanceBuilder>(builder);
+    for (auto material : materialList)
+        context->Destroy<cMaterial>(material);
+}
+
+int main()
+{
+    sCapabilities caps = {};
+    caps.headlessGraphics = K_TRUE;
+    caps.maxTransformCount = kTransformNodeCount;
+    caps.maxCullingObjectCount = kCullingObjectCount;
+
+    cContext context;
+    context.CreateMemoryAllocator();
+    context.RegisterFactory<cTransformHierarchy>();
+    context.RegisterFactory<cCullingBounds>();
+    context.RegisterFactory<cFrustumCulling>();
+    context.RegisterFactory<cDrawList>();
+    context.RegisterFactory<cInstanceBuilder>();
+    context.RegisterFactory<cMaterial>();
+
+    // The engine is only there for the capabilities, it never runs Initialize
+    cBenchmarkApplication* application = new cBenchmarkApplication(&context, &caps);
+    cEngine* engine = new cEngine(&context, application);
+    context.RegisterSubsystem(engine);
+
+    BenchmarkTransformHierarchy(&context);
+    BenchmarkMath();
+    BenchmarkFrustumCulling(&context);
+    BenchmarkDrawList(&context);
+    BenchmarkInstanceBuilder(&context);
+
+    // Registered last, the benchmarks above run on the calling thread only
+    cThread* threads = new cThread(&context);
+    context.RegisterSubsystem(threads);
+    BenchmarkInstanceBuilder(&context);
+
+    delete threads;
+    delete engine;
+    delete application;
+
+    return 0;
+}
\ No newline at end of file
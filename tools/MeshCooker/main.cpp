@@ -0,0 +1,459 @@
+// main.cpp
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/mesh.h>
+#include <assimp/postprocess.h>
+#include "mesh_file.hpp"
+#include "mesh_optimizer.hpp"
+#include "vertex_format.hpp"
+#include "culling_system.hpp"
+#include "graphics.hpp"
+#include "math.hpp"
+#include "filesystem_manager.hpp"
+#include "category.hpp"
+#include "types.hpp"
+
+using namespace triton;
+using namespace types;
+
+// Converts every fbx/dae model in a directory (runtime/data/models by default) into a .tmesh file
+// next to it. All meshes of a scene are pre-transformed into one vertex/index blob, each aiMesh
+// becomes a submesh. --vertex16 and --vertex12 write the compressed vertex formats instead of the
+// 32 byte one. Run with --benchmark to compare the Assimp import against a mapped load.
+
+static constexpr u32 kImportFlags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_PreTransformVertices | aiProcess_GenSmoothNormals;
+
+struct sCookedVertex
+{
+    f32 position[3];
+    f32 texcoord[2];
+    f32 normal[3];
+};
+
+static usize Align(usize value, usize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static boolean IsModelFile(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    for (char& c : extension)
+        c = (char)std::tolower((unsigned char)c);
+
+    return extension == ".fbx" || extension == ".dae" ? K_TRUE : K_FALSE;
+}
+
+// Reorders each submesh for the post-transform cache and overdraw, then lays out vertices in fetch order.
+// Submeshes keep their index ranges, their vertex ranges shrink to what they reference.
+static void Optimize(std::vector<sCookedVertex>& vertices, std::vector<u32>& indices, std::vector<sMeshFileSubmesh>& submeshes)
+{
+    const sVertexCacheStats before = cMeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    for (const sMeshFileSubmesh& submesh : submeshes)
+    {
+        u32* submeshIndices = &indices[submesh.firstIndex];
+        cMeshOptimizer::OptimizeVertexCache(submeshIndices, submeshIndices, submesh.indexCount, vertices.size());
+        cMeshOptimizer::OptimizeOverdraw(submeshIndices, submeshIndices, submesh.indexCount, vertices[0].position, sizeof(sCookedVertex), vertices.size());
+    }
+
+    std::vector<sCookedVertex> fetchOrdered(vertices.size());
+    const usize vertexCount = cMeshOptimizer::OptimizeVertexFetch(fetchOrdered.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(sCookedVertex));
+    fetchOrdered.resize(vertexCount);
+    vertices.swap(fetchOrdered);
+
+    for (sMeshFileSubmesh& submesh : submeshes)
+    {
+        u32 firstVertex = 0xFFFFFFFF;
+        u32 lastVertex = 0;
+        for (u32 i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; i++)
+        {
+            firstVertex = std::min(firstVertex, indices[i]);
+            lastVertex = std::max(lastVertex, indices[i]);
+        }
+
+        submesh.firstVertex = submesh.indexCount > 0 ? firstVertex : 0;
+        submesh.vertexCount = submesh.indexCount > 0 ? lastVertex - firstVertex + 1 : 0;
+    }
+
+    const sVertexCacheStats after = cMeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    std::cout << "Vertex cache ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+// Every LOD halves the triangle count of the previous one and is simplified from LOD 0, so the stored error is
+// measured against the full mesh. Generation stops when the error passes kMaxLodError of the bounding radius.
+static constexpr f32 kMaxLodError = 0.05f;
+
+static void GenerateLods(const std::vector<sCookedVertex>& vertices, std::vector<u32>& indices, sMeshFileHeader& header)
+{
+    const usize fullIndexCount = indices.size();
+    std::vector<u32> lodIndices(fullIndexCount);
+
+    header.lodCount = 1;
+    header.lods[0] = { 0, (u32)fullIndexCount, 0.0f, 0 };
+
+    usize previousIndexCount = fullIndexCount;
+    while (header.lodCount < kMeshFileMaxLodCount)
+    {
+        f32 error = 0.0f;
+        const usize indexCount = cMeshOptimizer::Simplify(
+            lodIndices.data(),
+            indices.data(),
+            fullIndexCount,
+            vertices[0].position,
+            sizeof(sCookedVertex),
+            vertices.size(),
+            previousIndexCount / 2,
+            header.boundingSphere[3] * kMaxLodError,
+            &error
+        );
+
+        // Borders and the error limit can stop the simplifier early, a LOD that barely shrinks isn't worth its memory
+        if (indexCount == 0 || indexCount > previousIndexCount * 3 / 4)
+            break;
+
+        cMeshOptimizer::OptimizeVertexCache(lodIndices.data(), lodIndices.data(), indexCount, vertices.size());
+
+        header.lods[header.lodCount] = { (u32)indices.size(), (u32)indexCount, error, 0 };
+        header.lodCount += 1;
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.begin() + indexCount);
+        previousIndexCount = indexCount;
+
+        std::cout << "LOD " << header.lodCount - 1 << ": " << indexCount / 3 << " triangles (" << (fullIndexCount - indexCount) / 3 << " saved), error " << error << std::endl;
+    }
+}
+
+static boolean Cook(const std::filesystem::path& sourcePath, const std::filesystem::path& cookedPath, eCategory vertexFormat)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(sourcePath.string(), kImportFlags);
+    if (scene == nullptr || scene->mNumMeshes == 0)
+    {
+        std::cout << "Error: can't import '" << sourcePath.string() << "', " << importer.GetErrorString() << std::endl;
+        return K_FALSE;
+    }
+
+    std::vector<sCookedVertex> vertices;
+    std::vector<u32> indices;
+    std::vector<sMeshFileSubmesh> submeshes;
+    sMeshFileHeader header = {};
+
+    for (usize i = 0; i < 3; i++)
+    {
+        header.aabbMin[i] = FLT_MAX;
+        header.aabbMax[i] = -FLT_MAX;
+    }
+
+    for (u32 m = 0; m < scene->mNumMeshes; m++)
+    {
+        const aiMesh* mesh = scene->mMeshes[m];
+        if ((mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0)
+            continue;
+
+        sMeshFileSubmesh submesh = {};
+        submesh.firstIndex = (u32)indices.size();
+        submesh.firstVertex = (u32)vertices.size();
+        submesh.vertexCount = mesh->mNumVertices;
+        for (usize i = 0; i < 3; i++)
+        {
+            submesh.aabbMin[i] = FLT_MAX;
+            submesh.aabbMax[i] = -FLT_MAX;
+        }
+
+        for (u32 v = 0; v < mesh->mNumVertices; v++)
+        {
+            const aiVector3D position = mesh->mVertices[v];
+            const aiVector3D texcoord = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][v] : aiVector3D(0.0f, 0.0f, 0.0f);
+            const aiVector3D normal = mesh->HasNormals() ? mesh->mNormals[v] : aiVector3D(0.0f, 1.0f, 0.0f);
+
+            const sCookedVertex vertex = {
+                { position.x, position.y, position.z },
+                { texcoord.x, texcoord.y },
+                { normal.x, normal.y, normal.z }
+            };
+            vertices.push_back(vertex);
+
+            for (usize i = 0; i < 3; i++)
+            {
+                submesh.aabbMin[i] = std::fmin(submesh.aabbMin[i], vertex.position[i]);
+                submesh.aabbMax[i] = std::fmax(submesh.aabbMax[i], vertex.position[i]);
+            }
+        }
+
+        // Triangulate leaves points and lines of mixed meshes as they are, only faces with 3 indices go in
+        for (u32 f = 0; f < mesh->mNumFaces; f++)
+        {
+            const aiFace& face = mesh->mFaces[f];
+            if (face.mNumIndices != 3)
+                continue;
+
+            for (u32 j = 0; j < 3; j++)
+                indices.push_back(submesh.firstVertex + face.mIndices[j]);
+        }
+
+        submesh.indexCount = (u32)indices.size() - submesh.firstIndex;
+        submeshes.push_back(submesh);
+
+        for (usize i = 0; i < 3; i++)
+        {
+            header.aabbMin[i] = std::fmin(header.aabbMin[i], submesh.aabbMin[i]);
+            header.aabbMax[i] = std::fmax(header.aabbMax[i], submesh.aabbMax[i]);
+        }
+    }
+
+    if (vertices.empty() || indices.empty())
+    {
+        std::cout << "Error: '" << sourcePath.string() << "' has no triangles" << std::endl;
+        return K_FALSE;
+    }
+
+    Optimize(vertices, indices, submeshes);
+
+    // Per submesh so no meshlet straddles two of them, built before the LODs are appended
+    std::vector<sMeshlet> meshlets;
+    for (const sMeshFileSubmesh& submesh : submeshes)
+    {
+        const usize first = meshlets.size();
+        meshlets.resize(first + cMeshOptimizer::GetMaxMeshletCount(submesh.indexCount));
+        const usize count = cMeshOptimizer::BuildMeshlets(&meshlets[first], &indices[submesh.firstIndex], submesh.indexCount, vertices[0].position, sizeof(sCookedVertex), vertices.size());
+        meshlets.resize(first + count);
+        for (usize i = first; i < meshlets.size(); i++)
+            meshlets[i].firstIndex += submesh.firstIndex;
+    }
+
+    // Same bounding sphere as cGraphics::CreateGeometry builds, centered on the box
+    f32 radiusSquared = 0.0f;
+    for (usize i = 0; i < 3; i++)
+        header.boundingSphere[i] = (header.aabbMin[i] + header.aabbMax[i]) * 0.5f;
+    for (const sCookedVertex& vertex : vertices)
+    {
+        const f32 dx = vertex.position[0] - header.boundingSphere[0];
+        const f32 dy = vertex.position[1] - header.boundingSphere[1];
+        const f32 dz = vertex.position[2] - header.boundingSphere[2];
+        radiusSquared = std::fmax(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    header.boundingSphere[3] = std::sqrt(radiusSquared);
+
+    GenerateLods(vertices, indices, header);
+
+    const glm::vec3 aabbMin = glm::vec3(header.aabbMin[0], header.aabbMin[1], header.aabbMin[2]);
+    const glm::vec3 aabbMax = glm::vec3(header.aabbMax[0], header.aabbMax[1], header.aabbMax[2]);
+    if (IsVertexPositionInRange(vertexFormat, aabbMin) == K_FALSE || IsVertexPositionInRange(vertexFormat, aabbMax) == K_FALSE)
+    {
+        std::cout << "Warning: '" << sourcePath.string() << "' exceeds the half float position range, cooking it with 32 byte vertices" << std::endl;
+        vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3;
+    }
+
+    const usize vertexStride = GetVertexFormatStride(vertexFormat);
+    std::vector<u8> encodedVertices(vertices.size() * vertexStride);
+    for (usize i = 0; i < vertices.size(); i++)
+    {
+        const sCookedVertex& vertex = vertices[i];
+        EncodeVertex(
+            vertexFormat,
+            glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]),
+            glm::vec2(vertex.texcoord[0], vertex.texcoord[1]),
+            glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]),
+            &encodedVertices[i * vertexStride]
+        );
+    }
+
+    header.vertexFormat = (u32)vertexFormat;
+    header.vertexStride = (u32)vertexStride;
+    header.vertexCount = (u32)vertices.size();
+    header.indexCount = (u32)indices.size();
+    header.submeshCount = (u32)submeshes.size();
+    header.meshletCount = (u32)meshlets.size();
+    header.meshletOffset = Align(sizeof(sMeshFileHeader) + submeshes.size() * sizeof(sMeshFileSubmesh), kMeshFileAlignment);
+    header.vertexOffset = Align(header.meshletOffset + meshlets.size() * sizeof(sMeshlet), kMeshFileAlignment);
+    header.vertexByteSize = encodedVertices.size();
+    header.indexOffset = Align(header.vertexOffset + header.vertexByteSize, kMeshFileAlignment);
+    header.indexByteSize = indices.size() * sizeof(u32);
+    header.fileByteSize = header.indexOffset + header.indexByteSize;
+
+    std::vector<u8> file(header.fileByteSize, 0);
+    std::memcpy(&file[0], &header, sizeof(sMeshFileHeader));
+    std::memcpy(&file[sizeof(sMeshFileHeader)], submeshes.data(), submeshes.size() * sizeof(sMeshFileSubmesh));
+    if (meshlets.empty() == false)
+        std::memcpy(&file[header.meshletOffset], meshlets.data(), meshlets.size() * sizeof(sMeshlet));
+    std::memcpy(&file[header.vertexOffset], encodedVertices.data(), header.vertexByteSize);
+    std::memcpy(&file[header.indexOffset], indices.data(), header.indexByteSize);
+
+    std::ofstream stream(cookedPath, std::ios::binary);
+    stream.write((const char*)file.data(), (std::streamsize)file.size());
+    if (!stream)
+    {
+        std::cout << "Error: can't write '" << cookedPath.string() << "'" << std::endl;
+        return K_FALSE;
+    }
+
+    std::cout << sourcePath.filename().string() << " -> " << cookedPath.filename().string() << ": "
+        << submeshes.size() << " submeshes, " << vertices.size() << " vertices, " << header.lods[0].indexCount / 3 << " triangles, " << header.lodCount << " LODs, " << meshlets.size() << " meshlets" << std::endl;
+
+    return K_TRUE;
+}
+
+// Old path is what cGraphics::CreateModel did, import and copy positions, texcoords, normals and indices into
+// arrays. New path maps the cooked file and reads the blobs in place, the sum is there so the page faults
+// aren't skipped.
+static void Benchmark(const std::filesystem::path& sourcePath, const std::filesystem::path& cookedPath, usize iterationCount)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    f64 importSeconds = 0.0;
+    f64 mappedSeconds = 0.0;
+    f32 checksum = 0.0f;
+
+    for (usize iteration = 0; iteration < iterationCount; iteration++)
+    {
+        const auto importStart = clock::now();
+        {
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(sourcePath.string(), kImportFlags);
+            std::vector<sCookedVertex> vertices;
+            std::vector<u32> indices;
+            for (u32 m = 0; scene != nullptr && m < scene->mNumMeshes; m++)
+            {
+                const aiMesh* mesh = scene->mMeshes[m];
+                const u32 firstVertex = (u32)vertices.size();
+                for (u32 v = 0; v < mesh->mNumVertices; v++)
+                {
+                    const aiVector3D position = mesh->mVertices[v];
+                    const aiVector3D texcoord = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][v] : aiVector3D(0.0f, 0.0f, 0.0f);
+                    const aiVector3D normal = mesh->HasNormals() ? mesh->mNormals[v] : aiVector3D(0.0f, 1.0f, 0.0f);
+                    vertices.push_back({ { position.x, position.y, position.z }, { texcoord.x, texcoord.y }, { normal.x, normal.y, normal.z } });
+                }
+                for (u32 f = 0; f < mesh->mNumFaces; f++)
+                {
+                    const aiFace& face = mesh->mFaces[f];
+                    for (u32 i = 0; i < face.mNumIndices; i++)
+                        indices.push_back(firstVertex + face.mIndices[i]);
+                }
+            }
+            checksum += vertices.empty() ? 0.0f : vertices.back().position[0] + vertices.back().normal[1];
+            checksum += indices.empty() ? 0.0f : (f32)indices.back();
+        }
+        importSeconds += std::chrono::duration<f64>(clock::now() - importStart).count();
+
+        const auto mappedStart = clock::now();
+        {
+            cMappedFile file(nullptr);
+            if (file.Open(cookedPath.string()) == K_TRUE && IsMeshFileValid(file.GetData(), file.GetByteSize()) == K_TRUE)
+            {
+                const sMeshFileHeader* header = (const sMeshFileHeader*)file.GetData();
+                const u8* vertices = (const u8*)GetMeshFileVertices(file.GetData());
+                const u8* indices = (const u8*)GetMeshFileIndices(file.GetData());
+                for (u64 offset = 0; offset < header->vertexByteSize; offset += 4096)
+                    checksum += (f32)vertices[offset];
+                for (u64 offset = 0; offset < header->indexByteSize; offset += 4096)
+                    checksum += (f32)indices[offset];
+            }
+        }
+        mappedSeconds += std::chrono::duration<f64>(clock::now() - mappedStart).count();
+    }
+
+    std::cout << sourcePath.filename().string() << ": assimp " << importSeconds * 1000.0 / (f64)iterationCount
+        << " ms, mapped " << mappedSeconds * 1000.0 / (f64)iterationCount << " ms (" << checksum << ")" << std::endl;
+}
+
+// A 32x32 grid of instances seen from its edge, so part of it is outside the frustum and every instance shows
+// its back faces. Compares the triangles cluster culling keeps for a back face culled pass against drawing every
+// instance whole.
+static void BenchmarkClusterCulling(const std::filesystem::path& cookedPath, usize iterationCount)
+{
+    using clock = std::chrono::high_resolution_clock;
+    static constexpr usize kGridSize = 32;
+
+    cMappedFile file(nullptr);
+    if (file.Open(cookedPath.string()) == K_FALSE || IsMeshFileValid(file.GetData(), file.GetByteSize()) == K_FALSE)
+        return;
+
+    const sMeshFileHeader* header = (const sMeshFileHeader*)file.GetData();
+    sVertexBufferGeometry geometry = {};
+    geometry._indexCount = header->lods[0].indexCount;
+    geometry._meshlets = (sMeshlet*)GetMeshFileMeshlets(file.GetData());
+    geometry._meshletCount = header->meshletCount;
+
+    const f32 spacing = header->boundingSphere[3] * 3.0f;
+    std::vector<const sVertexBufferGeometry*> geometries(kGridSize * kGridSize, &geometry);
+    std::vector<glm::mat4> worlds(kGridSize * kGridSize);
+    for (usize i = 0; i < worlds.size(); i++)
+        worlds[i] = glm::translate(glm::mat4(1.0f), glm::vec3((f32)(i % kGridSize) * spacing, 0.0f, -(f32)(i / kGridSize) * spacing));
+
+    const glm::vec3 cameraPosition = glm::vec3(-spacing, spacing, spacing);
+    const cMatrix4 viewProjection = cMatrix4(60.0f, 16.0f / 9.0f, 0.1f, spacing * (f32)kGridSize * 2.0f) *
+        cMatrix4(cVector3(cameraPosition.x, cameraPosition.y, cameraPosition.z), cVector3(0.7f, -0.2f, -0.7f), cVector3(0.0f, 1.0f, 0.0f));
+
+    cClusterCulling culling(nullptr);
+    std::vector<sDrawIndirectCommand> commands(geometries.size() * (header->meshletCount + 1));
+    usize commandCount = 0;
+
+    const auto start = clock::now();
+    for (usize iteration = 0; iteration < iterationCount; iteration++)
+        commandCount = culling.Cull(geometries.data(), worlds.data(), nullptr, geometries.size(), viewProjection, cameraPosition, K_TRUE, commands.data(), commands.size());
+    const f64 seconds = std::chrono::duration<f64>(clock::now() - start).count();
+
+    std::cout << cookedPath.filename().string() << ": cluster culling " << seconds * 1000.0 / (f64)iterationCount << " ms for "
+        << culling.GetTestedMeshletCount() << " meshlets, " << culling.GetVisibleMeshletCount() << " visible in " << commandCount << " draws, "
+        << culling.GetVisibleTriangleCount() << " of " << geometries.size() * geometry._indexCount / 3 << " triangles" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path directory = "data/models";
+    boolean benchmark = K_FALSE;
+    eCategory vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_VEC3_VEC2_VEC3;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--benchmark") == 0)
+            benchmark = K_TRUE;
+        else if (std::strcmp(argv[i], "--vertex16") == 0)
+            vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_TEX_NRM_HALF4_UNORM2_OCT2;
+        else if (std::strcmp(argv[i], "--vertex12") == 0)
+            vertexFormat = eCategory::VERTEX_BUFFER_FORMAT_POS_NRM_TEX_HALF3_OCT2_UNORM2;
+        else
+            directory = argv[i];
+    }
+
+    if (!std::filesystem::is_directory(directory))
+    {
+        std::cout << "Usage: TritonMeshCooker [--benchmark] [--vertex16 | --vertex12] [models directory]" << std::endl;
+        return 1;
+    }
+
+    int result = 0;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory))
+    {
+        if (!entry.is_regular_file() || IsModelFile(entry.path()) == K_FALSE)
+            continue;
+
+        std::filesystem::path cookedPath = entry.path();
+        cookedPath.replace_extension(".tmesh");
+
+        if (Cook(entry.path(), cookedPath, vertexFormat) == K_FALSE)
+        {
+            result = 1;
+            continue;
+        }
+
+        if (benchmark == K_TRUE)
+        {
+            Benchmark(entry.path(), cookedPath, 16);
+            BenchmarkClusterCulling(cookedPath, 16);
+        }
+    }
+
+    return result;
+}
\ No newline at end of file